@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/box_geometry.h>
+
+#include <iostream>
+
+using namespace three;
+
+// Culling, sorting and recording 100k objects serially and on the worker
+// threads, against a GL that does nothing. Run with
+// --gtest_also_run_disabled_tests.
+
+namespace {
+
+struct Sample {
+  double culling;   // ms per frame
+  double recording; // ms per frame
+  int drawn;
+};
+
+Sample cullBoxes( int workerThreads, int frames ) {
+
+  auto renderer = stub::renderer( workerThreads );
+
+  auto scene = Scene::create();
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 10000 );
+  camera->position().z = 2000;
+
+  auto geometry = BoxGeometry::create( 1, 1, 1 );
+  auto material = MeshBasicMaterial::create();
+
+  for ( int i = 0; i < 100000; ++i ) {
+    auto mesh = Mesh::create( geometry, material );
+    mesh->position().set( ( float )( i % 400 ) * 10 - 2000, ( float )( i / 400 ) * 10 - 1250, 0 );
+    scene->add( mesh );
+  }
+
+  renderer->render( *scene, *camera );
+
+  Sample sample = { 0, 0, renderer->info().render.objectsDrawn };
+
+  for ( int frame = 0; frame < frames; ++frame ) {
+    renderer->render( *scene, *camera );
+    sample.culling += renderer->info().time.culling / frames;
+    sample.recording += renderer->info().time.recording / frames;
+  }
+
+  return sample;
+
+}
+
+} // namespace
+
+TEST(benchmark_culling_test, DISABLED_cull100k) {
+
+  const auto serial = cullBoxes( 0, 20 );
+  const auto parallel = cullBoxes( -1, 20 );
+
+  EXPECT_EQ( serial.drawn, parallel.drawn );
+
+  std::cout << "[    BENCH ] cull 100k - " << serial.drawn << " drawn"
+            << " - serial " << serial.culling << " ms culling, " << serial.recording << " ms recording"
+            << " - parallel " << parallel.culling << " ms culling, " << parallel.recording << " ms recording"
+            << std::endl;
+
+}
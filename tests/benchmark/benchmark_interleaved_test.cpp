@@ -0,0 +1,98 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/sphere_geometry.h>
+
+#include <chrono>
+#include <iostream>
+
+using namespace three;
+
+// Separate versus interleaved vertex buffers, against a GL that does
+// nothing: what is measured is the renderer's own packing and the number
+// of calls it issues, not what the driver or GPU make of the layout.
+// Run with --gtest_also_run_disabled_tests.
+
+namespace {
+
+struct Sample {
+  double milliseconds;
+  long callsPerFrame;
+};
+
+Sample renderSpheres( bool interleaved, bool dynamic, int frames ) {
+
+  auto renderer = stub::renderer();
+  renderer->sortObjects = false;
+
+  auto scene = Scene::create();
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 1000 );
+
+  std::vector<Geometry::Ptr> geometries;
+
+  for ( int i = 0; i < 16; ++i ) {
+    auto geometry = SphereGeometry::create( 50, 64, 64 );
+    geometry->interleaved = interleaved;
+    geometry->dynamic = dynamic;
+    scene->add( Mesh::create( geometry, MeshBasicMaterial::create() ) );
+    geometries.push_back( geometry );
+  }
+
+  renderer->render( *scene, *camera );
+
+  const auto calls = stub::calls();
+  const auto start = std::chrono::high_resolution_clock::now();
+
+  for ( int frame = 0; frame < frames; ++frame ) {
+
+    for ( auto& geometry : geometries ) {
+      geometry->verticesNeedUpdate = dynamic;
+      geometry->normalsNeedUpdate = dynamic;
+    }
+
+    renderer->render( *scene, *camera );
+
+  }
+
+  const auto elapsed = std::chrono::high_resolution_clock::now() - start;
+
+  return Sample {
+    std::chrono::duration<double, std::milli>( elapsed ).count(),
+    ( stub::calls() - calls ) / frames
+  };
+
+}
+
+void report( const char* name, const Sample& separate, const Sample& interleaved ) {
+
+  std::cout << "[    BENCH ] " << name
+            << " - separate " << separate.milliseconds << " ms, " << separate.callsPerFrame << " calls/frame"
+            << " - interleaved " << interleaved.milliseconds << " ms, " << interleaved.callsPerFrame << " calls/frame"
+            << std::endl;
+
+}
+
+} // namespace
+
+TEST(benchmark_interleaved_test, DISABLED_upload) {
+
+  const auto separate = renderSpheres( false, true, 100 );
+  const auto interleaved = renderSpheres( true, true, 100 );
+
+  report( "upload", separate, interleaved );
+
+}
+
+TEST(benchmark_interleaved_test, DISABLED_draw) {
+
+  const auto separate = renderSpheres( false, false, 1000 );
+  const auto interleaved = renderSpheres( true, false, 1000 );
+
+  report( "draw", separate, interleaved );
+
+}
@@ -0,0 +1,130 @@
+#include "gtest/gtest.h"
+
+#include <three/core/object3d.h>
+
+#include <chrono>
+#include <random>
+#include <iostream>
+#include <vector>
+
+using namespace three;
+
+// Moving every one of about a million objects, in a tree four levels deep,
+// and updating their world matrices. Run with
+// --gtest_also_run_disabled_tests.
+
+TEST(benchmark_transform_test, DISABLED_update1M) {
+
+  auto root = Object3D::create();
+  std::vector<Object3D::Ptr> objects;
+  objects.reserve( 1000000 );
+
+  // 100 under the root, 100 under each of those and 98 under each of theirs
+
+  for ( int i = 0; i < 100; ++i ) {
+    auto a = Object3D::create();
+    root->add( a );
+    objects.push_back( a );
+    for ( int j = 0; j < 100; ++j ) {
+      auto b = Object3D::create();
+      a->add( b );
+      objects.push_back( b );
+      for ( int k = 0; k < 98; ++k ) {
+        auto c = Object3D::create();
+        b->add( c );
+        objects.push_back( c );
+      }
+    }
+  }
+
+  root->updateMatrixWorld();
+
+  const int frames = 10;
+  double moving = 0, idle = 0;
+
+  for ( int frame = 0; frame < frames; ++frame ) {
+
+    for ( auto& object : objects ) object->position().y = ( float )frame;
+
+    auto start = std::chrono::steady_clock::now();
+    root->updateMatrixWorld();
+    moving += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() / frames;
+
+    start = std::chrono::steady_clock::now();
+    root->updateMatrixWorld();
+    idle += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() / frames;
+
+  }
+
+  EXPECT_FLOAT_EQ( 3.f * ( frames - 1 ), objects.back()->matrixWorld.elements[ 13 ] );
+
+  std::cout << "[    BENCH ] update " << objects.size() << " objects"
+            << " - " << moving << " ms all moving, " << idle << " ms none moving"
+            << std::endl;
+
+}
+
+// The same tree, with some of the leaves moving to other parents each frame
+// as all of the objects animate
+
+TEST(benchmark_transform_test, DISABLED_reparent1M) {
+
+  auto root = Object3D::create();
+  std::vector<Object3D::Ptr> objects, parents;
+  objects.reserve( 1000000 );
+
+  for ( int i = 0; i < 100; ++i ) {
+    auto a = Object3D::create();
+    root->add( a );
+    objects.push_back( a );
+    for ( int j = 0; j < 100; ++j ) {
+      auto b = Object3D::create();
+      a->add( b );
+      objects.push_back( b );
+      parents.push_back( b );
+      for ( int k = 0; k < 98; ++k ) {
+        auto c = Object3D::create();
+        b->add( c );
+        objects.push_back( c );
+      }
+    }
+  }
+
+  root->updateMatrixWorld();
+
+  std::mt19937 random( 7 );
+
+  const int frames = 10;
+
+  for ( int moves : { 10, 1000 } ) {
+
+    double reparenting = 0, updating = 0;
+
+    for ( int frame = 0; frame < frames; ++frame ) {
+
+      for ( auto& object : objects ) object->position().y = ( float )frame;
+
+      auto start = std::chrono::steady_clock::now();
+
+      for ( int i = 0; i < moves; ++i ) {
+        auto& leaf = objects[ random() % objects.size() ];
+        if ( leaf->children.empty() ) parents[ random() % parents.size() ]->add( leaf );
+      }
+
+      reparenting += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() / frames;
+
+      start = std::chrono::steady_clock::now();
+      root->updateMatrixWorld();
+      updating += std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() / frames;
+
+    }
+
+    EXPECT_FLOAT_EQ( 3.f * ( frames - 1 ), objects.back()->matrixWorld.elements[ 13 ] );
+
+    std::cout << "[    BENCH ] reparent " << moves << " of " << objects.size() << " objects per frame"
+              << " - " << reparenting << " ms reparenting, " << updating << " ms updating"
+              << std::endl;
+
+  }
+
+}
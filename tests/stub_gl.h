@@ -0,0 +1,73 @@
+#ifndef THREE_TESTS_STUB_GL_H
+#define THREE_TESTS_STUB_GL_H
+
+#include <three/gl.h>
+#include <three/renderers/gl_renderer.h>
+#include <three/renderers/renderer_parameters.h>
+
+#include <map>
+#include <string>
+
+// A GLInterface whose functions do nothing but count how often they were
+// called, so that the renderer can be driven without a context, and a
+// renderer on it.
+
+namespace three {
+namespace stub {
+
+inline long& calls() { static long c = 0; return c; }
+
+template < typename R, typename... A >
+R APIENTRY noop( A... ) { ++ calls(); return R(); }
+
+template < typename R, typename... A >
+R ( APIENTRY* noopFor( R ( APIENTRY* )( A... ) ) )( A... ) { return &noop<R, A...>; }
+
+inline void APIENTRY genNames( GLsizei n, GLuint* names ) { static GLuint next = 1; for ( GLsizei i = 0; i < n; ++i ) names[ i ] = next++; }
+inline GLuint APIENTRY createName() { static GLuint next = 1; return next++; }
+inline void APIENTRY getOk( GLuint, GLenum, GLint* p ) { *p = 1; }
+inline void APIENTRY getInt( GLenum, GLint* p ) { *p = 16; }
+inline void APIENTRY getFloat( GLenum, GLfloat* p ) { *p = 1; }
+inline const GLubyte* APIENTRY getString( GLenum name ) {
+  return reinterpret_cast<const GLubyte*>( name == GL_VERSION ? "3.3.0" : "" );
+}
+inline GLint APIENTRY uniformLocation( GLuint, const GLchar* ) { return -1; }
+inline GLint APIENTRY attribLocation( GLuint, const GLchar* name ) {
+  static std::map<std::string, GLint> names;
+  auto it = names.find( name );
+  if ( it != names.end() ) return it->second;
+  const GLint loc = ( GLint )names.size();
+  names[ name ] = loc;
+  return loc;
+}
+
+inline GLInterface gl() {
+  GLInterface gl;
+#define GL_FUNC_DECL(PFUNC, FUNC) gl.FUNC = noopFor( ( PFUNC )nullptr );
+#define GL_FUNC_EXT_DECL(PFUNC, FUNC) GL_FUNC_DECL(PFUNC, FUNC)
+#define GL_FUNC_OPT_DECL(PFUNC, FUNC)
+#include "three/gl_functions.h"
+#undef GL_FUNC_DECL
+#undef GL_FUNC_EXT_DECL
+#undef GL_FUNC_OPT_DECL
+  gl.GenBuffers = genNames; gl.GenTextures = genNames; gl.GenFramebuffers = genNames; gl.GenRenderbuffers = genNames;
+  gl.CreateProgram = createName; gl.CreateShader = []( GLenum ) -> GLuint { return createName(); };
+  gl.GetShaderiv = getOk; gl.GetProgramiv = getOk;
+  gl.GetIntegerv = getInt; gl.GetFloatv = getFloat;
+  gl.GetString = getString;
+  gl.GetUniformLocation = uniformLocation; gl.GetAttribLocation = attribLocation;
+  return gl;
+}
+
+// Without a stream buffer, as the stub maps none
+inline GLRenderer::Ptr renderer( int workerThreads = -1, const GLInterface& functions = gl() ) {
+  RendererParameters parameters;
+  parameters.streamBufferSize = 0;
+  parameters.workerThreads = workerThreads;
+  return GLRenderer::create( parameters, functions );
+}
+
+} // namespace stub
+} // namespace three
+
+#endif // THREE_TESTS_STUB_GL_H
@@ -0,0 +1,162 @@
+#include "gtest/gtest.h"
+
+#include <three/core/aabb_tree.h>
+#include <three/core/raycaster.h>
+#include <three/scenes/scene.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/box_geometry.h>
+
+#include <cmath>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+Box3 randomBox( std::mt19937& random ) {
+
+  std::uniform_real_distribution<float> position( -100.f, 100.f );
+  std::uniform_real_distribution<float> size( 0.1f, 5.f );
+
+  const Vector3 min( position( random ), position( random ), position( random ) );
+  return Box3( min, Vector3( min ).add( Vector3( size( random ), size( random ), size( random ) ) ) );
+
+}
+
+std::set<int> overlapping( const AABBTree& tree, const Box3& box ) {
+
+  std::set<int> found;
+
+  tree.query( [&box]( const Box3& node ) {
+    return node.isIntersectionBox( box ) ? AABBTree::Intersects : AABBTree::Outside;
+  }, [&found]( int proxy, bool ) {
+    found.insert( proxy );
+  } );
+
+  return found;
+
+}
+
+} // namespace
+
+TEST(core_aabb_tree_test, matchesBruteForce) {
+
+  std::mt19937 random( 7 );
+
+  AABBTree tree;
+  std::vector<int> proxies;
+
+  for ( int i = 0; i < 2000; ++i ) {
+    proxies.push_back( tree.insert( randomBox( random ), nullptr ) );
+  }
+
+  // move some far, some a little, and remove a quarter
+
+  for ( size_t i = 0; i < proxies.size(); i += 3 ) {
+    tree.move( proxies[ i ], randomBox( random ) );
+  }
+
+  for ( size_t i = 1; i < proxies.size(); i += 3 ) {
+    auto box = tree.fatBox( proxies[ i ] );
+    tree.move( proxies[ i ], box.expandByScalar( -0.01f ) );
+  }
+
+  std::vector<int> live;
+
+  for ( size_t i = 0; i < proxies.size(); ++i ) {
+    if ( i % 4 == 0 ) tree.remove( proxies[ i ] );
+    else live.push_back( proxies[ i ] );
+  }
+
+  EXPECT_EQ( live.size(), tree.size() );
+
+  // balanced to within a small factor of log2( n )
+
+  EXPECT_LE( tree.height(), 3 * ( int )std::ceil( std::log2( ( float )live.size() ) ) );
+
+  for ( int q = 0; q < 50; ++q ) {
+
+    const auto box = randomBox( random ).expandByScalar( 10.f );
+
+    std::set<int> expected;
+    for ( auto proxy : live ) {
+      if ( tree.fatBox( proxy ).isIntersectionBox( box ) ) expected.insert( proxy );
+    }
+
+    ASSERT_EQ( expected, overlapping( tree, box ) );
+
+  }
+
+}
+
+TEST(core_aabb_tree_test, smallMovesKeepLeaf) {
+
+  AABBTree tree;
+
+  const auto proxy = tree.insert( Box3( Vector3( 0, 0, 0 ), Vector3( 10, 10, 10 ) ), nullptr );
+
+  EXPECT_FALSE( tree.move( proxy, Box3( Vector3( 0.5f, 0, 0 ), Vector3( 10.5f, 10, 10 ) ) ) );
+  EXPECT_TRUE( tree.move( proxy, Box3( Vector3( 5, 0, 0 ), Vector3( 15, 10, 10 ) ) ) );
+
+  EXPECT_EQ( 1u, tree.size() );
+
+}
+
+TEST(core_aabb_tree_test, sceneAndRaycaster) {
+
+  auto scene = Scene::create();
+  auto geometry = BoxGeometry::create( 1, 1, 1 );
+  auto material = MeshBasicMaterial::create();
+
+  for ( int i = 0; i < 400; ++i ) {
+    auto mesh = Mesh::create( geometry, material );
+    mesh->position().set( ( float )( i % 20 ) * 3 - 30, ( float )( i / 20 ) * 3 - 30, 0 );
+    scene->add( mesh );
+  }
+
+  scene->updateMatrixWorld();
+  scene->updateBounds();
+
+  EXPECT_EQ( 400u, scene->__boundsTree.size() );
+
+  Raycaster raycaster( Vector3( 0, 0, 50 ), Vector3( 0, 0, -1 ) );
+
+  for ( int i = 0; i < 20; ++i ) {
+
+    raycaster.set( Vector3( ( float )i * 3 - 30, ( float )i * 3 - 30, 50 ), Vector3( 0, 0, -1 ) );
+
+    const auto expected = raycaster.intersectObjects( scene->children, true );
+    const auto found = raycaster.intersectScene( *scene );
+
+    ASSERT_EQ( expected.size(), found.size() );
+    ASSERT_FALSE( found.empty() );
+
+    for ( size_t j = 0; j < found.size(); ++j ) {
+      EXPECT_EQ( expected[ j ].object, found[ j ].object );
+      EXPECT_FLOAT_EQ( expected[ j ].distance, found[ j ].distance );
+    }
+
+  }
+
+  // moved and removed objects follow
+
+  auto moved = scene->children[ 0 ];
+  moved->position().set( 100, 100, 0 );
+  scene->remove( scene->children[ 1 ] );
+
+  scene->updateMatrixWorld();
+  scene->updateBounds();
+
+  EXPECT_EQ( 399u, scene->__boundsTree.size() );
+
+  raycaster.set( Vector3( 100, 100, 50 ), Vector3( 0, 0, -1 ) );
+
+  const auto found = raycaster.intersectScene( *scene );
+
+  ASSERT_FALSE( found.empty() );
+  EXPECT_EQ( moved.get(), found[ 0 ].object );
+
+}
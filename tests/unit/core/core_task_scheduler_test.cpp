@@ -0,0 +1,201 @@
+#include "gtest/gtest.h"
+
+#include <three/core/task_scheduler.h>
+#include <three/core/raycaster.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/sphere_geometry.h>
+
+#include <atomic>
+#include <vector>
+
+using namespace three;
+
+TEST(core_task_scheduler_test, runsEveryTask) {
+
+  auto scheduler = TaskScheduler::create( 3 );
+  EXPECT_EQ( 3u, scheduler->size() );
+
+  std::vector<int> results( 100, 0 );
+  std::vector<TaskScheduler::Task> tasks;
+
+  for ( size_t i = 0; i < results.size(); ++i ) {
+    tasks.emplace_back( [&results, i] { results[ i ] = ( int )i * 2; } );
+  }
+
+  // batches run back to back reuse the same workers
+
+  for ( int batch = 0; batch < 50; ++batch ) {
+    std::fill( results.begin(), results.end(), 0 );
+    scheduler->run( tasks );
+    for ( size_t i = 0; i < results.size(); ++i ) {
+      ASSERT_EQ( ( int )i * 2, results[ i ] );
+    }
+  }
+
+}
+
+TEST(core_task_scheduler_test, withoutWorkers) {
+
+  auto scheduler = TaskScheduler::create( 0 );
+
+  std::atomic<int> count( 0 );
+  std::vector<TaskScheduler::Task> tasks( 10, [&count] { ++count; } );
+
+  scheduler->run( tasks );
+  EXPECT_EQ( 10, count.load() );
+
+  TaskGroup group( nullptr );
+  group.run( [&count] { ++count; } );
+  EXPECT_EQ( 11, count.load() );
+
+}
+
+TEST(core_task_scheduler_test, nestedGroups) {
+
+  auto scheduler = TaskScheduler::create( 2 );
+
+  // tasks that wait for tasks of their own help run them instead of
+  // blocking the workers
+
+  std::atomic<int> count( 0 );
+  TaskGroup outer( scheduler.get() );
+
+  for ( int i = 0; i < 8; ++i ) {
+    outer.run( [&] {
+      TaskGroup inner( scheduler.get() );
+      for ( int j = 0; j < 8; ++j ) inner.run( [&count] { ++count; } );
+      inner.wait();
+    } );
+  }
+
+  outer.wait();
+  EXPECT_EQ( 64, count.load() );
+
+}
+
+TEST(core_task_scheduler_test, continuations) {
+
+  auto scheduler = TaskScheduler::create( 3 );
+
+  for ( int round = 0; round < 20; ++round ) {
+
+    std::atomic<int> count( 0 );
+    int seen = -1;
+
+    TaskGroup group( scheduler.get() );
+    for ( int i = 0; i < 16; ++i ) group.run( [&count] { ++count; } );
+    group.then( [&] { seen = count.load(); } );
+    group.wait();
+
+    ASSERT_EQ( 16, seen );
+
+  }
+
+  // with nothing left to wait for, a continuation runs straight away
+
+  int ran = 0;
+  TaskGroup group( scheduler.get() );
+  group.then( [&ran] { ++ran; } );
+  group.wait();
+  EXPECT_EQ( 1, ran );
+
+}
+
+TEST(core_task_scheduler_test, parallelFor) {
+
+  auto scheduler = TaskScheduler::create( 3 );
+
+  std::vector<int> hits( 1000, 0 );
+  std::vector<size_t> begins;
+
+  scheduler->parallelFor( 0, hits.size(), 64, [&hits]( size_t begin, size_t end ) {
+    for ( auto i = begin; i < end; ++i ) hits[ i ] ++;
+  } );
+
+  EXPECT_EQ( std::vector<int>( 1000, 1 ), hits );
+
+  // serially, chunks come in order
+
+  parallelFor( nullptr, 10, 35, 10, [&begins]( size_t begin, size_t end ) {
+    begins.push_back( begin );
+    EXPECT_EQ( std::min<size_t>( begin + 10, 35 ), end );
+  } );
+
+  EXPECT_EQ( ( std::vector<size_t> { 10, 20, 30 } ), begins );
+
+}
+
+TEST(core_task_scheduler_test, affinity) {
+
+  TaskScheduler::Parameters parameters;
+  parameters.workers = 2;
+  parameters.affinity.push_back( 0 );
+
+  auto scheduler = TaskScheduler::create( parameters );
+
+  std::atomic<int> count( 0 );
+  std::vector<TaskScheduler::Task> tasks( 10, [&count] { ++count; } );
+
+  scheduler->run( tasks );
+  EXPECT_EQ( 10, count.load() );
+
+}
+
+TEST(core_task_scheduler_test, geometry) {
+
+  auto scheduler = TaskScheduler::create( 3 );
+
+  auto serial = SphereGeometry::create( 10, 128, 96 );
+  auto parallel = SphereGeometry::create( 10, 128, 96 );
+  parallel->scheduler = scheduler;
+
+  for ( auto geometry : { serial, parallel } ) {
+    geometry->computeFaceNormals();
+    geometry->computeVertexNormals( true );
+    geometry->computeBoundingBox();
+    geometry->computeBoundingSphere();
+  }
+
+  ASSERT_GT( serial->faces.size(), 4096u );
+
+  for ( size_t f = 0; f < serial->faces.size(); ++f ) {
+    ASSERT_TRUE( serial->faces[ f ].normal.equals( parallel->faces[ f ].normal ) );
+    ASSERT_TRUE( serial->faces[ f ].vertexNormals[ 1 ].equals( parallel->faces[ f ].vertexNormals[ 1 ] ) );
+  }
+
+  EXPECT_TRUE( serial->boundingBox->equals( *parallel->boundingBox ) );
+  EXPECT_TRUE( serial->boundingSphere->center.equals( parallel->boundingSphere->center ) );
+  EXPECT_EQ( serial->boundingSphere->radius, parallel->boundingSphere->radius );
+
+}
+
+TEST(core_task_scheduler_test, raycaster) {
+
+  std::vector<Object3D::Ptr> objects;
+
+  auto geometry = SphereGeometry::create( 1, 8, 6 );
+  auto material = MeshBasicMaterial::create();
+
+  for ( int i = 0; i < 500; ++i ) {
+    auto mesh = Mesh::create( geometry, material );
+    mesh->position().set( ( float )( i % 3 ) - 1, 0, ( float )-i * 3 );
+    mesh->updateMatrixWorld();
+    objects.push_back( mesh );
+  }
+
+  Raycaster raycaster( Vector3( 0, 0, 10 ), Vector3( 0, 0, -1 ) );
+  const auto serial = raycaster.intersectObjects( objects );
+
+  raycaster.scheduler = TaskScheduler::create( 3 );
+  const auto parallel = raycaster.intersectObjects( objects );
+
+  ASSERT_GT( serial.size(), 0u );
+  ASSERT_EQ( serial.size(), parallel.size() );
+
+  for ( size_t i = 0; i < serial.size(); ++i ) {
+    EXPECT_EQ( serial[ i ].distance, parallel[ i ].distance );
+    EXPECT_EQ( serial[ i ].object, parallel[ i ].object );
+  }
+
+}
@@ -0,0 +1,156 @@
+#include "gtest/gtest.h"
+
+#include <three/core/object3d.h>
+#include <three/scenes/scene.h>
+
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+struct Tree {
+
+  Tree() : scene( Scene::create() ), parent( Object3D::create() ) {
+
+    scene->add( parent );
+
+    for ( int i = 0; i < 3; ++i ) {
+      auto child = Object3D::create();
+      child->position().x = ( float )i;
+      parent->add( child );
+      children.push_back( child );
+    }
+
+    scene->add( other = Object3D::create() );
+
+    scene->updateMatrixWorld();
+
+  }
+
+  std::vector<unsigned int> versions() const {
+    std::vector<unsigned int> result { parent->__matrixWorldVersion, other->__matrixWorldVersion };
+    for ( auto& child : children ) result.push_back( child->__matrixWorldVersion );
+    return result;
+  }
+
+  Scene::Ptr scene;
+  Object3D::Ptr parent, other;
+  std::vector<Object3D::Ptr> children;
+
+};
+
+} // namespace
+
+TEST(core_transform_propagation_test, skipsCleanSubtrees) {
+
+  Tree tree;
+
+  auto before = tree.versions();
+  tree.scene->updateMatrixWorld();
+  EXPECT_EQ( before, tree.versions() );
+
+  // one child
+
+  tree.children[ 1 ]->position().y = 5;
+  tree.scene->updateMatrixWorld();
+
+  auto after = tree.versions();
+  ++ before[ 3 ];
+  EXPECT_EQ( before, after );
+  EXPECT_FLOAT_EQ( 5.f, tree.children[ 1 ]->matrixWorld.elements[ 13 ] );
+
+  // the parent moves its children along
+
+  tree.parent->rotation().y = 1.f;
+  tree.parent->position().z = 10;
+  tree.scene->updateMatrixWorld();
+
+  after = tree.versions();
+  EXPECT_EQ( before[ 0 ] + 1, after[ 0 ] );
+  EXPECT_EQ( before[ 1 ], after[ 1 ] );
+  for ( size_t i = 2; i < after.size(); ++i ) EXPECT_EQ( before[ i ] + 1, after[ i ] );
+
+  Matrix4 expected;
+  expected.multiplyMatrices( tree.parent->matrixWorld, tree.children[ 2 ]->matrix );
+  for ( int i = 0; i < 16; ++i ) EXPECT_FLOAT_EQ( expected.elements[ i ], tree.children[ 2 ]->matrixWorld.elements[ i ] );
+
+}
+
+TEST(core_transform_propagation_test, changesTheAccessorsMiss) {
+
+  Tree tree;
+
+  // a reference kept from before the last update
+
+  auto& position = tree.other->position();
+  tree.scene->updateMatrixWorld();
+
+  position.x = 3;
+  tree.scene->updateMatrixWorld();
+  EXPECT_FLOAT_EQ( 0.f, tree.other->matrixWorld.elements[ 12 ] );
+
+  tree.other->transformChanged();
+  tree.scene->updateMatrixWorld();
+  EXPECT_FLOAT_EQ( 3.f, tree.other->matrixWorld.elements[ 12 ] );
+
+  // a matrix set by hand
+
+  tree.other->matrixAutoUpdate = false;
+  tree.other->matrix.makeTranslation( 7, 0, 0 );
+  tree.other->transformChanged();
+  tree.scene->updateMatrixWorld();
+  EXPECT_FLOAT_EQ( 7.f, tree.other->matrixWorld.elements[ 12 ] );
+
+  // forced updates trust no flags
+
+  tree.other->matrixAutoUpdate = true;
+  position.x = 4;
+  tree.scene->updateMatrixWorld( true );
+  EXPECT_FLOAT_EQ( 4.f, tree.other->matrixWorld.elements[ 12 ] );
+
+}
+
+TEST(core_transform_propagation_test, reparenting) {
+
+  Tree tree;
+
+  tree.parent->position().set( 0, 100, 0 );
+  tree.scene->updateMatrixWorld();
+
+  auto child = tree.children[ 0 ];
+  tree.other->add( child );
+  tree.scene->updateMatrixWorld();
+
+  EXPECT_FLOAT_EQ( 0.f, child->matrixWorld.elements[ 13 ] );
+
+  tree.parent->add( child );
+  tree.scene->updateMatrixWorld();
+
+  EXPECT_FLOAT_EQ( 100.f, child->matrixWorld.elements[ 13 ] );
+
+}
+
+TEST(core_transform_propagation_test, matrixWorldNeedsUpdate) {
+
+  Tree tree;
+
+  // a matrix set by hand, flagged the way three.js code does it
+
+  Matrix4 m;
+  m.makeTranslation( 0, 0, 6 );
+
+  tree.parent->matrixAutoUpdate = false;
+  tree.parent->matrix.copy( m );
+  tree.parent->matrixWorldNeedsUpdate = true;
+
+  EXPECT_TRUE( tree.parent->matrixWorldNeedsUpdate );
+
+  tree.scene->updateMatrixWorld();
+
+  EXPECT_FALSE( tree.parent->matrixWorldNeedsUpdate );
+  EXPECT_FLOAT_EQ( 6.f, tree.parent->matrixWorld.elements[ 14 ] );
+  EXPECT_FLOAT_EQ( 6.f, tree.children[ 2 ]->matrixWorld.elements[ 14 ] );
+  EXPECT_FLOAT_EQ( 2.f, tree.children[ 2 ]->matrixWorld.elements[ 12 ] );
+
+}
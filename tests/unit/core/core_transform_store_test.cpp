@@ -0,0 +1,292 @@
+#include "gtest/gtest.h"
+
+#include <three/core/object3d.h>
+#include <three/core/transform_store.h>
+#include <three/scenes/scene.h>
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+// matrixWorld as the recursive update computed it
+Matrix4 expectedWorld( const Object3D& object ) {
+
+  Matrix4 local;
+  local.compose( object.position(), object.quaternion(), object.scale() );
+
+  if ( ! object.parent ) return local;
+
+  return Matrix4().multiplyMatrices( expectedWorld( *object.parent ), local );
+
+}
+
+void expectWorlds( const std::vector<Object3D::Ptr>& objects ) {
+
+  for ( auto& object : objects ) {
+    const auto expected = expectedWorld( *object );
+    for ( int i = 0; i < 16; ++i ) {
+      ASSERT_NEAR( expected.elements[ i ], object->matrixWorld.elements[ i ], 1e-3f );
+    }
+  }
+
+}
+
+} // namespace
+
+TEST(core_transform_store_test, referencesIntoPools) {
+
+  auto& store = TransformStore::instance();
+
+  auto object = Object3D::create();
+  const auto slot = object->__transformSlot;
+
+  EXPECT_EQ( &store.position( slot ), &object->position() );
+  EXPECT_EQ( &store.quaternion( slot ), &object->quaternion() );
+  EXPECT_EQ( &store.world( slot ), &object->matrixWorld );
+
+  // growing the pools leaves them in place
+
+  const auto position = &object->position();
+
+  std::vector<Object3D::Ptr> objects;
+  for ( int i = 0; i < 5000; ++i ) objects.push_back( Object3D::create() );
+
+  EXPECT_EQ( position, &object->position() );
+
+  // and destroyed objects give their slots back
+
+  const auto size = store.size();
+  objects.clear();
+  EXPECT_EQ( size - 5000, store.size() );
+
+  auto reused = Object3D::create();
+  EXPECT_FLOAT_EQ( 0.f, reused->position().x );
+  EXPECT_FLOAT_EQ( 1.f, reused->scale().x );
+  EXPECT_FLOAT_EQ( 1.f, reused->matrixWorld.elements[ 0 ] );
+
+}
+
+TEST(core_transform_store_test, matchesRecursiveUpdate) {
+
+  std::mt19937 random( 11 );
+  std::uniform_real_distribution<float> value( -2.f, 2.f );
+
+  auto root = Object3D::create();
+  std::vector<Object3D::Ptr> objects( 1, root );
+
+  // a random tree, each object under one made before it
+
+  for ( int i = 0; i < 2000; ++i ) {
+    auto object = Object3D::create();
+    object->position().set( value( random ), value( random ), value( random ) );
+    object->rotation().set( value( random ), value( random ), value( random ) );
+    objects[ random() % objects.size() ]->add( object );
+    objects.push_back( object );
+  }
+
+  root->updateMatrixWorld();
+  expectWorlds( objects );
+
+  // some edits, and some objects moving to other parents
+
+  for ( int i = 0; i < 200; ++i ) {
+
+    auto& object = objects[ 1 + random() % ( objects.size() - 1 ) ];
+    object->quaternion().setFromAxisAngle( Vector3( 0, 1, 0 ), value( random ) );
+    object->scale().set( 2, 2, 2 );
+
+    // but never below itself
+
+    auto& parent = objects[ random() % objects.size() ];
+    auto ancestor = parent.get();
+    while ( ancestor && ancestor != object.get() ) ancestor = ancestor->parent;
+    if ( ! ancestor ) parent->add( object );
+
+  }
+
+  root->updateMatrixWorld();
+  expectWorlds( objects );
+
+  // a subtree alone
+
+  auto& inner = objects[ 1 ];
+  inner->position().x += 1;
+  inner->updateMatrixWorld();
+
+  const auto expected = expectedWorld( *inner );
+  EXPECT_FLOAT_EQ( expected.elements[ 12 ], inner->matrixWorld.elements[ 12 ] );
+
+}
+
+TEST(core_transform_store_test, orphanedChildren) {
+
+  auto child = Object3D::create();
+  child->position().x = 1;
+
+  {
+    auto parent = Object3D::create();
+    parent->position().x = 10;
+    parent->add( child );
+    parent->updateMatrixWorld();
+    EXPECT_FLOAT_EQ( 11.f, child->matrixWorld.elements[ 12 ] );
+  }
+
+  EXPECT_EQ( nullptr, child->parent );
+
+  child->updateMatrixWorld( true );
+  EXPECT_FLOAT_EQ( 1.f, child->matrixWorld.elements[ 12 ] );
+
+}
+
+TEST(core_transform_store_test, churn) {
+
+  std::mt19937 random( 5 );
+  std::uniform_real_distribution<float> value( -2.f, 2.f );
+
+  auto root = Object3D::create();
+  std::vector<Object3D::Ptr> objects( 1, root );
+
+  // objects made, moved, detached and destroyed between updates, which
+  // shift ranges of the order and leave gaps in it
+
+  for ( int frame = 0; frame < 50; ++frame ) {
+
+    for ( int i = 0; i < 40; ++i ) {
+
+      auto& object = objects[ random() % objects.size() ];
+      object->position().x = value( random );
+
+      switch ( random() % 4 ) {
+      case 0: {
+        auto created = Object3D::create();
+        created->position().set( value( random ), value( random ), value( random ) );
+        object->add( created );
+        objects.push_back( created );
+      } break;
+      case 1: {
+        auto& parent = objects[ random() % objects.size() ];
+        auto ancestor = parent.get();
+        while ( ancestor && ancestor != object.get() ) ancestor = ancestor->parent;
+        if ( ! ancestor ) parent->add( object );
+      } break;
+      case 2:
+        if ( object->parent ) object->parent->remove( object );
+        break;
+      case 3:
+        if ( object != root && object.use_count() == 1 ) {
+          std::swap( object, objects.back() );
+          objects.pop_back();
+        }
+        break;
+      }
+
+    }
+
+    for ( auto& object : objects ) {
+      if ( ! object->parent ) object->updateMatrixWorld();
+    }
+
+    expectWorlds( objects );
+
+  }
+
+}
+
+TEST(core_transform_store_test, threads) {
+
+  auto& store = TransformStore::instance();
+
+  auto root = Object3D::create();
+  std::vector<Object3D::Ptr> objects( 1, root );
+
+  for ( int i = 0; i < 100; ++i ) {
+    objects.push_back( Object3D::create() );
+    root->add( objects.back() );
+  }
+
+  const auto size = store.size();
+
+  // trees made and dropped on other threads while this one updates
+
+  std::vector<std::thread> threads;
+
+  for ( int t = 0; t < 4; ++t ) {
+    threads.emplace_back( [] {
+      for ( int i = 0; i < 200; ++i ) {
+        auto parent = Object3D::create();
+        for ( int j = 0; j < 20; ++j ) parent->add( Object3D::create() );
+        parent->position().x = 1;
+        parent->updateMatrixWorld();
+      }
+    } );
+  }
+
+  for ( int frame = 0; frame < 200; ++frame ) {
+    root->position().x = ( float )frame;
+    root->updateMatrixWorld();
+  }
+
+  for ( auto& thread : threads ) thread.join();
+
+  EXPECT_EQ( size, store.size() );
+  expectWorlds( objects );
+
+}
+
+TEST(core_transform_store_test, takeMoved) {
+
+  auto& store = TransformStore::instance();
+
+  auto scene = Scene::create(), other = Scene::create();
+  auto parent = Object3D::create(), child = Object3D::create(), still = Object3D::create();
+
+  parent->add( child );
+  scene->add( parent );
+  scene->add( still );
+
+  auto elsewhere = Object3D::create();
+  other->add( elsewhere );
+
+  scene->updateMatrixWorld();
+  other->updateMatrixWorld();
+
+  std::vector<Object3D*> moved;
+  store.takeMoved( scene->__transformSlot, moved );
+  EXPECT_EQ( 4u, moved.size() );
+
+  // taken once, and only objects that moved since
+
+  moved.clear();
+  store.takeMoved( scene->__transformSlot, moved );
+  EXPECT_TRUE( moved.empty() );
+
+  child->position().x = 1;
+  child->updateMatrixWorld();
+
+  store.takeMoved( scene->__transformSlot, moved );
+  EXPECT_EQ( std::vector<Object3D*>( 1, child.get() ), moved );
+
+  // a parent moves its children, and other scenes keep theirs
+
+  parent->position().x = 1;
+  scene->updateMatrixWorld();
+
+  moved.clear();
+  store.takeMoved( scene->__transformSlot, moved );
+  std::sort( moved.begin(), moved.end() );
+
+  std::vector<Object3D*> expected { parent.get(), child.get() };
+  std::sort( expected.begin(), expected.end() );
+  EXPECT_EQ( expected, moved );
+
+  moved.clear();
+  store.takeMoved( other->__transformSlot, moved );
+  EXPECT_EQ( 2u, moved.size() );
+  EXPECT_NE( moved.end(), std::find( moved.begin(), moved.end(), elsewhere.get() ) );
+
+}
@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/core/geometry.h>
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/box_geometry.h>
+
+using namespace three;
+
+TEST(core_world_bounds_test, followsTransformAndGeometry) {
+
+  auto geometry = BoxGeometry::create( 2, 2, 2 );
+  auto mesh = Mesh::create( geometry, MeshBasicMaterial::create() );
+
+  mesh->position().set( 10, 0, 0 );
+  mesh->updateMatrixWorld();
+
+  const auto& sphere = mesh->worldBoundingSphere();
+  EXPECT_FLOAT_EQ( 10.f, sphere.center.x );
+  EXPECT_FLOAT_EQ( std::sqrt( 3.f ), sphere.radius );
+
+  // nothing changed, nothing recomputed
+
+  const auto version = geometry->__boundsVersion;
+  EXPECT_EQ( &sphere, &mesh->worldBoundingSphere() );
+  EXPECT_EQ( version, geometry->__boundsVersion );
+
+  mesh->position().set( 20, 0, 0 );
+  mesh->scale().set( 2, 2, 2 );
+  mesh->updateMatrixWorld();
+
+  EXPECT_FLOAT_EQ( 20.f, mesh->worldBoundingSphere().center.x );
+  EXPECT_FLOAT_EQ( 2 * std::sqrt( 3.f ), mesh->worldBoundingSphere().radius );
+
+  // edits through markVerticesDirty drop the bounds straight away
+
+  for ( auto& vertex : geometry->vertices ) vertex.multiplyScalar( 2 );
+  geometry->markVerticesDirty( 0, ( int )geometry->vertices.size() );
+
+  EXPECT_FALSE( geometry->boundingSphere );
+  EXPECT_FLOAT_EQ( 4 * std::sqrt( 3.f ), mesh->worldBoundingSphere().radius );
+
+  // and so does another geometry
+
+  mesh->geometry = BoxGeometry::create( 1, 1, 1 );
+  EXPECT_FLOAT_EQ( std::sqrt( 3.f ), mesh->worldBoundingSphere().radius );
+
+}
+
+TEST(core_world_bounds_test, verticesNeedUpdate) {
+
+  auto renderer = stub::renderer();
+
+  auto scene = Scene::create();
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 1000 );
+  camera->position().z = 100;
+
+  // a box beside the view, that an edit stretches into it
+
+  auto geometry = BoxGeometry::create( 2, 2, 2 );
+  auto mesh = Mesh::create( geometry, MeshBasicMaterial::create() );
+  mesh->position().x = 200;
+  scene->add( mesh );
+
+  renderer->render( *scene, *camera );
+  EXPECT_EQ( 0, renderer->info().render.objectsDrawn );
+
+  for ( auto& vertex : geometry->vertices ) {
+    if ( vertex.x < 0 ) vertex.x = -200;
+  }
+  geometry->verticesNeedUpdate = true;
+
+  renderer->render( *scene, *camera );
+  EXPECT_EQ( 1, renderer->info().render.objectsDrawn );
+  EXPECT_GT( geometry->boundingSphere->radius, 100.f );
+
+}
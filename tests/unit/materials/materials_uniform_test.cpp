@@ -0,0 +1,84 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/materials/uniform.h>
+#include <three/materials/program.h>
+#include <three/materials/mesh_lambert_material.h>
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/extras/geometries/box_geometry.h>
+
+#include <map>
+#include <set>
+#include <string>
+
+using namespace three;
+
+namespace {
+
+// Locations spread out by name, so they differ from the ids
+std::map<std::string, GLint>& locations() { static std::map<std::string, GLint> l; return l; }
+
+GLint APIENTRY uniformLocation( GLuint, const GLchar* name ) {
+  static const std::set<std::string> missing { "bumpMap", "bumpScale", "normalMap", "flipEnvMap", "useRefract", "morphTargetInfluences" };
+  const std::string uniform( name );
+  if ( missing.count( uniform ) || uniform.compare( 0, 6, "shadow" ) == 0 || uniform.compare( 0, 9, "spotLight" ) == 0 ) return -1;
+  auto it = locations().find( uniform );
+  if ( it != locations().end() ) return it->second;
+  const GLint location = 100 + 7 * ( GLint )locations().size();
+  locations()[ uniform ] = location;
+  return location;
+}
+
+} // namespace
+
+TEST(materials_uniform_test, intern) {
+
+  const auto id = internUniform( "materials_uniform_test_a" );
+
+  EXPECT_EQ( id, internUniform( "materials_uniform_test_a" ) );
+  EXPECT_EQ( id, internUniform( std::string( "materials_uniform_" ) + "test_a" ) );
+  EXPECT_NE( id, internUniform( "materials_uniform_test_b" ) );
+  EXPECT_EQ( "materials_uniform_test_a", uniformName( id ) );
+  EXPECT_EQ( "materials_uniform_test_b", uniformName( internUniform( "materials_uniform_test_b" ) ) );
+
+  // the keys share the table
+
+  EXPECT_EQ( UniformKey::opacityId(), internUniform( "opacity" ) );
+  EXPECT_NE( UniformKey::opacityId(), UniformKey::diffuseId() );
+
+}
+
+TEST(materials_uniform_test, locations) {
+
+  auto gl = stub::gl();
+  gl.GetUniformLocation = uniformLocation;
+
+  auto renderer = stub::renderer( -1, gl );
+
+  auto scene = Scene::create();
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 1000 );
+  camera->position().z = 10;
+
+  auto material = MeshLambertMaterial::create();
+  scene->add( Mesh::create( BoxGeometry::create( 1, 1, 1 ), material ) );
+
+  renderer->render( *scene, *camera );
+
+  ASSERT_TRUE( material->program );
+  ASSERT_FALSE( locations().empty() );
+
+  // indexing by id finds what looking up the name did
+
+  const auto& uniforms = material->program->uniforms;
+
+  for ( const auto& location : locations() ) {
+    EXPECT_EQ( location.second, uniformLocation( uniforms, internUniform( location.first ) ) ) << location.first;
+  }
+
+  EXPECT_EQ( -1, uniformLocation( uniforms, UniformKey::bumpMapId() ) );
+  EXPECT_EQ( -1, uniformLocation( uniforms, internUniform( "materials_uniform_test_unused" ) ) );
+
+}
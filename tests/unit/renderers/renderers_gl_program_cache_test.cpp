@@ -0,0 +1,218 @@
+#include "gtest/gtest.h"
+
+#include <three/renderers/gl_program_cache.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <unistd.h>
+
+using namespace three;
+
+// Stub GL: a single program whose "binary" is a byte string
+
+namespace {
+
+const GLenum stubFormat = 0x1234;
+
+std::string stubVendor = "vendor";
+std::vector<unsigned char> stubBinary;
+bool stubLinked = false;
+
+const GLubyte* APIENTRY stubGetString( GLenum name ) {
+  static const GLubyte version[] = "4.1 stub";
+  if ( name == GL_VENDOR ) return reinterpret_cast<const GLubyte*>( stubVendor.c_str() );
+  return version;
+}
+
+void APIENTRY stubGetIntegerv( GLenum pname, GLint* params ) {
+  *params = pname == GL_NUM_PROGRAM_BINARY_FORMATS ? 1 : 0;
+}
+
+void APIENTRY stubGetProgramiv( GLuint, GLenum pname, GLint* params ) {
+  if ( pname == GL_PROGRAM_BINARY_LENGTH ) *params = ( GLint )stubBinary.size();
+  else if ( pname == GL_LINK_STATUS ) *params = stubLinked ? GL_TRUE : GL_FALSE;
+  else *params = 0;
+}
+
+void APIENTRY stubGetProgramBinary( GLuint, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary ) {
+  *length = std::min( bufSize, ( GLsizei )stubBinary.size() );
+  *binaryFormat = stubFormat;
+  std::copy( stubBinary.begin(), stubBinary.begin() + *length, static_cast<unsigned char*>( binary ) );
+}
+
+void APIENTRY stubProgramBinary( GLuint, GLenum binaryFormat, const void* binary, GLsizei length ) {
+  const auto bytes = static_cast<const unsigned char*>( binary );
+  stubLinked = binaryFormat == stubFormat;
+  stubBinary.assign( bytes, bytes + length );
+}
+
+GLInterface stubInterface() {
+  GLInterface gl;
+  gl.GetString = stubGetString;
+  gl.GetIntegerv = stubGetIntegerv;
+  gl.GetProgramiv = stubGetProgramiv;
+  gl.GetProgramBinary = stubGetProgramBinary;
+  gl.ProgramBinary = stubProgramBinary;
+  return gl;
+}
+
+// Each test writes into a directory of its own, removed afterwards
+
+class renderers_gl_program_cache_test : public ::testing::Test {
+protected:
+
+  void SetUp() override {
+    char name[] = "/tmp/three_program_cache_XXXXXX";
+    ASSERT_NE( nullptr, mkdtemp( name ) );
+    directory = name;
+  }
+
+  void TearDown() override {
+    if ( auto dir = opendir( directory.c_str() ) ) {
+      while ( auto entry = readdir( dir ) ) {
+        const std::string name = entry->d_name;
+        if ( name != "." && name != ".." ) std::remove( ( directory + "/" + name ).c_str() );
+      }
+      closedir( dir );
+    }
+    rmdir( directory.c_str() );
+  }
+
+  std::string directory;
+
+};
+
+} // namespace
+
+TEST_F(renderers_gl_program_cache_test, disabled) {
+  GLInterfaceWrapper gl( stubInterface() );
+
+  GLProgramCache cache( gl, "" );
+  EXPECT_FALSE( cache.enabled() );
+  EXPECT_FALSE( cache.load( 1, 1 ) );
+
+  GLInterface missing = stubInterface();
+  missing.ProgramBinary = nullptr;
+  GLInterfaceWrapper glMissing( missing );
+
+  GLProgramCache unsupported( glMissing, directory );
+  EXPECT_FALSE( unsupported.enabled() );
+}
+
+TEST_F(renderers_gl_program_cache_test, roundTrip) {
+  GLInterfaceWrapper gl( stubInterface() );
+  GLProgramCache cache( gl, directory );
+  ASSERT_TRUE( cache.enabled() );
+
+  const std::uint64_t key = 0x7e57ca11;
+  std::remove( cache.path( key ).c_str() );
+
+  EXPECT_FALSE( cache.load( key, 1 ) );
+
+  stubBinary = { 1, 2, 3, 4, 5 };
+  EXPECT_TRUE( cache.save( key, 1 ) );
+
+  stubBinary.clear();
+  stubLinked = false;
+
+  EXPECT_TRUE( cache.load( key, 1 ) );
+  EXPECT_EQ( std::vector<unsigned char>( { 1, 2, 3, 4, 5 } ), stubBinary );
+
+  std::remove( cache.path( key ).c_str() );
+}
+
+TEST_F(renderers_gl_program_cache_test, driverMismatch) {
+  GLInterfaceWrapper gl( stubInterface() );
+
+  stubVendor = "vendor";
+  GLProgramCache cache( gl, directory );
+
+  const std::uint64_t key = 0x7e57ca12;
+  stubBinary = { 9, 8, 7 };
+  ASSERT_TRUE( cache.save( key, 1 ) );
+
+  stubVendor = "other vendor";
+  GLProgramCache other( gl, directory );
+
+  EXPECT_NE( cache.path( key ), other.path( key ) );
+  EXPECT_FALSE( other.load( key, 1 ) );
+
+  // a file that doesn't match the driver that reads it is a miss too
+
+  std::rename( cache.path( key ).c_str(), other.path( key ).c_str() );
+  EXPECT_FALSE( other.load( key, 1 ) );
+
+  std::remove( other.path( key ).c_str() );
+  stubVendor = "vendor";
+}
+
+TEST_F(renderers_gl_program_cache_test, corruptLength) {
+  GLInterfaceWrapper gl( stubInterface() );
+  GLProgramCache cache( gl, directory );
+
+  const std::uint64_t key = 0x7e57ca13;
+  stubBinary = { 1, 2, 3 };
+  ASSERT_TRUE( cache.save( key, 1 ) );
+
+  std::vector<unsigned char> bytes;
+  if ( auto file = std::fopen( cache.path( key ).c_str(), "rb" ) ) {
+    for ( int c; ( c = std::fgetc( file ) ) != EOF; ) bytes.push_back( ( unsigned char )c );
+    std::fclose( file );
+  }
+
+  ASSERT_LT( 7u, bytes.size() );
+
+  // the length sits right before the binary; one past the end of the file
+  // and one too large to allocate are both misses
+
+  const auto rewrite = [&]( std::uint32_t length ) {
+    std::memcpy( &bytes[ bytes.size() - 3 - sizeof( length ) ], &length, sizeof( length ) );
+    auto file = std::fopen( cache.path( key ).c_str(), "wb" );
+    std::fwrite( bytes.data(), bytes.size(), 1, file );
+    std::fclose( file );
+  };
+
+  rewrite( 4 );
+  EXPECT_FALSE( cache.load( key, 1 ) );
+
+  rewrite( 0xfffffff0u );
+  EXPECT_FALSE( cache.load( key, 1 ) );
+
+  rewrite( 3 );
+  EXPECT_TRUE( cache.load( key, 1 ) );
+}
+
+TEST_F(renderers_gl_program_cache_test, replaceInPlace) {
+  GLInterfaceWrapper gl( stubInterface() );
+  GLProgramCache cache( gl, directory );
+
+  const std::uint64_t key = 0x7e57ca14;
+
+  stubBinary = { 1, 2 };
+  ASSERT_TRUE( cache.save( key, 1 ) );
+  stubBinary = { 3, 4, 5 };
+  ASSERT_TRUE( cache.save( key, 1 ) );
+
+  // the entry is replaced, and no temporary file is left next to it
+
+  std::vector<std::string> names;
+  if ( auto dir = opendir( directory.c_str() ) ) {
+    while ( auto entry = readdir( dir ) ) {
+      const std::string name = entry->d_name;
+      if ( name != "." && name != ".." ) names.push_back( directory + "/" + name );
+    }
+    closedir( dir );
+  }
+
+  EXPECT_EQ( std::vector<std::string>( { cache.path( key ) } ), names );
+
+  stubBinary.clear();
+  EXPECT_TRUE( cache.load( key, 1 ) );
+  EXPECT_EQ( std::vector<unsigned char>( { 3, 4, 5 } ), stubBinary );
+}
@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/materials/mesh_lambert_material.h>
+#include <three/materials/mesh_phong_material.h>
+#include <three/materials/mesh_normal_material.h>
+#include <three/materials/mesh_depth_material.h>
+#include <three/extras/geometries/box_geometry.h>
+
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+int& links() { static int l = 0; return l; }
+
+void APIENTRY linkProgram( GLuint ) { ++ links(); }
+
+// Boxes with a program each, and one sharing the first box's program
+struct Boxes {
+
+  Boxes()
+    : scene( Scene::create() ),
+      camera( PerspectiveCamera::create( 50, 1, 1, 1000 ) ) {
+
+    auto gl = stub::gl();
+    gl.LinkProgram = linkProgram;
+
+    renderer = stub::renderer( -1, gl );
+
+    camera->position().z = 20;
+
+    auto colored = MeshBasicMaterial::create();
+    colored->vertexColors = THREE::FaceColors;
+
+    std::vector<Material::Ptr> materials { MeshBasicMaterial::create(), colored, MeshLambertMaterial::create(),
+                                           MeshPhongMaterial::create(), MeshNormalMaterial::create(),
+                                           MeshDepthMaterial::create(), MeshBasicMaterial::create() };
+
+    auto geometry = BoxGeometry::create( 1, 1, 1 );
+
+    for ( size_t i = 0; i < materials.size(); ++i ) {
+      auto mesh = Mesh::create( geometry, materials[ i ] );
+      mesh->position().x = ( float )i * 2 - 6;
+      scene->add( mesh );
+    }
+
+  }
+
+  GLRenderer::Ptr renderer;
+  Scene::Ptr scene;
+  PerspectiveCamera::Ptr camera;
+
+};
+
+const int materials = 7;
+const int programs = 6;
+
+} // namespace
+
+TEST(renderers_gl_renderer_compile_test, beforeRender) {
+
+  Boxes boxes;
+
+  links() = 0;
+  EXPECT_TRUE( boxes.renderer->compile( *boxes.scene, *boxes.camera ) );
+
+  EXPECT_EQ( programs, links() );
+  EXPECT_EQ( programs, boxes.renderer->info().memory.programs );
+
+  // the first frame only draws
+
+  links() = 0;
+  boxes.renderer->render( *boxes.scene, *boxes.camera );
+
+  EXPECT_EQ( 0, links() );
+  EXPECT_EQ( materials, boxes.renderer->info().render.objectsDrawn );
+
+}
+
+TEST(renderers_gl_renderer_compile_test, timeBudget) {
+
+  Boxes boxes;
+
+  // a budget too small for more than one material per call, each call
+  // resuming where the last one stopped and the last returning true
+
+  links() = 0;
+  int calls = 1;
+
+  while ( ! boxes.renderer->compile( *boxes.scene, *boxes.camera, 1e-6f ) ) {
+    ++ calls;
+    ASSERT_GE( materials, calls );
+  }
+
+  EXPECT_EQ( materials, calls );
+  EXPECT_EQ( programs, links() );
+
+  // a finished compile has nothing left to build
+
+  EXPECT_TRUE( boxes.renderer->compile( *boxes.scene, *boxes.camera, 1e-6f ) );
+
+  links() = 0;
+  boxes.renderer->render( *boxes.scene, *boxes.camera );
+
+  EXPECT_EQ( 0, links() );
+
+}
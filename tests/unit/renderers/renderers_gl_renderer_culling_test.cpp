@@ -0,0 +1,72 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/box_geometry.h>
+
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+struct Culled {
+  std::vector<int> order; // objects in render list order, -1 when not drawn
+  int drawn;
+  int culled;
+};
+
+Culled cullBoxes( int workerThreads ) {
+
+  auto renderer = stub::renderer( workerThreads );
+
+  auto scene = Scene::create();
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 1000 );
+  camera->position().z = 500;
+
+  // a grid wider than the view, so that some objects fall outside it
+
+  unsigned firstId = 0;
+
+  for ( int i = 0; i < 3000; ++i ) {
+    auto material = MeshBasicMaterial::create();
+    material->transparent = i % 4 == 0;
+    auto mesh = Mesh::create( BoxGeometry::create( 1, 1, 1 ), material );
+    mesh->position().set( ( float )( i % 60 ) * 20 - 600, ( float )( i / 60 ) * 20 - 500, ( float )( i % 9 ) * -30 );
+    mesh->visible = i % 17 != 0;
+    if ( i == 0 ) firstId = mesh->id;
+    scene->add( mesh );
+  }
+
+  renderer->render( *scene, *camera );
+
+  Culled result;
+  result.drawn = renderer->info().render.objectsDrawn;
+  result.culled = renderer->info().render.objectsCulled;
+
+  for ( const auto& glObject : scene->__glObjects ) {
+    result.order.push_back( glObject.render ? ( int )( glObject.object->id - firstId ) : -1 );
+  }
+
+  return result;
+
+}
+
+} // namespace
+
+TEST(renderers_gl_renderer_culling_test, sameAsSerial) {
+
+  const auto serial = cullBoxes( 0 );
+  const auto parallel = cullBoxes( 3 );
+
+  EXPECT_GT( serial.drawn, 0 );
+  EXPECT_GT( serial.culled, 0 );
+  EXPECT_EQ( serial.drawn, parallel.drawn );
+  EXPECT_EQ( serial.culled, parallel.culled );
+  EXPECT_EQ( serial.order, parallel.order );
+
+}
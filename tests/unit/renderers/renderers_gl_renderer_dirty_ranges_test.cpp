@@ -0,0 +1,107 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/sphere_geometry.h>
+
+using namespace three;
+
+namespace {
+
+int& subUploads() { static int u = 0; return u; }
+
+void APIENTRY bufferSubData( GLenum, GLintptr, GLsizeiptr, const GLvoid* ) { ++ subUploads(); }
+
+// A dynamic sphere colored per face, rendered a frame at a time
+struct ColoredSphere {
+
+  ColoredSphere()
+    : scene( Scene::create() ),
+      camera( PerspectiveCamera::create( 50, 1, 1, 1000 ) ),
+      geometry( SphereGeometry::create( 10, 8, 8 ) ) {
+
+    auto gl = stub::gl();
+    gl.BufferSubData = bufferSubData;
+
+    renderer = stub::renderer( -1, gl );
+
+    camera->position().z = 200;
+
+    auto material = MeshBasicMaterial::create();
+    material->vertexColors = THREE::FaceColors;
+
+    geometry->dynamic = true;
+
+    scene->add( Mesh::create( geometry, material ) );
+
+    render();
+
+  }
+
+  size_t render() {
+    subUploads() = 0;
+    renderer->render( *scene, *camera );
+    return renderer->info().render.bufferBytesUploaded;
+  }
+
+  GLRenderer::Ptr renderer;
+  Scene::Ptr scene;
+  PerspectiveCamera::Ptr camera;
+  Geometry::Ptr geometry;
+
+};
+
+} // namespace
+
+TEST(renderers_gl_renderer_dirty_ranges_test, dirtyFaceColors) {
+
+  ColoredSphere sphere;
+
+  // one face's three colors, and not the whole buffer
+
+  sphere.geometry->faces[ 5 ].color.setRGB( 1, 0, 0 );
+  sphere.geometry->markColorsDirty( 5, 1 );
+
+  EXPECT_EQ( 9 * sizeof( float ), sphere.render() );
+  EXPECT_TRUE( sphere.geometry->__dirtyColors.empty() );
+
+  // the ranges are reset by the upload
+
+  EXPECT_EQ( 0u, sphere.render() );
+
+}
+
+TEST(renderers_gl_renderer_dirty_ranges_test, adjacentFaces) {
+
+  ColoredSphere sphere;
+
+  // adjacent and overlapping faces go up as one range
+
+  sphere.geometry->markColorsDirty( 5, 2 );
+  sphere.geometry->markColorsDirty( 7, 1 );
+  sphere.geometry->markColorsDirty( 6, 2 );
+
+  EXPECT_EQ( 3 * 9 * sizeof( float ), sphere.render() );
+  EXPECT_EQ( 1, subUploads() );
+
+}
+
+TEST(renderers_gl_renderer_dirty_ranges_test, fullRangeFallback) {
+
+  ColoredSphere sphere;
+
+  // a full update uploads the whole buffer and drops the ranges with it
+
+  sphere.geometry->markColorsDirty( 5, 1 );
+  sphere.geometry->colorsNeedUpdate = true;
+
+  EXPECT_EQ( sphere.geometry->faces.size() * 9 * sizeof( float ), sphere.render() );
+  EXPECT_TRUE( sphere.geometry->__dirtyColors.empty() );
+
+  EXPECT_EQ( 0u, sphere.render() );
+
+}
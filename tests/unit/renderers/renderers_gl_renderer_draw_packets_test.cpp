@@ -0,0 +1,139 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/scenes/fog.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/lights/directional_light.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/materials/mesh_lambert_material.h>
+#include <three/materials/mesh_phong_material.h>
+#include <three/extras/geometries/box_geometry.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+// Every uniform uploaded, as the function, the location and the values
+std::vector<float>& uploads() { static std::vector<float> u; return u; }
+
+void upload( int function, GLint location, const float* values, int count ) {
+  uploads().push_back( ( float )function );
+  uploads().push_back( ( float )location );
+  uploads().insert( uploads().end(), values, values + count );
+}
+
+// A location for every uniform but those of features the programs here
+// compile out, whose default values would not load
+GLint APIENTRY uniformLocation( GLuint, const GLchar* name ) {
+  static const std::set<std::string> missing { "bumpMap", "bumpScale", "normalMap", "flipEnvMap", "useRefract", "morphTargetInfluences" };
+  const std::string uniform( name );
+  if ( missing.count( uniform ) || uniform.compare( 0, 6, "shadow" ) == 0 || uniform.compare( 0, 9, "spotLight" ) == 0 ) return -1;
+  static std::map<std::string, GLint> names;
+  auto it = names.find( name );
+  if ( it != names.end() ) return it->second;
+  const GLint location = ( GLint )names.size();
+  names[ name ] = location;
+  return location;
+}
+
+void APIENTRY useProgram( GLuint ) { uploads().push_back( -1 ); }
+
+void APIENTRY uniform1i( GLint location, GLint v ) { const float f = ( float )v; upload( 1, location, &f, 1 ); }
+void APIENTRY uniform1f( GLint location, GLfloat v ) { upload( 2, location, &v, 1 ); }
+void APIENTRY uniform2f( GLint location, GLfloat x, GLfloat y ) { const float v[] = { x, y }; upload( 3, location, v, 2 ); }
+void APIENTRY uniform3f( GLint location, GLfloat x, GLfloat y, GLfloat z ) { const float v[] = { x, y, z }; upload( 4, location, v, 3 ); }
+void APIENTRY uniform4f( GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w ) { const float v[] = { x, y, z, w }; upload( 5, location, v, 4 ); }
+void APIENTRY uniform1fv( GLint location, GLsizei count, const GLfloat* v ) { upload( 6, location, v, count ); }
+void APIENTRY uniform3fv( GLint location, GLsizei count, const GLfloat* v ) { upload( 7, location, v, 3 * count ); }
+void APIENTRY uniformMatrix3fv( GLint location, GLsizei count, GLboolean, const GLfloat* v ) { upload( 8, location, v, 9 * count ); }
+void APIENTRY uniformMatrix4fv( GLint location, GLsizei count, GLboolean, const GLfloat* v ) { upload( 9, location, v, 16 * count ); }
+
+// The second frame's uploads, through draw packets or the serial path
+std::vector<float> renderBoxes( int workerThreads, bool drawPackets, bool sortObjects ) {
+
+  auto gl = stub::gl();
+  gl.GetUniformLocation = uniformLocation;
+  gl.UseProgram = useProgram;
+  gl.Uniform1i = uniform1i;
+  gl.Uniform1f = uniform1f;
+  gl.Uniform2f = uniform2f;
+  gl.Uniform3f = uniform3f;
+  gl.Uniform4f = uniform4f;
+  gl.Uniform1fv = uniform1fv;
+  gl.Uniform3fv = uniform3fv;
+  gl.UniformMatrix3fv = uniformMatrix3fv;
+  gl.UniformMatrix4fv = uniformMatrix4fv;
+
+  auto renderer = stub::renderer( workerThreads, gl );
+  renderer->drawPackets = drawPackets;
+  renderer->sortObjects = sortObjects;
+
+  auto scene = Scene::create();
+  scene->fog = Fog::create( 0x808080, 10, 2000 );
+
+  auto light = DirectionalLight::create( 0xffffff, 0.8f );
+  light->position().set( 1, 2, 3 );
+  scene->add( light );
+
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 10000 );
+  camera->position().z = 1000;
+
+  auto geometry = BoxGeometry::create( 1, 1, 1 );
+
+  std::vector<Material::Ptr> materials { MeshLambertMaterial::create(), MeshPhongMaterial::create(),
+                                         MeshBasicMaterial::create(), MeshBasicMaterial::create() };
+
+  for ( size_t i = 0; i < materials.size(); ++i ) materials[ i ]->color.set( 0x3fu << ( 8 * i ) );
+
+  materials[ 3 ]->opacity = 0.5f;
+  materials[ 3 ]->transparent = true;
+
+  for ( int i = 0; i < 2000; ++i ) {
+    auto mesh = Mesh::create( geometry, materials[ i % materials.size() ] );
+    mesh->position().set( ( float )( i % 40 ) * 10 - 200, ( float )( i / 40 ) * 10 - 250, ( float )( i % 7 ) * -20 );
+    mesh->rotation().set( 0, ( float )i, 0 );
+    scene->add( mesh );
+  }
+
+  renderer->render( *scene, *camera );
+
+  // values changed between frames reach the uploads
+
+  materials[ 0 ]->opacity = 0.75f;
+  light->intensity = 0.5f;
+
+  uploads().clear();
+  renderer->render( *scene, *camera );
+
+  EXPECT_EQ( 2000, renderer->info().render.objectsDrawn );
+
+  return uploads();
+
+}
+
+} // namespace
+
+TEST(renderers_gl_renderer_draw_packets_test, sameAsSerial) {
+
+  const auto serial = renderBoxes( 0, false, false );
+  EXPECT_FALSE( serial.empty() );
+  EXPECT_EQ( serial, renderBoxes( 0, true, false ) );
+  EXPECT_EQ( serial, renderBoxes( 3, true, false ) );
+
+}
+
+TEST(renderers_gl_renderer_draw_packets_test, sameAsSerialSorted) {
+
+  const auto serial = renderBoxes( 0, false, true );
+  EXPECT_EQ( serial, renderBoxes( 0, true, true ) );
+  EXPECT_EQ( serial, renderBoxes( 3, true, true ) );
+
+}
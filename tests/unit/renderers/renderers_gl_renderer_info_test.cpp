@@ -0,0 +1,52 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/sphere_geometry.h>
+
+using namespace three;
+
+TEST(renderers_gl_renderer_info_test, frame) {
+
+  auto renderer = stub::renderer();
+  renderer->sortObjects = false;
+
+  auto scene = Scene::create();
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 1000 );
+  camera->position().z = 200;
+
+  auto material = MeshBasicMaterial::create();
+
+  auto visible = Mesh::create( SphereGeometry::create( 10, 8, 8 ), material );
+  scene->add( visible );
+
+  auto behind = Mesh::create( SphereGeometry::create( 10, 8, 8 ), material );
+  behind->position().z = 1000;
+  scene->add( behind );
+
+  renderer->render( *scene, *camera );
+
+  const auto& info = renderer->info();
+
+  EXPECT_EQ( 1, info.render.objectsDrawn );
+  EXPECT_EQ( 1, info.render.objectsCulled );
+  EXPECT_EQ( 1, info.render.calls );
+  EXPECT_EQ( 1, info.render.programSwitches );
+  EXPECT_EQ( 1, info.render.materialRefreshes );
+  EXPECT_GT( info.render.bufferBytesUploaded, 0u );
+  EXPECT_EQ( 2, info.memory.geometries );
+  EXPECT_GE( info.time.update, 0 );
+  EXPECT_GE( info.time.opaque, 0 );
+
+  // nothing changed, so nothing is uploaded again
+
+  renderer->render( *scene, *camera );
+
+  EXPECT_EQ( 1, info.render.calls );
+  EXPECT_EQ( 0u, info.render.bufferBytesUploaded );
+
+}
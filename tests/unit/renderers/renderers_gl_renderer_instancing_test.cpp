@@ -0,0 +1,146 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/instanced_mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/box_geometry.h>
+
+#include <set>
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+// The locations with a divisor of 1, those while drawing, and the instance
+// count of every draw
+std::set<GLuint>& divided() { static std::set<GLuint> d; return d; }
+std::set<GLuint>& dividedWhileDrawing() { static std::set<GLuint> d; return d; }
+std::vector<GLsizei>& instanceCounts() { static std::vector<GLsizei> c; return c; }
+
+void APIENTRY vertexAttribDivisor( GLuint index, GLuint divisor ) {
+  if ( divisor == 1 ) divided().insert( index );
+  else divided().erase( index );
+}
+
+void draw( GLsizei count ) {
+  dividedWhileDrawing() = divided();
+  instanceCounts().push_back( count );
+}
+
+void APIENTRY drawArraysInstanced( GLenum, GLint, GLsizei, GLsizei count ) { draw( count ); }
+void APIENTRY drawElementsInstanced( GLenum, GLsizei, GLenum, const GLvoid*, GLsizei count ) { draw( count ); }
+
+GLInterface instancingGL() {
+  auto gl = stub::gl();
+  gl.VertexAttribDivisor = vertexAttribDivisor;
+  gl.DrawArraysInstanced = drawArraysInstanced;
+  gl.DrawElementsInstanced = drawElementsInstanced;
+  return gl;
+}
+
+// Ten boxes in view and five far to the side of it
+InstancedMesh::Ptr boxes() {
+
+  auto mesh = InstancedMesh::create( BoxGeometry::create( 1, 1, 1 ), MeshBasicMaterial::create(), 15 );
+
+  for ( size_t i = 0; i < mesh->count(); ++i ) {
+    const float x = i < 10 ? ( float )i * 2 - 9 : 1000 + ( float )i * 2;
+    mesh->setMatrixAt( i, Matrix4().makeTranslation( x, 0, 0 ) );
+  }
+
+  return mesh;
+
+}
+
+// Renders the boxes, recording the draws of the frame
+struct Boxes {
+
+  Boxes()
+    : renderer( stub::renderer( -1, instancingGL() ) ),
+      scene( Scene::create() ),
+      camera( PerspectiveCamera::create( 50, 1, 1, 1000 ) ),
+      mesh( boxes() ) {
+    camera->position().z = 50;
+    scene->add( mesh );
+  }
+
+  void render() {
+    divided().clear();
+    dividedWhileDrawing().clear();
+    instanceCounts().clear();
+    renderer->render( *scene, *camera );
+  }
+
+  GLRenderer::Ptr renderer;
+  Scene::Ptr scene;
+  PerspectiveCamera::Ptr camera;
+  InstancedMesh::Ptr mesh;
+
+};
+
+} // namespace
+
+TEST(renderers_gl_renderer_instancing_test, divisors) {
+
+  Boxes boxes;
+  boxes.render();
+
+  ASSERT_EQ( 1u, instanceCounts().size() );
+
+  // the four matrix columns step per instance while drawing
+
+  const GLuint matrix = ( GLuint )stub::attribLocation( 0, "instanceMatrix" );
+  EXPECT_EQ( ( std::set<GLuint> { matrix, matrix + 1, matrix + 2, matrix + 3 } ), dividedWhileDrawing() );
+
+  // and are restored for the next program
+
+  EXPECT_TRUE( divided().empty() );
+
+}
+
+TEST(renderers_gl_renderer_instancing_test, culledCount) {
+
+  Boxes boxes;
+  boxes.render();
+
+  ASSERT_EQ( 1u, instanceCounts().size() );
+  EXPECT_EQ( 10, instanceCounts()[ 0 ] );
+  EXPECT_EQ( 10, boxes.mesh->__instanceCount );
+
+  boxes.mesh->instanceFrustumCulled = false;
+  boxes.render();
+
+  ASSERT_EQ( 1u, instanceCounts().size() );
+  EXPECT_EQ( 15, instanceCounts()[ 0 ] );
+
+}
+
+TEST(renderers_gl_renderer_instancing_test, shadowCasterKeepsAll) {
+
+  Boxes boxes;
+  boxes.renderer->shadowMapEnabled = true;
+  boxes.mesh->castShadow = true;
+  boxes.render();
+
+  // the instances out of view may still cast shadows into it
+
+  ASSERT_EQ( 1u, instanceCounts().size() );
+  EXPECT_EQ( 15, instanceCounts()[ 0 ] );
+
+  boxes.mesh->castShadow = false;
+  boxes.render();
+
+  ASSERT_EQ( 1u, instanceCounts().size() );
+  EXPECT_EQ( 10, instanceCounts()[ 0 ] );
+
+  boxes.mesh->castShadow = true;
+  boxes.render();
+
+  ASSERT_EQ( 1u, instanceCounts().size() );
+  EXPECT_EQ( 15, instanceCounts()[ 0 ] );
+
+}
@@ -0,0 +1,82 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_lambert_material.h>
+#include <three/extras/geometries/sphere_geometry.h>
+
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+// The bytes of every buffer upload, in order
+std::vector<std::vector<unsigned char>>& uploads() { static std::vector<std::vector<unsigned char>> u; return u; }
+
+void record( GLsizeiptr size, const GLvoid* data ) {
+  const auto bytes = static_cast<const unsigned char*>( data );
+  uploads().push_back( bytes ? std::vector<unsigned char>( bytes, bytes + size ) : std::vector<unsigned char>( size ) );
+}
+
+void APIENTRY bufferData( GLenum, GLsizeiptr size, const GLvoid* data, GLenum ) { record( size, data ); }
+void APIENTRY bufferSubData( GLenum, GLintptr, GLsizeiptr size, const GLvoid* data ) { record( size, data ); }
+
+// A mesh with every stream packMeshBuffers fills, uploaded once
+std::vector<std::vector<unsigned char>> packSphere( int workerThreads ) {
+
+  auto gl = stub::gl();
+  gl.BufferData = bufferData;
+  gl.BufferSubData = bufferSubData;
+
+  auto renderer = stub::renderer( workerThreads, gl );
+
+  auto scene = Scene::create();
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 1000 );
+  camera->position().z = 200;
+
+  // enough faces for the packing to go to the workers
+
+  auto geometry = SphereGeometry::create( 10, 80, 60 );
+
+  for ( size_t i = 0; i < geometry->faces.size(); ++i ) {
+    for ( int j = 0; j < 3; ++j ) {
+      geometry->faces[ i ].vertexColors[ j ].setRGB( ( float )( i % 7 ) / 7, ( float )j / 3, 0.5f );
+    }
+  }
+
+  for ( int t = 0; t < 2; ++t ) {
+    GeometryBuffer::MorphTarget target;
+    target.name = "target";
+    for ( const auto& vertex : geometry->vertices ) target.vertices.push_back( Vector3( vertex ).multiplyScalar( 1.5f + t ) );
+    geometry->morphTargets.push_back( target );
+  }
+
+  auto material = MeshLambertMaterial::create();
+  material->vertexColors = THREE::VertexColors;
+  material->morphTargets = true;
+
+  scene->add( Mesh::create( geometry, material ) );
+
+  uploads().clear();
+  renderer->render( *scene, *camera );
+
+  return uploads();
+
+}
+
+} // namespace
+
+TEST(renderers_gl_renderer_packing_test, sameAsSerial) {
+
+  const auto serial = packSphere( 0 );
+
+  // positions, normals, uvs, colors, two morph targets and the indices
+
+  ASSERT_EQ( 7u, serial.size() );
+  EXPECT_EQ( serial, packSphere( 3 ) );
+
+}
@@ -0,0 +1,129 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/shader_material.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/box_geometry.h>
+
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+// A box per material, rendered in one frame
+struct Boxes {
+
+  explicit Boxes( const std::vector<Material::Ptr>& materials )
+    : renderer( stub::renderer( -1 ) ),
+      scene( Scene::create() ),
+      camera( PerspectiveCamera::create( 50, 1, 1, 1000 ) ) {
+
+    camera->position().z = 20;
+
+    auto geometry = BoxGeometry::create( 1, 1, 1 );
+
+    for ( size_t i = 0; i < materials.size(); ++i ) {
+      auto mesh = Mesh::create( geometry, materials[ i ] );
+      mesh->position().x = ( float )i * 2 - 2;
+      scene->add( mesh );
+    }
+
+    renderer->render( *scene, *camera );
+
+  }
+
+  int programs() { return renderer->info().memory.programs; }
+
+  GLRenderer::Ptr renderer;
+  Scene::Ptr scene;
+  PerspectiveCamera::Ptr camera;
+
+};
+
+Material::Ptr shader( const Material::Defines& defines ) {
+  auto material = ShaderMaterial::create( "void main() { gl_Position = vec4( 0.0 ); }",
+                                          "void main() { gl_FragColor = vec4( 1.0 ); }" );
+  material->defines = defines;
+  return material;
+}
+
+} // namespace
+
+TEST(renderers_gl_renderer_program_key_test, reorderedDefines) {
+
+  // the same defines, inserted in another order into a map of other buckets
+
+  Material::Defines first;
+  first[ "A" ] = "1";
+  first[ "B" ] = "2";
+  first[ "C" ] = "3";
+
+  Material::Defines second;
+  second.rehash( 64 );
+  second[ "C" ] = "3";
+  second[ "B" ] = "2";
+  second[ "A" ] = "1";
+
+  auto a = shader( first );
+  auto b = shader( second );
+
+  Boxes boxes( { a, b } );
+
+  EXPECT_EQ( 1, boxes.programs() );
+  ASSERT_TRUE( !! a->program );
+  EXPECT_EQ( a->program, b->program );
+
+}
+
+TEST(renderers_gl_renderer_program_key_test, differentDefines) {
+
+  Material::Defines first;
+  first[ "A" ] = "1";
+
+  Material::Defines value;
+  value[ "A" ] = "2";
+
+  // a value moved to a name must not cancel out
+
+  Material::Defines swapped;
+  swapped[ "1" ] = "A";
+
+  auto a = shader( first );
+  auto b = shader( value );
+  auto c = shader( swapped );
+  auto d = shader( Material::Defines() );
+
+  Boxes boxes( { a, b, c, d } );
+
+  EXPECT_EQ( 4, boxes.programs() );
+  EXPECT_NE( a->program->key, b->program->key );
+  EXPECT_NE( a->program->key, c->program->key );
+  EXPECT_NE( a->program->key, d->program->key );
+
+}
+
+TEST(renderers_gl_renderer_program_key_test, differentParameters) {
+
+  auto plain = MeshBasicMaterial::create();
+
+  auto colored = MeshBasicMaterial::create();
+  colored->vertexColors = THREE::FaceColors;
+
+  auto alphaTested = MeshBasicMaterial::create();
+  alphaTested->alphaTest = 0.5f;
+
+  auto same = MeshBasicMaterial::create();
+
+  Boxes boxes( { plain, colored, alphaTested, same } );
+
+  EXPECT_EQ( 3, boxes.programs() );
+  EXPECT_NE( plain->program->key, colored->program->key );
+  EXPECT_NE( plain->program->key, alphaTested->program->key );
+  EXPECT_EQ( plain->program, same->program );
+
+}
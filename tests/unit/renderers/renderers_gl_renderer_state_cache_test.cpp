@@ -0,0 +1,223 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/textures/texture.h>
+#include <three/extras/geometries/box_geometry.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <set>
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+// A GL that keeps bindings like a context does: names are reused once
+// deleted, and deleting a bound name unbinds it
+
+struct Context {
+  std::set<GLuint> buffers, textures;
+  std::map<GLenum, GLuint> boundBuffers;
+  GLenum activeTexture = GL_TEXTURE0;
+  std::map<GLenum, GLuint> boundTextures;
+  GLuint framebuffer = 0;
+  std::map<std::string, int> calls;
+  std::vector<GLuint> uploadedBuffers, uploadedTextures;
+};
+
+Context& context() { static Context c; return c; }
+
+GLuint lowestFree( const std::set<GLuint>& names ) {
+  GLuint name = 1;
+  while ( names.count( name ) ) ++name;
+  return name;
+}
+
+void APIENTRY genBuffers( GLsizei n, GLuint* names ) {
+  for ( GLsizei i = 0; i < n; ++i ) context().buffers.insert( names[ i ] = lowestFree( context().buffers ) );
+}
+
+void APIENTRY deleteBuffers( GLsizei n, const GLuint* names ) {
+  for ( GLsizei i = 0; i < n; ++i ) {
+    context().buffers.erase( names[ i ] );
+    for ( auto& bound : context().boundBuffers ) if ( bound.second == names[ i ] ) bound.second = 0;
+  }
+}
+
+void APIENTRY bindBuffer( GLenum target, GLuint buffer ) {
+  ++ context().calls[ "BindBuffer" ];
+  context().boundBuffers[ target ] = buffer;
+}
+
+void APIENTRY bufferData( GLenum target, GLsizeiptr, const GLvoid*, GLenum ) {
+  context().uploadedBuffers.push_back( context().boundBuffers[ target ] );
+}
+
+void APIENTRY genTextures( GLsizei n, GLuint* names ) {
+  for ( GLsizei i = 0; i < n; ++i ) context().textures.insert( names[ i ] = lowestFree( context().textures ) );
+}
+
+void APIENTRY deleteTextures( GLsizei n, const GLuint* names ) {
+  for ( GLsizei i = 0; i < n; ++i ) {
+    context().textures.erase( names[ i ] );
+    for ( auto& bound : context().boundTextures ) if ( bound.second == names[ i ] ) bound.second = 0;
+  }
+}
+
+// Only the texture gets a location, so no other uniform has to load
+GLint APIENTRY uniformLocation( GLuint, const GLchar* name ) { return std::string( name ) == "map" ? 0 : -1; }
+
+void APIENTRY activeTexture( GLenum unit ) { context().activeTexture = unit; }
+
+void APIENTRY bindTexture( GLenum, GLuint texture ) {
+  ++ context().calls[ "BindTexture" ];
+  context().boundTextures[ context().activeTexture ] = texture;
+}
+
+void APIENTRY texImage2D( GLenum, GLint, GLint, GLsizei, GLsizei, GLint, GLenum, GLenum, const GLvoid* ) {
+  context().uploadedTextures.push_back( context().boundTextures[ context().activeTexture ] );
+}
+
+void APIENTRY bindFramebuffer( GLenum, GLuint framebuffer ) {
+  ++ context().calls[ "BindFramebuffer" ];
+  context().framebuffer = framebuffer;
+}
+
+void APIENTRY vertexAttribPointer( GLuint, GLint, GLenum, GLboolean, GLsizei, const GLvoid* ) {
+  ++ context().calls[ "VertexAttribPointer" ];
+}
+
+// A textured box, rendered a frame at a time
+struct TexturedBox {
+
+  TexturedBox()
+    : scene( Scene::create() ),
+      camera( PerspectiveCamera::create( 50, 1, 1, 1000 ) ),
+      geometry( BoxGeometry::create( 1, 1, 1 ) ),
+      texture( Texture::create( TextureDesc( Image( std::vector<unsigned char>( 4 * 4 * 4, 255 ), 4, 4 ) ) ) ) {
+
+    context() = Context();
+
+    auto gl = stub::gl();
+    gl.GenBuffers = genBuffers;
+    gl.DeleteBuffers = deleteBuffers;
+    gl.BindBuffer = bindBuffer;
+    gl.BufferData = bufferData;
+    gl.GenTextures = genTextures;
+    gl.DeleteTextures = deleteTextures;
+    gl.ActiveTexture = activeTexture;
+    gl.BindTexture = bindTexture;
+    gl.TexImage2D = texImage2D;
+    gl.BindFramebuffer = bindFramebuffer;
+    gl.VertexAttribPointer = vertexAttribPointer;
+    gl.GetUniformLocation = uniformLocation;
+
+    renderer = stub::renderer( -1, gl );
+
+    camera->position().z = 10;
+
+    material = MeshBasicMaterial::create();
+    material->map = texture;
+    texture->needsUpdate( true );
+
+    mesh = Mesh::create( geometry, material );
+    scene->add( mesh );
+
+  }
+
+  void render() {
+    context().calls.clear();
+    context().uploadedBuffers.clear();
+    context().uploadedTextures.clear();
+    renderer->render( *scene, *camera );
+  }
+
+  int calls( const char* function ) { return context().calls[ function ]; }
+
+  GLRenderer::Ptr renderer;
+  Scene::Ptr scene;
+  PerspectiveCamera::Ptr camera;
+  Geometry::Ptr geometry;
+  Texture::Ptr texture;
+  Material::Ptr material;
+  Mesh::Ptr mesh;
+
+};
+
+} // namespace
+
+TEST(renderers_gl_renderer_state_cache_test, repeatedBinds) {
+
+  TexturedBox box;
+  box.render();
+
+  EXPECT_LT( 0, box.calls( "BindBuffer" ) );
+  EXPECT_EQ( 1, box.calls( "BindTexture" ) );
+  EXPECT_EQ( 1u, context().uploadedTextures.size() );
+
+  // the same bindings again issue nothing
+
+  box.render();
+
+  EXPECT_EQ( 0, box.calls( "BindBuffer" ) );
+  EXPECT_EQ( 0, box.calls( "BindTexture" ) );
+  EXPECT_EQ( 0, box.calls( "BindFramebuffer" ) );
+  EXPECT_EQ( 0, box.calls( "VertexAttribPointer" ) );
+
+  EXPECT_LT( 0, box.renderer->info().render.bufferBindsSkipped + box.renderer->info().render.attributeCallsSkipped );
+  EXPECT_LT( 0, box.renderer->info().render.textureBindsSkipped );
+
+}
+
+TEST(renderers_gl_renderer_state_cache_test, forgetDeleted) {
+
+  TexturedBox box;
+  box.render();
+
+  box.scene->remove( box.mesh );
+  box.render();
+
+  // a new box's buffers and the texture get the deleted names back, which
+  // the context unbound, so they have to be bound again before uploading
+
+  box.renderer->deallocateGeometry( *box.geometry );
+  box.renderer->deallocateTexture( *box.texture );
+  box.texture->needsUpdate( true );
+
+  box.scene->add( Mesh::create( BoxGeometry::create( 1, 1, 1 ), box.material ) );
+
+  box.render();
+
+  ASSERT_FALSE( context().uploadedBuffers.empty() );
+  EXPECT_EQ( 0u, std::count( context().uploadedBuffers.begin(), context().uploadedBuffers.end(), 0u ) );
+  EXPECT_EQ( context().uploadedBuffers.size(), std::set<GLuint>( context().uploadedBuffers.begin(), context().uploadedBuffers.end() ).size() );
+
+  ASSERT_EQ( 1u, context().uploadedTextures.size() );
+  EXPECT_NE( 0u, context().uploadedTextures[ 0 ] );
+
+}
+
+TEST(renderers_gl_renderer_state_cache_test, invalidate) {
+
+  TexturedBox box;
+  box.render();
+  box.render();
+
+  // after a reset nothing is assumed bound
+
+  box.renderer->resetStates();
+  box.render();
+
+  EXPECT_LT( 0, box.calls( "BindBuffer" ) );
+  EXPECT_EQ( 1, box.calls( "BindTexture" ) );
+  EXPECT_EQ( 1, box.calls( "BindFramebuffer" ) );
+  EXPECT_LT( 0, box.calls( "VertexAttribPointer" ) );
+
+}
@@ -0,0 +1,95 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/sphere_geometry.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+// The type and count of every indexed draw, and the size of every index upload
+std::vector<std::pair<GLenum, GLsizei>>& draws() { static std::vector<std::pair<GLenum, GLsizei>> d; return d; }
+std::vector<GLsizeiptr>& indexUploads() { static std::vector<GLsizeiptr> u; return u; }
+
+void APIENTRY drawElements( GLenum, GLsizei count, GLenum type, const GLvoid* ) { draws().emplace_back( type, count ); }
+
+void APIENTRY bufferData( GLenum target, GLsizeiptr size, const GLvoid*, GLenum ) {
+  if ( target == GL_ELEMENT_ARRAY_BUFFER ) indexUploads().push_back( size );
+}
+
+// A sphere of 25280 faces, 75840 vertices once unrolled
+Geometry::Ptr renderSphere( bool uintIndices ) {
+
+  auto gl = stub::gl();
+  gl.DrawElements = drawElements;
+  gl.BufferData = bufferData;
+
+  RendererParameters parameters;
+  parameters.streamBufferSize = 0;
+  parameters.uintIndices = uintIndices;
+
+  auto renderer = GLRenderer::create( parameters, gl );
+
+  auto scene = Scene::create();
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 1000 );
+  camera->position().z = 10;
+
+  auto geometry = SphereGeometry::create( 1, 160, 80 );
+  scene->add( Mesh::create( geometry, MeshBasicMaterial::create() ) );
+
+  draws().clear();
+  indexUploads().clear();
+  renderer->render( *scene, *camera );
+
+  return geometry;
+
+}
+
+} // namespace
+
+TEST(renderers_gl_renderer_uint_indices_test, oneGroup) {
+
+  auto geometry = renderSphere( true );
+  const auto indices = ( GLsizei )geometry->faces.size() * 3;
+
+  ASSERT_LT( 65535, indices );
+  ASSERT_EQ( 1u, geometry->geometryGroups.size() );
+  EXPECT_TRUE( geometry->geometryGroups[ 0 ]->__glUintIndices );
+
+  ASSERT_EQ( 1u, draws().size() );
+  EXPECT_EQ( ( GLenum )GL_UNSIGNED_INT, draws()[ 0 ].first );
+  EXPECT_EQ( indices, draws()[ 0 ].second );
+
+  // and the faces' indices are uploaded 32-bit
+
+  EXPECT_NE( indexUploads().end(), std::find( indexUploads().begin(), indexUploads().end(), ( GLsizeiptr )indices * 4 ) );
+
+}
+
+TEST(renderers_gl_renderer_uint_indices_test, splitWithout) {
+
+  auto geometry = renderSphere( false );
+  const auto indices = ( GLsizei )geometry->faces.size() * 3;
+
+  // without 32-bit indices the groups stay within 16-bit range
+
+  ASSERT_EQ( 2u, geometry->geometryGroups.size() );
+  EXPECT_FALSE( geometry->geometryGroups[ 0 ]->__glUintIndices );
+  EXPECT_FALSE( geometry->geometryGroups[ 1 ]->__glUintIndices );
+
+  ASSERT_EQ( 2u, draws().size() );
+  EXPECT_EQ( ( GLenum )GL_UNSIGNED_SHORT, draws()[ 0 ].first );
+  EXPECT_EQ( ( GLenum )GL_UNSIGNED_SHORT, draws()[ 1 ].first );
+  EXPECT_GE( 65535, draws()[ 0 ].second );
+  EXPECT_EQ( indices, draws()[ 0 ].second + draws()[ 1 ].second );
+
+}
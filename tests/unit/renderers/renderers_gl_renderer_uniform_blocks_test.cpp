@@ -0,0 +1,213 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/scenes/fog.h>
+#include <three/scenes/fog_exp2.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/lights/ambient_light.h>
+#include <three/lights/directional_light.h>
+#include <three/lights/point_light.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_lambert_material.h>
+#include <three/extras/geometries/box_geometry.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+// The last payload of every uniform buffer, the buffers by block binding
+// and the vertex shader sources
+
+GLuint& boundUniformBuffer() { static GLuint b = 0; return b; }
+std::map<GLuint, std::vector<float>>& payloads() { static std::map<GLuint, std::vector<float>> p; return p; }
+std::map<GLuint, GLuint>& bindings() { static std::map<GLuint, GLuint> b; return b; }
+std::map<GLuint, GLenum>& shaderTypes() { static std::map<GLuint, GLenum> t; return t; }
+std::vector<std::string>& vertexSources() { static std::vector<std::string> s; return s; }
+
+void APIENTRY bindBuffer( GLenum target, GLuint buffer ) {
+  if ( target == GL_UNIFORM_BUFFER ) boundUniformBuffer() = buffer;
+}
+
+void APIENTRY bufferData( GLenum target, GLsizeiptr size, const GLvoid* data, GLenum ) {
+  if ( target != GL_UNIFORM_BUFFER ) return;
+  const auto floats = static_cast<const float*>( data );
+  payloads()[ boundUniformBuffer() ].assign( floats, floats + size / sizeof( float ) );
+}
+
+void APIENTRY bufferSubData( GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data ) {
+  if ( target != GL_UNIFORM_BUFFER ) return;
+  const auto floats = static_cast<const float*>( data );
+  std::copy( floats, floats + size / sizeof( float ), payloads()[ boundUniformBuffer() ].begin() + offset / sizeof( float ) );
+}
+
+void APIENTRY bindBufferBase( GLenum, GLuint index, GLuint buffer ) { bindings()[ index ] = buffer; }
+
+GLuint APIENTRY uniformBlockIndex( GLuint, const GLchar* ) { return 0; }
+void APIENTRY uniformBlockBinding( GLuint, GLuint, GLuint ) { }
+
+GLuint APIENTRY createShader( GLenum type ) {
+  const auto shader = stub::createName();
+  shaderTypes()[ shader ] = type;
+  return shader;
+}
+
+void APIENTRY shaderSource( GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths ) {
+  if ( shaderTypes()[ shader ] != GL_VERTEX_SHADER ) return;
+  std::string source;
+  for ( GLsizei i = 0; i < count; ++i ) source += lengths ? std::string( strings[ i ], lengths[ i ] ) : std::string( strings[ i ] );
+  vertexSources().push_back( source );
+}
+
+const std::vector<float>& block( GLuint binding ) { return payloads()[ bindings()[ binding ] ]; }
+
+// Renders a lit, fogged box, with the shared uniforms in blocks or not
+GLRenderer::Ptr renderBox( bool uniformBlocks, const IFog::Ptr& fog ) {
+
+  auto gl = stub::gl();
+  gl.BindBuffer = bindBuffer;
+  gl.BufferData = bufferData;
+  gl.BufferSubData = bufferSubData;
+  gl.BindBufferBase = bindBufferBase;
+  gl.GetUniformBlockIndex = uniformBlockIndex;
+  gl.UniformBlockBinding = uniformBlockBinding;
+  gl.CreateShader = createShader;
+  gl.ShaderSource = shaderSource;
+
+  RendererParameters parameters;
+  parameters.streamBufferSize = 0;
+  parameters.maxLights = 2;
+  parameters.uniformBlocks = uniformBlocks;
+
+  payloads().clear();
+  bindings().clear();
+  vertexSources().clear();
+
+  auto renderer = GLRenderer::create( parameters, gl );
+
+  auto scene = Scene::create();
+  scene->fog = fog;
+
+  scene->add( AmbientLight::create( 0x336699 ) );
+
+  auto directional = DirectionalLight::create( 0xffffff, 0.5f );
+  directional->position().set( 0, 0, 1 );
+  scene->add( directional );
+
+  auto point = PointLight::create( 0xff0000, 1, 100 );
+  point->position().set( 1, 2, 3 );
+  scene->add( point );
+
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 1000 );
+  camera->position().set( 4, 5, 6 );
+  camera->lookAt( Vector3( 0, 0, 0 ) );
+
+  scene->add( Mesh::create( BoxGeometry::create( 1, 1, 1 ), MeshLambertMaterial::create() ) );
+
+  renderer->render( *scene, *camera );
+
+  return renderer;
+
+}
+
+} // namespace
+
+TEST(renderers_gl_renderer_uniform_blocks_test, cameraBlock) {
+
+  renderBox( true, Fog::create( 0x808080, 10, 2000 ) );
+
+  // two mat4 and the camera position, padded to a vec4
+
+  const auto& camera = block( 0 );
+  ASSERT_EQ( 16u + 16u + 4u, camera.size() );
+
+  EXPECT_FLOAT_EQ( 4, camera[ 32 ] );
+  EXPECT_FLOAT_EQ( 5, camera[ 33 ] );
+  EXPECT_FLOAT_EQ( 6, camera[ 34 ] );
+  EXPECT_EQ( 0, camera[ 35 ] );
+
+}
+
+TEST(renderers_gl_renderer_uniform_blocks_test, fogBlock) {
+
+  renderBox( true, Fog::create( 0x808080, 10, 2000 ) );
+
+  // fogNear fills the vec3 color's fourth slot, far and density follow
+
+  auto fog = block( 2 );
+  ASSERT_EQ( 8u, fog.size() );
+
+  EXPECT_FLOAT_EQ( 128.f / 255, fog[ 0 ] );
+  EXPECT_FLOAT_EQ( 10, fog[ 3 ] );
+  EXPECT_FLOAT_EQ( 2000, fog[ 4 ] );
+  EXPECT_EQ( 0, fog[ 5 ] );
+
+  renderBox( true, FogExp2::create( 0x808080, 0.25f ) );
+
+  fog = block( 2 );
+  ASSERT_EQ( 8u, fog.size() );
+
+  EXPECT_EQ( 0, fog[ 3 ] );
+  EXPECT_EQ( 0, fog[ 4 ] );
+  EXPECT_FLOAT_EQ( 0.25f, fog[ 5 ] );
+
+}
+
+TEST(renderers_gl_renderer_uniform_blocks_test, lightsBlock) {
+
+  renderBox( true, Fog::create( 0x808080, 10, 2000 ) );
+
+  // the ambient color, then 14 arrays of two lights, each element a vec4
+
+  const int lights = 2;
+  const auto& data = block( 1 );
+  ASSERT_EQ( 4u + 14 * 4 * lights, data.size() );
+
+  EXPECT_FLOAT_EQ( 0x33 / 255.f, data[ 0 ] );
+  EXPECT_FLOAT_EQ( 0x99 / 255.f, data[ 2 ] );
+
+  const auto array = []( int index ) { return 4 + index * 4 * lights; };
+
+  // directionalLightColor, directionalLightDirection
+
+  EXPECT_FLOAT_EQ( 0.5f, data[ array( 0 ) ] );
+  EXPECT_FLOAT_EQ( 0.5f, data[ array( 0 ) + 2 ] );
+  EXPECT_EQ( 0, data[ array( 0 ) + 3 ] );
+  EXPECT_EQ( 0, data[ array( 0 ) + 4 ] );
+  EXPECT_FLOAT_EQ( 1, data[ array( 1 ) + 2 ] );
+
+  // pointLightColor, pointLightPosition, pointLightDistance
+
+  EXPECT_FLOAT_EQ( 1, data[ array( 5 ) ] );
+  EXPECT_EQ( 0, data[ array( 5 ) + 1 ] );
+  EXPECT_FLOAT_EQ( 1, data[ array( 6 ) ] );
+  EXPECT_FLOAT_EQ( 2, data[ array( 6 ) + 1 ] );
+  EXPECT_FLOAT_EQ( 3, data[ array( 6 ) + 2 ] );
+  EXPECT_EQ( 0, data[ array( 6 ) + 3 ] );
+  EXPECT_FLOAT_EQ( 100, data[ array( 7 ) ] );
+  EXPECT_EQ( 0, data[ array( 7 ) + 1 ] );
+  EXPECT_EQ( 0, data[ array( 7 ) + 4 ] );
+
+}
+
+TEST(renderers_gl_renderer_uniform_blocks_test, version) {
+
+  renderBox( true, Fog::create( 0x808080, 10, 2000 ) );
+
+  ASSERT_FALSE( vertexSources().empty() );
+  EXPECT_EQ( 0u, vertexSources()[ 0 ].find( "#version 140\n" ) );
+
+  // plain uniforms keep the default GLSL version
+
+  renderBox( false, Fog::create( 0x808080, 10, 2000 ) );
+
+  EXPECT_TRUE( payloads().empty() );
+  ASSERT_FALSE( vertexSources().empty() );
+  EXPECT_EQ( std::string::npos, vertexSources()[ 0 ].find( "#version" ) );
+
+}
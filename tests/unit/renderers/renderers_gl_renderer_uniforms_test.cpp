@@ -0,0 +1,114 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/scenes/fog.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/box_geometry.h>
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace three;
+
+namespace {
+
+// The uniform names by location, and every material uniform uploaded
+std::map<GLint, std::string>& names() { static std::map<GLint, std::string> n; return n; }
+std::vector<std::pair<std::string, std::vector<float>>>& uploads() { static std::vector<std::pair<std::string, std::vector<float>>> u; return u; }
+
+// A location for every uniform but those of features the programs here
+// compile out, whose default values would not load
+GLint APIENTRY uniformLocation( GLuint, const GLchar* name ) {
+  static const std::set<std::string> missing { "bumpMap", "bumpScale", "normalMap", "flipEnvMap", "useRefract", "morphTargetInfluences" };
+  const std::string uniform( name );
+  if ( missing.count( uniform ) || uniform.compare( 0, 6, "shadow" ) == 0 || uniform.compare( 0, 9, "spotLight" ) == 0 ) return -1;
+  for ( const auto& location : names() ) if ( location.second == uniform ) return location.first;
+  const GLint location = ( GLint )names().size();
+  names()[ location ] = uniform;
+  return location;
+}
+
+// The object and camera matrices are loaded for every draw, the rest go
+// through the uniform shadows
+void upload( GLint location, const float* values, int count ) {
+  static const std::set<std::string> perDraw { "modelMatrix", "modelViewMatrix", "normalMatrix", "projectionMatrix", "viewMatrix", "cameraPosition" };
+  const auto& name = names()[ location ];
+  if ( ! perDraw.count( name ) ) uploads().emplace_back( name, std::vector<float>( values, values + count ) );
+}
+
+void APIENTRY uniform1i( GLint location, GLint v ) { const float f = ( float )v; upload( location, &f, 1 ); }
+void APIENTRY uniform1f( GLint location, GLfloat v ) { upload( location, &v, 1 ); }
+void APIENTRY uniform2f( GLint location, GLfloat x, GLfloat y ) { const float v[] = { x, y }; upload( location, v, 2 ); }
+void APIENTRY uniform3f( GLint location, GLfloat x, GLfloat y, GLfloat z ) { const float v[] = { x, y, z }; upload( location, v, 3 ); }
+void APIENTRY uniform4f( GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w ) { const float v[] = { x, y, z, w }; upload( location, v, 4 ); }
+void APIENTRY uniform1fv( GLint location, GLsizei count, const GLfloat* v ) { upload( location, v, count ); }
+void APIENTRY uniform3fv( GLint location, GLsizei count, const GLfloat* v ) { upload( location, v, 3 * count ); }
+void APIENTRY uniformMatrix3fv( GLint location, GLsizei count, GLboolean, const GLfloat* v ) { upload( location, v, 9 * count ); }
+void APIENTRY uniformMatrix4fv( GLint location, GLsizei count, GLboolean, const GLfloat* v ) { upload( location, v, 16 * count ); }
+
+GLInterface uniformsGL() {
+  auto gl = stub::gl();
+  gl.GetUniformLocation = uniformLocation;
+  gl.Uniform1i = uniform1i;
+  gl.Uniform1f = uniform1f;
+  gl.Uniform2f = uniform2f;
+  gl.Uniform3f = uniform3f;
+  gl.Uniform4f = uniform4f;
+  gl.Uniform1fv = uniform1fv;
+  gl.Uniform3fv = uniform3fv;
+  gl.UniformMatrix3fv = uniformMatrix3fv;
+  gl.UniformMatrix4fv = uniformMatrix4fv;
+  return gl;
+}
+
+} // namespace
+
+TEST(renderers_gl_renderer_uniforms_test, shadowed) {
+
+  auto renderer = stub::renderer( -1, uniformsGL() );
+
+  auto scene = Scene::create();
+  scene->fog = Fog::create( 0x808080, 10, 2000 );
+
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 1000 );
+  camera->position().z = 10;
+
+  auto material = MeshBasicMaterial::create();
+  material->color.set( 0xff0000 );
+
+  scene->add( Mesh::create( BoxGeometry::create( 1, 1, 1 ), material ) );
+
+  uploads().clear();
+  renderer->render( *scene, *camera );
+
+  EXPECT_FALSE( uploads().empty() );
+  EXPECT_LT( 0, renderer->info().render.uniformUploads );
+
+  // the same values again load nothing
+
+  uploads().clear();
+  renderer->render( *scene, *camera );
+
+  EXPECT_TRUE( uploads().empty() );
+  EXPECT_EQ( 0, renderer->info().render.uniformUploads );
+  EXPECT_LT( 0, renderer->info().render.uniformUploadsSkipped );
+
+  // and a changed value loads just that one
+
+  material->opacity = 0.5f;
+
+  uploads().clear();
+  renderer->render( *scene, *camera );
+
+  ASSERT_EQ( 1u, uploads().size() );
+  EXPECT_EQ( "opacity", uploads()[ 0 ].first );
+  EXPECT_EQ( std::vector<float> { 0.5f }, uploads()[ 0 ].second );
+  EXPECT_EQ( 1, renderer->info().render.uniformUploads );
+
+}
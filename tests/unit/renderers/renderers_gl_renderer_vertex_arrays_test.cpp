@@ -0,0 +1,132 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/materials/mesh_lambert_material.h>
+#include <three/extras/geometries/box_geometry.h>
+#include <three/extras/geometries/sphere_geometry.h>
+
+#include <map>
+#include <string>
+
+using namespace three;
+
+namespace {
+
+std::map<std::string, int>& calls() { static std::map<std::string, int> c; return c; }
+
+void APIENTRY genVertexArrays( GLsizei n, GLuint* arrays ) {
+  ++ calls()[ "GenVertexArrays" ];
+  stub::genNames( n, arrays );
+}
+
+void APIENTRY deleteVertexArrays( GLsizei, const GLuint* ) { }
+void APIENTRY bindVertexArray( GLuint ) { ++ calls()[ "BindVertexArray" ]; }
+
+void APIENTRY vertexAttribPointer( GLuint, GLint, GLenum, GLboolean, GLsizei, const GLvoid* ) {
+  ++ calls()[ "VertexAttribPointer" ];
+}
+
+// Two meshes, so that every frame switches between their arrays
+struct Meshes {
+
+  Meshes()
+    : scene( Scene::create() ),
+      camera( PerspectiveCamera::create( 50, 1, 1, 1000 ) ),
+      box( Mesh::create( BoxGeometry::create( 1, 1, 1 ), MeshBasicMaterial::create() ) ),
+      sphere( Mesh::create( SphereGeometry::create( 1 ), MeshBasicMaterial::create() ) ) {
+
+    auto gl = stub::gl();
+    gl.GenVertexArrays = genVertexArrays;
+    gl.DeleteVertexArrays = deleteVertexArrays;
+    gl.BindVertexArray = bindVertexArray;
+    gl.VertexAttribPointer = vertexAttribPointer;
+
+    renderer = stub::renderer( -1, gl );
+
+    camera->position().z = 10;
+    box->position().x = -2;
+    sphere->position().x = 2;
+
+    scene->add( box );
+    scene->add( sphere );
+
+  }
+
+  void render() {
+    calls().clear();
+    renderer->render( *scene, *camera );
+  }
+
+  GLRenderer::Ptr renderer;
+  Scene::Ptr scene;
+  PerspectiveCamera::Ptr camera;
+  Mesh::Ptr box, sphere;
+
+};
+
+} // namespace
+
+TEST(renderers_gl_renderer_vertex_arrays_test, replay) {
+
+  Meshes meshes;
+  meshes.render();
+
+  EXPECT_EQ( 2, calls()[ "GenVertexArrays" ] );
+  EXPECT_LT( 0, calls()[ "VertexAttribPointer" ] );
+
+  // the recorded arrays are bound again, with no attribute setup
+
+  meshes.render();
+
+  EXPECT_EQ( 0, calls()[ "GenVertexArrays" ] );
+  EXPECT_LE( 2, calls()[ "BindVertexArray" ] );
+  EXPECT_EQ( 0, calls()[ "VertexAttribPointer" ] );
+
+}
+
+TEST(renderers_gl_renderer_vertex_arrays_test, newProgram) {
+
+  Meshes meshes;
+  meshes.render();
+  meshes.render();
+
+  // another program may place the attributes elsewhere
+
+  meshes.box->material = MeshLambertMaterial::create();
+  meshes.render();
+
+  EXPECT_EQ( 1, calls()[ "GenVertexArrays" ] );
+  EXPECT_LT( 0, calls()[ "VertexAttribPointer" ] );
+
+  meshes.render();
+
+  EXPECT_EQ( 0, calls()[ "GenVertexArrays" ] );
+  EXPECT_EQ( 0, calls()[ "VertexAttribPointer" ] );
+
+}
+
+TEST(renderers_gl_renderer_vertex_arrays_test, wireframe) {
+
+  Meshes meshes;
+  meshes.render();
+  meshes.render();
+
+  // wireframe draws bind the line index buffer instead
+
+  meshes.sphere->material->wireframe = true;
+  meshes.render();
+
+  EXPECT_EQ( 1, calls()[ "GenVertexArrays" ] );
+  EXPECT_LT( 0, calls()[ "VertexAttribPointer" ] );
+
+  meshes.render();
+
+  EXPECT_EQ( 0, calls()[ "GenVertexArrays" ] );
+  EXPECT_EQ( 0, calls()[ "VertexAttribPointer" ] );
+
+}
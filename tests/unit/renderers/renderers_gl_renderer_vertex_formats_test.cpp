@@ -0,0 +1,65 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_lambert_material.h>
+#include <three/extras/geometries/sphere_geometry.h>
+
+using namespace three;
+
+namespace {
+
+const char* sVersion = "";
+const char* sExtensions = "";
+
+const GLubyte* APIENTRY getString( GLenum name ) {
+  return reinterpret_cast<const GLubyte*>( name == GL_VERSION ? sVersion : sExtensions );
+}
+
+// Bytes uploaded for a sphere with compact normals, on a context reporting
+// `version` and `extensions`
+size_t uploadedBytes( const char* version, const char* extensions ) {
+
+  sVersion = version;
+  sExtensions = extensions;
+
+  auto gl = stub::gl();
+  gl.GetString = getString;
+
+  auto renderer = stub::renderer( -1, gl );
+
+  auto scene = Scene::create();
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 1000 );
+  camera->position().z = 200;
+
+  auto geometry = SphereGeometry::create( 10, 8, 8 );
+  geometry->vertexFormats.normal = THREE::Int2101010VertexFormat;
+
+  scene->add( Mesh::create( geometry, MeshLambertMaterial::create() ) );
+
+  renderer->render( *scene, *camera );
+
+  return renderer->info().render.bufferBytesUploaded;
+
+}
+
+} // namespace
+
+TEST(renderers_gl_renderer_vertex_formats_test, fallsBackToFloats) {
+
+  const auto compact = uploadedBytes( "3.3.0", "" );
+  const auto floats = uploadedBytes( "2.1 Mesa", "" );
+
+  EXPECT_GT( floats, compact );
+
+  // or an older context with the extensions
+
+  EXPECT_EQ( compact, uploadedBytes( "3.0", "GL_ARB_vertex_type_2_10_10_10_rev" ) );
+  EXPECT_EQ( compact, uploadedBytes( "2.1", "GL_ARB_half_float_vertex GL_ARB_vertex_type_2_10_10_10_rev GL_EXT_foo" ) );
+  EXPECT_EQ( floats, uploadedBytes( "2.1", "GL_ARB_vertex_type_2_10_10_10_rev_x" ) );
+  EXPECT_EQ( floats, uploadedBytes( "", "" ) );
+
+}
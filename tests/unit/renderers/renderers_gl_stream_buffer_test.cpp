@@ -0,0 +1,220 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/renderers/gl_stream_buffer.h>
+#include <three/renderers/gl_renderer.h>
+#include <three/renderers/renderer_parameters.h>
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/core/geometry.h>
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+using namespace three;
+
+// Stub GL: buffer 1 is the ring, writes go to `stubStorage`
+
+namespace {
+
+std::vector<unsigned char> stubStorage;
+std::vector<unsigned char> stubTarget;
+int stubAllocations = 0;
+
+void APIENTRY stubGenBuffers( GLsizei, GLuint* buffers ) { *buffers = 1; }
+void APIENTRY stubDeleteBuffers( GLsizei, const GLuint* ) { }
+void APIENTRY stubBindBuffer( GLenum, GLuint ) { }
+
+void APIENTRY stubBufferData( GLenum, GLsizeiptr size, const void*, GLenum ) {
+  stubStorage.assign( size, 0 );
+  stubAllocations ++;
+}
+
+void APIENTRY stubBufferSubData( GLenum, GLintptr offset, GLsizeiptr size, const void* data ) {
+  std::memcpy( &stubStorage[ offset ], data, size );
+}
+
+void* APIENTRY stubMapBufferRange( GLenum, GLintptr offset, GLsizeiptr, GLbitfield ) {
+  return &stubStorage[ offset ];
+}
+
+GLboolean APIENTRY stubUnmapBuffer( GLenum ) { return GL_TRUE; }
+
+void APIENTRY stubCopyBufferSubData( GLenum, GLenum, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size ) {
+  stubTarget.resize( writeOffset + size );
+  std::memcpy( &stubTarget[ writeOffset ], &stubStorage[ readOffset ], size );
+}
+
+GLInterface stubInterface() {
+  GLInterface gl;
+  gl.GenBuffers = stubGenBuffers;
+  gl.DeleteBuffers = stubDeleteBuffers;
+  gl.BindBuffer = stubBindBuffer;
+  gl.BufferData = stubBufferData;
+  gl.BufferSubData = stubBufferSubData;
+  gl.MapBufferRange = stubMapBufferRange;
+  gl.UnmapBuffer = stubUnmapBuffer;
+  gl.CopyBufferSubData = stubCopyBufferSubData;
+  return gl;
+}
+
+} // namespace
+
+TEST(renderers_gl_stream_buffer_test, disabled) {
+  GLInterfaceWrapper gl( stubInterface() );
+
+  GLStreamBuffer empty( gl, 0 );
+  EXPECT_FALSE( empty.enabled() );
+
+  GLInterface missing = stubInterface();
+  missing.MapBufferRange = nullptr;
+  GLInterfaceWrapper glMissing( missing );
+
+  GLStreamBuffer unsupported( glMissing, 256 );
+  EXPECT_FALSE( unsupported.enabled() );
+}
+
+TEST(renderers_gl_stream_buffer_test, writeAndWrap) {
+  GLInterfaceWrapper gl( stubInterface() );
+  GLStreamBuffer stream( gl, 64 );
+  ASSERT_TRUE( stream.enabled() );
+
+  const float a[ 3 ] = { 1, 2, 3 };
+  const float b[ 5 ] = { 4, 5, 6, 7, 8 };
+
+  // offsets are aligned to 16 bytes
+
+  EXPECT_EQ( 0u, stream.write( a, sizeof( a ) ) );
+  EXPECT_EQ( 16u, stream.write( b, sizeof( b ) ) );
+  EXPECT_EQ( 0, std::memcmp( &stubStorage[ 16 ], b, sizeof( b ) ) );
+  EXPECT_EQ( 0, stream.orphans() );
+
+  // 48 + 20 doesn't fit, the ring starts over on fresh storage
+
+  stubAllocations = 0;
+  EXPECT_EQ( 0u, stream.write( b, sizeof( b ) ) );
+  EXPECT_EQ( 1, stream.orphans() );
+  EXPECT_EQ( 1, stubAllocations );
+  EXPECT_EQ( 0, std::memcmp( &stubStorage[ 0 ], b, sizeof( b ) ) );
+}
+
+TEST(renderers_gl_stream_buffer_test, reserve) {
+  GLInterfaceWrapper gl( stubInterface() );
+  GLStreamBuffer stream( gl, 64 );
+
+  const float b[ 5 ] = { 4, 5, 6, 7, 8 };
+  EXPECT_EQ( 32u, GLStreamBuffer::footprint( sizeof( b ) ) );
+
+  stream.write( b, sizeof( b ) );
+
+  // two more writes of b take 64 bytes from 32, only one fits
+
+  stream.reserve( GLStreamBuffer::footprint( sizeof( b ) ) );
+  EXPECT_EQ( 0, stream.orphans() );
+
+  stream.reserve( 2 * GLStreamBuffer::footprint( sizeof( b ) ) );
+  EXPECT_EQ( 1, stream.orphans() );
+  EXPECT_EQ( 0u, stream.write( b, sizeof( b ) ) );
+}
+
+TEST(renderers_gl_stream_buffer_test, upload) {
+  GLInterfaceWrapper gl( stubInterface() );
+  GLStreamBuffer stream( gl, 64 );
+
+  const unsigned short indices[ 6 ] = { 0, 1, 2, 2, 1, 3 };
+
+  stubTarget.clear();
+  stream.upload( 2, indices, sizeof( indices ) );
+
+  ASSERT_EQ( sizeof( indices ), stubTarget.size() );
+  EXPECT_EQ( 0, std::memcmp( stubTarget.data(), indices, sizeof( indices ) ) );
+}
+
+// A renderer streaming an immediate object's attributes: the ring may only
+// be orphaned between draws, never after an attribute was pointed into it
+
+namespace {
+
+struct ImmediateObject : public Object3D {
+  THREE::Type type() const override { return THREE::ImmediateRenderObject; }
+  void visit( Visitor& v ) override { v( *this ); }
+};
+
+std::map<GLenum, GLuint> bound;
+GLuint ring = 0;
+bool pointedIntoRing = false;
+int orphansAfterPointer = 0;
+int draws = 0;
+
+void APIENTRY recordBindBuffer( GLenum target, GLuint buffer ) { bound[ target ] = buffer; }
+
+void APIENTRY recordBufferData( GLenum target, GLsizeiptr, const void*, GLenum ) {
+  if ( target != GL_COPY_WRITE_BUFFER ) return;
+  ring = bound[ target ];
+  if ( pointedIntoRing ) ++ orphansAfterPointer;
+}
+
+void APIENTRY recordVertexAttribPointer( GLuint, GLint, GLenum, GLboolean, GLsizei, const void* ) {
+  if ( bound[ GL_ARRAY_BUFFER ] == ring ) pointedIntoRing = true;
+}
+
+void APIENTRY recordDrawArrays( GLenum, GLint, GLsizei ) {
+  pointedIntoRing = false;
+  ++ draws;
+}
+
+void* APIENTRY scratchMapBufferRange( GLenum, GLintptr, GLsizeiptr size, GLbitfield ) {
+  static std::vector<unsigned char> scratch;
+  scratch.resize( size );
+  return scratch.data();
+}
+
+} // namespace
+
+TEST(renderers_gl_stream_buffer_test, immediateObject) {
+
+  auto gl = stub::gl();
+  gl.BindBuffer = recordBindBuffer;
+  gl.BufferData = recordBufferData;
+  gl.VertexAttribPointer = recordVertexAttribPointer;
+  gl.DrawArrays = recordDrawArrays;
+  gl.MapBufferRange = scratchMapBufferRange;
+  gl.UnmapBuffer = stubUnmapBuffer;
+  gl.CopyBufferSubData = stubCopyBufferSubData;
+
+  // seven triangles' worth of positions and normals, 84 bytes each, take
+  // 96 of the ring with alignment. The second frame's positions still fit
+  // into the 300 bytes, its normals do not.
+
+  RendererParameters parameters;
+  parameters.streamBufferSize = 300;
+
+  auto renderer = GLRenderer::create( parameters, gl );
+
+  auto scene = Scene::create();
+  auto camera = PerspectiveCamera::create( 50, 1, 1, 1000 );
+
+  auto object = std::make_shared<ImmediateObject>();
+  object->material = MeshBasicMaterial::create();
+  object->geometry = Geometry::create();
+  scene->add( object );
+
+  for ( int frame = 0; frame < 4; ++frame ) {
+
+    auto& data = object->glImmediateData;
+    data.positionArray.assign( 21, 1.f );
+    data.normalArray.assign( 21, 0.f );
+    data.hasPositions = data.hasNormals = true;
+    data.count = 7;
+
+    renderer->render( *scene, *camera );
+
+  }
+
+  EXPECT_EQ( 4, draws );
+  EXPECT_EQ( 0, orphansAfterPointer );
+
+}
@@ -0,0 +1,122 @@
+#include "gtest/gtest.h"
+
+#include <tests/stub_gl.h>
+
+#include <three/renderers/occlusion_buffer.h>
+#include <three/scenes/scene.h>
+#include <three/cameras/perspective_camera.h>
+#include <three/objects/mesh.h>
+#include <three/materials/mesh_basic_material.h>
+#include <three/extras/geometries/box_geometry.h>
+#include <three/extras/geometries/plane_geometry.h>
+
+using namespace three;
+
+namespace {
+
+struct Scene3 {
+
+  Scene3() : scene( Scene::create() ), camera( PerspectiveCamera::create( 50, 2, 1, 1000 ) ) {
+
+    camera->position().z = 100;
+
+    auto material = MeshBasicMaterial::create();
+
+    wall = Mesh::create( PlaneGeometry::create( 60, 60, 2, 2 ), material );
+    wall->occluder = true;
+    scene->add( wall );
+
+    hidden = Mesh::create( BoxGeometry::create( 10, 10, 10 ), material );
+    hidden->position().z = -50;
+    scene->add( hidden );
+
+    aside = Mesh::create( BoxGeometry::create( 10, 10, 10 ), material );
+    aside->position().set( 60, 0, -50 );
+    scene->add( aside );
+
+    scene->updateMatrixWorld();
+    camera->updateMatrixWorld();
+    camera->matrixWorldInverse.getInverse( camera->matrixWorld );
+
+    for ( auto& mesh : { wall, hidden, aside } ) mesh->geometry->computeBoundingSphere();
+
+  }
+
+  Matrix4 viewProjection() const {
+    return Matrix4().multiplyMatrices( camera->projectionMatrix, camera->matrixWorldInverse );
+  }
+
+  Scene::Ptr scene;
+  PerspectiveCamera::Ptr camera;
+  Mesh::Ptr wall, hidden, aside;
+
+};
+
+} // namespace
+
+TEST(renderers_occlusion_buffer_test, hidesBehindOccluder) {
+
+  Scene3 s;
+
+  OcclusionBuffer buffer( 64, 32 );
+  buffer.clear( s.viewProjection() );
+  buffer.addOccluder( *s.wall );
+
+  EXPECT_EQ( 8u, buffer.triangleCount() );
+
+  buffer.rasterize( TaskScheduler::create( 2 ).get() );
+
+  // the middle of the screen is covered, the corners are not
+
+  EXPECT_LT( buffer.depth( 32, 16 ), 1.f );
+  EXPECT_EQ( std::numeric_limits<float>::infinity(), buffer.depth( 0, 0 ) );
+
+  EXPECT_TRUE( buffer.occludes( *s.hidden ) );
+  EXPECT_FALSE( buffer.occludes( *s.aside ) );
+
+  // in front of the wall
+
+  s.hidden->position().z = 20;
+  s.hidden->updateMatrixWorld();
+
+  EXPECT_FALSE( buffer.occludes( *s.hidden ) );
+
+}
+
+TEST(renderers_occlusion_buffer_test, partialCoverage) {
+
+  Scene3 s;
+
+  // only half the pixels under the box are behind the wall
+
+  s.hidden->position().x = 45;
+  s.hidden->updateMatrixWorld();
+
+  OcclusionBuffer buffer;
+  buffer.clear( s.viewProjection() );
+  buffer.addOccluder( *s.wall );
+  buffer.rasterize();
+
+  EXPECT_FALSE( buffer.occludes( *s.hidden ) );
+
+}
+
+TEST(renderers_occlusion_buffer_test, renderer) {
+
+  auto renderer = stub::renderer( 2 );
+
+  Scene3 s;
+
+  renderer->render( *s.scene, *s.camera );
+
+  EXPECT_EQ( 3, renderer->info().render.objectsDrawn );
+  EXPECT_EQ( 0, renderer->info().render.objectsOccluded );
+
+  renderer->occlusionCulling = true;
+  renderer->render( *s.scene, *s.camera );
+
+  EXPECT_EQ( 2, renderer->info().render.objectsDrawn );
+  EXPECT_EQ( 1, renderer->info().render.objectsOccluded );
+  EXPECT_EQ( 2, renderer->info().render.calls );
+
+}
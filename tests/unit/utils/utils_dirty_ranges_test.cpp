@@ -0,0 +1,106 @@
+#include "gtest/gtest.h"
+
+#include <three/utils/dirty_ranges.h>
+
+using namespace three;
+
+TEST(utils_dirty_ranges_test, merge) {
+  DirtyRanges ranges;
+  EXPECT_TRUE( ranges.empty() );
+
+  ranges.add( 10, 5 );  // 10..14
+  ranges.add( 0, 2 );   // 0..1
+  ranges.add( 12, 8 );  // 12..19, overlaps
+  ranges.add( 20, 1 );  // 20, adjacent
+  ranges.add( 30, 0 );  // ignored
+
+  const auto& merged = ranges.merge();
+  ASSERT_EQ( 2u, merged.size() );
+  EXPECT_EQ( 0, merged[ 0 ].first );
+  EXPECT_EQ( 2, merged[ 0 ].count );
+  EXPECT_EQ( 10, merged[ 1 ].first );
+  EXPECT_EQ( 11, merged[ 1 ].count );
+
+  EXPECT_TRUE( ranges.contains( 1 ) );
+  EXPECT_FALSE( ranges.contains( 2 ) );
+  EXPECT_TRUE( ranges.contains( 20 ) );
+  EXPECT_FALSE( ranges.contains( 21 ) );
+
+  ranges.clear();
+  EXPECT_TRUE( ranges.empty() );
+  EXPECT_FALSE( ranges.contains( 1 ) );
+}
+
+TEST(utils_dirty_ranges_test, adjacent) {
+  DirtyRanges ranges;
+
+  ranges.add( 4, 2 );   // 4..5
+  ranges.add( 0, 4 );   // 0..3, ends where the first starts
+  ranges.add( 7, 1 );   // 7, one gap after
+
+  const auto& merged = ranges.merge();
+  ASSERT_EQ( 2u, merged.size() );
+  EXPECT_EQ( 0, merged[ 0 ].first );
+  EXPECT_EQ( 6, merged[ 0 ].count );
+  EXPECT_EQ( 7, merged[ 1 ].first );
+  EXPECT_EQ( 1, merged[ 1 ].count );
+
+  EXPECT_FALSE( ranges.contains( 6 ) );
+}
+
+TEST(utils_dirty_ranges_test, overlapping) {
+  DirtyRanges ranges;
+
+  ranges.add( 2, 6 );   // 2..7
+  ranges.add( 3, 2 );   // 3..4, inside
+  ranges.add( 6, 4 );   // 6..9, past the end
+  ranges.add( 2, 1 );   // same start
+
+  const auto& merged = ranges.merge();
+  ASSERT_EQ( 1u, merged.size() );
+  EXPECT_EQ( 2, merged[ 0 ].first );
+  EXPECT_EQ( 8, merged[ 0 ].count );
+
+  EXPECT_FALSE( ranges.contains( 1 ) );
+  EXPECT_TRUE( ranges.contains( 9 ) );
+  EXPECT_FALSE( ranges.contains( 10 ) );
+}
+
+TEST(utils_dirty_ranges_test, resetAfterUpload) {
+  DirtyRanges ranges;
+
+  ranges.add( 0, 10 );
+  ranges.merge();
+  ranges.clear();
+
+  EXPECT_TRUE( ranges.merge().empty() );
+
+  // ranges added after the reset are merged on their own
+
+  ranges.add( 20, 2 );
+  ranges.add( 22, 2 );
+
+  const auto& merged = ranges.merge();
+  ASSERT_EQ( 1u, merged.size() );
+  EXPECT_EQ( 20, merged[ 0 ].first );
+  EXPECT_EQ( 4, merged[ 0 ].count );
+  EXPECT_FALSE( ranges.contains( 5 ) );
+}
+
+TEST(utils_dirty_ranges_test, fullRange) {
+  DirtyRanges ranges;
+
+  ranges.add( 3, 2 );
+  ranges.add( 90, 5 );
+  ranges.add( 0, 100 );  // the whole buffer absorbs the rest
+  ranges.add( 50, 1 );
+
+  const auto& merged = ranges.merge();
+  ASSERT_EQ( 1u, merged.size() );
+  EXPECT_EQ( 0, merged[ 0 ].first );
+  EXPECT_EQ( 100, merged[ 0 ].count );
+
+  // merging again keeps it
+
+  EXPECT_EQ( 1u, ranges.merge().size() );
+}
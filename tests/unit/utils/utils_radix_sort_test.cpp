@@ -0,0 +1,68 @@
+#include "gtest/gtest.h"
+
+#include <three/utils/radix_sort.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace three;
+
+typedef std::pair<std::uint64_t, int> Item;
+
+static std::uint64_t itemKey( const Item& item ) {
+  return item.first;
+}
+
+TEST(utils_radix_sort_test, empty) {
+  std::vector<Item> items, scratch;
+  radixSort( items, scratch, itemKey );
+  EXPECT_TRUE( items.empty() );
+}
+
+TEST(utils_radix_sort_test, sorted) {
+  std::vector<Item> items, scratch;
+  items.push_back( Item( 1ULL << 63, 0 ) );
+  items.push_back( Item( 42, 1 ) );
+  items.push_back( Item( 0x0000ff0000000000ULL, 2 ) );
+  items.push_back( Item( 0, 3 ) );
+  items.push_back( Item( 7, 4 ) );
+
+  radixSort( items, scratch, itemKey );
+
+  EXPECT_EQ( 5u, items.size() );
+  EXPECT_EQ( 3, items[ 0 ].second );
+  EXPECT_EQ( 4, items[ 1 ].second );
+  EXPECT_EQ( 1, items[ 2 ].second );
+  EXPECT_EQ( 2, items[ 3 ].second );
+  EXPECT_EQ( 0, items[ 4 ].second );
+}
+
+TEST(utils_radix_sort_test, stable) {
+  std::vector<Item> items, scratch;
+  for ( int i = 0; i < 1000; ++i ) {
+    items.push_back( Item( ( i * 7919 ) % 13, i ) );
+  }
+
+  radixSort( items, scratch, itemKey );
+
+  for ( size_t i = 1; i < items.size(); ++i ) {
+    EXPECT_TRUE( items[ i - 1 ].first <= items[ i ].first );
+    if ( items[ i - 1 ].first == items[ i ].first ) {
+      EXPECT_TRUE( items[ i - 1 ].second < items[ i ].second );
+    }
+  }
+}
+
+TEST(utils_radix_sort_test, identicalKeys) {
+  std::vector<Item> items, scratch;
+  for ( int i = 0; i < 10; ++i ) {
+    items.push_back( Item( 0xabcdef, i ) );
+  }
+
+  radixSort( items, scratch, itemKey );
+
+  for ( int i = 0; i < 10; ++i ) {
+    EXPECT_EQ( i, items[ i ].second );
+  }
+}
@@ -0,0 +1,81 @@
+#include "gtest/gtest.h"
+
+#include <three/utils/vertex_encoding.h>
+
+#include <vector>
+
+using namespace three;
+
+TEST(utils_vertex_encoding_test, halfFloat) {
+  EXPECT_EQ( 0x0000, toHalfFloat( 0.f ) );
+  EXPECT_EQ( 0x3c00, toHalfFloat( 1.f ) );
+  EXPECT_EQ( 0x3800, toHalfFloat( 0.5f ) );
+  EXPECT_EQ( 0xc000, toHalfFloat( -2.f ) );
+  EXPECT_EQ( 0x7bff, toHalfFloat( 65504.f ) );
+  EXPECT_EQ( 0x7c00, toHalfFloat( 1e6f ) );
+  EXPECT_EQ( 0x0001, toHalfFloat( 5.96046448e-8f ) ); // smallest denormal
+  EXPECT_EQ( 0x3c00, toHalfFloat( 1.0002f ) );         // rounds down
+  EXPECT_EQ( 0x3c01, toHalfFloat( 1.0008f ) );         // rounds up
+}
+
+TEST(utils_vertex_encoding_test, packInt2101010) {
+  EXPECT_EQ( 0u, packInt2101010( 0, 0, 0, 0 ) );
+  EXPECT_EQ( 511u, packInt2101010( 1, 0, 0, 0 ) );
+  EXPECT_EQ( 513u << 10, packInt2101010( 0, -1, 0, 0 ) );
+  EXPECT_EQ( 511u << 20, packInt2101010( 0, 0, 2, 0 ) );  // clamped
+  EXPECT_EQ( 3u << 30, packInt2101010( 0, 0, 0, -1 ) );
+}
+
+TEST(utils_vertex_encoding_test, sizes) {
+  EXPECT_EQ( 12u, VertexEncoding( THREE::FloatVertexFormat, 3 ).size() );
+  EXPECT_EQ( 4u, VertexEncoding( THREE::HalfFloatVertexFormat, 2 ).size() );
+  EXPECT_EQ( 4u, VertexEncoding( THREE::Int2101010VertexFormat, 3 ).size() );
+  EXPECT_EQ( 8u, VertexEncoding( THREE::UnsignedShortVertexFormat, 3 ).size() );
+  EXPECT_EQ( 4u, VertexEncoding( THREE::UnsignedByteVertexFormat, 4 ).size() );
+}
+
+TEST(utils_vertex_encoding_test, quantize) {
+  const std::vector<float> positions = { -2, 0, 5,   2, 0, 7,   0, 0, 6 };
+
+  VertexEncoding encoding( THREE::UnsignedShortVertexFormat, 3 );
+  encoding.fit( positions.data(), 3 );
+
+  EXPECT_EQ( -2.f, encoding.offset[ 0 ] );
+  EXPECT_EQ( 4.f, encoding.scale[ 0 ] );
+  EXPECT_EQ( 1.f, encoding.scale[ 1 ] ); // flat axis
+
+  std::vector<unsigned char> bytes( 3 * encoding.size() );
+  encoding.encode( positions.data(), 3, bytes.data() );
+
+  std::vector<std::uint16_t> values( bytes.size() / 2 );
+  std::memcpy( values.data(), bytes.data(), bytes.size() );
+
+  EXPECT_EQ( 0, values[ 0 ] );
+  EXPECT_EQ( 0, values[ 2 ] );
+  EXPECT_EQ( 65535, values[ 4 ] );
+  EXPECT_EQ( 65535, values[ 6 ] );
+  EXPECT_EQ( 32768, values[ 8 ] );
+  EXPECT_EQ( 0, values[ 3 ] ); // padding
+}
+
+TEST(utils_vertex_encoding_test, bytes) {
+  const std::vector<float> skin = { 0, 3, 17, 300,   0.25f, 0.75f, 0, 1 };
+
+  VertexEncoding indices( THREE::UnsignedByteVertexFormat, 4 );
+  indices.normalized = false;
+
+  VertexEncoding weights( THREE::UnsignedByteVertexFormat, 4 );
+
+  unsigned char bytes[ 8 ];
+  indices.encode( &skin[ 0 ], 1, bytes );
+  weights.encode( &skin[ 4 ], 1, bytes + 4 );
+
+  EXPECT_EQ( 0, bytes[ 0 ] );
+  EXPECT_EQ( 3, bytes[ 1 ] );
+  EXPECT_EQ( 17, bytes[ 2 ] );
+  EXPECT_EQ( 255, bytes[ 3 ] );
+  EXPECT_EQ( 64, bytes[ 4 ] );
+  EXPECT_EQ( 191, bytes[ 5 ] );
+  EXPECT_EQ( 0, bytes[ 6 ] );
+  EXPECT_EQ( 255, bytes[ 7 ] );
+}
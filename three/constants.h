@@ -117,6 +117,17 @@ enum DataType {
   FloatType         = 1015
 };
 
+// Encodings for vertex attribute arrays, which are floats on the CPU.
+// The compact ones need GL 3.3 (or ARB_vertex_type_2_10_10_10_rev), and fall
+// back to FloatVertexFormat elsewhere.
+enum VertexFormat {
+  FloatVertexFormat = 0,
+  HalfFloatVertexFormat,     // 16-bit floats (uvs)
+  Int2101010VertexFormat,    // signed normalized 10:10:10:2 (normals, tangents)
+  UnsignedShortVertexFormat, // normalized 16-bit, positions rescaled to their bounds
+  UnsignedByteVertexFormat   // 8-bit, normalized except for skin indices
+};
+
 enum PixelType {
   //UnsignedByteType    = 1009,
   UnsignedShort4444Type = 1016,
@@ -182,7 +193,8 @@ enum Type {
   LOD,
   Vector3,
   Box3,
-  Sphere
+  Sphere,
+  InstancedMesh
 };
 
 enum GeometryType {
@@ -0,0 +1,123 @@
+#ifndef THREE_AABB_TREE_H
+#define THREE_AABB_TREE_H
+
+#include <three/common.h>
+
+#include <three/math/box3.h>
+#include <three/utils/noncopyable.h>
+
+#include <utility>
+#include <vector>
+
+namespace three {
+
+// A bounding volume hierarchy of axis aligned boxes that objects can be
+// added to, moved in and removed from one at a time. Each leaf keeps a
+// box grown a little beyond its object's bounds, so that objects moving
+// within it leave the tree alone. Inner nodes are kept balanced by
+// rotations, as in Box2D's dynamic tree.
+
+class THREE_DECL AABBTree : NonCopyable {
+public:
+
+  static const int nullNode = -1;
+
+  enum Overlap { Outside, Intersects, Contains };
+
+  // Leaf boxes are grown by `fattening` times their size along each axis
+  explicit AABBTree( float fattening = 0.1f );
+
+  // Adds a leaf for `object` and returns its proxy, which stays the same
+  // until the leaf is removed
+  int insert( const Box3& box, Object3D* object );
+
+  void remove( int proxy );
+
+  // Moves the leaf if `box` has left its grown box. Returns whether it did.
+  bool move( int proxy, const Box3& box );
+
+  void clear();
+
+  Object3D* object( int proxy ) const { return _nodes[ proxy ].object; }
+  const Box3& fatBox( int proxy ) const { return _nodes[ proxy ].box; }
+
+  size_t size() const { return _leaves; }
+
+  // every proxy is below this
+  size_t capacity() const { return _nodes.size(); }
+
+  int height() const { return _root == nullNode ? 0 : _nodes[ _root ].height; }
+
+  // Calls visit( proxy, contained ) for each leaf whose box `test` does not
+  // rule out. test( box ) returns an Overlap, and a subtree whose box it
+  // finds Contains is visited without further tests, with `contained` set.
+  template < typename Test, typename Visit >
+  void query( const Test& test, const Visit& visit ) const {
+
+    if ( _root == nullNode ) return;
+
+    std::vector<std::pair<int, bool>> stack;
+    stack.reserve( 64 );
+    stack.emplace_back( _root, false );
+
+    while ( ! stack.empty() ) {
+
+      const auto index = stack.back().first;
+      auto contained = stack.back().second;
+      stack.pop_back();
+
+      const auto& node = _nodes[ index ];
+
+      if ( ! contained ) {
+        const auto overlap = test( node.box );
+        if ( overlap == Outside ) continue;
+        contained = overlap == Contains;
+      }
+
+      if ( node.leaf() ) {
+        visit( index, contained );
+      } else {
+        stack.emplace_back( node.right, contained );
+        stack.emplace_back( node.left, contained );
+      }
+
+    }
+
+  }
+
+private:
+
+  struct Node {
+    Box3 box;
+    // null for inner nodes
+    Object3D* object;
+    // the next free node while on the free list
+    int parent;
+    int left;
+    int right;
+    // 0 for leaves, -1 while free
+    int height;
+    bool leaf() const { return left == nullNode; }
+  };
+
+  int allocate();
+  void release( int index );
+
+  void insertLeaf( int leaf );
+  void removeLeaf( int leaf );
+  int balance( int index );
+  void refit( int index );
+
+  Box3 fatten( const Box3& box ) const;
+
+  std::vector<Node> _nodes;
+  int _root;
+  int _free;
+  size_t _leaves;
+  float _fattening;
+
+};
+
+} // namespace three
+
+#endif // THREE_AABB_TREE_H
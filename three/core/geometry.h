@@ -6,6 +6,7 @@
 #include <three/core/geometry_buffer.h>
 #include <three/core/geometry_group.h>
 #include <three/core/face.h>
+#include <three/core/task_scheduler.h>
 
 #include <three/math/math.h>
 #include <three/math/color.h>
@@ -16,6 +17,7 @@
 
 #include <three/materials/material.h>
 
+#include <three/utils/dirty_ranges.h>
 #include <three/utils/optional.h>
 #include <three/utils/memory.h>
 
@@ -70,6 +72,16 @@ public:
   optional<Box3> boundingBox;
   optional<Sphere> boundingSphere;
 
+  // Changes each time the bounds above are computed or dropped, for bounds
+  // derived from them such as Object3D::worldBoundingSphere. Versions are
+  // unique across geometries.
+  unsigned int __boundsVersion;
+
+  // Drops both bounds, to be computed again where next needed. Edits do this
+  // through markVerticesDirty straight away, and through verticesNeedUpdate
+  // once the renderer takes them.
+  void invalidateBounds();
+
   bool hasTangents;
 
   bool dynamic;
@@ -85,15 +97,31 @@ public:
 
   bool buffersNeedUpdate;
 
+  // Vertices changed since the last render, for edits too small to justify
+  // verticesNeedUpdate. Only the affected parts of the buffers are refilled
+  // and uploaded. Like the flags this needs a dynamic geometry, whose arrays
+  // the renderer keeps. Colors are per vertex on lines and particle systems,
+  // and per face on meshes.
+  void markVerticesDirty( int first, int count );
+  void markColorsDirty( int first, int count );
+
+  DirtyRanges __dirtyVertices;
+  DirtyRanges __dirtyColors;
+
   std::vector<Offset> offsets;
 
-  std::unordered_map<std::string, GeometryGroup::Ptr> geometryGroups;
+  // indexed by group number, in creation order
+  std::vector<GeometryGroup::Ptr> geometryGroups;
   std::vector<GeometryGroup*> geometryGroupsList;
 
   std::vector<Vector3> skinVerticesA;
   std::vector<Vector3> skinVerticesB;
   Attributes attributes;
 
+  // Runs the compute*() methods and applyMatrix over large geometries on
+  // these workers, null to keep them on the calling thread
+  TaskScheduler::Ptr scheduler;
+
   virtual void applyMatrix( Matrix4& matrix );
 
   virtual void computeCentroids();
@@ -110,6 +138,8 @@ protected:
 
   Geometry();
 
+  static unsigned int nextBoundsVersion();
+
 private:
 
   std::vector<Vector3> __originalFaceNormal;
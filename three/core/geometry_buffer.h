@@ -9,6 +9,7 @@
 #include <three/core/event_dispatcher.h>
 
 #include <memory>
+#include <unordered_map>
 
 namespace three {
 
@@ -80,6 +81,50 @@ public:
   std::vector<GLBuffer> __glMorphNormalsBuffers;
   std::vector<GLBuffer> __glMorphTargetsBuffers;
 
+  // Vertex array objects recorded by the renderer, keyed by program and
+  // wireframe mode, with the index buffer each one captured
+  struct THREE_DECL VertexArray {
+    VertexArray() : array( 0 ), elementBuffer( 0 ) { }
+    GLBuffer array;
+    GLBuffer elementBuffer;
+  };
+  std::unordered_map<int, VertexArray> __glVertexArrays;
+
+  // Opt-in: keep the vertex attributes in one buffer, each vertex's values
+  // side by side, instead of a buffer per attribute. Morph targets, skinning,
+  // custom attributes and indices keep their own buffers.
+  bool interleaved;
+
+  // Where the renderer put each attribute within an interleaved vertex,
+  // in floats
+  struct THREE_DECL InterleavedAttribute {
+    std::string name;
+    const std::vector<float>* array;
+    int size;
+    int offset;
+  };
+  std::vector<InterleavedAttribute> __interleavedAttributes;
+  int __interleavedStride;
+  GLBuffer __glInterleavedBuffer;
+  std::vector<float> __interleavedArray;
+
+  // Compact encodings for the streams the renderer builds from a Geometry,
+  // copied to its geometry groups. Interleaved geometry stays in floats.
+  struct THREE_DECL VertexFormats {
+    VertexFormats()
+      : position( THREE::FloatVertexFormat ), normal( THREE::FloatVertexFormat ),
+        uv( THREE::FloatVertexFormat ), skin( THREE::FloatVertexFormat ) { }
+    THREE::VertexFormat position; // UnsignedShortVertexFormat
+    THREE::VertexFormat normal;   // and tangents: Int2101010VertexFormat
+    THREE::VertexFormat uv;       // and uv2s: HalfFloatVertexFormat
+    THREE::VertexFormat skin;     // indices and weights: UnsignedByteVertexFormat
+  };
+  VertexFormats vertexFormats;
+
+  // Bounds 16-bit positions are relative to: position = value * scale + offset
+  Vector3 __positionOffset;
+  Vector3 __positionScale;
+
   int __glFaceCount;
   int __glLineCount;
   int __glParticleCount;
@@ -102,11 +147,17 @@ public:
   std::vector<float> __uvArray;
   std::vector<float> __uv2Array;
 
-  std::vector<int> __skinIndexArray;
+  std::vector<float> __skinIndexArray;
   std::vector<float> __skinWeightArray;
 
+  // 16-bit indices unless the group has more vertices than they can
+  // address, in which case only the 32-bit arrays are used
+  bool __glUintIndices;
+
   std::vector<uint16_t> __faceArray;
   std::vector<uint16_t> __lineArray;
+  std::vector<uint32_t> __faceArray32;
+  std::vector<uint32_t> __lineArray32;
 
   bool __inittedArrays;
 
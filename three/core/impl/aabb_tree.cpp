@@ -0,0 +1,346 @@
+#include <three/core/aabb_tree.h>
+
+#include <algorithm>
+
+namespace three {
+
+namespace {
+
+inline Box3 united( const Box3& a, const Box3& b ) {
+
+  return Box3( a ).unionBox( b );
+
+}
+
+// half the surface area, the cost of a node in the insertion heuristic
+inline float area( const Box3& box ) {
+
+  const auto x = box.max.x - box.min.x;
+  const auto y = box.max.y - box.min.y;
+  const auto z = box.max.z - box.min.z;
+
+  return x * y + y * z + z * x;
+
+}
+
+} // namespace
+
+AABBTree::AABBTree( float fattening )
+  : _root( nullNode ), _free( nullNode ), _leaves( 0 ), _fattening( fattening ) { }
+
+int AABBTree::insert( const Box3& box, Object3D* object ) {
+
+  const auto leaf = allocate();
+
+  auto& node = _nodes[ leaf ];
+  node.box = fatten( box );
+  node.object = object;
+  node.height = 0;
+
+  insertLeaf( leaf );
+  ++ _leaves;
+
+  return leaf;
+
+}
+
+void AABBTree::remove( int proxy ) {
+
+  removeLeaf( proxy );
+  release( proxy );
+  -- _leaves;
+
+}
+
+bool AABBTree::move( int proxy, const Box3& box ) {
+
+  if ( _nodes[ proxy ].box.containsBox( box ) ) return false;
+
+  removeLeaf( proxy );
+  _nodes[ proxy ].box = fatten( box );
+  insertLeaf( proxy );
+
+  return true;
+
+}
+
+void AABBTree::clear() {
+
+  _nodes.clear();
+  _root = nullNode;
+  _free = nullNode;
+  _leaves = 0;
+
+}
+
+int AABBTree::allocate() {
+
+  if ( _free == nullNode ) {
+    _nodes.push_back( Node() );
+    _free = ( int )_nodes.size() - 1;
+    _nodes[ _free ].parent = nullNode;
+  }
+
+  const auto index = _free;
+  auto& node = _nodes[ index ];
+
+  _free = node.parent;
+
+  node.object = nullptr;
+  node.parent = nullNode;
+  node.left = nullNode;
+  node.right = nullNode;
+  node.height = 0;
+
+  return index;
+
+}
+
+void AABBTree::release( int index ) {
+
+  auto& node = _nodes[ index ];
+
+  node.object = nullptr;
+  node.parent = _free;
+  node.height = -1;
+
+  _free = index;
+
+}
+
+// Descends towards the sibling that makes the tree's total area grow the
+// least, and pairs the leaf with it under a new inner node
+
+void AABBTree::insertLeaf( int leaf ) {
+
+  if ( _root == nullNode ) {
+    _root = leaf;
+    _nodes[ leaf ].parent = nullNode;
+    return;
+  }
+
+  const auto box = _nodes[ leaf ].box;
+
+  auto index = _root;
+
+  while ( ! _nodes[ index ].leaf() ) {
+
+    const auto& node = _nodes[ index ];
+
+    const auto nodeArea = area( node.box );
+    const auto combinedArea = area( united( node.box, box ) );
+
+    // the cost of a new parent for this node and the leaf, and what every
+    // level below pays for growing to hold the leaf
+
+    const auto cost = 2.f * combinedArea;
+    const auto inheritance = 2.f * ( combinedArea - nodeArea );
+
+    auto childCost = [&]( int child ) {
+      const auto& childBox = _nodes[ child ].box;
+      const auto grown = area( united( box, childBox ) );
+      return _nodes[ child ].leaf() ? grown + inheritance : grown - area( childBox ) + inheritance;
+    };
+
+    const auto leftCost = childCost( node.left );
+    const auto rightCost = childCost( node.right );
+
+    if ( cost < leftCost && cost < rightCost ) break;
+
+    index = leftCost < rightCost ? node.left : node.right;
+
+  }
+
+  const auto sibling = index;
+  const auto oldParent = _nodes[ sibling ].parent;
+  const auto newParent = allocate();
+
+  auto& parent = _nodes[ newParent ];
+  parent.parent = oldParent;
+  parent.box = united( box, _nodes[ sibling ].box );
+  parent.height = _nodes[ sibling ].height + 1;
+  parent.left = sibling;
+  parent.right = leaf;
+
+  if ( oldParent != nullNode ) {
+    auto& grandParent = _nodes[ oldParent ];
+    if ( grandParent.left == sibling ) grandParent.left = newParent;
+    else grandParent.right = newParent;
+  } else {
+    _root = newParent;
+  }
+
+  _nodes[ sibling ].parent = newParent;
+  _nodes[ leaf ].parent = newParent;
+
+  refit( _nodes[ leaf ].parent );
+
+}
+
+void AABBTree::removeLeaf( int leaf ) {
+
+  if ( leaf == _root ) {
+    _root = nullNode;
+    return;
+  }
+
+  const auto parent = _nodes[ leaf ].parent;
+  const auto grandParent = _nodes[ parent ].parent;
+  const auto sibling = _nodes[ parent ].left == leaf ? _nodes[ parent ].right : _nodes[ parent ].left;
+
+  if ( grandParent != nullNode ) {
+
+    auto& node = _nodes[ grandParent ];
+    if ( node.left == parent ) node.left = sibling;
+    else node.right = sibling;
+
+    _nodes[ sibling ].parent = grandParent;
+    release( parent );
+
+    refit( grandParent );
+
+  } else {
+
+    _root = sibling;
+    _nodes[ sibling ].parent = nullNode;
+    release( parent );
+
+  }
+
+}
+
+// Rebalances and recomputes the boxes and heights from `index` to the root
+
+void AABBTree::refit( int index ) {
+
+  while ( index != nullNode ) {
+
+    index = balance( index );
+
+    auto& node = _nodes[ index ];
+    const auto& left = _nodes[ node.left ];
+    const auto& right = _nodes[ node.right ];
+
+    node.height = 1 + std::max( left.height, right.height );
+    node.box = united( left.box, right.box );
+
+    index = node.parent;
+
+  }
+
+}
+
+// Rotates the taller child of `iA` up in its place if the children's
+// heights differ by more than one. Returns the node now in its place.
+
+int AABBTree::balance( int iA ) {
+
+  auto& A = _nodes[ iA ];
+
+  if ( A.leaf() || A.height < 2 ) return iA;
+
+  const auto iB = A.left;
+  const auto iC = A.right;
+
+  auto& B = _nodes[ iB ];
+  auto& C = _nodes[ iC ];
+
+  const auto difference = C.height - B.height;
+
+  if ( difference > 1 ) {
+
+    const auto iF = C.left;
+    const auto iG = C.right;
+
+    auto& F = _nodes[ iF ];
+    auto& G = _nodes[ iG ];
+
+    C.left = iA;
+    C.parent = A.parent;
+    A.parent = iC;
+
+    if ( C.parent != nullNode ) {
+      auto& parent = _nodes[ C.parent ];
+      if ( parent.left == iA ) parent.left = iC;
+      else parent.right = iC;
+    } else {
+      _root = iC;
+    }
+
+    if ( F.height > G.height ) {
+      C.right = iF;
+      A.right = iG;
+      G.parent = iA;
+      A.box = united( B.box, G.box );
+      C.box = united( A.box, F.box );
+      A.height = 1 + std::max( B.height, G.height );
+      C.height = 1 + std::max( A.height, F.height );
+    } else {
+      C.right = iG;
+      A.right = iF;
+      F.parent = iA;
+      A.box = united( B.box, F.box );
+      C.box = united( A.box, G.box );
+      A.height = 1 + std::max( B.height, F.height );
+      C.height = 1 + std::max( A.height, G.height );
+    }
+
+    return iC;
+
+  }
+
+  if ( difference < -1 ) {
+
+    const auto iD = B.left;
+    const auto iE = B.right;
+
+    auto& D = _nodes[ iD ];
+    auto& E = _nodes[ iE ];
+
+    B.left = iA;
+    B.parent = A.parent;
+    A.parent = iB;
+
+    if ( B.parent != nullNode ) {
+      auto& parent = _nodes[ B.parent ];
+      if ( parent.left == iA ) parent.left = iB;
+      else parent.right = iB;
+    } else {
+      _root = iB;
+    }
+
+    if ( D.height > E.height ) {
+      B.right = iD;
+      A.left = iE;
+      E.parent = iA;
+      A.box = united( C.box, E.box );
+      B.box = united( A.box, D.box );
+      A.height = 1 + std::max( C.height, E.height );
+      B.height = 1 + std::max( A.height, D.height );
+    } else {
+      B.right = iE;
+      A.left = iD;
+      D.parent = iA;
+      A.box = united( C.box, D.box );
+      B.box = united( A.box, E.box );
+      A.height = 1 + std::max( C.height, D.height );
+      B.height = 1 + std::max( A.height, E.height );
+    }
+
+    return iB;
+
+  }
+
+  return iA;
+
+}
+
+Box3 AABBTree::fatten( const Box3& box ) const {
+
+  const auto margin = Vector3().subVectors( box.max, box.min ).multiplyScalar( _fattening );
+
+  return Box3( Vector3().subVectors( box.min, margin ), Vector3().addVectors( box.max, margin ) );
+
+}
+
+} // namespace three
@@ -12,6 +12,7 @@ void BufferGeometry::applyMatrix( Matrix4& matrix ) {
   if ( auto positionsP = attributes.get( AttributeKey::position() ) ) {
     matrix.multiplyVector3Array( positionsP->array );
     verticesNeedUpdate = true;
+    invalidateBounds();
   }
 
   if ( auto normalP = attributes.get( AttributeKey::normal() ) ) {
@@ -93,6 +94,8 @@ void BufferGeometry::computeBoundingBox() {
 
   }
 
+  __boundsVersion = nextBoundsVersion();
+
 }
 
 void BufferGeometry::computeBoundingSphere() {
@@ -121,6 +124,8 @@ void BufferGeometry::computeBoundingSphere() {
 
   }
 
+  __boundsVersion = nextBoundsVersion();
+
 }
 
 void BufferGeometry::computeVertexNormals( bool areaWeighted ) {
@@ -5,8 +5,40 @@
 #include <three/math/vector4.h>
 #include <three/math/matrix3.h>
 
+#include <algorithm>
+#include <atomic>
+
 namespace three {
 
+// Faces and vertices go to the scheduler in chunks of this many, so
+// smaller geometries are computed on the calling thread
+
+static const size_t parallelGrain = 4096;
+
+// Bounds of each chunk, joined afterwards
+static Box3 boundsOf( TaskScheduler* scheduler, const std::vector<Vector3>& points ) {
+
+  std::vector<Box3> boxes( ( points.size() + parallelGrain - 1 ) / parallelGrain );
+
+  parallelFor( scheduler, 0, points.size(), parallelGrain, [&]( size_t begin, size_t end ) {
+
+    auto& box = boxes[ begin / parallelGrain ];
+
+    box.min.copy( points[ begin ] );
+    box.max.copy( points[ begin ] );
+
+    for ( auto i = begin + 1; i < end; ++i ) box.addPoint( points[ i ] );
+
+  } );
+
+  if ( boxes.empty() ) return Box3().makeEmpty();
+
+  for ( size_t i = 1; i < boxes.size(); ++i ) boxes[ 0 ].unionBox( boxes[ i ] );
+
+  return boxes[ 0 ];
+
+}
+
 template <class T>
 inline void hash_combine( std::size_t& seed, const T& v ) {
   std::hash<T> hasher;
@@ -27,27 +59,35 @@ void Geometry::applyMatrix( Matrix4& matrix ) {
 
   auto normalMatrix = Matrix3().getNormalMatrix( matrix );
 
-  for ( size_t i = 0, il = vertices.size(); i < il; i ++ ) {
+  parallelFor( scheduler.get(), 0, vertices.size(), parallelGrain, [&]( size_t begin, size_t end ) {
 
-    auto& vertex = vertices[ i ];
-    vertex.applyMatrix4( matrix );
+    for ( auto i = begin; i < end; i ++ ) {
 
-  }
+      auto& vertex = vertices[ i ];
+      vertex.applyMatrix4( matrix );
 
-  for ( size_t i = 0, il = faces.size(); i < il; i ++ ) {
+    }
 
-    auto& face = faces[ i ];
-    face.normal.applyMatrix3( normalMatrix ).normalize();
+  } );
 
-    for ( size_t j = 0, jl = face.vertexNormals.size(); j < jl; j ++ ) {
+  parallelFor( scheduler.get(), 0, faces.size(), parallelGrain, [&]( size_t begin, size_t end ) {
 
-      face.vertexNormals[ j ].applyMatrix3( normalMatrix ).normalize();
+    for ( auto i = begin; i < end; i ++ ) {
 
-    }
+      auto& face = faces[ i ];
+      face.normal.applyMatrix3( normalMatrix ).normalize();
 
-    face.centroid.applyMatrix4( matrix );
+      for ( size_t j = 0, jl = face.vertexNormals.size(); j < jl; j ++ ) {
 
-  }
+        face.vertexNormals[ j ].applyMatrix3( normalMatrix ).normalize();
+
+      }
+
+      face.centroid.applyMatrix4( matrix );
+
+    }
+
+  } );
 
   computeBoundingBox();
 
@@ -57,7 +97,9 @@ void Geometry::applyMatrix( Matrix4& matrix ) {
 
 void Geometry::computeCentroids() {
 
-    for ( size_t f = 0, fl = faces.size(); f < fl; f ++ ) {
+  parallelFor( scheduler.get(), 0, faces.size(), parallelGrain, [this]( size_t begin, size_t end ) {
+
+    for ( auto f = begin; f < end; f ++ ) {
 
       auto& face = faces[ f ];
       face.centroid.set( 0, 0, 0 );
@@ -69,27 +111,35 @@ void Geometry::computeCentroids() {
 
     }
 
+  } );
+
 }
 
 void Geometry::computeFaceNormals() {
 
-  Vector3 cb, ab;
+  parallelFor( scheduler.get(), 0, faces.size(), parallelGrain, [this]( size_t begin, size_t end ) {
 
-  for ( auto& face : faces ) {
+    Vector3 cb, ab;
 
-    auto& vA = vertices[ face.a ];
-    auto& vB = vertices[ face.b ];
-    auto& vC = vertices[ face.c ];
+    for ( auto f = begin; f < end; f ++ ) {
 
-    cb.subVectors( vC, vB );
-    ab.subVectors( vA, vB );
-    cb.cross( ab );
+      auto& face = faces[ f ];
+
+      auto& vA = vertices[ face.a ];
+      auto& vB = vertices[ face.b ];
+      auto& vC = vertices[ face.c ];
 
-    cb.normalize();
+      cb.subVectors( vC, vB );
+      ab.subVectors( vA, vB );
+      cb.cross( ab );
 
-    face.normal.copy( cb );
+      cb.normalize();
 
-  }
+      face.normal.copy( cb );
+
+    }
+
+  } );
 
 }
 
@@ -109,21 +159,40 @@ void Geometry::computeVertexNormals( bool areaWeighted ) {
     // vertex normals weighted by triangle areas
     // http://www.iquilezles.org/www/articles/normals/normals.htm
 
-    auto cb = Vector3(), ab = Vector3();
+    // faces share vertices, so only the cross products run in parallel and
+    // the sums are made in face order, as they would be serially
 
-    for ( const auto& face : faces ) {
+    std::vector<Vector3> faceNormals( faces.size() );
 
-      auto& vA = this->vertices[ face.a ];
-      auto& vB = this->vertices[ face.b ];
-      auto& vC = this->vertices[ face.c ];
+    parallelFor( scheduler.get(), 0, faces.size(), parallelGrain, [&]( size_t begin, size_t end ) {
 
-      cb.subVectors( vC, vB );
-      ab.subVectors( vA, vB );
-      cb.cross( ab );
+      auto ab = Vector3();
+
+      for ( auto f = begin; f < end; f ++ ) {
+
+        const auto& face = faces[ f ];
+
+        auto& vA = this->vertices[ face.a ];
+        auto& vB = this->vertices[ face.b ];
+        auto& vC = this->vertices[ face.c ];
+
+        auto& cb = faceNormals[ f ];
 
-      verticesTmp[ face.a ].add( cb );
-      verticesTmp[ face.b ].add( cb );
-      verticesTmp[ face.c ].add( cb );
+        cb.subVectors( vC, vB );
+        ab.subVectors( vA, vB );
+        cb.cross( ab );
+
+      }
+
+    } );
+
+    for ( size_t f = 0, fl = faces.size(); f < fl; f ++ ) {
+
+      const auto& face = faces[ f ];
+
+      verticesTmp[ face.a ].add( faceNormals[ f ] );
+      verticesTmp[ face.b ].add( faceNormals[ f ] );
+      verticesTmp[ face.c ].add( faceNormals[ f ] );
 
     }
 
@@ -140,19 +209,29 @@ void Geometry::computeVertexNormals( bool areaWeighted ) {
   }
 
 
-  for ( auto& vertice : verticesTmp ) {
+  parallelFor( scheduler.get(), 0, verticesTmp.size(), parallelGrain, [&]( size_t begin, size_t end ) {
 
-    vertice.normalize();
+    for ( auto i = begin; i < end; i ++ ) {
 
-  }
+      verticesTmp[ i ].normalize();
 
-  for ( auto& face : faces ) {
+    }
 
-    face.vertexNormals[ 0 ].copy( verticesTmp[ face.abc[ 0 ] ].clone() );
-    face.vertexNormals[ 1 ].copy( verticesTmp[ face.abc[ 1 ] ].clone() );
-    face.vertexNormals[ 2 ].copy( verticesTmp[ face.abc[ 2 ] ].clone() );
+  } );
 
-  }
+  parallelFor( scheduler.get(), 0, faces.size(), parallelGrain, [&]( size_t begin, size_t end ) {
+
+    for ( auto f = begin; f < end; f ++ ) {
+
+      auto& face = faces[ f ];
+
+      face.vertexNormals[ 0 ].copy( verticesTmp[ face.abc[ 0 ] ] );
+      face.vertexNormals[ 1 ].copy( verticesTmp[ face.abc[ 1 ] ] );
+      face.vertexNormals[ 2 ].copy( verticesTmp[ face.abc[ 2 ] ] );
+
+    }
+
+  } );
 
 }
 
@@ -234,7 +313,7 @@ void Geometry::computeTangents() {
   std::vector<Vector3> tan1( vertices.size() );
   std::vector<Vector3> tan2( vertices.size() );
 
-  static auto handleTriangle = [&, this]( const std::array<Vector2, 3>& uv, int a, int b, int c, int ua, int ub, int uc ) {
+  auto handleTriangle = [&, this]( const std::array<Vector2, 3>& uv, int a, int b, int c, int ua, int ub, int uc ) {
 
     const auto& vA = vertices[ a ];
     const auto& vB = vertices[ b ];
@@ -284,34 +363,40 @@ void Geometry::computeTangents() {
     handleTriangle( uv, face.a, face.b, face.c, 0, 1, 2 );
   }
 
-  Vector3 tmp, tmp2, n;
+  parallelFor( scheduler.get(), 0, faces.size(), parallelGrain, [&]( size_t begin, size_t end ) {
 
-  for ( auto& face : faces ) {
+    Vector3 tmp, tmp2, n;
 
-    for ( auto i = 0; i < face.size(); i++ ) {
+    for ( auto f = begin; f < end; f ++ ) {
 
-      n.copy( face.vertexNormals[ i ] );
+      auto& face = faces[ f ];
+
+      for ( auto i = 0; i < face.size(); i++ ) {
+
+        n.copy( face.vertexNormals[ i ] );
 
-      auto vertexIndex = face.abc[ i ];
+        auto vertexIndex = face.abc[ i ];
 
-      const auto& t = tan1[ vertexIndex ];
+        const auto& t = tan1[ vertexIndex ];
 
-      // Gram-Schmidt orthogonalize
+        // Gram-Schmidt orthogonalize
 
-      tmp.copy( t );
-      tmp.sub( n.multiplyScalar( n.dot( t ) ) ).normalize();
+        tmp.copy( t );
+        tmp.sub( n.multiplyScalar( n.dot( t ) ) ).normalize();
 
-      // Calculate handedness
+        // Calculate handedness
 
-      tmp2.crossVectors( face.vertexNormals[ i ], t );
-      const auto test = tmp2.dot( tan2[ vertexIndex ] );
-      const auto w = ( test < 0.0f ) ? -1.0f : 1.0f;
+        tmp2.crossVectors( face.vertexNormals[ i ], t );
+        const auto test = tmp2.dot( tan2[ vertexIndex ] );
+        const auto w = ( test < 0.0f ) ? -1.0f : 1.0f;
 
-      face.vertexTangents[ i ] = Vector4( tmp.x, tmp.y, tmp.z, w );
+        face.vertexTangents[ i ] = Vector4( tmp.x, tmp.y, tmp.z, w );
+
+      }
 
     }
 
-  }
+  } );
 
   hasTangents = true;
 
@@ -325,7 +410,9 @@ void Geometry::computeBoundingBox() {
 
   }
 
-  boundingBox->setFromPoints( vertices );
+  *boundingBox = boundsOf( scheduler.get(), vertices );
+
+  __boundsVersion = nextBoundsVersion();
 
 }
 
@@ -337,7 +424,42 @@ void Geometry::computeBoundingSphere() {
 
   }
 
-  boundingSphere->setFromPoints( vertices );
+  // centered on the bounding box, like Sphere::setFromPoints
+
+  const auto center = boundsOf( scheduler.get(), vertices ).center();
+
+  std::vector<float> radiiSq( ( vertices.size() + parallelGrain - 1 ) / parallelGrain, 0.f );
+
+  parallelFor( scheduler.get(), 0, vertices.size(), parallelGrain, [&]( size_t begin, size_t end ) {
+
+    auto& maxRadiusSq = radiiSq[ begin / parallelGrain ];
+
+    for ( auto i = begin; i < end; ++i ) {
+      maxRadiusSq = Math::max( maxRadiusSq, center.distanceToSquared( vertices[ i ] ) );
+    }
+
+  } );
+
+  boundingSphere->center.copy( center );
+  boundingSphere->radius = Math::sqrt( radiiSq.empty() ? 0.f : *std::max_element( radiiSq.begin(), radiiSq.end() ) );
+
+  __boundsVersion = nextBoundsVersion();
+
+}
+
+unsigned int Geometry::nextBoundsVersion() {
+
+  static std::atomic<unsigned int> version( 0 );
+  return ++ version;
+
+}
+
+void Geometry::invalidateBounds() {
+
+  boundingBox = optional<Box3>();
+  boundingSphere = optional<Sphere>();
+
+  __boundsVersion = nextBoundsVersion();
 
 }
 
@@ -398,6 +520,7 @@ Geometry::Geometry()
   : id( GeometryCount()++ ),
     uuid( Math::generateUUID() ),
     faceVertexUvs( 2 ),
+    __boundsVersion( nextBoundsVersion() ),
     hasTangents( false ),
     dynamic( true ),
     verticesNeedUpdate( false ),
@@ -410,4 +533,13 @@ Geometry::Geometry()
 
 Geometry::~Geometry() { }
 
+void Geometry::markVerticesDirty( int first, int count ) {
+  __dirtyVertices.add( first, count );
+  invalidateBounds();
+}
+
+void Geometry::markColorsDirty( int first, int count ) {
+  __dirtyColors.add( first, count );
+}
+
 } // namespace three
@@ -21,12 +21,17 @@ GeometryBuffer::GeometryBuffer( int numMorphTargets, int numMorphNormals, int ma
     __glUV2Buffer( 0 ),
     __glUVBuffer( 0 ),
     __glVertexBuffer( 0 ),
+    interleaved( false ),
+    __interleavedStride( 0 ),
+    __glInterleavedBuffer( 0 ),
+    __positionScale( 1, 1, 1 ),
     __glFaceCount( 0 ),
     __glLineCount( 0 ),
     __glParticleCount( 0 ),
     __glVertexCount( 0 ),
     numMorphTargets( numMorphTargets ),
     numMorphNormals( numMorphNormals ),
+    __glUintIndices( false ),
     __inittedArrays( false ) { }
 
 GeometryBuffer::~GeometryBuffer() { }
@@ -43,7 +48,10 @@ void GeometryBuffer::dispose() {
   __uv2Array.clear();
   __faceArray.clear();
   __vertexArray.clear();
+  __interleavedArray.clear();
   __lineArray.clear();
+  __faceArray32.clear();
+  __lineArray32.clear();
   __skinIndexArray.clear();
   __skinWeightArray.clear();
 }
@@ -4,19 +4,21 @@
 
 #include <three/console.h>
 
+#include <atomic>
+
 namespace three {
 
 namespace {
 
 unsigned nextObjectID() {
-  static unsigned int sObject3DIdCount = 0;
+  static std::atomic<unsigned int> sObject3DIdCount( 0 );
   return ++sObject3DIdCount;
 }
 
 } // namespace
 
-Object3D::SyncedEulerQuaternion::SyncedEulerQuaternion()
-    : _lastMaybeUpdated( LastUpdatedRotationType::None ) {}
+Object3D::SyncedEulerQuaternion::SyncedEulerQuaternion( Quaternion& quaternion )
+    : _lastMaybeUpdated( LastUpdatedRotationType::None ), _quaternion( quaternion ) {}
 
 Euler& Object3D::SyncedEulerQuaternion::rotation() {
   synchronizeRotation();
@@ -240,8 +242,14 @@ void Object3D::add( const Object3D::Ptr& object ) {
   }
 
   object->parent = this;
+  transforms().setParent( object->__transformSlot, __transformSlot );
   object->dispatchEvent( TargetEvent::TARGET_ADDED );
 
+  // the world matrices below it now follow this object
+
+  object->matrixWorldNeedsUpdate = true;
+  subtreeChanged();
+
   children.push_back( object );
 
   // add to scene
@@ -258,15 +266,24 @@ void Object3D::add( const Object3D::Ptr& object ) {
 
 }
 
-void Object3D::remove( const Object3D::Ptr& object ) {
+void Object3D::remove( const Object3D::Ptr& child ) {
+
+  // a copy, as `child` may refer to the entry of children erased below
+
+  const auto object = child;
 
   auto index = std::find( children.begin(), children.end(), object );
 
   if ( index != children.end() ) {
 
     object->parent = nullptr;
+    transforms().setParent( object->__transformSlot, TransformStore::nullSlot );
     children.erase( index );
 
+    // its world matrix is its own matrix now
+
+    object->matrixWorldNeedsUpdate = true;
+
     object->dispatchEvent( TargetEvent::TARGET_REMOVED );
 
     // remove from scene
@@ -367,7 +384,9 @@ std::vector<Object3D::Ptr>& Object3D::getDescendants(std::vector<Object3D::Ptr>&
 
 Object3D& Object3D::updateMatrix() {
 
-  matrix.compose( position(), quaternion(), scale() );
+  composeMatrix();
+
+  // for the next updateMatrixWorld to find
 
   matrixWorldNeedsUpdate = true;
 
@@ -375,38 +394,80 @@ Object3D& Object3D::updateMatrix() {
 
 }
 
-Object3D& Object3D::updateMatrixWorld( bool force ) {
+void Object3D::composeMatrix() {
 
-  if ( matrixAutoUpdate == true ) updateMatrix();
+  // through the const accessors, which leave the transform unmarked
 
-  if ( matrixWorldNeedsUpdate == true || force == true ) {
+  const auto& self = *this;
 
-    if ( ! parent ) {
+  matrix.compose( self.position(), self.quaternion(), self.scale() );
 
-      matrixWorld.copy( matrix );
+}
 
-    } else {
+Object3D::WorldNeedsUpdate& Object3D::WorldNeedsUpdate::operator=( bool value ) {
 
-      matrixWorld.multiplyMatrices( parent->matrixWorld, matrix );
+  transforms().worldNeedsUpdate( _object.__transformSlot ) = value;
 
-    }
+  if ( value ) _object.subtreeChanged();
 
-    matrixWorldNeedsUpdate = false;
+  return *this;
 
-    force = true;
+}
 
-  }
+Object3D::WorldNeedsUpdate::operator bool() const {
 
-  // update children
+  return transforms().worldNeedsUpdate( _object.__transformSlot );
 
-  for ( auto& child : children ) {
-    child->updateMatrixWorld( force );
+}
+
+void Object3D::subtreeChanged() {
+
+  for ( auto object = this; object; object = object->parent ) {
+    auto& subtreeNeedsUpdate = transforms().subtreeNeedsUpdate( object->__transformSlot );
+    if ( subtreeNeedsUpdate ) break;
+    subtreeNeedsUpdate = true;
   }
 
+}
+
+// The TransformStore keeps the objects in parent-before-child order, and
+// updates the subtree in one pass
+
+Object3D& Object3D::updateMatrixWorld( bool force ) {
+
+  transforms().update( __transformSlot, force );
+
   return *this;
 
 }
 
+const Sphere& Object3D::worldBoundingSphere() const {
+
+  if ( ! geometry->boundingSphere ) geometry->computeBoundingSphere();
+
+  if ( _worldBoundsGeometry != geometry.get() ||
+       _worldBoundsMatrixVersion != __matrixWorldVersion ||
+       _worldBoundsGeometryVersion != geometry->__boundsVersion ) {
+
+    _worldBoundingSphere.copy( *geometry->boundingSphere ).applyMatrix4( matrixWorld );
+
+    _worldBoundsGeometry = geometry.get();
+    _worldBoundsMatrixVersion = __matrixWorldVersion;
+    _worldBoundsGeometryVersion = geometry->__boundsVersion;
+
+  }
+
+  return _worldBoundingSphere;
+
+}
+
+bool Object3D::worldBoundsGeometryChanged() const {
+
+  return _worldBoundsGeometry != geometry.get() ||
+         _worldBoundsGeometryVersion != geometry->__boundsVersion;
+
+}
+
 Object3D::Ptr Object3D::clone( bool recursive ) const {
   Ptr cloned;
   __clone( cloned, recursive );
@@ -420,26 +481,45 @@ Object3D::Object3D( const Material::Ptr& material ,
     parent( nullptr ),
     renderDepth( 0 ),
     rotationAutoUpdate( true ),
-    matrix( Matrix4() ),
-    matrixWorld( Matrix4() ),
-    matrixAutoUpdate( true ),
-    matrixWorldNeedsUpdate( true ),
+    __transformSlot( transforms().allocate( this ) ),
+    matrix( transforms().local( __transformSlot ) ),
+    matrixWorld( transforms().world( __transformSlot ) ),
+    __matrixWorldVersion( transforms().worldVersion( __transformSlot ) ),
+    matrixAutoUpdate( transforms().autoUpdate( __transformSlot ) ),
+    matrixWorldNeedsUpdate( *this ),
     visible( true ),
     castShadow( false ),
     receiveShadow( false ),
     frustumCulled( true ),
+    occluder( false ),
     useVertexTexture( false ),
     boneTextureWidth( 0 ),
     boneTextureHeight( 0 ),
     morphTargetBase( -1 ),
     material( material ),
     geometry( geometry ),
+    __boundsProxy( -1 ),
+    _transform( transforms().quaternion( __transformSlot ) ),
     _up( 0, 1, 0 ),
-    _scale( 1, 1, 1 ) {
+    _worldBoundsGeometry( nullptr ),
+    _worldBoundsMatrixVersion( 0 ),
+    _worldBoundsGeometryVersion( 0 ) {
 }
 
 
-Object3D::~Object3D() { }
+Object3D::~Object3D() {
+
+  // children that outlive this object become roots
+
+  for ( auto& child : children ) {
+    child->parent = nullptr;
+    transforms().setParent( child->__transformSlot, TransformStore::nullSlot );
+    child->matrixWorldNeedsUpdate = true;
+  }
+
+  transforms().release( __transformSlot );
+
+}
 
 void Object3D::__addObject( const Ptr& object ) { }
 
@@ -477,6 +557,7 @@ void Object3D::__clone( Ptr& cloned, bool recursive ) const {
   object.receiveShadow = this->receiveShadow;
 
   object.frustumCulled = this->frustumCulled;
+  object.occluder = this->occluder;
 
   // TODO
   //target.userData = JSON.parse( JSON.stringify( this->userData ) );
@@ -8,28 +8,11 @@
 #include <three/objects/sprite.h>
 #include <three/objects/LOD.h>
 #include <three/objects/line.h>
+#include <three/scenes/scene.h>
 #include <three/utils/optional.h>
 
 namespace three {
 
-struct Intersect {
-
-  public:
-
-    Intersect( float distanceIn, Vector3& pointIn, optional<Face> faceIn, size_t faceIndexIn = 0, Object3D* objectIn = nullptr )
-    : distance( distanceIn), point( pointIn ), face( std::move( faceIn ) ), faceIndex( faceIndexIn ), object( objectIn ) {}
-
-    float distance;
-
-    Vector3 point;
-
-    optional<Face> face;
-    size_t faceIndex;
-
-    Object3D* object;
-
-};
-
 struct DescSort {
   bool operator()( const Intersect& a, const Intersect& b ) const {
     return a.distance - b.distance < 0.f;
@@ -43,7 +26,6 @@ struct Raycaster::Impl : public NonCopyable {
 
   Impl() {}
 
-  Sphere sphere;
   Ray localRay;
   Plane facePlane;
   Vector3 intersectPoint;
@@ -97,7 +79,11 @@ struct IntersectObjectVisitor : public ConstRawPointerVisitor {
     impl.matrixPosition.setFromMatrixPosition( object->matrixWorld );
     float distance = raycaster.ray.origin.distanceTo( impl.matrixPosition );
 
-    raycaster.intersectObject( object->getObjectForDistance( distance ) );
+    // with this visitor's scratch, which may not be the raycaster's own
+
+    auto level = object->getObjectForDistance( distance );
+
+    if ( level ) level->visit( *this );
 
   }
 
@@ -107,12 +93,7 @@ struct IntersectObjectVisitor : public ConstRawPointerVisitor {
 
     // Checking boundingSphere distance to ray
 
-    if ( !geometry->boundingSphere ) geometry->computeBoundingSphere();
-
-    impl.sphere.copy( *geometry->boundingSphere );
-    impl.sphere.applyMatrix4( object->matrixWorld );
-
-    if ( raycaster.ray.isIntersectionSphere( impl.sphere ) == false ) {
+    if ( raycaster.ray.isIntersectionSphere( object->worldBoundingSphere() ) == false ) {
 
       return;
 
@@ -382,14 +363,9 @@ struct IntersectObjectVisitor : public ConstRawPointerVisitor {
 
     auto& geometry = object->geometry;
 
-    if ( !geometry->boundingSphere ) geometry->computeBoundingSphere();
-
     // Checking boundingSphere distance to ray
 
-    impl.sphere.copy( *geometry->boundingSphere );
-    impl.sphere.applyMatrix4( object->matrixWorld );
-
-    if ( raycaster.ray.isIntersectionSphere( impl.sphere ) == false ) {
+    if ( raycaster.ray.isIntersectionSphere( object->worldBoundingSphere() ) == false ) {
 
       return;
 
@@ -443,6 +419,8 @@ struct IntersectObjectVisitor : public ConstRawPointerVisitor {
 Raycaster::Raycaster( const Vector3& origin, const Vector3& direction, float near, float far)
   : ray( Ray( origin, direction ) ), near( near ), far( far ), impl( new Impl() ) { }
 
+Raycaster::~Raycaster() { }
+
 Raycaster& Raycaster::set( const Vector3& origin, const Vector3& direction ) {
 
   ray.set( origin, direction );
@@ -476,6 +454,18 @@ Intersects Raycaster::intersectObjects ( const std::vector<Object3D::Ptr>& objec
 
   Intersects intersects;
 
+  if ( scheduler && scheduler->size() > 0 ) {
+
+    _intersectObjectsParallel( objects, recursive, intersects );
+
+    std::sort( intersects.begin(),
+               intersects.end(),
+               DescSort() );
+
+    return intersects;
+
+  }
+
   for ( auto& obj : objects ) {
 
     _intersectObject( obj, intersects );
@@ -496,6 +486,82 @@ Intersects Raycaster::intersectObjects ( const std::vector<Object3D::Ptr>& objec
 
 }
 
+Intersects Raycaster::intersectScene( Scene& scene ) {
+
+  Intersects intersects;
+
+  detail::IntersectObjectVisitor visitor( *this, *impl, intersects );
+
+  const auto& tree = scene.__boundsTree;
+
+  tree.query( [this]( const Box3& box ) {
+
+    return ray.isIntersectionBox( box ) ? AABBTree::Intersects : AABBTree::Outside;
+
+  }, [&tree, &visitor]( int proxy, bool ) {
+
+    tree.object( proxy )->visit( visitor );
+
+  } );
+
+  std::sort( intersects.begin(),
+             intersects.end(),
+             DescSort() );
+
+  return intersects;
+
+}
+
+// Objects are tested in chunks, each with scratch of its own, and their
+// intersections joined in the order the serial loop would find them
+
+void Raycaster::_intersectObjectsParallel( const std::vector<Object3D::Ptr>& objects, bool recursive, Intersects& intersects ) {
+
+  std::vector<Object3D::Ptr> targets;
+
+  for ( auto& obj : objects ) {
+
+    targets.push_back( obj );
+
+    if ( recursive == true ) obj->getDescendants( targets );
+
+  }
+
+  // world bounding spheres are cached on first use, and geometry bounds
+  // are shared between objects
+
+  for ( auto& target : targets ) {
+
+    if ( target->geometry ) target->worldBoundingSphere();
+
+  }
+
+  const size_t grain = 64;
+
+  std::vector<Intersects> found( ( targets.size() + grain - 1 ) / grain );
+
+  parallelFor( scheduler.get(), 0, targets.size(), grain, [&]( size_t begin, size_t end ) {
+
+    Impl scratch;
+    auto& chunk = found[ begin / grain ];
+
+    for ( auto i = begin; i < end; ++i ) {
+
+      detail::IntersectObjectVisitor visitor( *this, scratch, chunk );
+      targets[ i ]->visit( visitor );
+
+    }
+
+  } );
+
+  for ( auto& chunk : found ) {
+
+    intersects.insert( intersects.end(), chunk.begin(), chunk.end() );
+
+  }
+
+}
+
 void Raycaster::_intersectDescendants( const Object3D::Ptr& object, Intersects& intersects ) {
 
   std::vector<Object3D::Ptr> descendants;
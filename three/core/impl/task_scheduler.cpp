@@ -0,0 +1,328 @@
+#include <three/core/task_scheduler.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace three {
+
+struct TaskScheduler::Impl : NonCopyable {
+
+  struct Job {
+    Task task;
+    TaskGroup* group;
+  };
+
+  struct Worker {
+    std::thread thread;
+    std::mutex mutex;
+    std::deque<Job> jobs;
+  };
+
+  explicit Impl( unsigned workers ) : queued( 0 ), quit( false ) {
+    for ( unsigned i = 0; i < workers; ++i ) {
+      this->workers.emplace_back( new Worker() );
+    }
+  }
+
+  std::vector<std::unique_ptr<Worker>> workers;
+
+  // jobs submitted from threads that are not workers
+  std::mutex sharedMutex;
+  std::deque<Job> shared;
+
+  // jobs in all queues, and what idle workers sleep on
+  std::atomic<size_t> queued;
+  std::mutex sleepMutex;
+  std::condition_variable wake;
+  bool quit;
+
+  // the worker running on this thread, if any
+  static thread_local Impl* currentScheduler;
+  static thread_local size_t currentWorker;
+
+  void submit( Job job ) {
+
+    if ( currentScheduler == this ) {
+      auto& worker = *workers[ currentWorker ];
+      std::lock_guard<std::mutex> lock( worker.mutex );
+      worker.jobs.push_back( std::move( job ) );
+    } else {
+      std::lock_guard<std::mutex> lock( sharedMutex );
+      shared.push_back( std::move( job ) );
+    }
+
+    ++ queued;
+
+    // taking the lock orders this with a worker about to sleep
+    { std::lock_guard<std::mutex> lock( sleepMutex ); }
+    wake.notify_one();
+
+  }
+
+  // Newest job of this thread's worker, then the oldest shared one, then
+  // the oldest of another worker
+  bool take( Job& job ) {
+
+    const auto self = currentScheduler == this ? currentWorker : workers.size();
+
+    if ( self < workers.size() ) {
+      auto& worker = *workers[ self ];
+      std::lock_guard<std::mutex> lock( worker.mutex );
+      if ( ! worker.jobs.empty() ) {
+        job = std::move( worker.jobs.back() );
+        worker.jobs.pop_back();
+        -- queued;
+        return true;
+      }
+    }
+
+    {
+      std::lock_guard<std::mutex> lock( sharedMutex );
+      if ( ! shared.empty() ) {
+        job = std::move( shared.front() );
+        shared.pop_front();
+        -- queued;
+        return true;
+      }
+    }
+
+    for ( size_t i = 1; i <= workers.size(); ++i ) {
+      auto& victim = *workers[ ( self + i ) % workers.size() ];
+      std::lock_guard<std::mutex> lock( victim.mutex );
+      if ( ! victim.jobs.empty() ) {
+        job = std::move( victim.jobs.front() );
+        victim.jobs.pop_front();
+        -- queued;
+        return true;
+      }
+    }
+
+    return false;
+
+  }
+
+  bool runOne() {
+
+    Job job;
+    if ( ! take( job ) ) return false;
+
+    job.task();
+    job.group->finished();
+
+    return true;
+
+  }
+
+  void work( size_t index ) {
+
+    currentScheduler = this;
+    currentWorker = index;
+
+    for ( ;; ) {
+
+      if ( runOne() ) continue;
+
+      std::unique_lock<std::mutex> lock( sleepMutex );
+      wake.wait( lock, [this] { return quit || queued > 0; } );
+      if ( quit ) return;
+
+    }
+
+  }
+
+  void pin( Worker& worker, int cpu ) {
+
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO( &set );
+    CPU_SET( cpu, &set );
+    pthread_setaffinity_np( worker.thread.native_handle(), sizeof( set ), &set );
+#else
+    ( void )worker;
+    ( void )cpu;
+#endif
+
+  }
+
+};
+
+thread_local TaskScheduler::Impl* TaskScheduler::Impl::currentScheduler = nullptr;
+thread_local size_t TaskScheduler::Impl::currentWorker = 0;
+
+TaskScheduler::TaskScheduler( const Parameters& parameters ) {
+
+  auto workers = parameters.workers;
+
+  if ( workers < 0 ) {
+    workers = std::max( ( int )std::thread::hardware_concurrency() - 1, 0 );
+  }
+
+  impl.reset( new Impl( ( unsigned )workers ) );
+
+  for ( size_t i = 0; i < impl->workers.size(); ++i ) {
+
+    auto& worker = *impl->workers[ i ];
+    worker.thread = std::thread( [this, i] { impl->work( i ); } );
+
+    if ( ! parameters.affinity.empty() ) {
+      impl->pin( worker, parameters.affinity[ i % parameters.affinity.size() ] );
+    }
+
+  }
+
+}
+
+TaskScheduler::~TaskScheduler() {
+
+  {
+    std::lock_guard<std::mutex> lock( impl->sleepMutex );
+    impl->quit = true;
+  }
+
+  impl->wake.notify_all();
+
+  for ( auto& worker : impl->workers ) worker->thread.join();
+
+}
+
+const TaskScheduler::Ptr& TaskScheduler::shared() {
+
+  static const Ptr scheduler = create();
+  return scheduler;
+
+}
+
+size_t TaskScheduler::size() const {
+
+  return impl->workers.size();
+
+}
+
+void TaskScheduler::run( std::vector<Task>& tasks ) {
+
+  TaskGroup group( this );
+
+  for ( auto& task : tasks ) group.run( task );
+
+  group.wait();
+
+}
+
+void TaskScheduler::parallelFor( size_t first, size_t last, size_t grain, const std::function<void( size_t, size_t )>& body ) {
+
+  three::parallelFor( this, first, last, grain, body );
+
+}
+
+TaskGroup::TaskGroup( TaskScheduler* scheduler )
+  : _scheduler( scheduler && scheduler->size() > 0 ? scheduler : nullptr ),
+    _pending( 0 ) { }
+
+TaskGroup::~TaskGroup() {
+
+  wait();
+
+}
+
+void TaskGroup::run( Task task ) {
+
+  if ( ! _scheduler ) {
+    task();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    ++ _pending;
+  }
+
+  _scheduler->impl->submit( TaskScheduler::Impl::Job { std::move( task ), this } );
+
+}
+
+void TaskGroup::then( Task continuation ) {
+
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+    if ( _pending > 0 ) {
+      _continuations.push_back( std::move( continuation ) );
+      return;
+    }
+  }
+
+  run( std::move( continuation ) );
+
+}
+
+void TaskGroup::finished() {
+
+  std::vector<Task> continuations;
+
+  {
+    std::lock_guard<std::mutex> lock( _mutex );
+
+    // the last task hands its place in _pending on to the continuations,
+    // so that the group never looks done in between
+
+    if ( _pending == 1 && ! _continuations.empty() ) {
+      continuations.swap( _continuations );
+      _pending += continuations.size();
+    }
+
+    if ( -- _pending == 0 ) _done.notify_all();
+  }
+
+  for ( auto& continuation : continuations ) {
+    _scheduler->impl->submit( TaskScheduler::Impl::Job { std::move( continuation ), this } );
+  }
+
+}
+
+void TaskGroup::wait() {
+
+  if ( ! _scheduler ) return;
+
+  for ( ;; ) {
+
+    {
+      std::lock_guard<std::mutex> lock( _mutex );
+      if ( _pending == 0 ) return;
+    }
+
+    // help with whatever is queued, this group's tasks or others', and
+    // sleep briefly when everything left is already running elsewhere
+
+    if ( ! _scheduler->impl->runOne() ) {
+      std::unique_lock<std::mutex> lock( _mutex );
+      _done.wait_for( lock, std::chrono::microseconds( 100 ), [this] { return _pending == 0; } );
+    }
+
+  }
+
+}
+
+void parallelFor( TaskScheduler* scheduler, size_t first, size_t last, size_t grain,
+                  const std::function<void( size_t, size_t )>& body ) {
+
+  grain = std::max<size_t>( grain, 1 );
+
+  TaskGroup group( last - first > grain ? scheduler : nullptr );
+
+  for ( auto begin = first; begin < last; begin += grain ) {
+    const auto end = std::min( begin + grain, last );
+    group.run( [&body, begin, end] { body( begin, end ); } );
+  }
+
+  group.wait();
+
+}
+
+} // namespace three
@@ -0,0 +1,354 @@
+#include <three/core/transform_store.h>
+
+#include <three/core/object3d.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace three {
+
+const int TransformStore::nullSlot;
+
+TransformStore& TransformStore::instance() {
+  // never destroyed, as objects may outlive any static
+  static TransformStore* sStore = new TransformStore();
+  return *sStore;
+}
+
+TransformStore::TransformStore() : _orderNeedsUpdate( false ), _shifted( 0 ) { }
+
+int TransformStore::allocate( Object3D* object ) {
+
+  std::lock_guard<std::mutex> lock( _mutex );
+
+  int slot;
+
+  if ( ! _free.empty() ) {
+
+    slot = _free.back();
+    _free.pop_back();
+
+  } else {
+
+    slot = ( int )_objects.size();
+
+    if ( slot % blockSize == 0 ) {
+      _positions.grow();
+      _quaternions.grow();
+      _scales.grow();
+      _locals.grow();
+      _worlds.grow();
+      _worldVersions.grow();
+      _autoUpdates.grow();
+      _worldNeedsUpdates.grow();
+      _localNeedsUpdates.grow();
+      _subtreeNeedsUpdates.grow();
+      _rotationsPending.grow();
+    }
+
+    _objects.push_back( nullptr );
+    _parents.push_back( nullSlot );
+    _ranks.push_back( 0 );
+    _sizes.push_back( 1 );
+    _changed.push_back( 0 );
+    _logged.push_back( 0 );
+
+  }
+
+  _positions[ slot ].set( 0, 0, 0 );
+  _quaternions[ slot ].set( 0, 0, 0, 1 );
+  _scales[ slot ].set( 1, 1, 1 );
+  _locals[ slot ].identity();
+  _worlds[ slot ].identity();
+  _worldVersions[ slot ] = 0;
+  _autoUpdates[ slot ] = true;
+  _worldNeedsUpdates[ slot ] = true;
+  _localNeedsUpdates[ slot ] = true;
+  _subtreeNeedsUpdates[ slot ] = true;
+  _rotationsPending[ slot ] = false;
+
+  _objects[ slot ] = object;
+  _parents[ slot ] = nullSlot;
+
+  // a new root goes at the end of the order
+
+  if ( ! _orderNeedsUpdate ) {
+    _ranks[ slot ] = ( int )_order.size();
+    _sizes[ slot ] = 1;
+    _order.push_back( slot );
+  }
+
+  return slot;
+
+}
+
+void TransformStore::release( int slot ) {
+
+  std::lock_guard<std::mutex> lock( _mutex );
+
+  // a lone root leaves a dead entry in the order rather than a rebuild,
+  // until too many gather
+
+  const auto alone = _parents[ slot ] == nullSlot && _sizes[ slot ] == 1;
+
+  if ( alone && ! _orderNeedsUpdate ) _order[ _ranks[ slot ] ] = nullSlot;
+
+  _objects[ slot ] = nullptr;
+  _parents[ slot ] = nullSlot;
+  _free.push_back( slot );
+
+  if ( ! alone || _order.size() > 2 * size() + blockSize ) {
+    _orderNeedsUpdate = true;
+  }
+
+}
+
+// The slot's subtree moves as one range of the order: to the end of the new
+// parent's, or for a new root past the tree it leaves. Only the entries in
+// between shift, and only the sizes of the ancestors change. Once the moves
+// since the last update shifted more entries than a rebuild visits, the
+// order is left for the update to rebuild instead.
+
+void TransformStore::setParent( int slot, int parent ) {
+
+  std::lock_guard<std::mutex> lock( _mutex );
+
+  const auto previous = _parents[ slot ];
+
+  if ( previous == parent ) return;
+
+  _parents[ slot ] = parent;
+
+  if ( _orderNeedsUpdate ) return;
+
+  int target;
+
+  if ( parent == nullSlot ) {
+    auto root = previous;
+    while ( _parents[ root ] != nullSlot ) root = _parents[ root ];
+    target = _ranks[ root ] + _sizes[ root ];
+  } else {
+    target = _ranks[ parent ] + _sizes[ parent ];
+  }
+
+  const auto size = _sizes[ slot ];
+  const auto first = _ranks[ slot ];
+
+  _shifted += std::abs( target - first ) + size;
+
+  if ( _shifted > _order.size() ) {
+    _orderNeedsUpdate = true;
+    return;
+  }
+
+  for ( auto ancestor = previous; ancestor != nullSlot; ancestor = _parents[ ancestor ] ) {
+    _sizes[ ancestor ] -= size;
+  }
+
+  for ( auto ancestor = parent; ancestor != nullSlot; ancestor = _parents[ ancestor ] ) {
+    _sizes[ ancestor ] += size;
+  }
+
+  move( first, size, target );
+
+}
+
+void TransformStore::move( int first, int count, int target ) {
+
+  auto order = _order.begin();
+
+  int begin, end;
+
+  if ( target > first ) {
+    std::rotate( order + first, order + first + count, order + target );
+    begin = first;
+    end = target;
+  } else {
+    std::rotate( order + target, order + first, order + first + count );
+    begin = target;
+    end = first + count;
+  }
+
+  for ( auto i = begin; i < end; ++i ) {
+    if ( _order[ i ] != nullSlot ) _ranks[ _order[ i ] ] = i;
+  }
+
+}
+
+// Depth first from each root. The children come from _parents rather than
+// the objects, whose lists other threads may be changing.
+
+void TransformStore::sortTopologically() {
+
+  const auto count = ( int )_objects.size();
+
+  // each slot's children, as a range of `children` starting at first[ slot ]
+
+  std::vector<int> first( count + 1, 0 ), children( count );
+
+  for ( int slot = 0; slot < count; ++slot ) {
+    if ( _objects[ slot ] && _parents[ slot ] != nullSlot ) ++ first[ _parents[ slot ] + 1 ];
+  }
+
+  for ( int slot = 0; slot < count; ++slot ) first[ slot + 1 ] += first[ slot ];
+
+  auto next = first;
+
+  for ( int slot = 0; slot < count; ++slot ) {
+    if ( _objects[ slot ] && _parents[ slot ] != nullSlot ) children[ next[ _parents[ slot ] ]++ ] = slot;
+  }
+
+  _order.clear();
+
+  std::vector<int> stack;
+
+  for ( int root = 0; root < count; ++root ) {
+
+    if ( ! _objects[ root ] || _parents[ root ] != nullSlot ) continue;
+
+    stack.push_back( root );
+
+    while ( ! stack.empty() ) {
+
+      const auto slot = stack.back();
+      stack.pop_back();
+
+      _ranks[ slot ] = ( int )_order.size();
+      _sizes[ slot ] = 1;
+      _order.push_back( slot );
+
+      for ( auto child = first[ slot + 1 ]; child-- > first[ slot ]; ) {
+        stack.push_back( children[ child ] );
+      }
+
+    }
+
+  }
+
+  // children come after their parents, so one backwards pass sums the sizes
+
+  for ( auto i = _order.size(); i-- > 0; ) {
+    const auto slot = _order[ i ];
+    if ( _parents[ slot ] != nullSlot ) _sizes[ _parents[ slot ] ] += _sizes[ slot ];
+  }
+
+  _orderNeedsUpdate = false;
+
+}
+
+void TransformStore::update( int slot, bool force ) {
+
+  std::lock_guard<std::mutex> lock( _mutex );
+
+  if ( _orderNeedsUpdate ) sortTopologically();
+
+  _shifted = 0;
+
+  const auto begin = _ranks[ slot ];
+  const auto end = begin + _sizes[ slot ];
+
+  for ( auto i = begin; i < end; ) {
+
+    const auto current = _order[ i ];
+    const auto parent = _parents[ current ];
+
+    const bool parentChanged = force || ( i != begin && _changed[ parent ] );
+
+    // nothing below changed
+
+    if ( ! parentChanged && ! _subtreeNeedsUpdates[ current ] ) {
+      _changed[ current ] = false;
+      i += _sizes[ current ];
+      continue;
+    }
+
+    if ( _localNeedsUpdates[ current ] || force ) {
+
+      if ( _autoUpdates[ current ] ) {
+
+        if ( _rotationsPending[ current ] ) {
+
+          // through the object, which turns the Euler angles into the
+          // quaternion
+
+          _objects[ current ]->composeMatrix();
+          _rotationsPending[ current ] = false;
+
+        } else {
+
+          _locals[ current ].compose( _positions[ current ], _quaternions[ current ], _scales[ current ] );
+
+        }
+
+      }
+
+      _worldNeedsUpdates[ current ] = true;
+      _localNeedsUpdates[ current ] = false;
+
+    }
+
+    const bool changed = _worldNeedsUpdates[ current ] || parentChanged;
+
+    if ( changed ) {
+
+      if ( parent == nullSlot ) {
+        _worlds[ current ].copy( _locals[ current ] );
+      } else {
+        _worlds[ current ].multiplyMatrices( _worlds[ parent ], _locals[ current ] );
+      }
+
+      _worldNeedsUpdates[ current ] = false;
+      ++ _worldVersions[ current ];
+
+      if ( ! _logged[ current ] ) {
+        _logged[ current ] = 1;
+        _moved.push_back( current );
+      }
+
+    }
+
+    _changed[ current ] = changed;
+    _subtreeNeedsUpdates[ current ] = false;
+
+    ++ i;
+
+  }
+
+}
+
+void TransformStore::takeMoved( int root, std::vector<Object3D*>& moved ) {
+
+  std::lock_guard<std::mutex> lock( _mutex );
+
+  size_t kept = 0;
+
+  for ( auto slot : _moved ) {
+
+    // released, and maybe reused since: the new object is taken all the same
+
+    const auto object = _objects[ slot ];
+
+    if ( ! object ) {
+      _logged[ slot ] = 0;
+      continue;
+    }
+
+    auto top = slot;
+    while ( _parents[ top ] != nullSlot ) top = _parents[ top ];
+
+    if ( top == root ) {
+      moved.push_back( object );
+      _logged[ slot ] = 0;
+    } else if ( _objects[ top ]->type() == THREE::Scene ) {
+      _moved[ kept ++ ] = slot;
+    } else {
+      _logged[ slot ] = 0;
+    }
+
+  }
+
+  _moved.resize( kept );
+
+}
+
+} // namespace three
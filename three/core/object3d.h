@@ -5,6 +5,7 @@
 
 #include <three/core/geometry.h>
 #include <three/core/event_dispatcher.h>
+#include <three/core/transform_store.h>
 
 #include <three/math/vector3.h>
 #include <three/math/quaternion.h>
@@ -56,11 +57,28 @@ public:
 
   bool rotationAutoUpdate;
 
-  Matrix4 matrix;
-  Matrix4 matrixWorld;
+  // The object's slot in the TransformStore, which holds its transform
+  const int __transformSlot;
 
-  bool matrixAutoUpdate;
-  bool matrixWorldNeedsUpdate;
+  Matrix4& matrix;
+  Matrix4& matrixWorld;
+
+  // Raised each time updateMatrixWorld changes matrixWorld
+  unsigned int& __matrixWorldVersion;
+
+  bool& matrixAutoUpdate;
+
+  // Setting it marks the object for the next updateMatrixWorld, which then
+  // recomputes matrixWorld from matrix, and the world matrices below it
+  class THREE_DECL WorldNeedsUpdate {
+  public:
+    explicit WorldNeedsUpdate( Object3D& object ) : _object( object ) { }
+    WorldNeedsUpdate& operator=( bool value );
+    WorldNeedsUpdate& operator=( const WorldNeedsUpdate& other ) { return *this = ( bool )other; }
+    operator bool() const;
+  private:
+    Object3D& _object;
+  } matrixWorldNeedsUpdate;
 
   bool visible;
 
@@ -69,23 +87,46 @@ public:
 
   bool frustumCulled;
 
+  // drawn into the renderer's occlusion buffer, see GLRenderer::occlusionCulling
+  bool occluder;
+
   // TODO
   //this.userdata = {};
 
-  inline const Vector3& position() const { return _position; }
-  inline Vector3& position() { return _position; }
+  // The non-const accessors of the transform mark it changed, see
+  // transformChanged
+
+  inline const Vector3& position() const { return transforms().position( __transformSlot ); }
+  inline Vector3& position() { transformChanged(); return transforms().position( __transformSlot ); }
 
-  inline const Vector3& scale() const { return _scale; }
-  inline Vector3& scale() { return _scale; }
+  inline const Vector3& scale() const { return transforms().scale( __transformSlot ); }
+  inline Vector3& scale() { transformChanged(); return transforms().scale( __transformSlot ); }
 
   inline const Vector3& up() const { return _up; }
   inline Vector3& up() { return _up; }
 
   inline const Euler& rotation() const { return _transform.rotation(); }
-  inline Euler& rotation() { return _transform.rotation(); }
+  inline Euler& rotation() {
+    transformChanged();
+    transforms().rotationPending( __transformSlot ) = true;
+    return _transform.rotation();
+  }
 
   inline const Quaternion& quaternion() const { return _transform.quaternion(); }
-  inline Quaternion& quaternion() { return _transform.quaternion(); }
+  inline Quaternion& quaternion() { transformChanged(); return _transform.quaternion(); }
+
+  // Marks matrix and matrixWorld for the next updateMatrixWorld, which skips
+  // the subtrees where nothing changed. The transform accessors and
+  // matrixWorldNeedsUpdate do this, so it is only needed for changes they
+  // cannot see: writes to matrix, or through references kept from an
+  // earlier call.
+  inline void transformChanged() {
+    auto& matrixNeedsUpdate = transforms().localNeedsUpdate( __transformSlot );
+    if ( ! matrixNeedsUpdate ) {
+      matrixNeedsUpdate = true;
+      subtreeChanged();
+    }
+  }
 
   Object3D& applyMatrix( Matrix4& m );
 
@@ -132,6 +173,9 @@ public:
   std::vector<Object3D::Ptr>& getDescendants( std::vector<Object3D::Ptr>& array ) const;
 
   Object3D& updateMatrix();
+
+  // Updates the matrices of this object and its descendants that changed.
+  // `force` updates every one, trusting no change tracking.
   Object3D& updateMatrixWorld( bool force = false );
 
   Ptr clone( bool recursive = true ) const;
@@ -150,6 +194,18 @@ public:
   Material::Ptr material;
   Geometry::Ptr geometry;
 
+  // leaf of the scene's AABBTree holding this object's bounds, or -1
+  int __boundsProxy;
+
+  // The geometry's bounding sphere in world space, computing the former if
+  // needed. Cached until matrixWorld, the geometry or its bounds change.
+  // Requires a geometry.
+  const Sphere& worldBoundingSphere() const;
+
+  // Whether the geometry, or its bounds, changed since worldBoundingSphere
+  // last ran. Requires a geometry.
+  bool worldBoundsGeometryChanged() const;
+
   struct THREE_DECL GLData {
     GLData() : __glInit( false ), __glActive( false ) { }
 
@@ -202,9 +258,18 @@ protected:
 
 private:
 
+  friend class TransformStore;
+
+  static TransformStore& transforms() { return TransformStore::instance(); }
+
+  // Marks the subtree here and on the parents that lack the mark
+  void subtreeChanged();
+
+  void composeMatrix();
+
   class THREE_DECL SyncedEulerQuaternion {
   public:
-    SyncedEulerQuaternion();
+    explicit SyncedEulerQuaternion( Quaternion& quaternion );
 
     Euler& rotation();
     const Euler& rotation() const;
@@ -225,14 +290,17 @@ private:
 
     mutable Euler _rotation;
     mutable Euler _prevRotation;
-    mutable Quaternion _quaternion;
+    Quaternion& _quaternion;
     mutable Quaternion _prevQuaternion;
 
   } _transform;
 
   Vector3 _up;
-  Vector3 _position;
-  Vector3 _scale;
+
+  mutable Sphere _worldBoundingSphere;
+  mutable const Geometry* _worldBoundsGeometry;
+  mutable unsigned int _worldBoundsMatrixVersion;
+  mutable unsigned int _worldBoundsGeometryVersion;
 
 };
 
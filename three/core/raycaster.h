@@ -7,6 +7,9 @@
 #include <three/math/vector3.h>
 #include <three/math/ray.h>
 #include <three/core/object3d.h>
+#include <three/core/face.h>
+#include <three/core/task_scheduler.h>
+#include <three/utils/optional.h>
 
 // minwindef.h defines
 #ifdef near
@@ -18,7 +21,23 @@
 
 namespace three {
 
-struct Intersect;
+struct Intersect {
+
+  public:
+
+    Intersect( float distanceIn, Vector3& pointIn, optional<Face> faceIn, size_t faceIndexIn = 0, Object3D* objectIn = nullptr )
+    : distance( distanceIn), point( pointIn ), face( std::move( faceIn ) ), faceIndex( faceIndexIn ), object( objectIn ) {}
+
+    float distance;
+
+    Vector3 point;
+
+    optional<Face> face;
+    size_t faceIndex;
+
+    Object3D* object;
+
+};
 
 typedef std::vector<Intersect> Intersects;
 
@@ -34,17 +53,27 @@ public:
   struct Impl;
 
   Raycaster( const Vector3& origin, const Vector3& direction, float near = 0.f, float far = Math::INF() );
+  ~Raycaster();
 
   Ray ray;
 
   float near;
   float far;
 
+  // Tests the objects given to intersectObjects on these workers, null to
+  // test them on the calling thread
+  TaskScheduler::Ptr scheduler;
+
   Raycaster& set( const Vector3& origin, const Vector3& direction );
 
   Intersects intersectObject( const Object3D::Ptr& object, bool recursive = false );
   Intersects intersectObjects( const std::vector<Object3D::Ptr>& objects, bool recursive = false );
 
+  // Tests the objects of `scene` whose box in its bounds tree the ray passes
+  // through. The boxes are as of the last Scene::updateBounds(), which
+  // GLRenderer::render calls, just like the world matrices raycasting uses.
+  Intersects intersectScene( Scene& scene );
+
 protected:
 
   std::unique_ptr<Impl> impl;
@@ -53,6 +82,8 @@ private:
 
   void _intersectDescendants( const Object3D::Ptr& object, Intersects& intersects );
 
+  void _intersectObjectsParallel( const std::vector<Object3D::Ptr>& objects, bool recursive, Intersects& intersects );
+
   void _intersectObject( const Object3D::Ptr& object, Intersects& intersects );
 
 };
@@ -0,0 +1,121 @@
+#ifndef THREE_TASK_SCHEDULER_H
+#define THREE_TASK_SCHEDULER_H
+
+#include <three/common.h>
+
+#include <three/utils/noncopyable.h>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace three {
+
+// Worker threads shared by everything in the library that can run in
+// parallel: the renderer, geometry computations, the raycaster and the
+// loaders each take a TaskScheduler::Ptr rather than starting threads of
+// their own. Every worker keeps a deque of tasks. It runs the newest task
+// of its own and, when that is empty, steals the oldest task of another
+// worker. Tasks submitted from other threads go to a shared queue.
+
+class THREE_DECL TaskScheduler : NonCopyable {
+public:
+
+  typedef std::shared_ptr<TaskScheduler> Ptr;
+  typedef std::function<void()> Task;
+
+  struct Parameters {
+    Parameters() : workers( -1 ) { }
+    // -1 for one per hardware thread besides the calling one
+    int workers;
+    // CPU of each worker, repeated when there are more workers than
+    // entries. Empty leaves placement to the OS. Only used on Linux.
+    std::vector<int> affinity;
+  };
+
+  static Ptr create( const Parameters& parameters = Parameters() ) {
+    return Ptr( new TaskScheduler( parameters ) );
+  }
+
+  static Ptr create( int workers ) {
+    Parameters parameters;
+    parameters.workers = workers;
+    return create( parameters );
+  }
+
+  // The scheduler subsystems use when they are not given one
+  static const Ptr& shared();
+
+  ~TaskScheduler();
+
+  size_t size() const;
+
+  // Runs every task and returns once all have finished, the calling thread
+  // taking part
+  void run( std::vector<Task>& tasks );
+
+  // See parallelFor below
+  void parallelFor( size_t first, size_t last, size_t grain, const std::function<void( size_t, size_t )>& body );
+
+  struct Impl;
+
+private:
+
+  friend class TaskGroup;
+
+  explicit TaskScheduler( const Parameters& parameters );
+
+  std::unique_ptr<Impl> impl;
+
+};
+
+// Tasks whose completion can be waited for. Without a scheduler, or with
+// one that has no workers, tasks run as soon as they are added.
+
+class THREE_DECL TaskGroup : NonCopyable {
+public:
+
+  typedef TaskScheduler::Task Task;
+
+  explicit TaskGroup( TaskScheduler* scheduler );
+
+  // Waits for the tasks still running
+  ~TaskGroup();
+
+  void run( Task task );
+
+  // Runs `continuation` in this group once every task added before it has
+  // finished, or straight away if none is left
+  void then( Task continuation );
+
+  // Returns once every task and continuation has finished, running queued
+  // tasks on this thread meanwhile
+  void wait();
+
+private:
+
+  friend struct TaskScheduler::Impl;
+
+  void finished();
+
+  TaskScheduler* _scheduler;
+
+  std::mutex _mutex;
+  std::condition_variable _done;
+  size_t _pending;
+  std::vector<Task> _continuations;
+
+};
+
+// Calls body( begin, end ) for consecutive chunks of [first, last), each
+// `grain` items long apart from the last. Chunks run on the scheduler's
+// workers if there is more than one, in order on this thread otherwise.
+
+THREE_DECL void parallelFor( TaskScheduler* scheduler, size_t first, size_t last, size_t grain,
+                             const std::function<void( size_t, size_t )>& body );
+
+} // namespace three
+
+#endif // THREE_TASK_SCHEDULER_H
@@ -0,0 +1,161 @@
+#ifndef THREE_TRANSFORM_STORE_H
+#define THREE_TRANSFORM_STORE_H
+
+#include <three/common.h>
+
+#include <three/math/vector3.h>
+#include <three/math/quaternion.h>
+#include <three/math/matrix4.h>
+#include <three/utils/noncopyable.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace three {
+
+// The transforms of every Object3D, as structure-of-arrays pools of
+// positions, quaternions, scales, local and world matrices and the flags
+// that track their changes, indexed by a slot per object. Object3D's
+// transform accessors, matrix and matrixWorld refer into the pools, which
+// grow a block at a time so that those references stay put.
+//
+// updateMatrixWorld walks the slots in parent-before-child order, in one
+// loop rather than down the children of each object. Reparenting moves a
+// subtree's range within the order, which is only rebuilt once destroyed
+// objects leave too many gaps in it.
+//
+// Objects may be made and destroyed on any thread: allocate, release,
+// setParent and update lock the store, and the slot lookups need no lock.
+// Changing or updating the transforms of one tree from several threads at
+// once is not safe, as before.
+
+class THREE_DECL TransformStore : NonCopyable {
+public:
+
+  static const int nullSlot = -1;
+
+  static TransformStore& instance();
+
+  // A slot with an identity transform, for `object`
+  int allocate( Object3D* object );
+
+  void release( int slot );
+
+  void setParent( int slot, int parent );
+
+  Vector3& position( int slot ) { return _positions[ slot ]; }
+  Quaternion& quaternion( int slot ) { return _quaternions[ slot ]; }
+  Vector3& scale( int slot ) { return _scales[ slot ]; }
+
+  Matrix4& local( int slot ) { return _locals[ slot ]; }
+  Matrix4& world( int slot ) { return _worlds[ slot ]; }
+  unsigned int& worldVersion( int slot ) { return _worldVersions[ slot ]; }
+
+  bool& autoUpdate( int slot ) { return _autoUpdates[ slot ]; }
+  bool& worldNeedsUpdate( int slot ) { return _worldNeedsUpdates[ slot ]; }
+  bool& localNeedsUpdate( int slot ) { return _localNeedsUpdates[ slot ]; }
+  bool& subtreeNeedsUpdate( int slot ) { return _subtreeNeedsUpdates[ slot ]; }
+  // the object's Euler angles may have changed, so that update composes
+  // its matrix through the object rather than from the quaternion
+  bool& rotationPending( int slot ) { return _rotationsPending[ slot ]; }
+
+  // Live objects
+  size_t size() const { return _objects.size() - _free.size(); }
+
+  // Updates the world matrices of `slot` and the slots below it, as
+  // Object3D::updateMatrixWorld documents
+  void update( int slot, bool force );
+
+  // Appends the objects under the root `root` whose world matrix changed
+  // since they were last taken, and forgets them. Those of other scenes are
+  // kept for them, those outside of any scene dropped, as joining one marks
+  // them again.
+  void takeMoved( int root, std::vector<Object3D*>& moved );
+
+private:
+
+  TransformStore();
+
+  static const int blockBits = 10;
+  static const int blockSize = 1 << blockBits;
+
+  // Storage that grows by whole blocks, which then never move. Lookups go
+  // through a table of the blocks, which growing replaces rather than
+  // reallocates, keeping the old tables for lookups still reading them.
+  template < typename T >
+  class Pool {
+  public:
+    Pool() : _table( nullptr ), _capacity( 0 ) { }
+    T& operator[]( int slot ) const {
+      return _table.load( std::memory_order_acquire )[ slot >> blockBits ][ slot & ( blockSize - 1 ) ];
+    }
+    // under the store's lock
+    void grow() {
+      auto table = _table.load( std::memory_order_relaxed );
+      if ( _blocks.size() == _capacity ) {
+        _capacity = _capacity ? 2 * _capacity : 16;
+        _tables.emplace_back( new T*[ _capacity ] );
+        table = _tables.back().get();
+        for ( size_t i = 0; i < _blocks.size(); ++i ) table[ i ] = _blocks[ i ].get();
+      }
+      _blocks.emplace_back( new T[ blockSize ] );
+      table[ _blocks.size() - 1 ] = _blocks.back().get();
+      _table.store( table, std::memory_order_release );
+    }
+  private:
+    std::atomic<T**> _table;
+    size_t _capacity;
+    std::vector<std::unique_ptr<T*[]>> _tables;
+    std::vector<std::unique_ptr<T[]>> _blocks;
+  };
+
+  void sortTopologically();
+
+  // Moves the `count` entries of the order at `first` up against `target`,
+  // an index outside of them
+  void move( int first, int count, int target );
+
+  Pool<Vector3> _positions;
+  Pool<Quaternion> _quaternions;
+  Pool<Vector3> _scales;
+  Pool<Matrix4> _locals;
+  Pool<Matrix4> _worlds;
+  Pool<unsigned int> _worldVersions;
+  Pool<bool> _autoUpdates;
+  Pool<bool> _worldNeedsUpdates;
+  Pool<bool> _localNeedsUpdates;
+  Pool<bool> _subtreeNeedsUpdates;
+  Pool<bool> _rotationsPending;
+
+  std::mutex _mutex;
+
+  // null for free slots
+  std::vector<Object3D*> _objects;
+  std::vector<int> _parents;
+  std::vector<int> _free;
+
+  // Every live slot, each followed by the slots below it. _ranks holds
+  // where each slot is, _sizes how many slots its subtree takes. Released
+  // slots may leave nullSlot entries, outside of every live subtree.
+  std::vector<int> _order;
+  std::vector<int> _ranks;
+  std::vector<int> _sizes;
+  bool _orderNeedsUpdate;
+  // entries setParent moved since the last update
+  size_t _shifted;
+
+  // whether update recomputed the slot's world matrix
+  std::vector<unsigned char> _changed;
+
+  // slots whose world matrix changed since takeMoved last took them, once
+  // each as marked in _logged
+  std::vector<int> _moved;
+  std::vector<unsigned char> _logged;
+
+};
+
+} // namespace three
+
+#endif // THREE_TRANSFORM_STORE_H
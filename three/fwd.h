@@ -15,6 +15,7 @@ class Scene;
 class Particle;
 class Sprite;
 class Mesh;
+class InstancedMesh;
 class Face;
 
 // Math
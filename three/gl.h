@@ -59,12 +59,20 @@ struct THREE_DECL GLInterfaceWrapper : public GLInterface {
   void DeleteFramebuffer( GLuint& buffer ) const;
   GLuint CreateRenderbuffer() const;
   void DeleteRenderbuffer( GLuint& buffer ) const;
+#if !defined(THREE_GLES)
+  GLuint CreateVertexArray() const;
+  void DeleteVertexArray( GLuint& array ) const;
+#endif
   GLint GetParameteri( GLenum pname ) const;
   GLfloat GetParameterf( GLenum pname ) const;
   GLint GetTexParameteri( GLenum pname ) const;
   GLfloat GetTexParameterf( GLenum pname ) const;
   GLint GetProgramParameter( GLuint program, GLenum pname ) const;
   GLint GetShaderParameter( GLuint program, GLenum pname ) const;
+  // The context's version as major * 10 + minor, 0 if it can't be read
+  int GetVersion() const;
+  // Whether GL_EXTENSIONS lists `name`, as compatibility contexts report them
+  bool HasExtension( const char* name ) const;
 
   template < typename C >
   inline void BindAndBuffer( GLenum target, unsigned buffer, const C& container, GLenum usage ) const {
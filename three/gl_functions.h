@@ -11,6 +11,14 @@
 #error "GL_FUNC_EXT_DECL should be defined before including this file"
 #endif
 
+// GL_FUNC_OPT_DECL includes optional functions that the renderer only uses when
+// the context provides them. They are loaded like GL_FUNC_EXT_DECL by default,
+// but GLInterface::validate() doesn't require them.
+#ifndef GL_FUNC_OPT_DECL
+#define GL_FUNC_OPT_DECL(PFUNC, FUNC) GL_FUNC_EXT_DECL(PFUNC, FUNC)
+#define THREE_GL_FUNC_OPT_DECL_DEFAULT
+#endif
+
 GL_FUNC_DECL(PFNGLBINDTEXTUREPROC, BindTexture)
 GL_FUNC_DECL(PFNGLBLENDFUNCPROC, BlendFunc)
 GL_FUNC_DECL(PFNGLCLEARPROC, Clear)
@@ -114,3 +122,26 @@ GL_FUNC_EXT_DECL(PFNGLUSEPROGRAMPROC, UseProgram)
 GL_FUNC_EXT_DECL(PFNGLVERTEXATTRIB2FVPROC, VertexAttrib2fv)
 GL_FUNC_EXT_DECL(PFNGLVERTEXATTRIB3FVPROC, VertexAttrib3fv)
 GL_FUNC_EXT_DECL(PFNGLVERTEXATTRIBPOINTERPROC, VertexAttribPointer)
+
+#if !defined(THREE_GLES)
+GL_FUNC_OPT_DECL(PFNGLDRAWARRAYSINSTANCEDPROC, DrawArraysInstanced)
+GL_FUNC_OPT_DECL(PFNGLDRAWELEMENTSINSTANCEDPROC, DrawElementsInstanced)
+GL_FUNC_OPT_DECL(PFNGLVERTEXATTRIBDIVISORPROC, VertexAttribDivisor)
+GL_FUNC_OPT_DECL(PFNGLGETUNIFORMBLOCKINDEXPROC, GetUniformBlockIndex)
+GL_FUNC_OPT_DECL(PFNGLUNIFORMBLOCKBINDINGPROC, UniformBlockBinding)
+GL_FUNC_OPT_DECL(PFNGLBINDBUFFERBASEPROC, BindBufferBase)
+GL_FUNC_OPT_DECL(PFNGLGETPROGRAMBINARYPROC, GetProgramBinary)
+GL_FUNC_OPT_DECL(PFNGLPROGRAMBINARYPROC, ProgramBinary)
+GL_FUNC_OPT_DECL(PFNGLPROGRAMPARAMETERIPROC, ProgramParameteri)
+GL_FUNC_OPT_DECL(PFNGLGENVERTEXARRAYSPROC, GenVertexArrays)
+GL_FUNC_OPT_DECL(PFNGLDELETEVERTEXARRAYSPROC, DeleteVertexArrays)
+GL_FUNC_OPT_DECL(PFNGLBINDVERTEXARRAYPROC, BindVertexArray)
+GL_FUNC_OPT_DECL(PFNGLMAPBUFFERRANGEPROC, MapBufferRange)
+GL_FUNC_OPT_DECL(PFNGLUNMAPBUFFERPROC, UnmapBuffer)
+GL_FUNC_OPT_DECL(PFNGLCOPYBUFFERSUBDATAPROC, CopyBufferSubData)
+#endif
+
+#if defined(THREE_GL_FUNC_OPT_DECL_DEFAULT)
+#undef GL_FUNC_OPT_DECL
+#undef THREE_GL_FUNC_OPT_DECL_DEFAULT
+#endif
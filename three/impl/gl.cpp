@@ -2,6 +2,10 @@
 
 #include <three/console.h>
 
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
 namespace three {
 
 namespace {
@@ -29,9 +33,11 @@ bool GLInterface::validate() const {
   }
 #define GL_FUNC_DECL(PFUNC, FUNC) CHECK_PTR(FUNC)
 #define GL_FUNC_EXT_DECL(PFUNC, FUNC) CHECK_PTR(FUNC)
+#define GL_FUNC_OPT_DECL(PFUNC, FUNC)
 #include "three/gl_functions.h"
 #undef GL_FUNC_DECL
 #undef GL_FUNC_EXT_DECL
+#undef GL_FUNC_OPT_DECL
 #undef CHECK_PTR
 
   return true;
@@ -96,6 +102,21 @@ void GLInterfaceWrapper::DeleteRenderbuffer( GLuint& buffer ) const {
   buffer = 0;
 }
 
+#if !defined(THREE_GLES)
+
+GLuint GLInterfaceWrapper::CreateVertexArray() const {
+  GLuint array = 0;
+  GenVertexArrays( 1, &array );
+  return array;
+}
+
+void GLInterfaceWrapper::DeleteVertexArray( GLuint& array ) const {
+  DeleteVertexArrays( 1, &array );
+  array = 0;
+}
+
+#endif
+
 GLint GLInterfaceWrapper::GetParameteri( GLenum pname ) const {
   GLint parameter = 0;
   GetIntegerv( pname, &parameter );
@@ -132,4 +153,27 @@ GLint GLInterfaceWrapper::GetShaderParameter( GLuint program, GLenum pname ) con
   return parameter;
 }
 
+int GLInterfaceWrapper::GetVersion() const {
+  // "4.5.0 NVIDIA 390.48" or "OpenGL ES 3.0 ..."
+  auto version = reinterpret_cast<const char*>( GetString( GL_VERSION ) );
+  if ( ! version ) return 0;
+  while ( *version && ! std::isdigit( ( unsigned char )*version ) ) ++version;
+  int major = 0, minor = 0;
+  if ( std::sscanf( version, "%d.%d", &major, &minor ) != 2 ) return 0;
+  return major * 10 + minor;
+}
+
+bool GLInterfaceWrapper::HasExtension( const char* name ) const {
+  auto extensions = reinterpret_cast<const char*>( GetString( GL_EXTENSIONS ) );
+  if ( ! extensions ) return false;
+  const auto length = std::strlen( name );
+  // whole names only, separated by spaces
+  for ( auto found = std::strstr( extensions, name ); found; found = std::strstr( found + 1, name ) ) {
+    const bool starts = found == extensions || found[ -1 ] == ' ';
+    const bool ends = found[ length ] == ' ' || found[ length ] == '\0';
+    if ( starts && ends ) return true;
+  }
+  return false;
+}
+
 } // namespace three
@@ -77,6 +77,7 @@ protected:
                     const std::string& texturePath ) {
 
     auto geometry = Geometry::create();
+    geometry->scheduler = scheduler;
 
     auto scale = json.HasMember( "scale" ) ? ( float )json["scale"].GetDouble() : 1.0f;
 
@@ -5,6 +5,7 @@
 
 #include <three/utils/noncopyable.h>
 #include <three/console.h>
+#include <three/core/task_scheduler.h>
 
 #include <iomanip>
 #include <functional>
@@ -24,6 +25,9 @@ public:
 
   }
 
+  // Given to the geometries this loader creates, see Geometry::scheduler
+  TaskScheduler::Ptr scheduler;
+
 protected:
 
   bool showStatus;
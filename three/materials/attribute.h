@@ -5,6 +5,7 @@
 #include <three/constants.h>
 
 #include <three/utils/any.h>
+#include <three/utils/dirty_ranges.h>
 #include <three/utils/index.h>
 #include <three/utils/noncopyable.h>
 
@@ -26,6 +27,7 @@ public:
       size( 0 ),
       numItems( 0 ),
       itemSize( 1 ),
+      format( THREE::FloatVertexFormat ),
       __glInitialized( false ),
       __original( nullptr ) {
 
@@ -34,6 +36,12 @@ public:
 
   }
 
+  // Marks `count` items starting at `first` for upload, instead of the
+  // whole array as needsUpdate does
+  void markDirty( int first, int count ) {
+    updateRanges.add( first * itemSize, count * itemSize );
+  }
+
   THREE::AttributeType type;
 
   // TODO: Use the union for indices support (rather than casting from float)
@@ -53,6 +61,13 @@ public:
   int numItems;
   int itemSize;
 
+  // How BufferGeometry uploads `array`; UnsignedShortVertexFormat positions
+  // are rescaled to the geometry's bounds and restored in the vertex shader
+  THREE::VertexFormat format;
+
+  // dirty parts of `array`, in floats
+  DirtyRanges updateRanges;
+
   bool __glInitialized;
   Attribute* __original;
 
@@ -147,6 +162,8 @@ DECLARE_ATTRIBUTE_KEY(skinIndex)
 DECLARE_ATTRIBUTE_KEY(morphTarget)
 DECLARE_ATTRIBUTE_KEY(numItems)
 DECLARE_ATTRIBUTE_KEY(lineDistance)
+DECLARE_ATTRIBUTE_KEY(instanceMatrix)
+DECLARE_ATTRIBUTE_KEY(instanceColor)
 
 #undef DECLARE_ATTRIBUTE_KEY
 
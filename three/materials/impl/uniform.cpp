@@ -14,6 +14,11 @@
 
 #include <three/gl.h>
 
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
 #ifndef NDEBUG
 #define GL_CALL(a) (a); gl.Error(__FILE__, __LINE__)
 #else
@@ -22,6 +27,48 @@
 
 namespace three {
 
+namespace {
+
+struct UniformIdTable {
+  std::mutex mutex;
+  std::unordered_map<std::string, UniformId> ids;
+  std::deque<std::string> names;
+};
+
+UniformIdTable& uniformIdTable() {
+  static UniformIdTable table;
+  return table;
+}
+
+} // namespace
+
+UniformId internUniform( const std::string& name ) {
+
+  auto& table = uniformIdTable();
+  std::lock_guard<std::mutex> lock( table.mutex );
+
+  auto idIt = table.ids.find( name );
+  if ( idIt != table.ids.end() ) {
+    return idIt->second;
+  }
+
+  const auto id = ( UniformId )table.names.size();
+  table.names.push_back( name );
+  table.ids.emplace( name, id );
+
+  return id;
+
+}
+
+const std::string& uniformName( UniformId id ) {
+
+  auto& table = uniformIdTable();
+  std::lock_guard<std::mutex> lock( table.mutex );
+
+  return table.names[ id ];
+
+}
+
 Uniform::Uniform( )
   : type( THREE::INVALID_UNIFORM ), value( ) { }
 
@@ -89,6 +136,25 @@ void loadmv( const GLInterfaceWrapper& gl, const F& f, int location, const any&
   GL_CALL( f( location, count, false, pv ) );
 }
 
+// Raw bytes of a uniform value, used to compare against the last upload
+
+template < typename T >
+struct ValueBytes {
+  static void get( const any& value, const unsigned char*& data, size_t& size ) {
+    const auto& t = value.cast<T>();
+    data = reinterpret_cast<const unsigned char*>( &t );
+    size = sizeof( T );
+  }
+};
+template < typename T >
+struct ValueBytes< std::vector<T> > {
+  static void get( const any& value, const unsigned char*& data, size_t& size ) {
+    const auto& v = value.cast< std::vector<T> >();
+    data = reinterpret_cast<const unsigned char*>( v.data() );
+    size = v.size() * sizeof( T );
+  }
+};
+
 template < int UniformType > struct UniformToType { };
 
 #define DECLARE_UNIFORM(UNIFORM_TYPE, TYPE, FUNC, FUNC_IMPL)                  \
@@ -97,6 +163,9 @@ template < int UniformType > struct UniformToType { };
     static void load(const GLInterfaceWrapper& gl, int location, const any& value) { \
       FUNC_IMPL<TYPE>(gl, FUNC, location, value);                                 \
     }                                                                         \
+    static void bytes(const any& value, const unsigned char*& data, size_t& size) { \
+      ValueBytes<TYPE>::get(value, data, size);                               \
+    }                                                                         \
   };
 
 #define DECLARE_UNIFORM_V(UNIFORM_TYPE, TYPE, ELEM_TYPE, FUNC, STRIDE)        \
@@ -105,6 +174,9 @@ template < int UniformType > struct UniformToType { };
     static void load(const GLInterfaceWrapper& gl, int location, const any& value) { \
       loadv<TYPE, ELEM_TYPE>(gl, FUNC, location, value, STRIDE);                  \
     }                                                                         \
+    static void bytes(const any& value, const unsigned char*& data, size_t& size) { \
+      ValueBytes<TYPE>::get(value, data, size);                               \
+    }                                                                         \
   };
 
 DECLARE_UNIFORM( c,  Color,   gl.Uniform3f, load3 )
@@ -209,5 +281,63 @@ void Uniform::load( const GLInterfaceWrapper& gl, int location ) {
 
 }
 
+bool Uniform::load( const GLInterfaceWrapper& gl, int location, std::vector<unsigned char>& shadow ) {
+
+  const unsigned char* data = nullptr;
+  size_t size = 0;
+
+  if ( ! bytes( data, size ) ) {
+    load( gl, location );
+    return true;
+  }
+
+  if ( shadow.size() == size && ( size == 0 || std::memcmp( shadow.data(), data, size ) == 0 ) ) {
+    return false;
+  }
+
+  shadow.assign( data, data + size );
+  load( gl, location );
+
+  return true;
+
+}
+
+bool Uniform::bytes( const unsigned char*& data, size_t& size ) const {
+
+#define UNIFORM_BYTES_CASE(UNIFORM_TYPE)                         \
+  case THREE::UNIFORM_TYPE:                                      \
+    UniformToType<THREE::UNIFORM_TYPE>::bytes( value, data, size ); \
+    return true;
+
+  try {
+
+    switch ( type ) {
+    UNIFORM_BYTES_CASE( i )
+    UNIFORM_BYTES_CASE( f )
+    UNIFORM_BYTES_CASE( v2 )
+    UNIFORM_BYTES_CASE( v3 )
+    UNIFORM_BYTES_CASE( v4 )
+    UNIFORM_BYTES_CASE( c )
+    UNIFORM_BYTES_CASE( iv1 )
+    UNIFORM_BYTES_CASE( iv )
+    UNIFORM_BYTES_CASE( fv1 )
+    UNIFORM_BYTES_CASE( fv )
+    UNIFORM_BYTES_CASE( v2v )
+    UNIFORM_BYTES_CASE( v3v )
+    UNIFORM_BYTES_CASE( v4v )
+    UNIFORM_BYTES_CASE( m4 )
+    UNIFORM_BYTES_CASE( m4v )
+    default:
+      return false;
+    };
+
+  } catch ( detail::bad_any_cast& ) {
+    return false;
+  }
+
+#undef UNIFORM_BYTES_CASE
+
+}
+
 } // namespace three
 
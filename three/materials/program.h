@@ -9,8 +9,10 @@
 #include <three/materials/attribute.h>
 #include <three/materials/uniform.h>
 
+#include <cstdint>
 #include <map>
 #include <string>
+#include <vector>
 
 namespace three {
 
@@ -26,13 +28,22 @@ public:
   UniformLocations uniforms;
   AttributeLocations attributes;
 
+  // Last value uploaded for each uniform, indexed like `uniforms`
+  std::vector<std::vector<unsigned char>> uniformValues;
+
   Buffer program;
   int id;
 
+  // Variant key the renderer's program cache stores this program under
+  std::uint64_t key;
+
+  // Dequantizes 16-bit positions, see THREE::UnsignedShortVertexFormat
+  bool quantizedPosition;
+
 protected:
 
   Program( Buffer program, int id )
-    : program( program ), id( id ) { }
+    : program( program ), id( id ), key( 0 ), quantizedPosition( false ) { }
 };
 
 } // namespace three
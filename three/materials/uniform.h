@@ -28,6 +28,10 @@ public:
 
   void load( const GLInterfaceWrapper& gl, int location );
 
+  // Uploads the value unless it is bit-identical to `shadow`, the copy of the
+  // last value uploaded to this location. Returns false if the upload was skipped.
+  bool load( const GLInterfaceWrapper& gl, int location, std::vector<unsigned char>& shadow );
+
   THREE::UniformType type;
   any value;
 
@@ -35,16 +39,24 @@ private:
 
   Uniform& swap( Uniform& other );
 
+  bool bytes( const unsigned char*& data, size_t& size ) const;
+
 };
 
+// Uniform names are interned once into dense ids shared by every program,
+// so per-draw lookups index a flat array instead of hashing strings.
+typedef int UniformId;
+
+THREE_DECL UniformId internUniform( const std::string& name );
+THREE_DECL const std::string& uniformName( UniformId id );
+
 typedef Properties<std::string, Uniform> Uniforms;
-typedef std::unordered_map<std::string, Index> UniformLocations;
-typedef std::vector<std::pair<Uniform*, std::string>> UniformsList;
+typedef std::vector<int> UniformLocations;
+typedef std::vector<std::pair<Uniform*, UniformId>> UniformsList;
 
-inline int uniformLocation( const UniformLocations& uniforms, const std::string& name ) {
-  auto uniformIndexIt = uniforms.find( name );
-  if ( uniformIndexIt != uniforms.end() ) {
-    return uniformIndexIt->second;
+inline int uniformLocation( const UniformLocations& uniforms, UniformId id ) {
+  if ( id >= 0 && id < ( int )uniforms.size() ) {
+    return uniforms[ id ];
   } else {
     return -1;
   }
@@ -61,6 +73,10 @@ namespace UniformKey {
   inline const std::string& a () {               \
     static const std::string uniformKey( (#a) ); \
     return uniformKey;                           \
+  }                                              \
+  inline UniformId a ## Id () {                  \
+    static const UniformId id( internUniform( a () ) ); \
+    return id;                                   \
   }
 #else
 #define DECLARE_UNIFORM_KEY(a) inline const char* a () { return #a; }
@@ -77,6 +93,8 @@ DECLARE_UNIFORM_KEY(boneTexture)
 DECLARE_UNIFORM_KEY(boneTextureWidth)
 DECLARE_UNIFORM_KEY(boneTextureHeight)
 DECLARE_UNIFORM_KEY(boneGlobalMatrices)
+DECLARE_UNIFORM_KEY(positionScale)
+DECLARE_UNIFORM_KEY(positionOffset)
 DECLARE_UNIFORM_KEY(mNear)
 DECLARE_UNIFORM_KEY(mFar)
 DECLARE_UNIFORM_KEY(map)
@@ -42,13 +42,13 @@ public:
   bool intersectsObject( const Object3D& object );
   bool intersectsSphere( const Sphere& sphere ) const;
   bool intersectsBox( const Box3& box );
+  bool containsBox( const Box3& box ) const;
 
   bool containsPoint( const Vector3& point ) const;
 
   Frustum clone() const;
 
 private:
-  Sphere _sphere;
   Vector3 _p1;
   Vector3 _p2;
 };
@@ -64,20 +64,11 @@ bool Frustum::intersectsObject( const Object3D& object ) {
     return false;
 
   }
-  //_sphere.reset(new Sphere);
 
-  const auto& geometry = object.geometry;
+  // cached; only objects whose cache is up to date, as after
+  // Scene::updateBounds, can be tested from several threads at once
 
-  if ( !geometry->boundingSphere ) {
-
-    geometry->computeBoundingSphere();
-
-  }
-
-  _sphere.copy( *geometry->boundingSphere );
-  _sphere.applyMatrix4( object.matrixWorld );
-
-  return intersectsSphere( _sphere );
+  return intersectsSphere( object.worldBoundingSphere() );
 
 }
 
@@ -131,6 +122,30 @@ bool Frustum::intersectsBox( const Box3& box ) {
 
 }
 
+bool Frustum::containsBox( const Box3& box ) const {
+
+  // the corner nearest to each plane's back side must be in front of it
+
+  for ( size_t i = 0; i < 6; i ++ ) {
+
+    const auto& plane = planes[ i ];
+
+    const Vector3 corner( plane.normal.x > 0 ? box.min.x : box.max.x,
+                          plane.normal.y > 0 ? box.min.y : box.max.y,
+                          plane.normal.z > 0 ? box.min.z : box.max.z );
+
+    if ( plane.distanceToPoint( corner ) < 0.f ) {
+
+      return false;
+
+    }
+
+  }
+
+  return true;
+
+}
+
 bool Frustum::containsPoint( const Vector3& point ) const {
 
   for ( size_t i = 0; i < 6; i ++ ) {
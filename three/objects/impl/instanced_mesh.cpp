@@ -0,0 +1,53 @@
+#include <three/objects/instanced_mesh.h>
+
+#include <three/console.h>
+
+namespace three {
+
+InstancedMesh::Ptr InstancedMesh::create( const Geometry::Ptr& geometry, const Material::Ptr& material, size_t count ) {
+  return three::make_shared<InstancedMesh>( geometry, material, count );
+}
+
+void InstancedMesh::setMatrixAt( size_t index, const Matrix4& matrix ) {
+
+  if ( index >= instanceMatrices.size() ) {
+    console().warn( "InstancedMesh::setMatrixAt: index out of range" );
+    return;
+  }
+
+  instanceMatrices[ index ].copy( matrix );
+  instancesNeedUpdate = true;
+
+}
+
+void InstancedMesh::setColorAt( size_t index, const Color& color ) {
+
+  if ( index >= instanceMatrices.size() ) {
+    console().warn( "InstancedMesh::setColorAt: index out of range" );
+    return;
+  }
+
+  if ( instanceColors.empty() ) {
+    instanceColors.resize( instanceMatrices.size() );
+  }
+
+  instanceColors[ index ].copy( color );
+  instancesNeedUpdate = true;
+
+}
+
+InstancedMesh::InstancedMesh( const Geometry::Ptr& geometry, const Material::Ptr& material, size_t count )
+  : Mesh( geometry, material ),
+    instanceMatrices( count ),
+    instanceFrustumCulled( true ),
+    instancesNeedUpdate( true ),
+    __glInstanceBuffer( 0 ),
+    __instanceCount( 0 ) {
+
+  // The mesh bounds don't cover the instances, they are culled one by one instead
+
+  frustumCulled = false;
+
+}
+
+} // namespace three
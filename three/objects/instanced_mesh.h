@@ -0,0 +1,51 @@
+#ifndef THREE_INSTANCED_MESH_H
+#define THREE_INSTANCED_MESH_H
+
+#include <three/objects/mesh.h>
+#include <three/math/matrix4.h>
+#include <three/math/color.h>
+
+#include <vector>
+
+namespace three {
+
+// Draws many copies of the same geometry and material in a single draw call.
+// Each instance has its own transform (relative to the mesh) and an optional
+// color. Instancing is a program variant, so don't share the material with
+// regular meshes, and set material->needsUpdate after adding or removing
+// instance colors.
+class THREE_DECL InstancedMesh : public Mesh {
+public:
+
+  THREE_IMPL_OBJECT(InstancedMesh)
+
+  static Ptr create( const Geometry::Ptr& geometry, const Material::Ptr& material, size_t count );
+
+  size_t count() const { return instanceMatrices.size(); }
+
+  void setMatrixAt( size_t index, const Matrix4& matrix );
+  void setColorAt( size_t index, const Color& color );
+
+  std::vector<Matrix4> instanceMatrices;
+  std::vector<Color> instanceColors;
+
+  // Cull each instance against the camera frustum every frame. Not done
+  // while the mesh casts shadows into a shadow map.
+  bool instanceFrustumCulled;
+  bool instancesNeedUpdate;
+
+  // Renderer data: visible instances packed as 16 matrix floats (+ 3 color floats)
+
+  Buffer __glInstanceBuffer;
+  std::vector<float> __instanceArray;
+  int __instanceCount;
+
+protected:
+
+  InstancedMesh( const Geometry::Ptr& geometry, const Material::Ptr& material, size_t count );
+
+};
+
+} // namespace three
+
+#endif // THREE_INSTANCED_MESH_H
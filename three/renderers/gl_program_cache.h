@@ -0,0 +1,45 @@
+#ifndef THREE_GL_PROGRAM_CACHE_H
+#define THREE_GL_PROGRAM_CACHE_H
+
+#include <three/common.h>
+#include <three/gl.h>
+
+#include <cstdint>
+#include <string>
+
+namespace three {
+
+// On-disk cache of linked program binaries (GL 4.1 / ARB_get_program_binary).
+// Entries are keyed by the renderer's program variant key together with the
+// driver's vendor, renderer and version strings. A missing or corrupt file,
+// a different driver or a binary the driver refuses are all misses, after
+// which the program is compiled from source and saved again.
+
+class THREE_DECL GLProgramCache {
+public:
+
+  GLProgramCache( const GLInterfaceWrapper& gl, std::string directory );
+
+  // True if a directory is set and the context can load program binaries
+  bool enabled() const { return _enabled; }
+
+  // Loads the binary stored for `key` into `program`, returns false on a miss
+  bool load( std::uint64_t key, Buffer program ) const;
+
+  // Stores the binary of the linked `program` under `key`
+  bool save( std::uint64_t key, Buffer program ) const;
+
+  std::string path( std::uint64_t key ) const;
+
+private:
+
+  const GLInterfaceWrapper& _gl;
+  std::string _directory;
+  std::string _driver;
+  bool _enabled;
+
+};
+
+} // namespace three
+
+#endif // THREE_GL_PROGRAM_CACHE_H
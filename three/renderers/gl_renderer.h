@@ -7,8 +7,11 @@
 
 #include <three/math/frustum.h>
 #include <three/math/vector3.h>
+#include <three/math/matrix3.h>
 #include <three/math/matrix4.h>
 #include <three/core/interfaces.h>
+#include <three/core/geometry_buffer.h>
+#include <three/core/task_scheduler.h>
 #include <three/events/event.h>
 
 #include <three/scenes/scene.h>
@@ -17,6 +20,17 @@
 #include <three/textures/texture.h>
 
 #include <three/renderers/gl_render_target.h>
+#include <three/renderers/gl_program_cache.h>
+#include <three/renderers/gl_stream_buffer.h>
+#include <three/renderers/occlusion_buffer.h>
+
+#include <three/utils/dirty_ranges.h>
+#include <three/utils/vertex_encoding.h>
+
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
 
 #ifndef TEXTURE_MAX_ANISOTROPY_EXT
 #define TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
@@ -54,6 +68,16 @@ public:
 
   bool sortObjects;
 
+  // Hides objects that the meshes marked Object3D::occluder cover entirely,
+  // after frustum culling. The occluders' Geometry faces are rasterized on
+  // the CPU every frame, so they should be few and simple.
+  bool occlusionCulling;
+
+  // Resolves each render list entry's program, matrices and material
+  // uniform values on the worker threads before drawing the list. Off, the
+  // list is resolved serially as it is drawn.
+  bool drawPackets;
+
   bool autoUpdateObjects;
   bool autoUpdateScene;
 
@@ -86,6 +110,63 @@ public:
 
 public:
 
+  // Statistics. The render counters and times cover the last render() call,
+  // memory counts what is currently allocated.
+
+  struct Info {
+
+    struct Memory {
+      Memory() : programs( 0 ), geometries( 0 ), textures( 0 ) { }
+      int programs;
+      int geometries;
+      int textures;
+    } memory;
+
+    struct Render {
+      Render() : calls( 0 ), vertices( 0 ), faces( 0 ), points( 0 ), programSwitches( 0 ), materialRefreshes( 0 ),
+        textureBinds( 0 ), stateChanges( 0 ), bufferBytesUploaded( 0 ), uniformUploads( 0 ), uniformUploadsSkipped( 0 ),
+        bufferBindsSkipped( 0 ), textureBindsSkipped( 0 ), attributeCallsSkipped( 0 ), framebufferBindsSkipped( 0 ),
+        objectsDrawn( 0 ), objectsCulled( 0 ), objectsOccluded( 0 ) { }
+      int calls;
+      int vertices;
+      int faces;
+      int points;
+      int programSwitches;
+      int materialRefreshes;
+      int textureBinds;
+      // blending, depth, face culling, polygon offset and line width
+      int stateChanges;
+      size_t bufferBytesUploaded;
+      int uniformUploads;
+      int uniformUploadsSkipped;
+      // GL calls avoided by the state cache
+      int bufferBindsSkipped;
+      int textureBindsSkipped;
+      int attributeCallsSkipped;
+      int framebufferBindsSkipped;
+      // visible objects in the scene's render list, by culling outcome;
+      // occluded ones passed the frustum test
+      int objectsDrawn;
+      int objectsCulled;
+      int objectsOccluded;
+    } render;
+
+    // CPU time of each phase of render(), in milliseconds
+    struct Time {
+      Time() : update( 0 ), prePlugins( 0 ), culling( 0 ), recording( 0 ), opaque( 0 ), transparent( 0 ), postPlugins( 0 ) { }
+      double update;      // scene graph, camera and object buffers
+      double prePlugins;
+      double culling;     // frustum and occlusion culling, sorting
+      double recording;   // draw packets, see recordDrawPackets
+      double opaque;      // or the override material pass
+      double transparent;
+      double postPlugins;
+    } time;
+
+  };
+
+  const Info& info() const { return _info; }
+
   GLInterface& getContext() { return _gl; }
 
   bool supportsVertexTextures() const { return _supportsVertexTextures; }
@@ -129,6 +210,12 @@ public:
   void updateShadowMap( const Scene& scene, const Camera& camera );
   void resetStates();
 
+  // Builds every buffer and program `scene` needs without drawing anything.
+  // With a time budget (in milliseconds) it returns false once the budget is
+  // spent, so new content can be prepared over several frames; call it again
+  // until it returns true.
+  bool compile( Scene& scene, Camera& camera, float timeBudget = 0 );
+
   int width() const { return _width; }
   int height() const { return _height; }
 
@@ -169,11 +256,54 @@ private:
   bool bufferGuessUVType( const Material* material );
   void initDirectBuffers( Geometry& geometry );
 
+  // Interleaved layout
+  void initInterleavedBuffer( GeometryBuffer& geometry, int vertices );
+  static void interleaveAttribute( GeometryBuffer& geometry, const GeometryBuffer::InterleavedAttribute& attribute, int first, int count );
+  static const GeometryBuffer::InterleavedAttribute* interleavedAttribute( const GeometryBuffer& geometry, const std::string& name );
+  void geometryAttribPointer( int location, GeometryBuffer& geometry, const std::string& name, Buffer buffer, int size,
+                              THREE::VertexFormat format = THREE::FloatVertexFormat, size_t firstVertex = 0 );
+
+  // Compact vertex formats
+  VertexEncoding vertexEncoding( const GeometryBuffer& geometry, const std::string& name, int itemSize, THREE::VertexFormat format ) const;
+  void bufferVertices( Buffer buffer, const std::vector<float>& array, const VertexEncoding& encoding, int hint );
+  void bufferVerticesRange( Buffer buffer, const std::vector<float>& array, const VertexEncoding& encoding, int first, int count );
+  bool quantizedPositions( const Geometry& geometry ) const;
+  bool quantizedPositions( const Object3D& object ) const;
+  void updatePositionQuantization( Geometry& geometry );
+
   // Buffer setting
 
   void setParticleBuffers( Geometry& geometry, int hint, Object3D& object );
   void setLineBuffers( Geometry& geometry, int hint );
-  void setMeshBuffers( GeometryGroup& geometryGroup, Object3D& object, int hint, bool dispose, Material* material );
+  // One geometry group's part of a setMeshBuffers call: which streams were
+  // packed, filled in before the uploads run on the GL thread
+  struct MeshBufferUpdate {
+    enum Stream { Vertices, MorphTargets, Skin, Colors, Tangents, Normals, Uvs, Uv2s, Elements, CustomAttributes };
+    MeshBufferUpdate( GeometryGroup& geometryGroup, Material* material )
+      : geometryGroup( &geometryGroup ), material( material ),
+        normalType( THREE::NoShading ), vertexColorType( THREE::NoColors ),
+        vertices( false ), morphTargets( 0 ), morphNormals( false ), skin( false ), colors( false ),
+        tangents( false ), normals( false ), uvs( false ), uv2s( false ), elements( false ),
+        interleavedDirty( false ) { }
+    // whether the stream of a named attribute was repacked
+    bool updated( const std::string& name ) const;
+    GeometryGroup* geometryGroup;
+    Material* material;
+    THREE::Shading normalType;
+    THREE::Colors vertexColorType;
+    bool vertices;
+    std::vector<DirtyRanges::Range> vertexRuns, colorRuns;
+    size_t morphTargets;
+    bool morphNormals, skin, colors, tangents, normals, uvs, uv2s, elements;
+    std::vector<Attribute*> customAttributes;
+    bool interleavedDirty;
+  };
+  void setMeshBuffers( std::vector<MeshBufferUpdate>& updates, Object3D& object, int hint, bool dispose );
+  void prepareMeshBuffers( MeshBufferUpdate& update, Object3D& object, std::vector<TaskScheduler::Task>& tasks );
+  void packMeshBuffers( MeshBufferUpdate& update, Object3D& object, MeshBufferUpdate::Stream stream, size_t index );
+  void interleaveMeshBuffers( MeshBufferUpdate& update, std::vector<TaskScheduler::Task>& tasks );
+  void uploadMeshBuffers( MeshBufferUpdate& update, int hint );
+  void uploadMeshStreams( MeshBufferUpdate& update, int hint );
   void setDirectBuffers( Geometry& geometry, int hint, bool dispose );
 
   // Buffer rendering
@@ -182,13 +312,53 @@ private:
   void renderBufferDirect( Camera& camera, Lights& lights, IFog* fog, Material& material, BufferGeometry& geometry, Object3D& object );
   void renderBuffer( Camera& camera, Lights& lights, IFog* fog, Material& material, GeometryGroup& geometryGroup, Object3D& object );
   void enableAttribute( int attributeId );
+  void disableAttribute( int attributeId );
   void disableAttributes();
+  void setDefaultAttributeValues( Program& program, Material& material, BufferGeometry& geometry );
+
+  // GL state cache helpers
+  void bindBuffer( GLenum target, Buffer buffer );
+  void bindTexture( GLenum target, Buffer texture, int slot = -1 );
+  void bindFramebuffer( Buffer framebuffer );
+  void vertexAttribPointer( int location, Buffer buffer, int size, GLenum type, bool normalized, int stride, size_t offset );
+  void invalidateStateCache();
+  void forgetBuffers();
+  void forgetTextures();
+
+  // Vertex array objects
+  bool bindVertexArray( GeometryBuffer& geometry, int key );
+  void bindDefaultVertexArray();
+  void endVertexArray();
+  void deleteVertexArrays( GeometryBuffer& geometry );
+
+  template < typename C >
+  void bindAndBuffer( GLenum target, Buffer buffer, const C& container, GLenum usage ) {
+    uploadBuffer( target, buffer, container.data(), container.size() * sizeof( container[0] ), usage );
+  }
+  template < typename C >
+  void bufferSubData( GLenum target, Buffer buffer, const C& container, int first, int count ) {
+    bindBuffer( target, buffer );
+    _gl.BufferSubData( target, first * sizeof( container[0] ), count * sizeof( container[0] ), &container[ first ] );
+    _info.render.bufferBytesUploaded += count * sizeof( container[0] );
+  }
+  template < typename T >
+  void updateDirtyRanges( DirtyRanges& ranges, const std::vector<T>& items, std::vector<float>& array, Buffer buffer );
+  void uploadBuffer( GLenum target, Buffer buffer, const void* data, size_t size, GLenum usage );
+  void deleteBuffer( Buffer& buffer );
+  bool canStream( size_t size ) const;
+  void immediateAttribute( int location, Buffer& buffer, const std::vector<float>& array, int size, bool streamed );
+  void setupInstances( InstancedMesh& object );
+  void enableInstanceAttributes( Program& program, InstancedMesh& object );
+  void resetInstanceAttributes( Program& program );
   void setupMorphTargets( Material& material, GeometryGroup& geometryGroup, Object3D& object );
 
 
   // Rendering
   void renderPlugins( std::vector<IPlugin::Ptr>& plugins, Scene& scene, Camera& camera );
-  void renderObjects( RenderList& renderList, bool reverse, THREE::RenderType materialType, Camera& camera, Lights& lights, IFog* fog, bool useBlending, Material* overrideMaterial = nullptr );
+  void cullObjects( Scene& scene, RenderList& renderList );
+  void occludeObjects( RenderList& renderList );
+  void recordDrawPackets( RenderList& renderList, Camera& camera, Lights& lights, IFog* fog, Material* overrideMaterial );
+  void renderObjects( RenderList& renderList, size_t first, size_t last, THREE::RenderType materialType, Camera& camera, Lights& lights, IFog* fog, bool useBlending, Material* overrideMaterial = nullptr );
   void renderObjectsImmediate( RenderList& renderList, THREE::RenderType materialType, Camera& camera, Lights& lights, IFog* fog, bool useBlending, Material* overrideMaterial = nullptr );
   void renderImmediateObject( Camera& camera, Lights& lights, IFog* fog, Material& material, Object3D& object );
   void unrollImmediateBufferMaterial( Scene::GLObject& globject );
@@ -219,8 +389,10 @@ private:
   void initMaterial( Material& material, Lights& lights, IFog* fog, Object3D& object );
   void setMaterialShaders( Material& material, const Shader& shaders );
   Program& setProgram( Camera& camera, Lights& lights, IFog* fog, Material& material, Object3D& object );
+  bool programCurrent( const Material& material, const Object3D& object ) const;
 
   // Uniforms (refresh uniforms objects)
+  void refreshUniformsMaterial( Camera& camera, IFog* fog, Material& material );
   void refreshUniformsCommon( Uniforms& uniforms, Material& material );
   void refreshUniformsLine( Uniforms& uniforms, Material& material );
   void refreshUniformsDash( Uniforms& uniforms, Material& material );
@@ -240,6 +412,14 @@ private:
   void setColorLinear( std::vector<float>& array, size_t offset, const Color& color, float intensity );
   void setupLights( Program& program, Lights& lights );
 
+  // Uniform blocks (shared by every program, uploaded once per frame)
+  void initUniformBlocks();
+  void bindUniformBlocks( Program& program );
+  void updateCameraBlock( Camera& camera );
+  void updateLightsBlock();
+  void updateFogBlock( IFog& fog );
+  int uniformBlockLights() const;
+
 
   // GL state setting
   void setFaceCulling( THREE::CullFace cullFace = THREE::CullFaceNone, THREE::FrontFaceDirection frontFace = THREE::FrontFaceDirectionCW );
@@ -347,41 +527,26 @@ private:
   Color _clearColor;
   float _clearAlpha;
   int _maxLights;
+  bool _uintIndices;
 
   // info
 
-  struct Info {
-
-    struct Memory {
-      Memory() : programs( 0 ), geometries( 0 ), textures( 0 ) { }
-      int programs;
-      int geometries;
-      int textures;
-    } memory;
-
-    struct Render {
-      Render() : calls( 0 ), vertices( 0 ), faces( 0 ), points( 0 ) { }
-      int calls;
-      int vertices;
-      int faces;
-      int points;
-    } render;
-
-  } _info;
+  Info _info;
 
   // internal properties
 
   struct ProgramInfo {
-    ProgramInfo( const Program::Ptr& program, std::string code, int usedTimes )
-      : program( program ), code( code ), usedTimes( usedTimes ) { }
+    ProgramInfo( const Program::Ptr& program, std::string variant, int usedTimes )
+      : program( program ), variant( std::move( variant ) ), usedTimes( usedTimes ) { }
     ProgramInfo()
       : program( 0 ), usedTimes( 0 ) { }
 
     Program::Ptr program;
-    std::string code;
+    std::string variant;
     int usedTimes;
   };
-  std::vector<ProgramInfo> _programs;
+  // compiled programs by the hash of their variant (see programVariant)
+  std::unordered_multimap<std::uint64_t, ProgramInfo> _programs;
   int _programs_counter;
 
   // internal state cache
@@ -423,6 +588,41 @@ private:
 
   std::unordered_map<int, bool> _enabledAttributes;
 
+  // bindings and attribute pointers last set through bindBuffer() and friends
+  // (unknownBinding after resetStates(), when a plugin may have changed them)
+
+  static const Buffer unknownBinding = ~0u;
+
+  struct AttributePointer {
+    AttributePointer()
+      : buffer( unknownBinding ), size( 0 ), type( 0 ), normalized( false ), stride( 0 ), offset( 0 ) { }
+    Buffer buffer;
+    int size;
+    GLenum type;
+    bool normalized;
+    int stride;
+    size_t offset;
+  };
+
+  Buffer _currentArrayBuffer;
+  Buffer _currentElementArrayBuffer;
+  int _currentTextureUnit;
+  std::vector<std::pair<GLenum, Buffer>> _currentTextures;
+  std::vector<AttributePointer> _currentAttributePointers;
+
+  // attribute state belongs to the bound vertex array, so the default array's
+  // is set aside while a recorded one is bound
+
+  Buffer _currentVertexArray;
+  GeometryBuffer::VertexArray* _recordingVertexArray;
+
+  struct VertexArrayState {
+    VertexArrayState() : elementArrayBuffer( unknownBinding ) { }
+    std::unordered_map<int, bool> enabledAttributes;
+    std::vector<AttributePointer> attributePointers;
+    Buffer elementArrayBuffer;
+  } _defaultVertexArrayState;
+
   Frustum _frustum;
 
   // camera matrices cache
@@ -431,6 +631,52 @@ private:
 
   Vector3 _vector3;
 
+  // render list sorting
+  RenderList _renderListScratch;
+  size_t _opaqueObjectsCount;
+  size_t _transparentObjectsCount;
+
+  // What drawing one render list entry takes besides GL calls, recorded by
+  // the workers after sorting and replayed in list order by renderObjects
+  struct DrawPacket {
+    Material* material; // of the entry's pass or the override, nullptr if it has none
+    Program* program;   // the material's, nullptr if setProgram must (re)build it
+    Matrix4 modelViewMatrix;
+    Matrix3 normalMatrix;
+  };
+
+  std::vector<DrawPacket> _drawPackets;
+  const DrawPacket* _drawPacket; // being replayed, read by setProgram and loadUniformsMatrices
+
+  // the materials of packets with a program, whose uniform values the
+  // workers refresh once per frame
+  std::vector<Material*> _packetMaterials;
+  std::unordered_set<Material*> _packetMaterialSet;
+
+  // What culling one chunk of the render list found, folded in chunk order
+  struct CullChunk {
+    CullChunk() : drawn( 0 ), culled( 0 ),
+      minZ( std::numeric_limits<float>::max() ), maxZ( std::numeric_limits<float>::lowest() ) { }
+    int drawn;
+    int culled;
+    float minZ;
+    float maxZ;
+  };
+
+  std::vector<CullChunk> _cullChunks;
+
+  // frustum test outcome by the scene's AABBTree proxy
+  std::vector<unsigned char> _inFrustum;
+  // the proxies of leaves the frustum crosses, tested object by object
+  std::vector<int> _boundaryProxies;
+
+  std::unique_ptr<OcclusionBuffer> _occlusionBuffer;
+  std::vector<Object3D*> _occluders;
+  std::vector<int> _occludedChunks;
+
+  // the render list is culled and recorded in chunks of this many objects
+  static const size_t renderListChunkSize = 256;
+
   // light arrays cache
   Vector3 _direction;
   bool _lightsNeedUpdate;
@@ -469,8 +715,34 @@ private:
 
   } _lights;
 
+  // uniform blocks
+  bool _uniformBlocks;
+  bool _fogBlockNeedsUpdate;
+  Buffer _cameraBlockBuffer;
+  Buffer _lightsBlockBuffer;
+  Buffer _fogBlockBuffer;
+  std::vector<float> _uniformBlockData;
+
   GLInterfaceWrapper _gl;
 
+  std::string _programCacheDirectory;
+  std::unique_ptr<GLProgramCache> _programCache;
+
+  // streaming uploads, with the sizes dynamic buffers were allocated at
+  size_t _streamBufferSize;
+  std::unique_ptr<GLStreamBuffer> _streamBuffer;
+  std::unordered_map<Buffer, size_t> _bufferSizes;
+
+  // scratch for vertices in compact formats, on their way to the GPU
+  std::vector<unsigned char> _encodedVertices;
+
+  // workers for vertex packing and the render list, and the smallest
+  // batch (in faces) worth packing on them
+  int _workerThreads;
+  TaskScheduler::Ptr _scheduler;
+  std::vector<TaskScheduler::Task> _packTasks;
+  static const size_t parallelPackFaces = 4096;
+
   bool _glExtensionTextureFloat;
   bool _glExtensionTextureFloatLinear;
   bool _glExtensionStandardDerivatives;
@@ -488,6 +760,11 @@ private:
 
   bool _supportsVertexTextures;
   bool _supportsBoneTextures;
+  bool _supportsInstancing;
+  bool _supportsUniformBlocks;
+  bool _supportsVertexArrays;
+  bool _supportsUintIndices;
+  bool _supportsVertexFormats;
 
   /*
   // default plugins (order is important)
@@ -0,0 +1,61 @@
+#ifndef THREE_GL_STREAM_BUFFER_H
+#define THREE_GL_STREAM_BUFFER_H
+
+#include <three/common.h>
+#include <three/gl.h>
+
+#include <cstddef>
+
+namespace three {
+
+// Ring buffer for data that is rewritten every frame or so. Writes append to
+// the ring through unsynchronized mappings; once it is full the storage is
+// orphaned, so the driver keeps the old one alive for draws still in flight
+// and no write ever waits on the GPU. Data either gets drawn straight from
+// buffer() or copied into its own buffer on the GPU with upload().
+
+class THREE_DECL GLStreamBuffer {
+public:
+
+  GLStreamBuffer( const GLInterfaceWrapper& gl, std::size_t capacity );
+  ~GLStreamBuffer();
+
+  // True if the context can map and copy buffers and the storage was created
+  bool enabled() const { return _buffer != 0; }
+
+  Buffer buffer() const { return _buffer; }
+  std::size_t capacity() const { return _capacity; }
+
+  // Number of times the ring wrapped around since creation
+  int orphans() const { return _orphans; }
+
+  // Appends `size` bytes and returns their offset in buffer().
+  // `size` must not exceed capacity().
+  std::size_t write( const void* data, std::size_t size );
+
+  // The room a write of `size` bytes takes in the ring, alignment included
+  static std::size_t footprint( std::size_t size );
+
+  // Orphans the storage now unless writes with footprints adding up to
+  // `size` still fit, so that data drawn together stays in one storage.
+  // `size` must not exceed capacity().
+  void reserve( std::size_t size );
+
+  // Replaces the first `size` bytes of `target` with `data` via the ring
+  void upload( Buffer target, const void* data, std::size_t size );
+
+private:
+
+  void orphan();
+
+  const GLInterfaceWrapper& _gl;
+  Buffer _buffer;
+  std::size_t _capacity;
+  std::size_t _offset;
+  int _orphans;
+
+};
+
+} // namespace three
+
+#endif // THREE_GL_STREAM_BUFFER_H
@@ -0,0 +1,213 @@
+#include <three/renderers/gl_program_cache.h>
+
+#include <three/console.h>
+#include <three/utils/hash.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+
+namespace three {
+
+namespace {
+
+const char programCacheMagic[ 8 ] = { 'T', 'H', 'R', 'E', 'E', 'P', 'B', '1' };
+
+std::string glString( const GLInterfaceWrapper& gl, GLenum name ) {
+  const auto str = gl.GetString( name );
+  return str ? std::string( reinterpret_cast<const char*>( str ) ) : std::string();
+}
+
+struct File {
+  explicit File( std::FILE* file ) : file( file ) { }
+  ~File() { if ( file ) std::fclose( file ); }
+  std::FILE* file;
+};
+
+bool writeUint32( std::FILE* file, std::uint32_t value ) {
+  return std::fwrite( &value, sizeof( value ), 1, file ) == 1;
+}
+
+bool readUint32( std::FILE* file, std::uint32_t& value ) {
+  return std::fread( &value, sizeof( value ), 1, file ) == 1;
+}
+
+// Bytes between the read position and the end of the file
+bool remaining( std::FILE* file, unsigned long& bytes ) {
+  const auto position = std::ftell( file );
+  if ( position < 0 || std::fseek( file, 0, SEEK_END ) != 0 ) return false;
+  const auto end = std::ftell( file );
+  if ( end < position || std::fseek( file, position, SEEK_SET ) != 0 ) return false;
+  bytes = ( unsigned long )( end - position );
+  return true;
+}
+
+// Moves `from` over `to`, which Windows' rename won't replace
+bool replace( const std::string& from, const std::string& to ) {
+  if ( std::rename( from.c_str(), to.c_str() ) == 0 ) return true;
+  std::remove( to.c_str() );
+  return std::rename( from.c_str(), to.c_str() ) == 0;
+}
+
+} // namespace
+
+GLProgramCache::GLProgramCache( const GLInterfaceWrapper& gl, std::string directory )
+  : _gl( gl ), _directory( std::move( directory ) ), _enabled( false ) {
+
+#if !defined(THREE_GLES)
+
+  if ( _directory.empty() ) return;
+
+  if ( ! _gl.GetProgramBinary || ! _gl.ProgramBinary ) {
+    console().warn( "THREE::GLProgramCache: Program binaries not supported, cache disabled." );
+    return;
+  }
+
+  if ( _gl.GetParameteri( GL_NUM_PROGRAM_BINARY_FORMATS ) <= 0 ) {
+    console().warn( "THREE::GLProgramCache: No program binary formats, cache disabled." );
+    return;
+  }
+
+  _driver = glString( _gl, GL_VENDOR ) + "\n" +
+            glString( _gl, GL_RENDERER ) + "\n" +
+            glString( _gl, GL_VERSION );
+
+  _enabled = true;
+
+#endif
+
+}
+
+std::string GLProgramCache::path( std::uint64_t key ) const {
+
+  // the driver is part of the name so several drivers can share a directory
+
+  const auto hash = fnv1a_hash( &key, sizeof( key ), fnv1a_hash( _driver.data(), _driver.size() ) );
+
+  char name[ 24 ];
+  std::snprintf( name, sizeof( name ), "%016llx.bin", ( unsigned long long )hash );
+
+  return _directory + "/" + name;
+
+}
+
+bool GLProgramCache::load( std::uint64_t key, Buffer program ) const {
+
+#if !defined(THREE_GLES)
+
+  if ( ! _enabled ) return false;
+
+  File file( std::fopen( path( key ).c_str(), "rb" ) );
+
+  if ( ! file.file ) return false;
+
+  char magic[ sizeof( programCacheMagic ) ];
+  std::uint32_t driverLength = 0, format = 0, length = 0;
+
+  if ( std::fread( magic, sizeof( magic ), 1, file.file ) != 1 ||
+       std::memcmp( magic, programCacheMagic, sizeof( magic ) ) != 0 ||
+       ! readUint32( file.file, driverLength ) ||
+       driverLength != _driver.size() ) {
+    return false;
+  }
+
+  std::string driver( driverLength, '\0' );
+
+  // a corrupt length must not allocate more than the file could hold
+
+  unsigned long available = 0;
+
+  if ( ( driverLength && std::fread( &driver[ 0 ], driverLength, 1, file.file ) != 1 ) ||
+       driver != _driver ||
+       ! readUint32( file.file, format ) ||
+       ! readUint32( file.file, length ) ||
+       length == 0 ||
+       ! remaining( file.file, available ) ||
+       length > available ) {
+    return false;
+  }
+
+  std::vector<unsigned char> binary( length );
+
+  if ( std::fread( binary.data(), length, 1, file.file ) != 1 ) return false;
+
+  _gl.ProgramBinary( program, format, binary.data(), ( GLsizei )length );
+
+  // drivers may reject binaries from older builds even with matching strings
+
+  return _gl.GetProgramParameter( program, GL_LINK_STATUS ) == GL_TRUE;
+
+#else
+
+  return false;
+
+#endif
+
+}
+
+bool GLProgramCache::save( std::uint64_t key, Buffer program ) const {
+
+#if !defined(THREE_GLES)
+
+  if ( ! _enabled ) return false;
+
+  const auto length = _gl.GetProgramParameter( program, GL_PROGRAM_BINARY_LENGTH );
+
+  if ( length <= 0 ) return false;
+
+  std::vector<unsigned char> binary( length );
+  GLsizei written = 0;
+  GLenum format = 0;
+
+  _gl.GetProgramBinary( program, length, &written, &format, binary.data() );
+
+  if ( written <= 0 ) return false;
+
+  // written next to the entry and renamed into place, so that a reader, or
+  // another process saving the same program, never sees a partial file
+
+  const auto filename = path( key );
+
+  char suffix[ 40 ];
+  std::snprintf( suffix, sizeof( suffix ), ".%llx.tmp",
+                 ( unsigned long long )( std::hash<std::thread::id>()( std::this_thread::get_id() ) ^
+                                         ( std::size_t )std::chrono::steady_clock::now().time_since_epoch().count() ) );
+
+  const auto temporary = filename + suffix;
+
+  File file( std::fopen( temporary.c_str(), "wb" ) );
+
+  if ( ! file.file ) {
+    console().warn() << "THREE::GLProgramCache: Unable to write " << filename;
+    return false;
+  }
+
+  auto complete = std::fwrite( programCacheMagic, sizeof( programCacheMagic ), 1, file.file ) == 1 &&
+                  writeUint32( file.file, ( std::uint32_t )_driver.size() ) &&
+                  ( _driver.empty() || std::fwrite( _driver.data(), _driver.size(), 1, file.file ) == 1 ) &&
+                  writeUint32( file.file, format ) &&
+                  writeUint32( file.file, ( std::uint32_t )written ) &&
+                  std::fwrite( binary.data(), written, 1, file.file ) == 1;
+
+  complete = std::fclose( file.file ) == 0 && complete;
+  file.file = nullptr;
+
+  if ( ! complete || ! replace( temporary, filename ) ) {
+    std::remove( temporary.c_str() );
+    return false;
+  }
+
+  return true;
+
+#else
+
+  return false;
+
+#endif
+
+}
+
+} // namespace three
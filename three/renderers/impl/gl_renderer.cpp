@@ -10,6 +10,7 @@
 #include <three/math/vector3.h>
 #include <three/math/vector4.h>
 #include <three/math/color.h>
+#include <three/math/sphere.h>
 
 #include <three/core/interfaces.h>
 #include <three/core/buffer_geometry.h>
@@ -27,10 +28,12 @@
 
 #include <three/objects/line.h>
 #include <three/objects/mesh.h>
+#include <three/objects/instanced_mesh.h>
 #include <three/objects/particle_system.h>
 
 #include <three/renderers/gl_render_target.h>
 #include <three/renderers/gl/gl_shader.h>
+#include <three/renderers/shaders/shader_chunk.h>
 #include <three/renderers/shaders/shader_lib.h>
 #include <three/renderers/renderer_parameters.h>
 #include <three/renderers/renderables/renderable_object.h>
@@ -44,9 +47,16 @@
 #include <three/utils/hash.h>
 #include <three/utils/conversion.h>
 #include <three/utils/template.h>
+#include <three/utils/radix_sort.h>
 
 #include <three/events/events.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
 #ifndef NDEBUG
 #define GL_CALL(a) (a); _gl.Error(__FILE__, __LINE__)
 #else
@@ -94,8 +104,23 @@ struct ProgramParameters {
   bool wrapAround;
   bool doubleSided;
   bool flipSided;
+  bool instancing;
+  bool instancingColor;
+  bool quantizedPosition;
 };
 
+static inline GLenum vertexFormatType( THREE::VertexFormat format ) {
+  switch ( format ) {
+#ifndef THREE_GLES
+  case THREE::HalfFloatVertexFormat:     return GL_HALF_FLOAT;
+  case THREE::Int2101010VertexFormat:    return GL_INT_2_10_10_10_REV;
+#endif
+  case THREE::UnsignedShortVertexFormat: return GL_UNSIGNED_SHORT;
+  case THREE::UnsignedByteVertexFormat:  return GL_UNSIGNED_BYTE;
+  default:                               return GL_FLOAT;
+  }
+}
+
 GLRenderer::Ptr GLRenderer::create( const RendererParameters& parameters,
                                     const GLInterface& gl ) {
   auto renderer = make_shared<GLRenderer>( parameters, gl );
@@ -110,6 +135,8 @@ GLRenderer::GLRenderer( const RendererParameters& parameters, const GLInterface&
     autoClearDepth( true ),
     autoClearStencil( true ),
     sortObjects( true ),
+    occlusionCulling( false ),
+    drawPackets( true ),
     autoUpdateObjects( true ),
     autoUpdateScene( true ),
     gammaInput( false ),
@@ -135,6 +162,7 @@ GLRenderer::GLRenderer( const RendererParameters& parameters, const GLInterface&
     _clearColor( parameters.clearColor ),
     _clearAlpha( parameters.clearAlpha ),
     _maxLights( parameters.maxLights ),
+    _uintIndices( parameters.uintIndices ),
     _programs_counter( 0 ),
     _currentProgram( 0 ),
     _currentFramebuffer( 0 ),
@@ -161,8 +189,25 @@ GLRenderer::GLRenderer( const RendererParameters& parameters, const GLInterface&
     _viewportHeight( 0 ),
     _currentWidth( 0 ),
     _currentHeight( 0 ),
+    _currentArrayBuffer( unknownBinding ),
+    _currentElementArrayBuffer( unknownBinding ),
+    _currentTextureUnit( -1 ),
+    _currentVertexArray( 0 ),
+    _recordingVertexArray( nullptr ),
+    _opaqueObjectsCount( 0 ),
+    _transparentObjectsCount( 0 ),
+    _drawPacket( nullptr ),
     _lightsNeedUpdate( true ),
-    _gl( gl ) {
+    _uniformBlocks( parameters.uniformBlocks ),
+    _fogBlockNeedsUpdate( true ),
+    _cameraBlockBuffer( 0 ),
+    _lightsBlockBuffer( 0 ),
+    _fogBlockBuffer( 0 ),
+    _gl( gl ),
+    _programCacheDirectory( parameters.programCacheDirectory ),
+    _streamBufferSize( parameters.streamBufferSize ),
+    _workerThreads( parameters.workerThreads ),
+    _scheduler( parameters.scheduler ) {
   console().log() << "GLRenderer created";
 }
 
@@ -193,6 +238,66 @@ void GLRenderer::initialize() {
   _maxAnisotropy = _glExtensionTextureFilterAnisotropic ? _gl.GetTexParameterf( TEXTURE_MAX_ANISOTROPY_EXT ) : 0.f;
   _supportsVertexTextures = ( _maxVertexTextures > 0 );
   _supportsBoneTextures = _supportsVertexTextures && _glExtensionTextureFloat;
+#ifndef THREE_GLES
+  _supportsInstancing = _gl.DrawArraysInstanced && _gl.DrawElementsInstanced && _gl.VertexAttribDivisor;
+#else
+  _supportsInstancing = false;
+#endif
+#if !defined(THREE_GLES) && !defined(__APPLE__)
+  _supportsUniformBlocks = _gl.GetUniformBlockIndex && _gl.UniformBlockBinding && _gl.BindBufferBase;
+#else
+  _supportsUniformBlocks = false;
+#endif
+#ifndef THREE_GLES
+  _supportsVertexArrays = _gl.GenVertexArrays && _gl.DeleteVertexArrays && _gl.BindVertexArray;
+#else
+  _supportsVertexArrays = false;
+#endif
+  // core in desktop GL, an extension (OES_element_index_uint) on ES 2
+#ifndef THREE_GLES
+  _supportsUintIndices = _uintIndices;
+#else
+  _supportsUintIndices = false;
+#endif
+  // 10:10:10:2 vertex attributes are core since GL 3.3, half floats since
+  // 3.0, and both extensions before
+#ifndef THREE_GLES
+  _supportsVertexFormats = _gl.GetVersion() >= 33 ||
+                           ( ( _gl.GetVersion() >= 30 || _gl.HasExtension( "GL_ARB_half_float_vertex" ) ) &&
+                             _gl.HasExtension( "GL_ARB_vertex_type_2_10_10_10_rev" ) );
+  if ( ! _supportsVertexFormats ) {
+    console().log( "THREE::GLRenderer: Compact vertex formats not supported, falling back to floats." );
+  }
+#else
+  _supportsVertexFormats = false;
+#endif
+
+  if ( _uniformBlocks && ! _supportsUniformBlocks ) {
+    console().warn( "THREE::GLRenderer: Uniform blocks not supported, falling back to plain uniforms." );
+    _uniformBlocks = false;
+  }
+
+  if ( _uniformBlocks ) initUniformBlocks();
+
+  if ( ! _programCacheDirectory.empty() ) {
+    _programCache.reset( new GLProgramCache( _gl, _programCacheDirectory ) );
+  }
+
+  if ( _streamBufferSize > 0 ) {
+    _streamBuffer.reset( new GLStreamBuffer( _gl, _streamBufferSize ) );
+    if ( ! _streamBuffer->enabled() ) _streamBuffer.reset();
+  }
+
+  // a thread count of its own gets the renderer its own workers, by
+  // default it shares the library's
+
+  if ( ! _scheduler ) {
+    if ( _workerThreads < 0 ) {
+      _scheduler = TaskScheduler::shared();
+    } else if ( _workerThreads > 0 ) {
+      _scheduler = TaskScheduler::create( _workerThreads );
+    }
+  }
 
   console().log() << "THREE::GLRenderer initialized";
 
@@ -461,27 +566,32 @@ void GLRenderer::onMaterialDispose( const Event& event ) {
 
 void GLRenderer::deleteBuffers( GeometryBuffer& geometry ) {
 
-  _gl.DeleteBuffer( geometry.__glVertexBuffer );
-  _gl.DeleteBuffer( geometry.__glNormalBuffer );
-  _gl.DeleteBuffer( geometry.__glTangentBuffer );
-  _gl.DeleteBuffer( geometry.__glColorBuffer );
-  _gl.DeleteBuffer( geometry.__glUVBuffer );
-  _gl.DeleteBuffer( geometry.__glUV2Buffer );
+  deleteBuffer( geometry.__glVertexBuffer );
+  deleteBuffer( geometry.__glNormalBuffer );
+  deleteBuffer( geometry.__glTangentBuffer );
+  deleteBuffer( geometry.__glColorBuffer );
+  deleteBuffer( geometry.__glUVBuffer );
+  deleteBuffer( geometry.__glUV2Buffer );
 
-  _gl.DeleteBuffer( geometry.__glSkinIndicesBuffer );
-  _gl.DeleteBuffer( geometry.__glSkinWeightsBuffer );
+  deleteBuffer( geometry.__glSkinIndicesBuffer );
+  deleteBuffer( geometry.__glSkinWeightsBuffer );
 
-  _gl.DeleteBuffer( geometry.__glFaceBuffer );
-  _gl.DeleteBuffer( geometry.__glLineBuffer );
+  deleteBuffer( geometry.__glFaceBuffer );
+  deleteBuffer( geometry.__glLineBuffer );
 
-  _gl.DeleteBuffer( geometry.__glLineDistanceBuffer );
+  deleteBuffer( geometry.__glLineDistanceBuffer );
+
+  deleteBuffer( geometry.__glInterleavedBuffer );
 
   // custom attributes
 
   for ( auto& attribute : geometry.__glCustomAttributesList ) {
-    _gl.DeleteBuffer( attribute->buffer );
+    deleteBuffer( attribute->buffer );
   }
 
+  deleteVertexArrays( geometry );
+  forgetBuffers();
+
   _info.memory.geometries --;
 
 }
@@ -499,25 +609,28 @@ void GLRenderer::deallocateGeometry( Geometry& geometry ) {
       //auto& a = namedAttribute.first;
       auto& attribute = namedAttribute.second;
 
-      _gl.DeleteBuffer( attribute.buffer );
+      deleteBuffer( attribute.buffer );
 
     }
 
+    deleteBuffer( geometry.__glInterleavedBuffer );
+
+    deleteVertexArrays( geometry );
+    forgetBuffers();
+
     _info.memory.geometries --;
 
   } else {
 
     if ( geometry.geometryGroups.size() ) {
 
-      for ( auto& g : geometry.geometryGroups ) {
-
-        auto& geometryGroup = g.second;
+      for ( auto& geometryGroup : geometry.geometryGroups ) {
 
         if ( geometryGroup->morphTargets.size() ) {
 
           for ( size_t m = 0, ml = geometryGroup->morphTargets.size(); m < ml; m ++ ) {
 
-            _gl.DeleteBuffer( geometryGroup->__glMorphTargetsBuffers[ m ] );
+            deleteBuffer( geometryGroup->__glMorphTargetsBuffers[ m ] );
 
           }
 
@@ -527,7 +640,7 @@ void GLRenderer::deallocateGeometry( Geometry& geometry ) {
 
           for ( size_t m = 0, ml = geometryGroup->morphNormals.size(); m < ml; m ++ ) {
 
-            _gl.DeleteBuffer( geometryGroup->__glMorphNormalsBuffers[ m ] );
+            deleteBuffer( geometryGroup->__glMorphNormalsBuffers[ m ] );
 
           }
 
@@ -558,6 +671,8 @@ void GLRenderer::deallocateTexture( Texture& texture ) {
   texture.__glInit = false;
   _gl.DeleteTexture( texture.__glTexture );
 
+  forgetTextures();
+
   _info.memory.textures --;
 
 }
@@ -573,6 +688,11 @@ void GLRenderer::deallocateRenderTarget( GLRenderTarget& renderTarget ) {
     _gl.DeleteFramebuffer( frameBuffer );
   }
 
+  // deleting the bound framebuffer reverts the binding to the default one
+
+  forgetTextures();
+  _currentFramebuffer = unknownBinding;
+
   renderTarget.__glFramebuffer.clear();
 
   for ( auto& renderBuffer : renderTarget.__glRenderbuffer ) {
@@ -590,24 +710,28 @@ void GLRenderer::deallocateMaterial( Material& material ) {
 
   if ( ! program ) return;
 
-  // only deallocate GL program if this was the last use of shared program
-  // assumed there is only single copy of any program in the _programs list
-  // (that's how it's constructed)
+  // the material releases its reference either way, so a material
+  // deallocated twice can't take the count below its real users
 
-  auto programCmp = [&]( const ProgramInfo& programInfo ) {
-    return programInfo.program == program;
-  };
+  material.program.reset();
+
+  // only deallocate GL program if this was the last use of shared program
 
-  auto programIt = std::find_if( _programs.begin(), _programs.end(), programCmp );
+  auto programs = _programs.equal_range( program->key );
+  auto programIt = std::find_if( programs.first, programs.second, [&program]( const std::pair<const std::uint64_t, ProgramInfo>& p ) {
+    return p.second.program == program;
+  } );
 
-  if ( programIt == _programs.end() )
+  if ( programIt == programs.second )
     return;
 
-  if ( --programIt->usedTimes == 0 ) {
+  if ( --programIt->second.usedTimes == 0 ) {
+
+    if ( _currentProgram == program.get() ) _currentProgram = 0;
 
     _gl.DeleteProgram( program->program );
-    _info.memory.programs --;
-    _programs.erase( std::remove_if(_programs.begin(), _programs.end(), programCmp) );
+    _programs.erase( programIt );
+    _info.memory.programs = ( int )_programs.size();
 
   }
 
@@ -744,8 +868,38 @@ void GLRenderer::initMeshBuffers( GeometryGroup& geometryGroup, Mesh& object ) {
 
   }
 
-  geometryGroup.__faceArray.resize( ntris * 3 );
-  geometryGroup.__lineArray.resize( nlines * 2 );
+  if ( geometryGroup.interleaved ) {
+
+    // the streams sized above are the ones the material reads
+
+    auto& layout = geometryGroup.__interleavedAttributes;
+    layout.clear();
+
+    const std::pair<const char*, const std::vector<float>*> streams[] = {
+      { AttributeKey::position(), &geometryGroup.__vertexArray },
+      { AttributeKey::normal(),   &geometryGroup.__normalArray },
+      { AttributeKey::tangent(),  &geometryGroup.__tangentArray },
+      { AttributeKey::color(),    &geometryGroup.__colorArray },
+      { AttributeKey::uv(),       &geometryGroup.__uvArray },
+      { AttributeKey::uv2(),      &geometryGroup.__uv2Array }
+    };
+
+    for ( const auto& stream : streams ) {
+      if ( stream.second->empty() ) continue;
+      layout.push_back( GeometryBuffer::InterleavedAttribute{ stream.first, stream.second, ( int )( stream.second->size() / nvertices ), 0 } );
+    }
+
+    initInterleavedBuffer( geometryGroup, nvertices );
+
+  }
+
+  if ( geometryGroup.__glUintIndices ) {
+    geometryGroup.__faceArray32.resize( ntris * 3 );
+    geometryGroup.__lineArray32.resize( nlines * 2 );
+  } else {
+    geometryGroup.__faceArray.resize( ntris * 3 );
+    geometryGroup.__lineArray.resize( nlines * 2 );
+  }
 
   if ( geometryGroup.numMorphTargets ) {
 
@@ -895,23 +1049,323 @@ bool GLRenderer::bufferGuessUVType( const Material* material ) {
 
 void GLRenderer::initDirectBuffers( Geometry& geometry ) {
 
+  auto& layout = geometry.__interleavedAttributes;
+  layout.clear();
+
+  auto vertices = std::numeric_limits<int>::max();
+
+  if ( quantizedPositions( geometry ) ) {
+    updatePositionQuantization( geometry );
+  }
+
   for ( auto& a : geometry.attributes ) {
 
     auto type = a.first == AttributeKey::index() ? GL_ELEMENT_ARRAY_BUFFER
                 : GL_ARRAY_BUFFER;
 
     auto& attribute = a.second;
-    attribute.buffer = _gl.CreateBuffer();
     attribute.numItems = (int)attribute.array.size();
 
-    _gl.BindAndBuffer( type, attribute.buffer, attribute.array, GL_STATIC_DRAW );
+    if ( geometry.interleaved && type == GL_ARRAY_BUFFER && attribute.itemSize > 0 ) {
+
+      layout.push_back( GeometryBuffer::InterleavedAttribute{ a.first, &attribute.array, attribute.itemSize, 0 } );
+      vertices = std::min( vertices, attribute.numItems / attribute.itemSize );
+      continue;
+
+    }
+
+    attribute.buffer = _gl.CreateBuffer();
+
+    if ( type == GL_ARRAY_BUFFER && attribute.itemSize > 0 ) {
+      bufferVertices( attribute.buffer, attribute.array, vertexEncoding( geometry, a.first, attribute.itemSize, attribute.format ), GL_STATIC_DRAW );
+    } else {
+      bindAndBuffer( type, attribute.buffer, attribute.array, GL_STATIC_DRAW );
+    }
+
+  }
+
+  if ( layout.empty() ) return;
+
+  // attributes come out of a hash map, sort them for a stable layout
+
+  std::sort( layout.begin(), layout.end(), []( const GeometryBuffer::InterleavedAttribute& a, const GeometryBuffer::InterleavedAttribute& b ) {
+    return a.name < b.name;
+  } );
+
+  initInterleavedBuffer( geometry, vertices );
+
+  for ( const auto& attribute : layout ) {
+    interleaveAttribute( geometry, attribute, 0, vertices );
+  }
+
+  bindAndBuffer( GL_ARRAY_BUFFER, geometry.__glInterleavedBuffer, geometry.__interleavedArray, GL_STATIC_DRAW );
+
+}
+
+// Interleaved layout
+
+void GLRenderer::initInterleavedBuffer( GeometryBuffer& geometry, int vertices ) {
+
+  // the attributes were listed by the caller, lay them out in that order
+
+  int stride = 0;
+
+  for ( auto& attribute : geometry.__interleavedAttributes ) {
+    attribute.offset = stride;
+    stride += attribute.size;
+  }
+
+  geometry.__interleavedStride = stride;
+  geometry.__interleavedArray.assign( ( size_t )vertices * stride, 0.f );
+
+  if ( ! geometry.__glInterleavedBuffer ) {
+    geometry.__glInterleavedBuffer = _gl.CreateBuffer();
+  }
+
+}
+
+void GLRenderer::interleaveAttribute( GeometryBuffer& geometry, const GeometryBuffer::InterleavedAttribute& attribute, int first, int count ) {
+
+  const auto stride = geometry.__interleavedStride;
+  const auto size   = attribute.size;
+
+  const auto& source = *attribute.array;
+  auto& target = geometry.__interleavedArray;
+
+  const auto last = std::min( { ( size_t )first + count, source.size() / size, target.size() / stride } );
+
+  for ( size_t v = first; v < last; ++ v ) {
+
+    const auto src = &source[ v * size ];
+    const auto dst = &target[ v * stride + attribute.offset ];
+
+    for ( int i = 0; i < size; ++ i ) dst[ i ] = src[ i ];
+
+  }
+
+}
+
+const GeometryBuffer::InterleavedAttribute* GLRenderer::interleavedAttribute( const GeometryBuffer& geometry, const std::string& name ) {
+
+  if ( geometry.interleaved ) {
+
+    for ( const auto& attribute : geometry.__interleavedAttributes ) {
+      if ( attribute.name == name ) return &attribute;
+    }
+
+  }
+
+  return nullptr;
+
+}
+
+void GLRenderer::geometryAttribPointer( int location, GeometryBuffer& geometry, const std::string& name, Buffer buffer, int size, THREE::VertexFormat format, size_t firstVertex ) {
+
+  const auto encoding = vertexEncoding( geometry, name, size, format );
+
+  if ( auto attribute = interleavedAttribute( geometry, name ) ) {
+
+    const auto stride = geometry.__interleavedStride * sizeof( float );
+
+    vertexAttribPointer( location, geometry.__glInterleavedBuffer, size, GL_FLOAT, false, ( int )stride,
+                         firstVertex * stride + attribute->offset * sizeof( float ) );
+
+  } else if ( encoding.format == THREE::FloatVertexFormat ) {
+
+    vertexAttribPointer( location, buffer, size, GL_FLOAT, false, 0, firstVertex * size * sizeof( float ) );
+
+  } else {
+
+    // packed items are padded, so the stride is explicit; 10:10:10:2 always
+    // has four components
+
+    const auto stride = encoding.size();
+    const auto components = encoding.format == THREE::Int2101010VertexFormat ? 4 : size;
+    const auto normalized = encoding.format != THREE::HalfFloatVertexFormat && encoding.normalized;
+
+    vertexAttribPointer( location, buffer, components, vertexFormatType( encoding.format ), normalized, ( int )stride, firstVertex * stride );
+
+  }
+
+}
+
+// Compact vertex formats
+
+VertexEncoding GLRenderer::vertexEncoding( const GeometryBuffer& geometry, const std::string& name, int itemSize, THREE::VertexFormat format ) const {
+
+  if ( ! _supportsVertexFormats || geometry.interleaved ||
+       ( format == THREE::Int2101010VertexFormat && itemSize > 4 ) ) {
+    format = THREE::FloatVertexFormat;
+  }
+
+  VertexEncoding encoding( format, itemSize );
+
+  if ( name == AttributeKey::skinIndex() ) {
+
+    encoding.normalized = false;
+
+  } else if ( name == AttributeKey::position() && format == THREE::UnsignedShortVertexFormat ) {
+
+    for ( int c = 0; c < 3; ++ c ) {
+      encoding.offset[ c ] = geometry.__positionOffset[ c ];
+      encoding.scale[ c ]  = geometry.__positionScale[ c ];
+    }
+
+  }
+
+  return encoding;
+
+}
+
+void GLRenderer::bufferVertices( Buffer buffer, const std::vector<float>& array, const VertexEncoding& encoding, int hint ) {
+
+  if ( encoding.format == THREE::FloatVertexFormat ) {
+    bindAndBuffer( GL_ARRAY_BUFFER, buffer, array, hint );
+    return;
+  }
+
+  const auto count = array.size() / encoding.itemSize;
+
+  _encodedVertices.resize( count * encoding.size() );
+  encoding.encode( array.data(), count, _encodedVertices.data() );
+
+  uploadBuffer( GL_ARRAY_BUFFER, buffer, _encodedVertices.data(), _encodedVertices.size(), hint );
+
+}
+
+void GLRenderer::bufferVerticesRange( Buffer buffer, const std::vector<float>& array, const VertexEncoding& encoding, int first, int count ) {
+
+  if ( encoding.format == THREE::FloatVertexFormat ) {
+    bufferSubData( GL_ARRAY_BUFFER, buffer, array, first * encoding.itemSize, count * encoding.itemSize );
+    return;
+  }
+
+  const auto size = encoding.size();
+
+  _encodedVertices.resize( count * size );
+  encoding.encode( &array[ first * encoding.itemSize ], count, _encodedVertices.data() );
+
+  bindBuffer( GL_ARRAY_BUFFER, buffer );
+  _gl.BufferSubData( GL_ARRAY_BUFFER, first * size, count * size, _encodedVertices.data() );
+
+  _info.render.bufferBytesUploaded += count * size;
+
+}
+
+bool GLRenderer::quantizedPositions( const Geometry& geometry ) const {
+
+  auto format = geometry.vertexFormats.position;
+
+  if ( geometry.type() == THREE::BufferGeometry ) {
+    const auto position = geometry.attributes.get( AttributeKey::position() );
+    format = position ? position->format : THREE::FloatVertexFormat;
+  }
+
+  return vertexEncoding( geometry, AttributeKey::position(), 3, format ).format == THREE::UnsignedShortVertexFormat;
+
+}
+
+bool GLRenderer::quantizedPositions( const Object3D& object ) const {
+
+  // only meshes take vertexFormats, BufferGeometry attributes always apply
+
+  if ( ! object.geometry ) return false;
+
+  if ( object.geometry->type() != THREE::BufferGeometry &&
+       object.type() != THREE::Mesh && object.type() != THREE::InstancedMesh ) {
+    return false;
+  }
+
+  return quantizedPositions( *object.geometry );
+
+}
+
+void GLRenderer::updatePositionQuantization( Geometry& geometry ) {
+
+  // the bounds of every position, shared by the geometry's groups
+
+  VertexEncoding encoding( THREE::UnsignedShortVertexFormat, 3 );
+
+  if ( geometry.type() == THREE::BufferGeometry ) {
+
+    if ( ! geometry.attributes.contains( AttributeKey::position() ) ) return;
+
+    const auto& array = geometry.attributes[ AttributeKey::position() ].array;
+    encoding.fit( array.data(), array.size() / 3 );
+
+  } else {
+
+    std::vector<float> positions;
+    positions.reserve( geometry.vertices.size() * 3 );
+
+    for ( const auto& vertex : geometry.vertices ) {
+      positions.push_back( vertex.x );
+      positions.push_back( vertex.y );
+      positions.push_back( vertex.z );
+    }
+
+    encoding.fit( positions.data(), geometry.vertices.size() );
+
+  }
+
+  geometry.__positionOffset.set( encoding.offset[ 0 ], encoding.offset[ 1 ], encoding.offset[ 2 ] );
+  geometry.__positionScale.set( encoding.scale[ 0 ], encoding.scale[ 1 ], encoding.scale[ 2 ] );
 
+  for ( auto& geometryGroup : geometry.geometryGroupsList ) {
+    geometryGroup->__positionOffset = geometry.__positionOffset;
+    geometryGroup->__positionScale  = geometry.__positionScale;
   }
 
 }
 
 // Buffer setting
 
+static inline void fillArray( const std::vector<Vector3>& vertices, int first, int last, std::vector<float>& vertexArray ) {
+
+  for ( int v = first, offset = first * 3; v < last; v ++, offset += 3 ) {
+
+    const auto& vertex = vertices[ v ];
+
+    vertexArray[ offset ]     = vertex.x;
+    vertexArray[ offset + 1 ] = vertex.y;
+    vertexArray[ offset + 2 ] = vertex.z;
+
+  }
+
+}
+
+static inline void fillArray( const std::vector<Color>& colors, int first, int last, std::vector<float>& colorArray ) {
+
+  for ( int c = first, offset = first * 3; c < last; c ++, offset += 3 ) {
+
+    const auto& color = colors[ c ];
+
+    colorArray[ offset ]     = color.r;
+    colorArray[ offset + 1 ] = color.g;
+    colorArray[ offset + 2 ] = color.b;
+
+  }
+
+}
+
+// Refills and uploads the merged dirty ranges of a per-vertex array
+
+template < typename T >
+void GLRenderer::updateDirtyRanges( DirtyRanges& ranges, const std::vector<T>& items, std::vector<float>& array, Buffer buffer ) {
+
+  for ( const auto& range : ranges.merge() ) {
+
+    const auto last = std::min( range.end(), ( int )items.size() );
+
+    if ( last <= range.first ) continue;
+
+    fillArray( items, range.first, last, array );
+    bufferSubData( GL_ARRAY_BUFFER, buffer, array, range.first * 3, ( last - range.first ) * 3 );
+
+  }
+
+}
+
 void GLRenderer::setParticleBuffers( Geometry& geometry, int hint, Object3D& object ) {
 
   auto& vertices = geometry.vertices;
@@ -1010,33 +1464,21 @@ void GLRenderer::setParticleBuffers( Geometry& geometry, int hint, Object3D& obj
 
     if ( dirtyVertices ) {
 
-      for ( int v = 0; v < vl; v ++ ) {
-
-        const auto& vertex = vertices[ v ];
-
-        offset = v * 3;
+      fillArray( vertices, 0, vl, vertexArray );
 
-        vertexArray[ offset ]     = vertex.x;
-        vertexArray[ offset + 1 ] = vertex.y;
-        vertexArray[ offset + 2 ] = vertex.z;
+    } else if ( ! geometry.__dirtyVertices.empty() ) {
 
-      }
+      updateDirtyRanges( geometry.__dirtyVertices, vertices, vertexArray, geometry.__glVertexBuffer );
 
     }
 
     if ( dirtyColors ) {
 
-      for ( int c = 0; c < cl; c ++ ) {
-
-        const auto& color = colors[ c ];
+      fillArray( colors, 0, cl, colorArray );
 
-        offset = c * 3;
+    } else if ( ! geometry.__dirtyColors.empty() ) {
 
-        colorArray[ offset ]     = color.r;
-        colorArray[ offset + 1 ] = color.g;
-        colorArray[ offset + 2 ] = color.b;
-
-      }
+      updateDirtyRanges( geometry.__dirtyColors, colors, colorArray, geometry.__glColorBuffer );
 
     }
 
@@ -1071,11 +1513,11 @@ void GLRenderer::setParticleBuffers( Geometry& geometry, int hint, Object3D& obj
   }
 
   if ( vl > 0 && ( dirtyVertices || object.sortParticles ) ) {
-    _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometry.__glVertexBuffer, vertexArray, hint );
+    bindAndBuffer( GL_ARRAY_BUFFER, geometry.__glVertexBuffer, vertexArray, hint );
   }
 
   if ( cl > 0 && ( dirtyColors || object.sortParticles ) ) {
-    _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometry.__glColorBuffer, colorArray, hint );
+    bindAndBuffer( GL_ARRAY_BUFFER, geometry.__glColorBuffer, colorArray, hint );
   }
 
   for ( int i = 0, il = ( int )customAttributes.size(); i < il; i ++ ) {
@@ -1083,7 +1525,7 @@ void GLRenderer::setParticleBuffers( Geometry& geometry, int hint, Object3D& obj
     auto& customAttribute = *customAttributes[ i ];
 
     if ( customAttribute.needsUpdate || object.sortParticles ) {
-      _gl.BindAndBuffer( GL_ARRAY_BUFFER, customAttribute.buffer, customAttribute.array, hint );
+      bindAndBuffer( GL_ARRAY_BUFFER, customAttribute.buffer, customAttribute.array, hint );
     }
 
   }
@@ -1111,41 +1553,27 @@ void GLRenderer::setLineBuffers( Geometry& geometry, int hint ) {
 
   auto& customAttributes = geometry.__glCustomAttributesList;
 
-  int offset = 0;
-
   if ( dirtyVertices ) {
 
-    for ( int v = 0; v < vl; v ++ ) {
-
-      const auto& vertex = vertices[ v ];
-
-      offset = v * 3;
+    fillArray( vertices, 0, vl, vertexArray );
 
-      vertexArray[ offset ]     = vertex.x;
-      vertexArray[ offset + 1 ] = vertex.y;
-      vertexArray[ offset + 2 ] = vertex.z;
+    bindAndBuffer( GL_ARRAY_BUFFER, geometry.__glVertexBuffer, vertexArray, hint );
 
-    }
+  } else if ( ! geometry.__dirtyVertices.empty() ) {
 
-    _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometry.__glVertexBuffer, vertexArray, hint );
+    updateDirtyRanges( geometry.__dirtyVertices, vertices, vertexArray, geometry.__glVertexBuffer );
 
   }
 
   if ( dirtyColors ) {
 
-    for ( int c = 0; c < cl; c ++ ) {
-
-      const auto& color = colors[ c ];
-
-      offset = c * 3;
+    fillArray( colors, 0, cl, colorArray );
 
-      colorArray[ offset ]     = color.r;
-      colorArray[ offset + 1 ] = color.g;
-      colorArray[ offset + 2 ] = color.b;
+    bindAndBuffer( GL_ARRAY_BUFFER, geometry.__glColorBuffer, colorArray, hint );
 
-    }
+  } else if ( ! geometry.__dirtyColors.empty() ) {
 
-    _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometry.__glColorBuffer, colorArray, hint );
+    updateDirtyRanges( geometry.__dirtyColors, colors, colorArray, geometry.__glColorBuffer );
 
   }
 
@@ -1157,7 +1585,7 @@ void GLRenderer::setLineBuffers( Geometry& geometry, int hint ) {
 
       }
 
-      _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometry.__glLineDistanceBuffer, lineDistanceArray, hint );
+      bindAndBuffer( GL_ARRAY_BUFFER, geometry.__glLineDistanceBuffer, lineDistanceArray, hint );
 
     }
 
@@ -1183,7 +1611,7 @@ void GLRenderer::setLineBuffers( Geometry& geometry, int hint ) {
         fillFromAny<Vector4>( customAttribute.value, customAttribute.array );
       }
 
-      _gl.BindAndBuffer( GL_ARRAY_BUFFER, customAttribute.buffer, customAttribute.array, hint );
+      bindAndBuffer( GL_ARRAY_BUFFER, customAttribute.buffer, customAttribute.array, hint );
 
     }
 
@@ -1192,81 +1620,288 @@ void GLRenderer::setLineBuffers( Geometry& geometry, int hint ) {
 }
 
 
-void GLRenderer::setMeshBuffers( GeometryGroup& geometryGroup, Object3D& object, int hint, bool dispose, Material* material ) {
+template < typename T >
+static void fillElementArrays( std::vector<T>& faceArray, std::vector<T>& lineArray, size_t faces ) {
 
-  if ( ! geometryGroup.__inittedArrays ) {
-    return;
-  }
+  T vertexIndex = 0;
 
-  const auto normalType      = bufferGuessNormalType( material );
-  const auto vertexColorType = bufferGuessVertexColorType( material );
-  const auto uvType          = bufferGuessUVType( material );
+  size_t offset_face = 0, offset_line = 0;
 
-  const auto needsSmoothNormals = ( normalType == THREE::SmoothShading );
+  for ( size_t f = 0; f < faces; ++ f ) {
 
-  Color c1, c2, c3, c4;
+    faceArray[ offset_face ]     = vertexIndex;
+    faceArray[ offset_face + 1 ] = vertexIndex + 1;
+    faceArray[ offset_face + 2 ] = vertexIndex + 2;
 
-  int vertexIndex        = 0,
-      offset             = 0,
-      offset_uv          = 0,
-      offset_uv2         = 0,
-      offset_face        = 0,
-      offset_normal      = 0,
-      offset_tangent     = 0,
-      offset_line        = 0,
-      offset_color       = 0,
-      offset_skin        = 0,
-      offset_morphTarget = 0,
-      offset_custom      = 0;
+    offset_face += 3;
 
-  auto& vertexArray  = geometryGroup.__vertexArray;
-  auto& uvArray      = geometryGroup.__uvArray;
-  auto& uv2Array     = geometryGroup.__uv2Array;
-  auto& normalArray  = geometryGroup.__normalArray;
-  auto& tangentArray = geometryGroup.__tangentArray;
-  auto& colorArray   = geometryGroup.__colorArray;
+    lineArray[ offset_line ]     = vertexIndex;
+    lineArray[ offset_line + 1 ] = vertexIndex + 1;
 
-  auto& skinIndexArray   = geometryGroup.__skinIndexArray;
-  auto& skinWeightArray  = geometryGroup.__skinWeightArray;
+    lineArray[ offset_line + 2 ] = vertexIndex;
+    lineArray[ offset_line + 3 ] = vertexIndex + 2;
 
-  auto& morphTargetsArrays = geometryGroup.__morphTargetsArrays;
-  auto& morphNormalsArrays = geometryGroup.__morphNormalsArrays;
+    lineArray[ offset_line + 4 ] = vertexIndex + 1;
+    lineArray[ offset_line + 5 ] = vertexIndex + 2;
 
-  auto& customAttributes = geometryGroup.__glCustomAttributesList;
+    offset_line += 6;
 
-  auto& faceArray = geometryGroup.__faceArray;
-  auto& lineArray = geometryGroup.__lineArray;
+    vertexIndex += 3;
 
-  Geometry& geometry = *object.geometry;
+  }
 
-  const bool dirtyVertices     = geometry.verticesNeedUpdate,
-             dirtyElements     = geometry.elementsNeedUpdate,
-             dirtyUvs          = geometry.uvsNeedUpdate,
-             dirtyNormals      = geometry.normalsNeedUpdate,
-             dirtyTangents     = geometry.tangentsNeedUpdate,
-             dirtyColors       = geometry.colorsNeedUpdate,
-             dirtyMorphTargets = geometry.morphTargetsNeedUpdate;
+}
 
-  auto& vertices     = geometry.vertices;
-  auto& chunk_faces3 = geometryGroup.faces3;
-  auto& obj_faces    = geometry.faces;
+void GLRenderer::setMeshBuffers( std::vector<MeshBufferUpdate>& updates, Object3D& object, int hint, bool dispose ) {
 
-  auto& obj_uvs  = geometry.faceVertexUvs[ 0 ];
-  auto& obj_uvs2 = geometry.faceVertexUvs[ 1 ];
+  // the streams of every group fill separate arrays, so they are packed as
+  // independent tasks; only the uploads have to wait for the GL thread
 
-  //auto& obj_colors = geometry.colors;
+  _packTasks.clear();
 
-  auto& obj_skinIndices   = geometry.skinIndices;
-  auto& obj_skinWeights   = geometry.skinWeights;
+  size_t faces = 0;
 
-  auto& morphTargets = geometry.morphTargets;
-  auto& morphNormals = geometry.morphNormals;
+  for ( auto& update : updates ) {
 
-  if ( dirtyVertices ) {
+    prepareMeshBuffers( update, object, _packTasks );
 
-    for ( const auto& fi : chunk_faces3 ) {
+    faces += update.geometryGroup->faces3.size();
 
-      const auto& face = obj_faces[ fi ];
+  }
+
+  auto runTasks = [&] {
+
+    if ( _scheduler && faces >= parallelPackFaces ) {
+
+      _scheduler->run( _packTasks );
+
+    } else {
+
+      for ( auto& task : _packTasks ) task();
+
+    }
+
+    _packTasks.clear();
+
+  };
+
+  runTasks();
+
+  // interleaved groups copy the refreshed streams into their shared array
+  // once all of them are packed
+
+  for ( auto& update : updates ) {
+
+    if ( update.geometryGroup->interleaved ) {
+      interleaveMeshBuffers( update, _packTasks );
+    }
+
+  }
+
+  runTasks();
+
+  for ( auto& update : updates ) {
+
+    uploadMeshBuffers( update, hint );
+
+    if ( dispose ) {
+
+      update.geometryGroup->dispose();
+
+    }
+
+  }
+
+}
+
+void GLRenderer::prepareMeshBuffers( MeshBufferUpdate& update, Object3D& object, std::vector<TaskScheduler::Task>& tasks ) {
+
+  auto& geometryGroup = *update.geometryGroup;
+  auto  material      = update.material;
+
+  if ( ! geometryGroup.__inittedArrays ) {
+    return;
+  }
+
+  update.normalType      = bufferGuessNormalType( material );
+  update.vertexColorType = bufferGuessVertexColorType( material );
+
+  const auto uvType = bufferGuessUVType( material );
+
+  Geometry& geometry = *object.geometry;
+
+  const bool hasFaces = ! geometryGroup.faces3.empty();
+
+  auto queue = [&]( MeshBufferUpdate::Stream stream, size_t index ) {
+    tasks.emplace_back( [this, &update, &object, stream, index] {
+      packMeshBuffers( update, object, stream, index );
+    } );
+  };
+
+  if ( geometry.verticesNeedUpdate ) {
+
+    update.vertices = true;
+    queue( MeshBufferUpdate::Vertices, 0 );
+
+  } else if ( ! geometry.__dirtyVertices.empty() ) {
+
+    // merged here, the workers only query it
+    geometry.__dirtyVertices.merge();
+    queue( MeshBufferUpdate::Vertices, 0 );
+
+  }
+
+  if ( geometry.morphTargetsNeedUpdate ) {
+
+    update.morphTargets = geometry.morphTargets.size();
+    update.morphNormals = material && material->morphNormals;
+
+    for ( size_t vk = 0; vk < geometry.morphTargets.size(); vk ++ ) {
+      queue( MeshBufferUpdate::MorphTargets, vk );
+    }
+
+  }
+
+  if ( geometry.skinWeights.size() && hasFaces ) {
+
+    update.skin = true;
+    queue( MeshBufferUpdate::Skin, 0 );
+
+  }
+
+  if ( geometry.colorsNeedUpdate && update.vertexColorType && hasFaces ) {
+
+    update.colors = true;
+    queue( MeshBufferUpdate::Colors, 0 );
+
+  } else if ( ! geometry.__dirtyColors.empty() && update.vertexColorType && hasFaces ) {
+
+    geometry.__dirtyColors.merge();
+    queue( MeshBufferUpdate::Colors, 0 );
+
+  }
+
+  if ( geometry.tangentsNeedUpdate && geometry.hasTangents ) {
+
+    update.tangents = true;
+    queue( MeshBufferUpdate::Tangents, 0 );
+
+  }
+
+  if ( geometry.normalsNeedUpdate && update.normalType ) {
+
+    update.normals = true;
+    queue( MeshBufferUpdate::Normals, 0 );
+
+  }
+
+  if ( geometry.uvsNeedUpdate && geometry.faceVertexUvs[ 0 ].size() > 0 && uvType && hasFaces ) {
+
+    update.uvs = true;
+    queue( MeshBufferUpdate::Uvs, 0 );
+
+  }
+
+  if ( geometry.uvsNeedUpdate && geometry.faceVertexUvs[ 1 ].size() != 0 && uvType && hasFaces ) {
+
+    update.uv2s = true;
+    queue( MeshBufferUpdate::Uv2s, 0 );
+
+  }
+
+  if ( geometry.elementsNeedUpdate ) {
+
+    update.elements = true;
+    queue( MeshBufferUpdate::Elements, 0 );
+
+  }
+
+  for ( auto& customAttributePtr : geometryGroup.__glCustomAttributesList ) {
+
+    auto& customAttribute = *customAttributePtr;
+
+    if ( customAttribute.__original && ( ! customAttribute.__original->needsUpdate ) ) continue;
+
+    queue( MeshBufferUpdate::CustomAttributes, update.customAttributes.size() );
+    update.customAttributes.push_back( &customAttribute );
+
+  }
+
+}
+
+bool GLRenderer::MeshBufferUpdate::updated( const std::string& name ) const {
+
+  return ( name == AttributeKey::position() && vertices ) ||
+         ( name == AttributeKey::normal()   && normals )  ||
+         ( name == AttributeKey::tangent()  && tangents ) ||
+         ( name == AttributeKey::color()    && colors )   ||
+         ( name == AttributeKey::uv()       && uvs )      ||
+         ( name == AttributeKey::uv2()      && uv2s );
+
+}
+
+void GLRenderer::interleaveMeshBuffers( MeshBufferUpdate& update, std::vector<TaskScheduler::Task>& tasks ) {
+
+  auto& geometryGroup = *update.geometryGroup;
+
+  for ( const auto& attribute : geometryGroup.__interleavedAttributes ) {
+
+    const auto attributePtr = &attribute;
+
+    if ( update.updated( attribute.name ) ) {
+
+      update.interleavedDirty = true;
+
+      tasks.emplace_back( [&geometryGroup, attributePtr] {
+        interleaveAttribute( geometryGroup, *attributePtr, 0, std::numeric_limits<int>::max() );
+      } );
+
+    } else if ( attribute.name == AttributeKey::position() && ! update.vertexRuns.empty() ) {
+
+      // runs are in floats of the vertex array, three per vertex
+
+      tasks.emplace_back( [&geometryGroup, &update, attributePtr] {
+        for ( const auto& run : update.vertexRuns ) {
+          interleaveAttribute( geometryGroup, *attributePtr, run.first / 3, run.count / 3 );
+        }
+      } );
+
+    } else if ( attribute.name == AttributeKey::color() && ! update.colorRuns.empty() ) {
+
+      tasks.emplace_back( [&geometryGroup, &update, attributePtr] {
+        for ( const auto& run : update.colorRuns ) {
+          interleaveAttribute( geometryGroup, *attributePtr, run.first / 3, run.count / 3 );
+        }
+      } );
+
+    }
+
+  }
+
+}
+
+void GLRenderer::packMeshBuffers( MeshBufferUpdate& update, Object3D& object, MeshBufferUpdate::Stream stream, size_t index ) {
+
+  // runs on a worker thread: no GL calls, and only this stream's array is written
+
+  auto& geometryGroup = *update.geometryGroup;
+  auto  material      = update.material;
+
+  const auto needsSmoothNormals = ( update.normalType == THREE::SmoothShading );
+
+  const Geometry& geometry = *object.geometry;
+
+  const auto& vertices     = geometry.vertices;
+  const auto& chunk_faces3 = geometryGroup.faces3;
+  const auto& obj_faces    = geometry.faces;
+
+  switch ( stream ) {
+
+  case MeshBufferUpdate::Vertices: {
+
+    auto& vertexArray = geometryGroup.__vertexArray;
+
+    auto fillFaceVertices = [&]( const Face& face, int offset ) {
 
       const auto& v1 = vertices[ face.a ];
       const auto& v2 = vertices[ face.b ];
@@ -1284,107 +1919,151 @@ void GLRenderer::setMeshBuffers( GeometryGroup& geometryGroup, Object3D& object,
       vertexArray[ offset + 7 ] = v3.y;
       vertexArray[ offset + 8 ] = v3.z;
 
-      offset += 9;
+    };
 
-    }
+    int offset = 0;
 
-    _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometryGroup.__glVertexBuffer, vertexArray, hint );
+    if ( update.vertices ) {
 
-  }
+      for ( const auto& fi : chunk_faces3 ) {
 
-  if ( dirtyMorphTargets ) {
+        fillFaceVertices( obj_faces[ fi ], offset );
 
-    for ( size_t vk = 0, vkl = morphTargets.size(); vk < vkl; vk ++ ) {
+        offset += 9;
+
+      }
 
-      offset_morphTarget = 0;
+      break;
 
-      for ( const auto& chf : chunk_faces3 ) {
+    }
 
-        const auto& face = obj_faces[ chf ];
+    // refill the faces using a dirty vertex and record them as runs, which
+    // may span a few clean faces to save upload calls
 
-        // morph positions
+    const auto& dirty = geometry.__dirtyVertices;
 
-        const auto& v1 = morphTargets[ vk ].vertices[ face.a ];
-        const auto& v2 = morphTargets[ vk ].vertices[ face.b ];
-        const auto& v3 = morphTargets[ vk ].vertices[ face.c ];
+    const int maxGap = 64 * 9;
 
-        auto& vka = morphTargetsArrays[ vk ];
+    int runFirst = -1, runLast = -1;
 
-        vka[ offset_morphTarget ]     = v1.x;
-        vka[ offset_morphTarget + 1 ] = v1.y;
-        vka[ offset_morphTarget + 2 ] = v1.z;
+    for ( const auto& fi : chunk_faces3 ) {
 
-        vka[ offset_morphTarget + 3 ] = v2.x;
-        vka[ offset_morphTarget + 4 ] = v2.y;
-        vka[ offset_morphTarget + 5 ] = v2.z;
+      const auto& face = obj_faces[ fi ];
 
-        vka[ offset_morphTarget + 6 ] = v3.x;
-        vka[ offset_morphTarget + 7 ] = v3.y;
-        vka[ offset_morphTarget + 8 ] = v3.z;
+      if ( dirty.contains( face.a ) || dirty.contains( face.b ) || dirty.contains( face.c ) ) {
 
-        // morph normals
+        fillFaceVertices( face, offset );
 
-        if ( material && material->morphNormals ) {
+        if ( runFirst >= 0 && offset - runLast > maxGap ) {
+          update.vertexRuns.push_back( DirtyRanges::Range{ runFirst, runLast - runFirst } );
+          runFirst = -1;
+        }
 
-          Vector3 n1, n2, n3;
+        if ( runFirst < 0 ) runFirst = offset;
+        runLast = offset + 9;
 
-          if ( needsSmoothNormals ) {
+      }
 
-            // TODO: FIgure out where the vertexNormals array comes from
-            const auto& faceVertexNormals = morphNormals[ vk ].vertexNormals[ chf ];
+      offset += 9;
 
-            n1 = faceVertexNormals.a;
-            n2 = faceVertexNormals.b;
-            n3 = faceVertexNormals.c;
+    }
 
-          } else {
+    if ( runFirst >= 0 ) {
+      update.vertexRuns.push_back( DirtyRanges::Range{ runFirst, runLast - runFirst } );
+    }
 
-            // TODO: FIgure out where the faceNormals array comes from
-            n1 = morphNormals[ vk ].faceNormals[ chf ];
-            n2 = n1;
-            n3 = n1;
+  } break;
 
-          }
+  case MeshBufferUpdate::MorphTargets: {
 
-          auto& nka = morphNormalsArrays[ vk ];
+    const auto vk = index;
 
-          nka[ offset_morphTarget ]     = n1.x;
-          nka[ offset_morphTarget + 1 ] = n1.y;
-          nka[ offset_morphTarget + 2 ] = n1.z;
+    const auto& morphTargets = geometry.morphTargets;
+    const auto& morphNormals = geometry.morphNormals;
 
-          nka[ offset_morphTarget + 3 ] = n2.x;
-          nka[ offset_morphTarget + 4 ] = n2.y;
-          nka[ offset_morphTarget + 5 ] = n2.z;
+    auto& vka = geometryGroup.__morphTargetsArrays[ vk ];
 
-          nka[ offset_morphTarget + 6 ] = n3.x;
-          nka[ offset_morphTarget + 7 ] = n3.y;
-          nka[ offset_morphTarget + 8 ] = n3.z;
+    int offset_morphTarget = 0;
 
-        }
+    for ( const auto& chf : chunk_faces3 ) {
 
-        //
+      const auto& face = obj_faces[ chf ];
 
-        offset_morphTarget += 9;
+      // morph positions
 
-      }
+      const auto& v1 = morphTargets[ vk ].vertices[ face.a ];
+      const auto& v2 = morphTargets[ vk ].vertices[ face.b ];
+      const auto& v3 = morphTargets[ vk ].vertices[ face.c ];
 
-      _gl.BindAndBuffer( GL_ARRAY_BUFFER,
-                       geometryGroup.__glMorphTargetsBuffers[ vk ],
-                       morphTargetsArrays[ vk ], hint );
+      vka[ offset_morphTarget ]     = v1.x;
+      vka[ offset_morphTarget + 1 ] = v1.y;
+      vka[ offset_morphTarget + 2 ] = v1.z;
+
+      vka[ offset_morphTarget + 3 ] = v2.x;
+      vka[ offset_morphTarget + 4 ] = v2.y;
+      vka[ offset_morphTarget + 5 ] = v2.z;
+
+      vka[ offset_morphTarget + 6 ] = v3.x;
+      vka[ offset_morphTarget + 7 ] = v3.y;
+      vka[ offset_morphTarget + 8 ] = v3.z;
+
+      // morph normals
 
       if ( material && material->morphNormals ) {
 
-        _gl.BindAndBuffer( GL_ARRAY_BUFFER,
-                         geometryGroup.__glMorphNormalsBuffers[ vk ],
-                         morphNormalsArrays[ vk ], hint );
+        Vector3 n1, n2, n3;
+
+        if ( needsSmoothNormals ) {
+
+          // TODO: FIgure out where the vertexNormals array comes from
+          const auto& faceVertexNormals = morphNormals[ vk ].vertexNormals[ chf ];
+
+          n1 = faceVertexNormals.a;
+          n2 = faceVertexNormals.b;
+          n3 = faceVertexNormals.c;
+
+        } else {
+
+          // TODO: FIgure out where the faceNormals array comes from
+          n1 = morphNormals[ vk ].faceNormals[ chf ];
+          n2 = n1;
+          n3 = n1;
+
+        }
+
+        auto& nka = geometryGroup.__morphNormalsArrays[ vk ];
+
+        nka[ offset_morphTarget ]     = n1.x;
+        nka[ offset_morphTarget + 1 ] = n1.y;
+        nka[ offset_morphTarget + 2 ] = n1.z;
+
+        nka[ offset_morphTarget + 3 ] = n2.x;
+        nka[ offset_morphTarget + 4 ] = n2.y;
+        nka[ offset_morphTarget + 5 ] = n2.z;
+
+        nka[ offset_morphTarget + 6 ] = n3.x;
+        nka[ offset_morphTarget + 7 ] = n3.y;
+        nka[ offset_morphTarget + 8 ] = n3.z;
 
       }
 
+      //
+
+      offset_morphTarget += 9;
+
     }
 
-  }
+  } break;
 
-  if ( obj_skinWeights.size() ) {
+  case MeshBufferUpdate::Skin: {
+
+    const auto& obj_skinIndices = geometry.skinIndices;
+    const auto& obj_skinWeights = geometry.skinWeights;
+
+    auto& skinIndexArray  = geometryGroup.__skinIndexArray;
+    auto& skinWeightArray = geometryGroup.__skinWeightArray;
+
+    int offset_skin = 0;
 
     for ( const auto& fi : chunk_faces3 ) {
 
@@ -1436,63 +2115,100 @@ void GLRenderer::setMeshBuffers( GeometryGroup& geometryGroup, Object3D& object,
 
     }
 
-    if ( offset_skin > 0 ) {
+  } break;
 
-      _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometryGroup.__glSkinIndicesBuffer, skinIndexArray, hint );
-      _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometryGroup.__glSkinWeightsBuffer, skinWeightArray, hint );
+  case MeshBufferUpdate::Colors: {
 
-    }
+    auto& colorArray = geometryGroup.__colorArray;
 
-  }
+    auto fillFaceColors = [&]( const Face& face, int offset ) {
 
-  if ( dirtyColors && vertexColorType ) {
+      Color c1, c2, c3;
 
-    for ( const auto& fi : chunk_faces3 ) {
+      if ( face.size() == 3 && update.vertexColorType == THREE::VertexColors ) {
 
-      const auto& face = obj_faces[ fi ];
+        c1 = face.vertexColors[ 0 ];
+        c2 = face.vertexColors[ 1 ];
+        c3 = face.vertexColors[ 2 ];
+
+      } else {
+
+        c1 = face.color;
+        c2 = face.color;
+        c3 = face.color;
 
-      const auto& vertexColors = face.vertexColors;
-      const auto& faceColor = face.color;
+      }
 
-      if ( face.size() == 3 && vertexColorType == THREE::VertexColors ) {
+      colorArray[ offset ]     = c1.r;
+      colorArray[ offset + 1 ] = c1.g;
+      colorArray[ offset + 2 ] = c1.b;
 
-        c1 = vertexColors[ 0 ];
-        c2 = vertexColors[ 1 ];
-        c3 = vertexColors[ 2 ];
+      colorArray[ offset + 3 ] = c2.r;
+      colorArray[ offset + 4 ] = c2.g;
+      colorArray[ offset + 5 ] = c2.b;
 
-      } else {
+      colorArray[ offset + 6 ] = c3.r;
+      colorArray[ offset + 7 ] = c3.g;
+      colorArray[ offset + 8 ] = c3.b;
+
+    };
+
+    int offset_color = 0;
+
+    if ( update.colors ) {
 
-        c1 = faceColor;
-        c2 = faceColor;
-        c3 = faceColor;
+      for ( const auto& fi : chunk_faces3 ) {
+
+        fillFaceColors( obj_faces[ fi ], offset_color );
+
+        offset_color += 9;
 
       }
 
-      colorArray[ offset_color ]     = c1.r;
-      colorArray[ offset_color + 1 ] = c1.g;
-      colorArray[ offset_color + 2 ] = c1.b;
+      break;
+
+    }
+
+    // on meshes the dirty colors are those of faces: refill them and record
+    // runs as for the vertices
+
+    const auto& dirty = geometry.__dirtyColors;
+
+    const int maxGap = 64 * 9;
+
+    int runFirst = -1, runLast = -1;
 
-      colorArray[ offset_color + 3 ] = c2.r;
-      colorArray[ offset_color + 4 ] = c2.g;
-      colorArray[ offset_color + 5 ] = c2.b;
+    for ( const auto& fi : chunk_faces3 ) {
+
+      if ( dirty.contains( fi ) ) {
+
+        fillFaceColors( obj_faces[ fi ], offset_color );
+
+        if ( runFirst >= 0 && offset_color - runLast > maxGap ) {
+          update.colorRuns.push_back( DirtyRanges::Range{ runFirst, runLast - runFirst } );
+          runFirst = -1;
+        }
+
+        if ( runFirst < 0 ) runFirst = offset_color;
+        runLast = offset_color + 9;
 
-      colorArray[ offset_color + 6 ] = c3.r;
-      colorArray[ offset_color + 7 ] = c3.g;
-      colorArray[ offset_color + 8 ] = c3.b;
+      }
 
       offset_color += 9;
 
     }
 
-    if ( offset_color > 0 ) {
+    if ( runFirst >= 0 ) {
+      update.colorRuns.push_back( DirtyRanges::Range{ runFirst, runLast - runFirst } );
+    }
 
-      _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometryGroup.__glColorBuffer, colorArray, hint );
+  } break;
 
-    }
+  case MeshBufferUpdate::Tangents: {
 
-  }
+    auto& tangentArray = geometryGroup.__tangentArray;
 
-  if ( dirtyTangents && geometry.hasTangents ) {
+    int offset_tangent = 0;
 
     for ( const auto& fi : chunk_faces3 ) {
 
@@ -1523,13 +2239,13 @@ void GLRenderer::setMeshBuffers( GeometryGroup& geometryGroup, Object3D& object,
 
     }
 
-    _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometryGroup.__glTangentBuffer, tangentArray, hint );
+  } break;
 
-  }
+  case MeshBufferUpdate::Normals: {
 
-  int i = 0;
+    auto& normalArray = geometryGroup.__normalArray;
 
-  if ( dirtyNormals && normalType ) {
+    int offset_normal = 0;
 
     for ( const auto& fi : chunk_faces3 ) {
 
@@ -1540,7 +2256,7 @@ void GLRenderer::setMeshBuffers( GeometryGroup& geometryGroup, Object3D& object,
 
       if ( face.size() == 3 && needsSmoothNormals ) {
 
-        for ( i = 0; i < 3; i ++ ) {
+        for ( int i = 0; i < 3; i ++ ) {
 
           const auto& vn = vertexNormals[ i ];
 
@@ -1554,7 +2270,7 @@ void GLRenderer::setMeshBuffers( GeometryGroup& geometryGroup, Object3D& object,
 
       } else {
 
-        for ( i = 0; i < 3; i ++ ) {
+        for ( int i = 0; i < 3; i ++ ) {
 
           normalArray[ offset_normal ]     = faceNormal.x;
           normalArray[ offset_normal + 1 ] = faceNormal.y;
@@ -1568,11 +2284,18 @@ void GLRenderer::setMeshBuffers( GeometryGroup& geometryGroup, Object3D& object,
 
     }
 
-    _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometryGroup.__glNormalBuffer, normalArray, hint );
+  } break;
 
-  }
+  case MeshBufferUpdate::Uvs:
+  case MeshBufferUpdate::Uv2s: {
 
-  if ( dirtyUvs && obj_uvs.size() > 0 && uvType ) {
+    const bool second = stream == MeshBufferUpdate::Uv2s;
+
+    const auto& obj_uvs = geometry.faceVertexUvs[ second ? 1 : 0 ];
+
+    auto& uvArray = second ? geometryGroup.__uv2Array : geometryGroup.__uvArray;
+
+    int offset_uv = 0;
 
     for ( const auto& fi : chunk_faces3 ) {
 
@@ -1581,7 +2304,7 @@ void GLRenderer::setMeshBuffers( GeometryGroup& geometryGroup, Object3D& object,
       // TODO:?
       //if ( uv == undefined ) continue;
 
-      for ( i = 0; i < 3; i ++ ) {
+      for ( int i = 0; i < 3; i ++ ) {
 
         const auto& uvi = uv[ i ];
 
@@ -1594,81 +2317,23 @@ void GLRenderer::setMeshBuffers( GeometryGroup& geometryGroup, Object3D& object,
 
     }
 
-    if ( offset_uv > 0 ) {
-
-      _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometryGroup.__glUVBuffer, uvArray, hint );
-
-    }
-
-  }
-
-  if ( dirtyUvs && obj_uvs2.size() != 0 && uvType ) {
-
-    for ( const auto& fi : chunk_faces3 ) {
-
-      const auto& uv2 = obj_uvs2[ fi ];
-
-      // TODO:?
-      //if ( uv2 == undefined ) continue;
-
-      for ( i = 0; i < 3; i ++ ) {
-
-        const auto& uv2i = uv2[ i ];
-
-        uv2Array[ offset_uv2 ]     = uv2i.x;
-        uv2Array[ offset_uv2 + 1 ] = uv2i.y;
-
-        offset_uv2 += 2;
-
-      }
-
-    }
-
-    if ( offset_uv2 > 0 ) {
-
-      _gl.BindAndBuffer( GL_ARRAY_BUFFER, geometryGroup.__glUV2Buffer, uv2Array, hint );
-
-    }
-
-  }
-
-  if ( dirtyElements ) {
-
-    for ( size_t f = 0; f < chunk_faces3.size(); ++ f ) {
-
-      faceArray[ offset_face ]     = vertexIndex;
-      faceArray[ offset_face + 1 ] = vertexIndex + 1;
-      faceArray[ offset_face + 2 ] = vertexIndex + 2;
-
-      offset_face += 3;
-
-      lineArray[ offset_line ]     = vertexIndex;
-      lineArray[ offset_line + 1 ] = vertexIndex + 1;
-
-      lineArray[ offset_line + 2 ] = vertexIndex;
-      lineArray[ offset_line + 3 ] = vertexIndex + 2;
-
-      lineArray[ offset_line + 4 ] = vertexIndex + 1;
-      lineArray[ offset_line + 5 ] = vertexIndex + 2;
-
-      offset_line += 6;
+  } break;
 
-      vertexIndex += 3;
+  case MeshBufferUpdate::Elements: {
 
+    if ( geometryGroup.__glUintIndices ) {
+      fillElementArrays( geometryGroup.__faceArray32, geometryGroup.__lineArray32, chunk_faces3.size() );
+    } else {
+      fillElementArrays( geometryGroup.__faceArray, geometryGroup.__lineArray, chunk_faces3.size() );
     }
 
-    _gl.BindAndBuffer( GL_ELEMENT_ARRAY_BUFFER, geometryGroup.__glFaceBuffer, faceArray, hint );
-    _gl.BindAndBuffer( GL_ELEMENT_ARRAY_BUFFER, geometryGroup.__glLineBuffer, lineArray, hint );
-
-  }
-
-  for ( auto& customAttributePtr : customAttributes ) {
+  } break;
 
-    auto& customAttribute = *customAttributePtr;
+  case MeshBufferUpdate::CustomAttributes: {
 
-    if ( customAttribute.__original && ( ! customAttribute.__original->needsUpdate ) ) continue;
+    auto& customAttribute = *update.customAttributes[ index ];
 
-    offset_custom = 0;
+    int offset_custom = 0;
 
     if ( customAttribute.size == 1 ) {
 
@@ -1942,38 +2607,236 @@ void GLRenderer::setMeshBuffers( GeometryGroup& geometryGroup, Object3D& object,
 
     }
 
-    _gl.BindAndBuffer( GL_ARRAY_BUFFER, customAttribute.buffer, customAttribute.array, hint );
+  } break;
 
   }
 
-  if ( dispose ) {
+}
 
-    geometryGroup.dispose();
+void GLRenderer::uploadMeshBuffers( MeshBufferUpdate& update, int hint ) {
 
-  }
+  auto& geometryGroup = *update.geometryGroup;
 
-}
+  if ( geometryGroup.interleaved ) {
 
-void GLRenderer::setDirectBuffers( Geometry& geometry, int hint, bool dispose ) {
+    const auto stride = geometryGroup.__interleavedStride;
 
-  auto& attributes = geometry.attributes;
+    if ( update.interleavedDirty ) {
 
-  for ( auto& a : attributes ) {
+      bindAndBuffer( GL_ARRAY_BUFFER, geometryGroup.__glInterleavedBuffer, geometryGroup.__interleavedArray, hint );
 
-    const auto& attributeName = a.first;
-    auto& attributeItem = a.second;
+    } else {
 
-    if ( attributeItem.needsUpdate ) {
+      for ( const auto& run : update.vertexRuns ) {
 
-      if( attributeName == AttributeKey::index() ) {
-        _gl.BindAndBuffer( GL_ELEMENT_ARRAY_BUFFER, attributeItem.buffer, attributeItem.array, hint );
+        bufferSubData( GL_ARRAY_BUFFER, geometryGroup.__glInterleavedBuffer, geometryGroup.__interleavedArray, run.first / 3 * stride, run.count / 3 * stride );
+
+      }
+
+      for ( const auto& run : update.colorRuns ) {
+
+        bufferSubData( GL_ARRAY_BUFFER, geometryGroup.__glInterleavedBuffer, geometryGroup.__interleavedArray, run.first / 3 * stride, run.count / 3 * stride );
+
+      }
+
+    }
+
+  } else {
+
+    uploadMeshStreams( update, hint );
+
+  }
+
+  if ( update.morphTargets ) {
+
+    for ( size_t vk = 0; vk < update.morphTargets; vk ++ ) {
+
+      bindAndBuffer( GL_ARRAY_BUFFER,
+                       geometryGroup.__glMorphTargetsBuffers[ vk ],
+                       geometryGroup.__morphTargetsArrays[ vk ], hint );
+
+      if ( update.morphNormals ) {
+
+        bindAndBuffer( GL_ARRAY_BUFFER,
+                         geometryGroup.__glMorphNormalsBuffers[ vk ],
+                         geometryGroup.__morphNormalsArrays[ vk ], hint );
+
+      }
+
+    }
+
+  }
+
+  if ( update.skin ) {
+
+    const auto& formats = geometryGroup.vertexFormats;
+
+    bufferVertices( geometryGroup.__glSkinIndicesBuffer, geometryGroup.__skinIndexArray,
+                    vertexEncoding( geometryGroup, AttributeKey::skinIndex(), 4, formats.skin ), hint );
+    bufferVertices( geometryGroup.__glSkinWeightsBuffer, geometryGroup.__skinWeightArray,
+                    vertexEncoding( geometryGroup, AttributeKey::skinWeight(), 4, formats.skin ), hint );
+
+  }
+
+  if ( update.elements && geometryGroup.__glUintIndices ) {
+
+    bindAndBuffer( GL_ELEMENT_ARRAY_BUFFER, geometryGroup.__glFaceBuffer, geometryGroup.__faceArray32, hint );
+    bindAndBuffer( GL_ELEMENT_ARRAY_BUFFER, geometryGroup.__glLineBuffer, geometryGroup.__lineArray32, hint );
+
+  } else if ( update.elements ) {
+
+    bindAndBuffer( GL_ELEMENT_ARRAY_BUFFER, geometryGroup.__glFaceBuffer, geometryGroup.__faceArray, hint );
+    bindAndBuffer( GL_ELEMENT_ARRAY_BUFFER, geometryGroup.__glLineBuffer, geometryGroup.__lineArray, hint );
+
+  }
+
+  for ( auto customAttribute : update.customAttributes ) {
+
+    bindAndBuffer( GL_ARRAY_BUFFER, customAttribute->buffer, customAttribute->array, hint );
+
+  }
+
+}
+
+void GLRenderer::uploadMeshStreams( MeshBufferUpdate& update, int hint ) {
+
+  auto& geometryGroup = *update.geometryGroup;
+  const auto& formats = geometryGroup.vertexFormats;
+
+  const auto positionEncoding = vertexEncoding( geometryGroup, AttributeKey::position(), 3, formats.position );
+
+  if ( update.vertices ) {
+
+    bufferVertices( geometryGroup.__glVertexBuffer, geometryGroup.__vertexArray, positionEncoding, hint );
+
+  }
+
+  // runs are in floats of the vertex array, three per vertex
+
+  for ( const auto& run : update.vertexRuns ) {
+
+    bufferVerticesRange( geometryGroup.__glVertexBuffer, geometryGroup.__vertexArray, positionEncoding, run.first / 3, run.count / 3 );
+
+  }
+
+  if ( update.colors ) {
+
+    bindAndBuffer( GL_ARRAY_BUFFER, geometryGroup.__glColorBuffer, geometryGroup.__colorArray, hint );
+
+  }
+
+  for ( const auto& run : update.colorRuns ) {
+
+    bufferSubData( GL_ARRAY_BUFFER, geometryGroup.__glColorBuffer, geometryGroup.__colorArray, run.first, run.count );
+
+  }
+
+  if ( update.tangents ) {
+
+    bufferVertices( geometryGroup.__glTangentBuffer, geometryGroup.__tangentArray,
+                    vertexEncoding( geometryGroup, AttributeKey::tangent(), 4, formats.normal ), hint );
+
+  }
+
+  if ( update.normals ) {
+
+    bufferVertices( geometryGroup.__glNormalBuffer, geometryGroup.__normalArray,
+                    vertexEncoding( geometryGroup, AttributeKey::normal(), 3, formats.normal ), hint );
+
+  }
+
+  if ( update.uvs ) {
+
+    bufferVertices( geometryGroup.__glUVBuffer, geometryGroup.__uvArray,
+                    vertexEncoding( geometryGroup, AttributeKey::uv(), 2, formats.uv ), hint );
+
+  }
+
+  if ( update.uv2s ) {
+
+    bufferVertices( geometryGroup.__glUV2Buffer, geometryGroup.__uv2Array,
+                    vertexEncoding( geometryGroup, AttributeKey::uv2(), 2, formats.uv ), hint );
+
+  }
+
+}
+
+void GLRenderer::setDirectBuffers( Geometry& geometry, int hint, bool dispose ) {
+
+  auto& attributes = geometry.attributes;
+
+  // interleaved vertices to upload, the interleaved array outlives a dispose
+  // since it is the only copy of every attribute
+
+  auto interleavedDirty = false;
+  DirtyRanges interleavedRanges;
+
+  for ( auto& a : attributes ) {
+
+    const auto& attributeName = a.first;
+    auto& attributeItem = a.second;
+
+    const auto target = attributeName == AttributeKey::index() ? GL_ELEMENT_ARRAY_BUFFER : GL_ARRAY_BUFFER;
+
+    // interleaved attributes are copied into the shared array, which is
+    // uploaded once below
+
+    const auto interleavedItem = interleavedAttribute( geometry, attributeName );
+
+    if ( attributeItem.needsUpdate ) {
+
+      if ( interleavedItem ) {
+        interleaveAttribute( geometry, *interleavedItem, 0, std::numeric_limits<int>::max() );
+        interleavedDirty = true;
+      } else if ( target == GL_ARRAY_BUFFER && attributeItem.itemSize > 0 ) {
+        bufferVertices( attributeItem.buffer, attributeItem.array, vertexEncoding( geometry, attributeName, attributeItem.itemSize, attributeItem.format ), hint );
       } else {
-        _gl.BindAndBuffer( GL_ARRAY_BUFFER, attributeItem.buffer, attributeItem.array, hint );
+        bindAndBuffer( target, attributeItem.buffer, attributeItem.array, hint );
       }
 
       attributeItem.needsUpdate = false;
+
+    } else if ( ! attributeItem.updateRanges.empty() ) {
+
+      for ( const auto& range : attributeItem.updateRanges.merge() ) {
+
+        const auto last = std::min( range.end(), ( int )attributeItem.array.size() );
+
+        if ( last <= range.first ) continue;
+
+        if ( interleavedItem ) {
+
+          const auto itemSize = interleavedItem->size;
+          const auto firstVertex = range.first / itemSize;
+          const auto lastVertex = ( last + itemSize - 1 ) / itemSize;
+
+          interleaveAttribute( geometry, *interleavedItem, firstVertex, lastVertex - firstVertex );
+          interleavedRanges.add( firstVertex, lastVertex - firstVertex );
+
+        } else if ( target == GL_ARRAY_BUFFER && attributeItem.format != THREE::FloatVertexFormat && attributeItem.itemSize > 0 ) {
+
+          // encoded items are re-encoded whole
+
+          const auto itemSize = attributeItem.itemSize;
+          const auto firstItem = range.first / itemSize;
+          const auto lastItem = std::min( ( last + itemSize - 1 ) / itemSize, ( int )attributeItem.array.size() / itemSize );
+
+          bufferVerticesRange( attributeItem.buffer, attributeItem.array,
+                               vertexEncoding( geometry, attributeName, itemSize, attributeItem.format ),
+                               firstItem, lastItem - firstItem );
+
+        } else {
+
+          bufferSubData( target, attributeItem.buffer, attributeItem.array, range.first, last - range.first );
+
+        }
+
+      }
+
     }
 
+    attributeItem.updateRanges.clear();
+
     if ( dispose && !attributeItem.dynamic ) {
 
       attributeItem.array.clear();
@@ -1982,32 +2845,60 @@ void GLRenderer::setDirectBuffers( Geometry& geometry, int hint, bool dispose )
 
   }
 
+  if ( interleavedDirty ) {
+
+    bindAndBuffer( GL_ARRAY_BUFFER, geometry.__glInterleavedBuffer, geometry.__interleavedArray, hint );
+
+  } else if ( ! interleavedRanges.empty() ) {
+
+    const auto stride = geometry.__interleavedStride;
+
+    for ( const auto& range : interleavedRanges.merge() ) {
+      bufferSubData( GL_ARRAY_BUFFER, geometry.__glInterleavedBuffer, geometry.__interleavedArray, range.first * stride, range.count * stride );
+    }
+
+  }
+
 }
 
 // Buffer rendering
 
 void GLRenderer::renderBufferImmediate( Object3D& object, Program& program, Material& material ) {
 
-  if ( object.glImmediateData.hasPositions && ! object.glImmediateData.__glVertexBuffer ) object.glImmediateData.__glVertexBuffer = _gl.CreateBuffer();
-  if ( object.glImmediateData.hasNormals   && ! object.glImmediateData.__glNormalBuffer ) object.glImmediateData.__glNormalBuffer = _gl.CreateBuffer();
-  if ( object.glImmediateData.hasUvs       && ! object.glImmediateData.__glUvBuffer )     object.glImmediateData.__glUvBuffer     = _gl.CreateBuffer();
-  if ( object.glImmediateData.hasColors    && ! object.glImmediateData.__glColorBuffer )  object.glImmediateData.__glColorBuffer  = _gl.CreateBuffer();
+  bindDefaultVertexArray();
 
-  if ( object.glImmediateData.hasPositions ) {
+  auto& data = object.glImmediateData;
 
-    _gl.BindAndBuffer( GL_ARRAY_BUFFER, object.glImmediateData.__glVertexBuffer, object.glImmediateData.positionArray, GL_DYNAMIC_DRAW );
-    _gl.EnableVertexAttribArray( program.attributes[AttributeKey::position()] );
-    _gl.VertexAttribPointer( program.attributes[AttributeKey::position()], 3, GL_FLOAT, false, 0, 0 );
+  const auto hasUvs = data.hasUvs && material.map;
+  const auto hasColors = data.hasColors && material.vertexColors != THREE::NoColors;
+
+  // the attributes stream together or not at all, as a wrap of the ring
+  // between them would orphan the data of those already pointed at
+
+  size_t bytes = 0;
+
+  if ( data.hasPositions ) bytes += GLStreamBuffer::footprint( data.positionArray.size() * sizeof( float ) );
+  if ( data.hasNormals ) bytes += GLStreamBuffer::footprint( data.normalArray.size() * sizeof( float ) );
+  if ( hasUvs ) bytes += GLStreamBuffer::footprint( data.uvArray.size() * sizeof( float ) );
+  if ( hasColors ) bytes += GLStreamBuffer::footprint( data.colorArray.size() * sizeof( float ) );
+
+  const auto streamed = canStream( bytes );
+
+  if ( streamed ) _streamBuffer->reserve( bytes );
+
+  if ( data.hasPositions ) {
+
+    immediateAttribute( program.attributes[AttributeKey::position()], data.__glVertexBuffer, data.positionArray, 3, streamed );
 
   }
 
-  if ( object.glImmediateData.hasNormals ) {
+  if ( data.hasNormals ) {
 
     if ( material.shading == THREE::FlatShading ) {
 
-      auto& normalArray = object.glImmediateData.normalArray;
+      auto& normalArray = data.normalArray;
 
-      for ( int i = 0, il = object.glImmediateData.count; i < il; i += 9 ) {
+      for ( int i = 0, il = data.count; i < il; i += 9 ) {
 
         const auto nax  = normalArray[ i ];
         const auto nay  = normalArray[ i + 1 ];
@@ -2041,31 +2932,49 @@ void GLRenderer::renderBufferImmediate( Object3D& object, Program& program, Mate
 
     }
 
-    _gl.BindAndBuffer( GL_ARRAY_BUFFER, object.glImmediateData.__glNormalBuffer, object.glImmediateData.normalArray, GL_DYNAMIC_DRAW );
-    _gl.EnableVertexAttribArray( program.attributes[AttributeKey::normal()] );
-    _gl.VertexAttribPointer( program.attributes[AttributeKey::normal()], 3, GL_FLOAT, false, 0, 0 );
+    immediateAttribute( program.attributes[AttributeKey::normal()], data.__glNormalBuffer, data.normalArray, 3, streamed );
+
+  }
+
+  if ( hasUvs ) {
+
+    immediateAttribute( program.attributes[AttributeKey::uv()], data.__glUvBuffer, data.uvArray, 2, streamed );
 
   }
 
-  if ( object.glImmediateData.hasUvs && material.map ) {
+  if ( hasColors ) {
 
-    _gl.BindAndBuffer( GL_ARRAY_BUFFER, object.glImmediateData.__glUvBuffer, object.glImmediateData.uvArray, GL_DYNAMIC_DRAW );
-    _gl.EnableVertexAttribArray( program.attributes[AttributeKey::uv()] );
-    _gl.VertexAttribPointer( program.attributes[AttributeKey::uv()], 2, GL_FLOAT, false, 0, 0 );
+    immediateAttribute( program.attributes[AttributeKey::color()], data.__glColorBuffer, data.colorArray, 3, streamed );
 
   }
 
-  if ( object.glImmediateData.hasColors && material.vertexColors != THREE::NoColors ) {
+  _gl.DrawArrays( GL_TRIANGLES, 0, data.count );
+
+  data.count = 0;
+
+}
+
+void GLRenderer::immediateAttribute( int location, Buffer& buffer, const std::vector<float>& array, int size, bool streamed ) {
+
+  const auto bytes = array.size() * sizeof( float );
 
-    _gl.BindAndBuffer( GL_ARRAY_BUFFER, object.glImmediateData.__glColorBuffer, object.glImmediateData.colorArray, GL_DYNAMIC_DRAW );
-    _gl.EnableVertexAttribArray( program.attributes[AttributeKey::color()] );
-    _gl.VertexAttribPointer( program.attributes[AttributeKey::color()], 3, GL_FLOAT, false, 0, 0 );
+  enableAttribute( location );
+
+  // immediate data changes every frame, draw it straight from the stream
+  // buffer, where renderBufferImmediate reserved room for it
+
+  if ( streamed ) {
+
+    const auto offset = _streamBuffer->write( array.data(), bytes );
+    vertexAttribPointer( location, _streamBuffer->buffer(), size, GL_FLOAT, false, 0, offset );
+    return;
 
   }
 
-  _gl.DrawArrays( GL_TRIANGLES, 0, object.glImmediateData.count );
+  if ( ! buffer ) buffer = _gl.CreateBuffer();
 
-  object.glImmediateData.count = 0;
+  bindAndBuffer( GL_ARRAY_BUFFER, buffer, array, GL_DYNAMIC_DRAW );
+  vertexAttribPointer( location, buffer, size, GL_FLOAT, false, 0, 0 );
 
 }
 
@@ -2082,10 +2991,23 @@ void GLRenderer::renderBufferDirect( Camera& camera, Lights& lights, IFog* fog,
   auto wireframeBit = material.wireframe ? 1 : 0;
   auto geometryHash = ( geometry.id * 0xffffff ) + ( program.id * 2 ) + wireframeBit;
 
-  if ( geometryHash != _currentGeometryGroupHash ) {
+  // chunked geometry moves its attribute pointers between draws and instanced
+  // meshes add per-object attributes, both stay on the default vertex array
+
+  if ( _supportsVertexArrays && object.type() != THREE::InstancedMesh && geometry.offsets.size() <= 1 ) {
+
+    updateBuffers = bindVertexArray( geometry, program.id * 2 + wireframeBit );
+
+  } else {
+
+    bindDefaultVertexArray();
+
+    if ( geometryHash != _currentGeometryGroupHash ) {
 
-    _currentGeometryGroupHash = geometryHash;
-    updateBuffers = true;
+      _currentGeometryGroupHash = geometryHash;
+      updateBuffers = true;
+
+    }
 
   }
 
@@ -2095,9 +3017,26 @@ void GLRenderer::renderBufferDirect( Camera& camera, Lights& lights, IFog* fog,
 
   }
 
+  // generic attribute values are context state rather than vertex array
+  // state, so the defaults go out with every draw that reads them
+
+  setDefaultAttributeValues( program, material, geometry );
+
   // render mesh
 
-  if ( object.type() == THREE::Mesh ) {
+  if ( object.type() == THREE::Mesh || object.type() == THREE::InstancedMesh ) {
+
+    InstancedMesh* instancedMesh = nullptr;
+    int instanceCount = 1;
+
+    if ( object.type() == THREE::InstancedMesh ) {
+
+      instancedMesh = static_cast<InstancedMesh*>( &object );
+      instanceCount = instancedMesh->__instanceCount;
+
+      enableInstanceAttributes( program, *instancedMesh );
+
+    }
 
     if( geometry.attributes.contains( AttributeKey::index() ) ) {
 
@@ -2126,21 +3065,8 @@ void GLRenderer::renderBufferDirect( Camera& camera, Lights& lights, IFog* fog,
 
                 const auto attributeItemSize = attributeItem.itemSize;
 
-                _gl.BindBuffer( GL_ARRAY_BUFFER, attributeItem.buffer );
                 enableAttribute( attributePointer );
-                _gl.VertexAttribPointer( attributePointer, attributeItemSize, GL_FLOAT, false, 0, toOffset( startIndex * attributeItemSize * 4 ) );
-
-            } else if ( material.defaultAttributeValues.find( attrKey ) != material.defaultAttributeValues.end() ) {
-
-              if ( material.defaultAttributeValues[ attrKey ].size() == 2 ) {
-
-                _gl.VertexAttrib2fv( attributePointer, &material.defaultAttributeValues[ attrKey ][0] );
-
-              } else if ( material.defaultAttributeValues[ attrKey ].size() == 3 ) {
-
-                _gl.VertexAttrib3fv( attributePointer, &material.defaultAttributeValues[ attrKey ][0] );
-
-              }
+                geometryAttribPointer( attributePointer, geometry, attrKey, attributeItem.buffer, attributeItemSize, attributeItem.format, startIndex );
 
             }
 
@@ -2150,17 +3076,21 @@ void GLRenderer::renderBufferDirect( Camera& camera, Lights& lights, IFog* fog,
 
           const auto& index = geometry.attributes[ AttributeKey::index() ];
 
-          _gl.BindBuffer( GL_ELEMENT_ARRAY_BUFFER, index.buffer );
+          bindBuffer( GL_ELEMENT_ARRAY_BUFFER, index.buffer );
 
         }
 
         // render indexed triangles
 
-        _gl.DrawElements( GL_TRIANGLES, offsets[ i ].count, GL_UNSIGNED_SHORT, toOffset( offsets[ i ].start * 2 ) ); // 2 bytes per Uint16
+        if ( instancedMesh ) {
+          _gl.DrawElementsInstanced( GL_TRIANGLES, offsets[ i ].count, GL_UNSIGNED_SHORT, toOffset( offsets[ i ].start * 2 ), instanceCount );
+        } else {
+          _gl.DrawElements( GL_TRIANGLES, offsets[ i ].count, GL_UNSIGNED_SHORT, toOffset( offsets[ i ].start * 2 ) ); // 2 bytes per Uint16
+        }
 
         _info.render.calls ++;
-        _info.render.vertices += offsets[ i ].count; // not really true, here vertices can be shared
-        _info.render.faces += offsets[ i ].count / 3;
+        _info.render.vertices += offsets[ i ].count * instanceCount; // not really true, here vertices can be shared
+        _info.render.faces += offsets[ i ].count / 3 * instanceCount;
 
       }
 
@@ -2182,22 +3112,8 @@ void GLRenderer::renderBufferDirect( Camera& camera, Lights& lights, IFog* fog,
 
                 const auto attributeItemSize = attributeItem.itemSize;
 
-                _gl.BindBuffer( GL_ARRAY_BUFFER, attributeItem.buffer );
                 enableAttribute( attributePointer );
-                _gl.VertexAttribPointer( attributePointer, attributeItemSize, GL_FLOAT, false, 0, 0 );
-
-            }
-            else if ( material.defaultAttributeValues.find( attrKey ) != material.defaultAttributeValues.end() ) {
-
-              if ( material.defaultAttributeValues[ attrKey ].size() == 2 ) {
-
-                _gl.VertexAttrib2fv( attributePointer, &material.defaultAttributeValues[ attrKey ][0] );
-
-              } else if ( material.defaultAttributeValues[ attrKey ].size() == 3 ) {
-
-                _gl.VertexAttrib3fv( attributePointer, &material.defaultAttributeValues[ attrKey ][0] );
-
-              }
+                geometryAttribPointer( attributePointer, geometry, attrKey, attributeItem.buffer, attributeItemSize, attributeItem.format );
 
             }
 
@@ -2208,12 +3124,20 @@ void GLRenderer::renderBufferDirect( Camera& camera, Lights& lights, IFog* fog,
 
         const auto& position = geometry.attributes[ AttributeKey::position() ];
 
-        _gl.DrawArrays(GL_TRIANGLES, 0, position.numItems / 3);
+        if ( instancedMesh ) {
+          _gl.DrawArraysInstanced( GL_TRIANGLES, 0, position.numItems / 3, instanceCount );
+        } else {
+          _gl.DrawArrays(GL_TRIANGLES, 0, position.numItems / 3);
+        }
 
         _info.render.calls ++;
-        _info.render.vertices += position.numItems / 3;
-        _info.render.faces += position.numItems / 3 / 3;
+        _info.render.vertices += position.numItems / 3 * instanceCount;
+        _info.render.faces += position.numItems / 3 / 3 * instanceCount;
+
+    }
 
+    if ( instancedMesh ) {
+      resetInstanceAttributes( program );
     }
 
     // render particles
@@ -2232,22 +3156,8 @@ void GLRenderer::renderBufferDirect( Camera& camera, Lights& lights, IFog* fog,
 
             const auto attributeItemSize = attributeItem.itemSize;
 
-            _gl.BindBuffer( GL_ARRAY_BUFFER, attributeItem.buffer );
             enableAttribute( attributePointer );
-            _gl.VertexAttribPointer( attributePointer, attributeItemSize, GL_FLOAT, false, 0, 0 );
-
-        }
-        else if ( material.defaultAttributeValues.find( attrKey ) != material.defaultAttributeValues.end() ) {
-
-          if ( material.defaultAttributeValues[ attrKey ].size() == 2 ) {
-
-            _gl.VertexAttrib2fv( attributePointer, &material.defaultAttributeValues[ attrKey ][0] );
-
-          } else if ( material.defaultAttributeValues[ attrKey ].size() == 3 ) {
-
-            _gl.VertexAttrib3fv( attributePointer, &material.defaultAttributeValues[ attrKey ][0] );
-
-          }
+            geometryAttribPointer( attributePointer, geometry, attrKey, attributeItem.buffer, attributeItemSize, attributeItem.format );
 
         }
 
@@ -2276,37 +3186,49 @@ void GLRenderer::renderBufferDirect( Camera& camera, Lights& lights, IFog* fog,
 
             const auto attributeItemSize = attributeItem.itemSize;
 
-            _gl.BindBuffer( GL_ARRAY_BUFFER, attributeItem.buffer );
             enableAttribute( attributePointer );
-            _gl.VertexAttribPointer( attributePointer, attributeItemSize, GL_FLOAT, false, 0, 0 );
+            geometryAttribPointer( attributePointer, geometry, attrKey, attributeItem.buffer, attributeItemSize, attributeItem.format );
 
 
-        } else if ( material.defaultAttributeValues.find( attrKey ) != material.defaultAttributeValues.end() ) {
+        }
 
-          if ( material.defaultAttributeValues[ attrKey ].size() == 2 ) {
+      }
 
-            _gl.VertexAttrib2fv( attributePointer, &material.defaultAttributeValues[ attrKey ][0] );
+    }
 
-          } else if ( material.defaultAttributeValues[ attrKey ].size() == 3 ) {
+    const auto& position = geometry.attributes[ AttributeKey::position() ];
 
-            _gl.VertexAttrib3fv( attributePointer, &material.defaultAttributeValues[ attrKey ][0] );
+    const auto primitives = ( static_cast<Line&>(object).lineType == THREE::LineStrip ) ? GL_LINE_STRIP : GL_LINES;
 
-          }
+    _gl.DrawArrays(primitives, 0, position.numItems / 3);
 
-        }
+    _info.render.calls ++;
+    _info.render.points += position.numItems;
 
-      }
+  }
+
+  endVertexArray();
+
+}
+
+void GLRenderer::setDefaultAttributeValues( Program& program, Material& material, BufferGeometry& geometry ) {
+
+  for ( auto& namedAttribute : program.attributes ) {
 
-      const auto& position = geometry.attributes[ AttributeKey::position() ];
+    const int location = namedAttribute.second;
 
-      const auto primitives = ( static_cast<Line&>(object).lineType == THREE::LineStrip ) ? GL_LINE_STRIP : GL_LINES;
+    if ( location < 0 || geometry.attributes.contains( namedAttribute.first ) ) continue;
 
-      _gl.DrawArrays(primitives, 0, position.numItems / 3);
+    const auto value = material.defaultAttributeValues.find( namedAttribute.first );
 
-      _info.render.calls ++;
-      _info.render.points += position.numItems;
+    if ( value == material.defaultAttributeValues.end() ) continue;
 
+    if ( value->second.size() == 2 ) {
+      _gl.VertexAttrib2fv( location, &value->second[ 0 ] );
+    } else if ( value->second.size() == 3 ) {
+      _gl.VertexAttrib3fv( location, &value->second[ 0 ] );
     }
+
   }
 
 }
@@ -2319,14 +3241,32 @@ void GLRenderer::renderBuffer( Camera& camera, Lights& lights, IFog* fog, Materi
 
   auto& attributes = program.attributes;
 
+  // lines and particle systems upload floats, only meshes use vertexFormats
+
+  const auto formats = object.type() == THREE::Mesh || object.type() == THREE::InstancedMesh ?
+                       geometryGroup.vertexFormats : GeometryBuffer::VertexFormats();
+
   auto updateBuffers = false;
   auto wireframeBit = material.wireframe ? 1 : 0;
   auto geometryGroupHash = ( geometryGroup.id * 0xffffff ) + ( program.id * 2 ) + wireframeBit;
 
-  if ( geometryGroupHash != _currentGeometryGroupHash ) {
+  // the attribute setup below is recorded once per program in a vertex array
+  // object, instanced meshes add per-object attributes and use the default one
+
+  if ( _supportsVertexArrays && object.type() != THREE::InstancedMesh ) {
+
+    updateBuffers = bindVertexArray( geometryGroup, program.id * 2 + wireframeBit );
+
+  } else {
+
+    bindDefaultVertexArray();
 
-    _currentGeometryGroupHash = geometryGroupHash;
-    updateBuffers = true;
+    if ( geometryGroupHash != _currentGeometryGroupHash ) {
+
+      _currentGeometryGroupHash = geometryGroupHash;
+      updateBuffers = true;
+
+    }
 
   }
 
@@ -2340,9 +3280,8 @@ void GLRenderer::renderBuffer( Camera& camera, Lights& lights, IFog* fog, Materi
 
     if ( updateBuffers ) {
 
-      _gl.BindBuffer( GL_ARRAY_BUFFER, geometryGroup.__glVertexBuffer );
       enableAttribute( attributes[AttributeKey::position()] );
-      _gl.VertexAttribPointer( attributes[AttributeKey::position()], 3, GL_FLOAT, false, 0, 0 );
+      geometryAttribPointer( attributes[AttributeKey::position()], geometryGroup, AttributeKey::position(), geometryGroup.__glVertexBuffer, 3, formats.position );
 
     }
 
@@ -2368,9 +3307,8 @@ void GLRenderer::renderBuffer( Camera& camera, Lights& lights, IFog* fog, Materi
       auto attributeIt = attributes.find( attribute->belongsToAttribute );
       if ( attributeIt != attributes.end() ) {
 
-        _gl.BindBuffer( GL_ARRAY_BUFFER, attribute->buffer );
         enableAttribute( attributeIt->second );
-        _gl.VertexAttribPointer( attributeIt->second, attribute->size, GL_FLOAT, false, 0, 0 );
+        vertexAttribPointer( attributeIt->second, attribute->buffer, attribute->size, GL_FLOAT, false, 0, 0 );
 
       }
 
@@ -2380,19 +3318,10 @@ void GLRenderer::renderBuffer( Camera& camera, Lights& lights, IFog* fog, Materi
 
     // colors
 
-    if ( (index = attributes[AttributeKey::color()]) >= 0 ) {
-
-      if( ! object.geometry->colors.empty()) {
+    if ( (index = attributes[AttributeKey::color()]) >= 0 && ! object.geometry->colors.empty() ) {
 
-        _gl.BindBuffer( GL_ARRAY_BUFFER, geometryGroup.__glColorBuffer );
-        enableAttribute( attributes[AttributeKey::color()] );
-        _gl.VertexAttribPointer( index, 3, GL_FLOAT, false, 0, 0 );
-
-      } else {
-
-        _gl.VertexAttrib3fv( attributes[AttributeKey::color()], &material.defaultAttributeValues[ AttributeKey::color() ][0] );
-
-      }
+      enableAttribute( attributes[AttributeKey::color()] );
+      geometryAttribPointer( index, geometryGroup, AttributeKey::color(), geometryGroup.__glColorBuffer, 3 );
 
     }
 
@@ -2400,9 +3329,8 @@ void GLRenderer::renderBuffer( Camera& camera, Lights& lights, IFog* fog, Materi
 
     if ( attributes[AttributeKey::normal()].valid() ) {
 
-      _gl.BindBuffer( GL_ARRAY_BUFFER, geometryGroup.__glNormalBuffer );
       enableAttribute( attributes[AttributeKey::normal()] );
-      _gl.VertexAttribPointer( attributes[AttributeKey::normal()], 3, GL_FLOAT, false, 0, 0 );
+      geometryAttribPointer( attributes[AttributeKey::normal()], geometryGroup, AttributeKey::normal(), geometryGroup.__glNormalBuffer, 3, formats.normal );
 
     }
 
@@ -2410,29 +3338,17 @@ void GLRenderer::renderBuffer( Camera& camera, Lights& lights, IFog* fog, Materi
 
     if ( attributes[AttributeKey::tangent()].valid() ) {
 
-      _gl.BindBuffer( GL_ARRAY_BUFFER, geometryGroup.__glTangentBuffer );
       enableAttribute( attributes[AttributeKey::tangent()] );
-      _gl.VertexAttribPointer( attributes[AttributeKey::tangent()], 4, GL_FLOAT, false, 0, 0 );
+      geometryAttribPointer( attributes[AttributeKey::tangent()], geometryGroup, AttributeKey::tangent(), geometryGroup.__glTangentBuffer, 4, formats.normal );
 
     }
 
     // uvs
 
-    if ( attributes[AttributeKey::uv()].valid() ) {
-
-      if ( object.geometry->faceVertexUvs.size() > 0 ) {
-
-        _gl.BindBuffer( GL_ARRAY_BUFFER, geometryGroup.__glUVBuffer );
-        enableAttribute( attributes[AttributeKey::uv()] );
-        _gl.VertexAttribPointer( attributes[AttributeKey::uv()], 2, GL_FLOAT, false, 0, 0 );
-
-        _gl.EnableVertexAttribArray( attributes[AttributeKey::uv()] );
+    if ( attributes[AttributeKey::uv()].valid() && object.geometry->faceVertexUvs.size() > 0 ) {
 
-      } else {
-
-        _gl.VertexAttrib3fv( attributes[AttributeKey::uv()], &material.defaultAttributeValues[ AttributeKey::uv() ][0] );
-
-      }
+      enableAttribute( attributes[AttributeKey::uv()] );
+      geometryAttribPointer( attributes[AttributeKey::uv()], geometryGroup, AttributeKey::uv(), geometryGroup.__glUVBuffer, 2, formats.uv );
 
     }
 
@@ -2440,14 +3356,12 @@ void GLRenderer::renderBuffer( Camera& camera, Lights& lights, IFog* fog, Materi
 
       if ( object.geometry->faceVertexUvs.size() > 1 ) {
 
-        _gl.BindBuffer( GL_ARRAY_BUFFER, geometryGroup.__glUV2Buffer );
-        _gl.VertexAttribPointer( attributes[AttributeKey::uv2()], 2, GL_FLOAT, false, 0, 0 );
-
-        _gl.EnableVertexAttribArray( attributes[AttributeKey::uv2()] );
+        enableAttribute( attributes[AttributeKey::uv2()] );
+        geometryAttribPointer( attributes[AttributeKey::uv2()], geometryGroup, AttributeKey::uv2(), geometryGroup.__glUV2Buffer, 2, formats.uv );
 
       } else {
 
-        _gl.DisableVertexAttribArray( attributes[AttributeKey::uv2()] );
+        disableAttribute( attributes[AttributeKey::uv2()] );
 
       }
 
@@ -2456,13 +3370,11 @@ void GLRenderer::renderBuffer( Camera& camera, Lights& lights, IFog* fog, Materi
     if ( material.skinning &&
          attributes[AttributeKey::skinIndex()].valid() && attributes[AttributeKey::skinWeight()].valid() ) {
 
-      _gl.BindBuffer( GL_ARRAY_BUFFER, geometryGroup.__glSkinIndicesBuffer );
       enableAttribute( attributes[AttributeKey::skinIndex()] );
-      _gl.VertexAttribPointer( attributes[AttributeKey::skinIndex()], 4, GL_FLOAT, false, 0, 0 );
+      geometryAttribPointer( attributes[AttributeKey::skinIndex()], geometryGroup, AttributeKey::skinIndex(), geometryGroup.__glSkinIndicesBuffer, 4, formats.skin );
 
-      _gl.BindBuffer( GL_ARRAY_BUFFER, geometryGroup.__glSkinWeightsBuffer );
       enableAttribute( attributes[AttributeKey::skinWeight()] );
-      _gl.VertexAttribPointer( attributes[AttributeKey::skinWeight()], 4, GL_FLOAT, false, 0, 0 );
+      geometryAttribPointer( attributes[AttributeKey::skinWeight()], geometryGroup, AttributeKey::skinWeight(), geometryGroup.__glSkinWeightsBuffer, 4, formats.skin );
 
     }
 
@@ -2470,14 +3382,26 @@ void GLRenderer::renderBuffer( Camera& camera, Lights& lights, IFog* fog, Materi
 
     if ( lineDistance >= 0 ) {
 
-      _gl.BindBuffer( GL_ARRAY_BUFFER, geometryGroup.__glLineDistanceBuffer );
       enableAttribute( lineDistance );
-      _gl.VertexAttribPointer( lineDistance, 1, GL_FLOAT, false, 0, 0 );
+      vertexAttribPointer( lineDistance, geometryGroup.__glLineDistanceBuffer, 1, GL_FLOAT, false, 0, 0 );
 
     }
 
   }
 
+  // generic attribute values are context state rather than vertex array
+  // state, so the defaults go out with every draw that reads them
+
+  if ( attributes[AttributeKey::color()].valid() && object.geometry->colors.empty() ) {
+    _gl.VertexAttrib3fv( attributes[AttributeKey::color()], &material.defaultAttributeValues[ AttributeKey::color() ][0] );
+  }
+
+  if ( attributes[AttributeKey::uv()].valid() && object.geometry->faceVertexUvs.empty() ) {
+    _gl.VertexAttrib2fv( attributes[AttributeKey::uv()], &material.defaultAttributeValues[ AttributeKey::uv() ][0] );
+  }
+
+  const GLenum indexType = geometryGroup.__glUintIndices ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+
   // render mesh
 
   if ( object.type() == THREE::Mesh ) {
@@ -2488,15 +3412,15 @@ void GLRenderer::renderBuffer( Camera& camera, Lights& lights, IFog* fog, Materi
 
       setLineWidth( material.wireframeLinewidth );
 
-      if ( updateBuffers ) _gl.BindBuffer( GL_ELEMENT_ARRAY_BUFFER, geometryGroup.__glLineBuffer );
-      _gl.DrawElements( GL_LINES, geometryGroup.__glLineCount, GL_UNSIGNED_SHORT, 0 );
+      bindBuffer( GL_ELEMENT_ARRAY_BUFFER, geometryGroup.__glLineBuffer );
+      _gl.DrawElements( GL_LINES, geometryGroup.__glLineCount, indexType, 0 );
 
       // triangles
 
     } else {
 
-      if ( updateBuffers ) _gl.BindBuffer( GL_ELEMENT_ARRAY_BUFFER, geometryGroup.__glFaceBuffer );
-      _gl.DrawElements( GL_TRIANGLES, geometryGroup.__glFaceCount, GL_UNSIGNED_SHORT, 0 );
+      bindBuffer( GL_ELEMENT_ARRAY_BUFFER, geometryGroup.__glFaceBuffer );
+      _gl.DrawElements( GL_TRIANGLES, geometryGroup.__glFaceCount, indexType, 0 );
 
     }
 
@@ -2504,6 +3428,35 @@ void GLRenderer::renderBuffer( Camera& camera, Lights& lights, IFog* fog, Materi
     _info.render.vertices += geometryGroup.__glFaceCount;
     _info.render.faces += geometryGroup.__glFaceCount / 3;
 
+    // render instanced mesh
+
+  } else if ( object.type() == THREE::InstancedMesh ) {
+
+    auto& instancedMesh = static_cast<InstancedMesh&>( object );
+    const auto instanceCount = instancedMesh.__instanceCount;
+
+    enableInstanceAttributes( program, instancedMesh );
+
+    if ( material.wireframe ) {
+
+      setLineWidth( material.wireframeLinewidth );
+
+      bindBuffer( GL_ELEMENT_ARRAY_BUFFER, geometryGroup.__glLineBuffer );
+      _gl.DrawElementsInstanced( GL_LINES, geometryGroup.__glLineCount, indexType, 0, instanceCount );
+
+    } else {
+
+      bindBuffer( GL_ELEMENT_ARRAY_BUFFER, geometryGroup.__glFaceBuffer );
+      _gl.DrawElementsInstanced( GL_TRIANGLES, geometryGroup.__glFaceCount, indexType, 0, instanceCount );
+
+    }
+
+    resetInstanceAttributes( program );
+
+    _info.render.calls ++;
+    _info.render.vertices += geometryGroup.__glFaceCount * instanceCount;
+    _info.render.faces += geometryGroup.__glFaceCount / 3 * instanceCount;
+
     // render lines
 
   } else if ( object.type() == THREE::Line ) {
@@ -2537,12 +3490,35 @@ void GLRenderer::renderBuffer( Camera& camera, Lights& lights, IFog* fog, Materi
 
   }
 
+  endVertexArray();
+
 }
 
 void GLRenderer::enableAttribute( int attributeId ) {
 
+  auto& enabled = _enabledAttributes[ attributeId ];
+
+  if ( enabled ) {
+    _info.render.attributeCallsSkipped ++;
+    return;
+  }
+
   _gl.EnableVertexAttribArray( attributeId );
-  _enabledAttributes[ attributeId ] = true;
+  enabled = true;
+
+}
+
+void GLRenderer::disableAttribute( int attributeId ) {
+
+  auto& enabled = _enabledAttributes[ attributeId ];
+
+  if ( ! enabled ) {
+    _info.render.attributeCallsSkipped ++;
+    return;
+  }
+
+  _gl.DisableVertexAttribArray( attributeId );
+  enabled = false;
 
 }
 
@@ -2550,14 +3526,429 @@ void GLRenderer::disableAttributes() {
 
   for ( auto& attribute : _enabledAttributes ) {
 
-    _gl.DisableVertexAttribArray( attribute.first );
+    if ( attribute.second ) {
+
+      _gl.DisableVertexAttribArray( attribute.first );
+      attribute.second = false;
+
+    }
+
+  }
+
+}
+
+const Buffer GLRenderer::unknownBinding;
+
+void GLRenderer::bindBuffer( GLenum target, Buffer buffer ) {
+
+  // only the two vertex targets are tracked, others go straight through
+
+  Buffer* current = nullptr;
+
+  if ( target == GL_ARRAY_BUFFER ) {
+    current = &_currentArrayBuffer;
+  } else if ( target == GL_ELEMENT_ARRAY_BUFFER ) {
+    current = &_currentElementArrayBuffer;
+  }
+
+  // the index binding is vertex array state, keep recorded arrays intact
+
+  if ( target == GL_ELEMENT_ARRAY_BUFFER && _currentVertexArray != 0 &&
+       ! _recordingVertexArray && _currentElementArrayBuffer != buffer ) {
+    bindDefaultVertexArray();
+  }
+
+  if ( current && *current == buffer ) {
+    _info.render.bufferBindsSkipped ++;
+    return;
+  }
+
+  _gl.BindBuffer( target, buffer );
+
+  if ( current ) *current = buffer;
+
+  if ( target == GL_ELEMENT_ARRAY_BUFFER && _recordingVertexArray ) {
+    _recordingVertexArray->elementBuffer = buffer;
+  }
+
+}
+
+void GLRenderer::bindTexture( GLenum target, Buffer texture, int slot ) {
+
+  // slot -1 binds to whichever unit is active, e.g. to upload render targets
+
+  if ( slot < 0 ) {
+
+    if ( _currentTextureUnit < 0 ) {
+      _gl.BindTexture( target, texture );
+      _info.render.textureBinds ++;
+      forgetTextures();
+      return;
+    }
+
+    slot = _currentTextureUnit;
+
+  }
+
+  if ( slot != _currentTextureUnit ) {
+    _gl.ActiveTexture( GL_TEXTURE0 + slot );
+    _currentTextureUnit = slot;
+  }
+
+  if ( ( int )_currentTextures.size() <= slot ) {
+    _currentTextures.resize( slot + 1, std::make_pair( ( GLenum )0, unknownBinding ) );
+  }
+
+  auto& current = _currentTextures[ slot ];
+
+  if ( current.first == target && current.second == texture ) {
+    _info.render.textureBindsSkipped ++;
+    return;
+  }
+
+  _gl.BindTexture( target, texture );
+  _info.render.textureBinds ++;
+  current = std::make_pair( target, texture );
+
+}
+
+void GLRenderer::bindFramebuffer( Buffer framebuffer ) {
+
+  if ( framebuffer == _currentFramebuffer ) {
+    _info.render.framebufferBindsSkipped ++;
+    return;
+  }
+
+  _gl.BindFramebuffer( GL_FRAMEBUFFER, framebuffer );
+  _currentFramebuffer = framebuffer;
+
+}
+
+void GLRenderer::vertexAttribPointer( int location, Buffer buffer, int size, GLenum type, bool normalized, int stride, size_t offset ) {
+
+  if ( location < 0 ) return;
+
+  if ( ( int )_currentAttributePointers.size() <= location ) {
+    _currentAttributePointers.resize( location + 1 );
+  }
+
+  auto& current = _currentAttributePointers[ location ];
+
+  if ( current.buffer == buffer && current.size == size && current.type == type &&
+       current.normalized == normalized && current.stride == stride && current.offset == offset ) {
+    _info.render.attributeCallsSkipped ++;
+    return;
+  }
+
+  bindBuffer( GL_ARRAY_BUFFER, buffer );
+  _gl.VertexAttribPointer( location, size, type, normalized, stride, toOffset( offset ) );
+
+  current.buffer = buffer;
+  current.size = size;
+  current.type = type;
+  current.normalized = normalized;
+  current.stride = stride;
+  current.offset = offset;
+
+}
+
+void GLRenderer::invalidateStateCache() {
+
+  // a plugin may have bound an array of its own
+
+  if ( _currentVertexArray != 0 ) {
+    bindDefaultVertexArray();
+  } else if ( _supportsVertexArrays ) {
+#if !defined(THREE_GLES)
+    _gl.BindVertexArray( 0 );
+#endif
+  }
+
+  disableAttributes();
+
+  _currentFramebuffer = unknownBinding;
+  _currentTextureUnit = -1;
+
+  forgetBuffers();
+  forgetTextures();
+
+}
+
+void GLRenderer::forgetBuffers() {
+
+  // a deleted buffer's name can be reused by the next CreateBuffer
+
+  _currentArrayBuffer = unknownBinding;
+  _currentElementArrayBuffer = unknownBinding;
+  _currentAttributePointers.clear();
+
+  _defaultVertexArrayState.elementArrayBuffer = unknownBinding;
+  _defaultVertexArrayState.attributePointers.clear();
+
+}
+
+void GLRenderer::uploadBuffer( GLenum target, Buffer buffer, const void* data, size_t size, GLenum usage ) {
+
+  // dynamic data that keeps its size is copied in from the stream buffer on
+  // the GPU, which neither reallocates the buffer nor waits for draws using it
+
+  if ( usage != GL_STATIC_DRAW && canStream( size ) ) {
+
+    auto& allocated = _bufferSizes[ buffer ];
+
+    if ( allocated == size ) {
+      _streamBuffer->upload( buffer, data, size );
+      _info.render.bufferBytesUploaded += size;
+      return;
+    }
+
+    allocated = size;
+
+  } else if ( ! _bufferSizes.empty() ) {
+
+    _bufferSizes.erase( buffer );
+
+  }
+
+  bindBuffer( target, buffer );
+  _gl.BufferData( target, size, data, usage );
+
+  _info.render.bufferBytesUploaded += size;
+
+}
+
+void GLRenderer::deleteBuffer( Buffer& buffer ) {
+
+  _bufferSizes.erase( buffer );
+  _gl.DeleteBuffer( buffer );
+
+}
+
+bool GLRenderer::canStream( size_t size ) const {
+
+  return _streamBuffer && size > 0 && size <= _streamBuffer->capacity();
+
+}
+
+void GLRenderer::forgetTextures() {
+
+  _currentTextures.clear();
+
+}
+
+bool GLRenderer::bindVertexArray( GeometryBuffer& geometry, int key ) {
+
+  // returns true if the array is new and the caller has to record its
+  // attribute setup, which is then replayed by a single bind on later draws
+
+  auto& vertexArray = geometry.__glVertexArrays[ key ];
 
-    _enabledAttributes[ attribute.first ] = false;
+  if ( vertexArray.array && vertexArray.array == _currentVertexArray ) {
+    return false;
+  }
+
+  const auto record = ! vertexArray.array;
+
+#if !defined(THREE_GLES)
+  if ( record ) vertexArray.array = _gl.CreateVertexArray();
+#endif
+
+  if ( _currentVertexArray == 0 ) {
+    _defaultVertexArrayState.enabledAttributes.swap( _enabledAttributes );
+    _defaultVertexArrayState.attributePointers.swap( _currentAttributePointers );
+    _defaultVertexArrayState.elementArrayBuffer = _currentElementArrayBuffer;
+  }
+
+#if !defined(THREE_GLES)
+  _gl.BindVertexArray( vertexArray.array );
+#endif
+  _currentVertexArray = vertexArray.array;
+
+  // a new array has every attribute disabled, a recorded one is left alone
+
+  _enabledAttributes.clear();
+  _currentAttributePointers.clear();
+  _currentElementArrayBuffer = vertexArray.elementBuffer;
+  _recordingVertexArray = record ? &vertexArray : nullptr;
+
+  return record;
+
+}
+
+void GLRenderer::bindDefaultVertexArray() {
+
+  if ( _currentVertexArray == 0 ) return;
+
+#if !defined(THREE_GLES)
+  _gl.BindVertexArray( 0 );
+#endif
+  _currentVertexArray = 0;
+  _recordingVertexArray = nullptr;
+
+  _enabledAttributes.swap( _defaultVertexArrayState.enabledAttributes );
+  _currentAttributePointers.swap( _defaultVertexArrayState.attributePointers );
+  _currentElementArrayBuffer = _defaultVertexArrayState.elementArrayBuffer;
+
+  _defaultVertexArrayState.enabledAttributes.clear();
+  _defaultVertexArrayState.attributePointers.clear();
+
+}
+
+void GLRenderer::endVertexArray() {
+
+  _recordingVertexArray = nullptr;
+
+}
+
+void GLRenderer::deleteVertexArrays( GeometryBuffer& geometry ) {
+
+#if !defined(THREE_GLES)
+
+  if ( geometry.__glVertexArrays.empty() ) return;
+
+  bindDefaultVertexArray();
+
+  for ( auto& vertexArray : geometry.__glVertexArrays ) {
+    _gl.DeleteVertexArray( vertexArray.second.array );
+  }
+
+#endif
+
+  geometry.__glVertexArrays.clear();
+
+}
+
+void GLRenderer::setupInstances( InstancedMesh& object ) {
+
+  // pack the visible instances into the instance buffer
+
+  if ( ! _supportsInstancing ) {
+    object.__instanceCount = 0;
+    return;
+  }
+
+  // the shadow passes draw the same packed instances, and those outside the
+  // view may still cast shadows into it
+
+  const auto culled = object.instanceFrustumCulled && ! ( shadowMapEnabled && object.castShadow );
+
+  // an unculled packing holds every instance, one left by a culled frame may not
+
+  if ( ! culled && ! object.instancesNeedUpdate && object.__glInstanceBuffer &&
+       object.__instanceCount == ( int )object.count() ) return;
+
+  auto& geometry = *object.geometry;
+
+  if ( ! geometry.boundingSphere ) {
+    geometry.computeBoundingSphere();
+  }
+
+  const auto hasColors = ! object.instanceColors.empty();
+  const size_t stride = hasColors ? 19 : 16;
+
+  auto& array = object.__instanceArray;
+  array.resize( object.count() * stride );
+
+  Matrix4 instanceMatrixWorld;
+  Sphere sphere;
+
+  size_t offset = 0;
+
+  for ( size_t i = 0; i < object.count(); ++i ) {
+
+    const auto& instanceMatrix = object.instanceMatrices[ i ];
+
+    if ( culled ) {
+
+      instanceMatrixWorld.multiplyMatrices( object.matrixWorld, instanceMatrix );
+      sphere.copy( *geometry.boundingSphere ).applyMatrix4( instanceMatrixWorld );
+
+      if ( ! _frustum.intersectsSphere( sphere ) ) continue;
+
+    }
+
+    std::copy( instanceMatrix.elements, instanceMatrix.elements + 16, &array[ offset ] );
+
+    if ( hasColors ) {
+      std::copy( object.instanceColors[ i ].rgb, object.instanceColors[ i ].rgb + 3, &array[ offset + 16 ] );
+    }
+
+    offset += stride;
+
+  }
+
+  object.__instanceCount = ( int )( offset / stride );
+  object.instancesNeedUpdate = false;
+
+  if ( object.__instanceCount == 0 ) return;
+
+  if ( ! object.__glInstanceBuffer ) {
+    object.__glInstanceBuffer = _gl.CreateBuffer();
+  }
+
+  uploadBuffer( GL_ARRAY_BUFFER, object.__glInstanceBuffer, array.data(), offset * sizeof( float ), GL_DYNAMIC_DRAW );
+
+}
+
+void GLRenderer::enableInstanceAttributes( Program& program, InstancedMesh& object ) {
+
+  auto& attributes = program.attributes;
+
+  const auto hasColors = ! object.instanceColors.empty();
+  const int stride = ( hasColors ? 19 : 16 ) * sizeof( float );
+
+  // a mat4 attribute takes four consecutive locations, one per column
+
+  const int matrixLocation = attributes[ AttributeKey::instanceMatrix() ];
+
+  if ( matrixLocation >= 0 ) {
+
+    for ( int column = 0; column < 4; ++column ) {
+
+      enableAttribute( matrixLocation + column );
+      vertexAttribPointer( matrixLocation + column, object.__glInstanceBuffer, 4, GL_FLOAT, false, stride, column * 4 * sizeof( float ) );
+      _gl.VertexAttribDivisor( matrixLocation + column, 1 );
+
+    }
+
+  }
+
+  const int colorLocation = attributes[ AttributeKey::instanceColor() ];
+
+  if ( hasColors && colorLocation >= 0 ) {
+
+    enableAttribute( colorLocation );
+    vertexAttribPointer( colorLocation, object.__glInstanceBuffer, 3, GL_FLOAT, false, stride, 16 * sizeof( float ) );
+    _gl.VertexAttribDivisor( colorLocation, 1 );
 
   }
 
 }
 
+void GLRenderer::resetInstanceAttributes( Program& program ) {
+
+  // divisors stick to the attribute location, so restore them for the next program
+
+  auto& attributes = program.attributes;
+
+  const int matrixLocation = attributes[ AttributeKey::instanceMatrix() ];
+
+  if ( matrixLocation >= 0 ) {
+
+    for ( int column = 0; column < 4; ++column ) {
+      _gl.VertexAttribDivisor( matrixLocation + column, 0 );
+    }
+
+  }
+
+  const int colorLocation = attributes[ AttributeKey::instanceColor() ];
+
+  if ( colorLocation >= 0 ) {
+    _gl.VertexAttribDivisor( colorLocation, 0 );
+  }
+
+}
+
 void GLRenderer::setupMorphTargets( Material& material, GeometryGroup& geometryGroup, Object3D& object ) {
 
 #ifndef TODO_MORPH_TARGETS
@@ -2699,17 +4090,59 @@ void GLRenderer::setupMorphTargets( Material& material, GeometryGroup& geometryG
 
 }
 
-// Rendering
+// Rendering
+
+// Render list sort keys, most significant bits first:
+//
+//   opaque      : pass (1) | program (10) | material (14) | geometry group (15) | depth (24)
+//   transparent : pass (1) | inverted depth (24) | program (10) | material (14) | geometry group (15)
+//
+// Opaque objects are clustered by program and material and drawn front-to-back
+// inside each cluster, transparent objects stay back-to-front.
+
+static const int sortKeyDepthBits = 24;
+static const std::uint64_t sortKeyDepthMax = ( 1ULL << sortKeyDepthBits ) - 1;
+static const std::uint64_t sortKeyTransparentPass = 1ULL << 63;
+static const std::uint64_t sortKeyCulled = ~0ULL;
+
+static inline std::uint64_t renderStateSortKey( const Material& material, const GeometryBuffer& buffer ) {
+
+  const std::uint64_t programId = material.program ? ( material.program->id & 0x3ff ) : 0;
+  const std::uint64_t materialId = material.id & 0x3fff;
+  const std::uint64_t geometryGroupId = ( buffer.type() == THREE::BufferGeometry
+                                          ? static_cast<const BufferGeometry&>( buffer ).id
+                                          : static_cast<const GeometryGroup&>( buffer ).id ) & 0x7fff;
+
+  return ( programId << 29 ) | ( materialId << 15 ) | geometryGroupId;
+
+}
+
+void GLRenderer::render( Scene& scene, Camera& camera, const GLRenderTarget::Ptr& renderTarget /*= GLRenderTarget::Ptr()*/, bool forceClear /*= false*/ ) {
+
+  auto& lights = scene.__lights;
+  auto  fog = scene.fog.get();
+
+  // per frame statistics, each phase's time ends when the next one starts
+
+  typedef std::chrono::steady_clock Clock;
+
+  _info.render = Info::Render();
+  _info.time = Info::Time();
 
-void GLRenderer::render( Scene& scene, Camera& camera, const GLRenderTarget::Ptr& renderTarget /*= GLRenderTarget::Ptr()*/, bool forceClear /*= false*/ ) {
+  auto phaseStart = Clock::now();
 
-  auto& lights = scene.__lights;
-  auto  fog = scene.fog.get();
+  auto endPhase = [&phaseStart]( double& time ) {
+    const auto now = Clock::now();
+    time += std::chrono::duration<double, std::milli>( now - phaseStart ).count();
+    phaseStart = now;
+  };
 
   // reset caching for this frame
 
   _currentMaterialId = -1;
+  _currentCamera = nullptr;
   _lightsNeedUpdate = true;
+  _fogBlockNeedsUpdate = true;
 
   // update scene graph
 
@@ -2731,17 +4164,29 @@ void GLRenderer::render( Scene& scene, Camera& camera, const GLRenderTarget::Ptr
 
   if ( autoUpdateObjects ) initGLObjects( scene );
 
+  // after the objects, which drop the bounds of edited geometries and list
+  // their objects for refitting
+
+  scene.updateBounds();
+
+
+  // cull and pack instances of instanced meshes
+
+  for ( auto object : scene.__objects ) {
+
+    if ( object->type() == THREE::InstancedMesh && object->visible ) {
+      setupInstances( static_cast<InstancedMesh&>( *object ) );
+    }
+
+  }
+
+  endPhase( _info.time.update );
 
   // custom render plugins (pre pass)
 
   renderPlugins( renderPluginsPre, scene, camera );
 
-  //
-
-  _info.render.calls = 0;
-  _info.render.vertices = 0;
-  _info.render.faces = 0;
-  _info.render.points = 0;
+  endPhase( _info.time.prePlugins );
 
   setRenderTarget( renderTarget );
 
@@ -2749,48 +4194,73 @@ void GLRenderer::render( Scene& scene, Camera& camera, const GLRenderTarget::Ptr
     clear( autoClearColor, autoClearDepth, autoClearStencil );
   }
 
-  // set matrices for regular objects (frustum culled)
+  // frustum cull regular objects
 
   auto& renderList = scene.__glObjects;
 
-  for ( size_t i = 0; i < renderList.size(); ++i) {
+  cullObjects( scene, renderList );
 
-    auto& glObject = renderList[i];
-    auto& object = *glObject.object;
+  auto minZ = std::numeric_limits<float>::max();
+  auto maxZ = std::numeric_limits<float>::lowest();
 
-    glObject.id = static_cast<int>( i );
-    glObject.render = false;
+  for ( const auto& chunk : _cullChunks ) {
 
-    if ( object.visible ) {
+    _info.render.objectsDrawn += chunk.drawn;
+    _info.render.objectsCulled += chunk.culled;
 
-      if ( !( object.type() == THREE::Mesh || object.type() == THREE::ParticleSystem ) ||
-           !( object.frustumCulled ) || _frustum.intersectsObject( object ) ) {
+    minZ = std::min( minZ, chunk.minZ );
+    maxZ = std::max( maxZ, chunk.maxZ );
 
-        setupMatrices( object, camera );
-        unrollBufferMaterial( glObject );
-        glObject.render = true;
+  }
 
-        if ( sortObjects ) {
+  if ( occlusionCulling ) occludeObjects( renderList );
 
-          if ( object.renderDepth ) {
-            glObject.z = object.renderDepth;
-          } else {
-            _vector3.copy( object.matrixWorld.getPosition() );
-            _vector3.applyProjection( _projScreenMatrix );
-            glObject.z = _vector3.z;
-          }
+  // pack sort keys and sort the list into opaque, transparent and culled ranges
 
-        }
+  const auto depthScale = maxZ > minZ ? ( float )sortKeyDepthMax / ( maxZ - minZ ) : 0.f;
+
+  _opaqueObjectsCount = 0;
+  _transparentObjectsCount = 0;
+
+  for ( auto& glObject : renderList ) {
+
+    if ( ! glObject.render ) {
+      glObject.sortKey = sortKeyCulled;
+      continue;
+    }
+
+    const auto depth = sortObjects
+                     ? std::min( ( std::uint64_t )( ( glObject.z - minZ ) * depthScale ), sortKeyDepthMax )
+                     : 0;
+
+    if ( glObject.opaque ) {
+
+      glObject.sortKey = ( renderStateSortKey( *glObject.opaque, *glObject.buffer ) << sortKeyDepthBits ) | depth;
+      ++_opaqueObjectsCount;
 
+    } else if ( glObject.transparent ) {
+
+      // without sorting, transparent objects keep their scene order
+
+      glObject.sortKey = sortKeyTransparentPass;
+
+      if ( sortObjects ) {
+        glObject.sortKey |= ( ( sortKeyDepthMax - depth ) << 39 ) | renderStateSortKey( *glObject.transparent, *glObject.buffer );
       }
 
+      ++_transparentObjectsCount;
+
+    } else {
+
+      glObject.sortKey = sortKeyCulled;
+
     }
 
   }
 
-  if ( sortObjects ) {
-    std::sort( renderList.begin(), renderList.end(), PainterSortStable() );
-  }
+  radixSort( renderList, _renderListScratch, []( const Scene::GLObject& glObject ) {
+    return glObject.sortKey;
+  } );
 
   // set matrices for immediate objects
 
@@ -2811,6 +4281,12 @@ void GLRenderer::render( Scene& scene, Camera& camera, const GLRenderTarget::Ptr
     }
   }
 
+  endPhase( _info.time.culling );
+
+  recordDrawPackets( renderList, camera, lights, fog, scene.overrideMaterial.get() );
+
+  endPhase( _info.time.recording );
+
   if ( scene.overrideMaterial ) {
 
     auto& material = *scene.overrideMaterial;
@@ -2820,29 +4296,37 @@ void GLRenderer::render( Scene& scene, Camera& camera, const GLRenderTarget::Ptr
     setDepthWrite( material.depthWrite );
     setPolygonOffset( material.polygonOffset, material.polygonOffsetFactor, material.polygonOffsetUnits );
 
-    renderObjects( scene.__glObjects, false, THREE::Override, camera, lights, fog, true, &material );
+    renderObjects( scene.__glObjects, 0, scene.__glObjects.size(), THREE::Override, camera, lights, fog, true, &material );
     renderObjectsImmediate( scene.__glObjectsImmediate, THREE::Override, camera, lights, fog, false, &material );
 
+    endPhase( _info.time.opaque );
+
   } else {
 
-    // opaque pass (front-to-back order)
+    // opaque pass (grouped by program and material, front-to-back order)
 
     setBlending( THREE::NoBlending );
 
-    renderObjects( scene.__glObjects, true, THREE::Opaque, camera, lights, fog, false );
+    renderObjects( scene.__glObjects, 0, _opaqueObjectsCount, THREE::Opaque, camera, lights, fog, false );
     renderObjectsImmediate( scene.__glObjectsImmediate, THREE::Opaque, camera, lights, fog, false );
 
+    endPhase( _info.time.opaque );
+
     // transparent pass (back-to-front order)
 
-    renderObjects( scene.__glObjects, false, THREE::Transparent, camera, lights, fog, true );
+    renderObjects( scene.__glObjects, _opaqueObjectsCount, _opaqueObjectsCount + _transparentObjectsCount, THREE::Transparent, camera, lights, fog, true );
     renderObjectsImmediate( scene.__glObjectsImmediate, THREE::Transparent, camera, lights, fog, true );
 
+    endPhase( _info.time.transparent );
+
   }
 
   // custom render plugins (post pass)
 
   renderPlugins( renderPluginsPost, scene, camera );
 
+  endPhase( _info.time.postPlugins );
+
   // Generate mipmap if we're using any kind of mipmap filtering
 
   if ( renderTarget &&
@@ -2880,24 +4364,268 @@ void GLRenderer::renderPlugins( std::vector<IPlugin::Ptr>& plugins, Scene& scene
 
 }
 
-void GLRenderer::renderObjects( RenderList& renderList, bool reverse, THREE::RenderType materialType, Camera& camera, Lights& lights, IFog* fog, bool useBlending, Material* overrideMaterial /*= nullptr*/ ) {
+// Marks the render list entries to draw, with their materials unrolled and
+// (when sorting) their depth. Each chunk writes only its own entries and
+// CullChunk, so the result does not depend on how the chunks were run.
+// The frustum is first tested against the scene's bounds tree, which skips
+// whole subtrees outside or inside it; the leaves it crosses are then tested
+// in parallel, and the chunks look the outcome up for objects in the tree.
 
-  int start, end, delta;
+void GLRenderer::cullObjects( Scene& scene, RenderList& renderList ) {
 
-  if ( reverse ) {
+  _cullChunks.assign( ( renderList.size() + renderListChunkSize - 1 ) / renderListChunkSize, CullChunk() );
 
-    start = ( int )renderList.size() - 1;
-    end = -1;
-    delta = -1;
+  const auto& tree = scene.__boundsTree;
 
-  } else {
+  _inFrustum.assign( tree.capacity(), 0 );
+  _boundaryProxies.clear();
+
+  tree.query( [this]( const Box3& box ) {
+
+    if ( ! _frustum.intersectsBox( box ) ) return AABBTree::Outside;
+    return _frustum.containsBox( box ) ? AABBTree::Contains : AABBTree::Intersects;
+
+  }, [this]( int proxy, bool contained ) {
+
+    if ( contained ) {
+      _inFrustum[ proxy ] = 1;
+    } else {
+      _boundaryProxies.push_back( proxy );
+    }
+
+  } );
+
+  parallelFor( _scheduler.get(), 0, _boundaryProxies.size(), renderListChunkSize, [this, &tree]( size_t first, size_t last ) {
+
+    for ( auto i = first; i < last; ++i ) {
+      const auto proxy = _boundaryProxies[ i ];
+      _inFrustum[ proxy ] = _frustum.intersectsObject( *tree.object( proxy ) );
+    }
+
+  } );
+
+  auto inFrustum = [this]( const Object3D& object ) {
+    return object.__boundsProxy != AABBTree::nullNode ? _inFrustum[ object.__boundsProxy ] != 0
+                                                      : _frustum.intersectsObject( object );
+  };
+
+  parallelFor( _scheduler.get(), 0, renderList.size(), renderListChunkSize, [this, &renderList, &inFrustum]( size_t first, size_t last ) {
+
+    auto& result = _cullChunks[ first / renderListChunkSize ];
+
+    Vector3 position;
+
+    for ( auto i = first; i < last; ++i ) {
+
+      auto& glObject = renderList[ i ];
+      auto& object = *glObject.object;
+
+      glObject.id = static_cast<int>( i );
+      glObject.render = false;
+
+      if ( object.type() == THREE::InstancedMesh && static_cast<InstancedMesh&>( object ).__instanceCount == 0 ) continue;
+
+      if ( ! object.visible ) continue;
+
+      if ( !( object.type() == THREE::Mesh || object.type() == THREE::ParticleSystem ) ||
+           !( object.frustumCulled ) || inFrustum( object ) ) {
+
+        unrollBufferMaterial( glObject );
+        glObject.render = true;
+        result.drawn ++;
+
+        if ( sortObjects ) {
+
+          if ( object.renderDepth ) {
+            glObject.z = object.renderDepth;
+          } else {
+            position.setFromMatrixPosition( object.matrixWorld );
+            position.applyProjection( _projScreenMatrix );
+            glObject.z = position.z;
+          }
+
+          result.minZ = std::min( result.minZ, glObject.z );
+          result.maxZ = std::max( result.maxZ, glObject.z );
+
+        }
+
+      } else {
+
+        result.culled ++;
+
+      }
+
+    }
+
+  } );
+
+}
+
+// Rasterizes the occluders that survived frustum culling and tests the
+// other culled objects against them, in the same chunks as cullObjects.
+// Occluders are never hidden, as one wall would otherwise hide the next.
+
+void GLRenderer::occludeObjects( RenderList& renderList ) {
+
+  if ( ! _occlusionBuffer ) _occlusionBuffer.reset( new OcclusionBuffer() );
+
+  auto& buffer = *_occlusionBuffer;
+  buffer.clear( _projScreenMatrix );
+
+  // objects drawn in several groups appear once per group
+
+  _occluders.clear();
+
+  for ( const auto& glObject : renderList ) {
+    if ( glObject.render && glObject.object->occluder && glObject.object->type() == THREE::Mesh ) {
+      _occluders.push_back( glObject.object );
+    }
+  }
+
+  std::sort( _occluders.begin(), _occluders.end() );
+  _occluders.erase( std::unique( _occluders.begin(), _occluders.end() ), _occluders.end() );
+
+  for ( auto occluder : _occluders ) buffer.addOccluder( *occluder );
+
+  if ( buffer.triangleCount() == 0 ) return;
+
+  buffer.rasterize( _scheduler.get() );
+
+  _occludedChunks.assign( _cullChunks.size(), 0 );
+
+  parallelFor( _scheduler.get(), 0, renderList.size(), renderListChunkSize, [this, &renderList, &buffer]( size_t first, size_t last ) {
+
+    auto& occluded = _occludedChunks[ first / renderListChunkSize ];
+
+    for ( auto i = first; i < last; ++i ) {
+
+      auto& glObject = renderList[ i ];
+      auto& object = *glObject.object;
+
+      if ( ! glObject.render || object.occluder || ! object.frustumCulled ) continue;
+      if ( !( object.type() == THREE::Mesh || object.type() == THREE::ParticleSystem ) ) continue;
+
+      if ( buffer.occludes( object ) ) {
+        glObject.render = false;
+        occluded ++;
+      }
+
+    }
+
+  } );
+
+  for ( auto occluded : _occludedChunks ) {
+    _info.render.objectsDrawn -= occluded;
+    _info.render.objectsOccluded += occluded;
+  }
+
+}
 
-    start = 0;
-    end = ( int )renderList.size();
-    delta = 1;
+static inline bool usesLights( const Material& material ) {
+  return material.type() == THREE::MeshPhongMaterial ||
+         material.type() == THREE::MeshLambertMaterial ||
+         material.lights;
+}
+
+// Everything per object that does not touch GL: the material of the
+// object's pass, its program when the material's current one fits the
+// object, and its matrices. Packets are written by index, so chunks of the
+// list can be recorded in any order and still replay in sort order;
+// objects drawn in several groups get a copy of their matrices per packet
+// rather than sharing glData between threads.
+//
+// The uniform values of the packets' materials are then refreshed once
+// each, a material per worker, so that replay only diffs them against what
+// the program last uploaded. Materials whose program has yet to be built
+// are refreshed by setProgram as it builds it.
+
+void GLRenderer::recordDrawPackets( RenderList& renderList, Camera& camera, Lights& lights, IFog* fog, Material* overrideMaterial ) {
+
+  if ( ! drawPackets ) {
+
+    _drawPackets.clear();
+
+    for ( auto& glObject : renderList ) {
+      if ( glObject.render ) setupMatrices( *glObject.object, camera );
+    }
+
+    return;
+
+  }
+
+  _drawPackets.resize( renderList.size() );
+
+  parallelFor( _scheduler.get(), 0, renderList.size(), renderListChunkSize, [this, &renderList, &camera, overrideMaterial]( size_t first, size_t last ) {
+
+    for ( auto i = first; i < last; ++i ) {
+
+      const auto& glObject = renderList[ i ];
+      auto& packet = _drawPackets[ i ];
+
+      packet.material = nullptr;
+      packet.program = nullptr;
+
+      if ( ! glObject.render ) continue;
+
+      const auto& object = *glObject.object;
+
+      packet.material = overrideMaterial ? overrideMaterial : glObject.opaque ? glObject.opaque : glObject.transparent;
+      packet.modelViewMatrix.multiplyMatrices( camera.matrixWorldInverse, object.matrixWorld );
+      packet.normalMatrix.getNormalMatrix( packet.modelViewMatrix );
+
+      if ( packet.material && programCurrent( *packet.material, object ) ) {
+        packet.program = packet.material->program.get();
+      }
+
+    }
+
+  } );
+
+  // the sorted list mostly repeats the previous packet's material
+
+  _packetMaterials.clear();
+
+  Material* previous = nullptr;
+  bool lit = false;
+
+  for ( const auto& packet : _drawPackets ) {
+
+    if ( ! packet.program || packet.material == previous ) continue;
+
+    previous = packet.material;
+
+    if ( _packetMaterialSet.insert( previous ).second ) {
+      _packetMaterials.push_back( previous );
+      lit = lit || usesLights( *previous );
+    }
+
+  }
+
+  _packetMaterialSet.clear();
+
+  if ( lit && _lightsNeedUpdate ) {
+    setupLights( *_packetMaterials.front()->program, lights );
+    if ( _uniformBlocks ) updateLightsBlock();
+    _lightsNeedUpdate = false;
   }
 
-  for ( auto i = start; i != end; i += delta ) {
+  parallelFor( _scheduler.get(), 0, _packetMaterials.size(), 16, [this, &camera, fog]( size_t first, size_t last ) {
+
+    for ( auto i = first; i < last; ++i ) {
+      refreshUniformsMaterial( camera, fog, *_packetMaterials[ i ] );
+    }
+
+  } );
+
+}
+
+void GLRenderer::renderObjects( RenderList& renderList, size_t first, size_t last, THREE::RenderType materialType, Camera& camera, Lights& lights, IFog* fog, bool useBlending, Material* overrideMaterial /*= nullptr*/ ) {
+
+  // replays the packets recordDrawPackets left for this range, if any; the
+  // ranges hold one pass each, so a packet's material belongs to
+  // materialType
+
+  for ( auto i = first; i < last; ++i ) {
 
     auto& glObject = renderList[ i ];
 
@@ -2905,6 +4633,7 @@ void GLRenderer::renderObjects( RenderList& renderList, bool reverse, THREE::Ren
 
       auto& object = *glObject.object;
       auto& buffer = *glObject.buffer;
+      const auto packet = _drawPackets.empty() ? nullptr : &_drawPackets[ i ];
 
       Material* material = nullptr;
 
@@ -2914,7 +4643,7 @@ void GLRenderer::renderObjects( RenderList& renderList, bool reverse, THREE::Ren
 
       } else {
 
-        material = materialType == THREE::Opaque ? glObject.opaque : glObject.transparent;
+        material = packet ? packet->material : materialType == THREE::Opaque ? glObject.opaque : glObject.transparent;
 
         if ( ! material ) continue;
 
@@ -2929,6 +4658,8 @@ void GLRenderer::renderObjects( RenderList& renderList, bool reverse, THREE::Ren
 
       setMaterialFaces( *material );
 
+      _drawPacket = packet;
+
       if ( buffer.type() == THREE::BufferGeometry ) {
         renderBufferDirect( camera, lights, fog, *material, static_cast<BufferGeometry&>( buffer ), object );
       } else {
@@ -2939,6 +4670,8 @@ void GLRenderer::renderObjects( RenderList& renderList, bool reverse, THREE::Ren
 
   }
 
+  _drawPacket = nullptr;
+
 }
 
 void GLRenderer::renderObjectsImmediate( RenderList& renderList, THREE::RenderType materialType, Camera& camera, Lights& lights, IFog* fog, bool useBlending, Material* overrideMaterial /*= nullptr*/ ) {
@@ -2977,6 +4710,68 @@ void GLRenderer::renderObjectsImmediate( RenderList& renderList, THREE::RenderTy
 
 }
 
+bool GLRenderer::compile( Scene& scene, Camera& camera, float timeBudget /*= 0*/ ) {
+
+  typedef std::chrono::steady_clock Clock;
+
+  const auto deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>( std::chrono::duration<float, std::milli>( timeBudget ) );
+
+  auto& lights = scene.__lights;
+  auto  fog = scene.fog.get();
+
+  _currentMaterialId = -1;
+  _currentCamera = nullptr;
+  _lightsNeedUpdate = true;
+  _fogBlockNeedsUpdate = true;
+
+  if ( ! camera.parent ) camera.updateMatrixWorld();
+
+  camera.matrixWorldInverse.getInverse( camera.matrixWorld );
+
+  camera.matrixWorldInverse.flattenToArray( camera._viewMatrixArray );
+  camera.projectionMatrix.flattenToArray( camera._projectionMatrixArray );
+
+  // buffers
+
+  initGLObjects( scene );
+
+  // programs (and the textures their uniforms reference), built the same
+  // way the first render would through setProgram. The budget is checked
+  // before each one, so every call makes progress and the call that builds
+  // the last one returns true
+
+  int compiled = 0;
+
+  auto compileObject = [&]( Scene::GLObject& glObject ) {
+
+    auto material = scene.overrideMaterial ? scene.overrideMaterial.get()
+                  : glObject.opaque ? glObject.opaque : glObject.transparent;
+
+    if ( ! material || ! material->needsUpdate ) return true;
+
+    if ( timeBudget > 0 && compiled > 0 && Clock::now() >= deadline ) return false;
+
+    setProgram( camera, lights, fog, *material, *glObject.object );
+    compiled ++;
+
+    return true;
+
+  };
+
+  for ( auto& glObject : scene.__glObjects ) {
+    unrollBufferMaterial( glObject );
+    if ( ! compileObject( glObject ) ) return false;
+  }
+
+  for ( auto& glObject : scene.__glObjectsImmediate ) {
+    unrollImmediateBufferMaterial( glObject );
+    if ( ! compileObject( glObject ) ) return false;
+  }
+
+  return true;
+
+}
+
 void GLRenderer::renderImmediateObject( Camera& camera, Lights& lights, IFog* fog, Material& material, Object3D& object ) {
 
   auto& program = setProgram( camera, lights, fog, material, object );
@@ -2986,7 +4781,9 @@ void GLRenderer::renderImmediateObject( Camera& camera, Lights& lights, IFog* fo
   setMaterialFaces( material );
 
   if ( object.immediateRenderCallback ) {
+    bindDefaultVertexArray();
     object.immediateRenderCallback( &program, &_gl, &_frustum );
+    invalidateStateCache();
   } else {
     object.render( [this, &program, &material]( Object3D & object ) {
       renderBufferImmediate( object, program, material );
@@ -3078,63 +4875,55 @@ void GLRenderer::unrollBufferMaterial( Scene::GLObject& globject ) {
 
 void GLRenderer::sortFacesByMaterial( Geometry& geometry, Material& material ) {
 
-  // 0: index, 1: count
-  typedef std::pair<int, int> MaterialHashValue;
-
-  std::unordered_map<int, MaterialHashValue> hash_map;
+  // material index -> number of the group currently being filled
+  std::unordered_map<int, int> currentGroups;
 
   const auto numMorphTargets = ( int )geometry.morphTargets.size();
   const auto numMorphNormals = ( int )geometry.morphNormals.size();
 
   const auto useFaceMaterial = material.type() == THREE::MeshFaceMaterial;
 
+  // groups only need splitting when 16-bit indices are all the GPU takes
+
+  const auto maxVertices = _supportsUintIndices ? std::numeric_limits<int>::max() : 65535;
+
   geometry.geometryGroups.clear();
 
   for ( int f = 0, fl = ( int )geometry.faces.size(); f < fl; ++f ) {
 
     const auto& face = geometry.faces[ f ];
 
-    const auto materialIndex = useFaceMaterial ? face.materialIndex : 0;
-    const auto materialHash = materialIndex;
-
-    if ( hash_map.count( materialHash ) == 0 ) {
-      hash_map[ materialHash ] = MaterialHashValue( materialHash, 0 );
-    }
-
-    auto groupHash = toString( hash_map[ materialHash ] );
-
-    if ( geometry.geometryGroups.count( groupHash ) == 0 ) {
-      geometry.geometryGroups.insert( std::make_pair( groupHash, GeometryGroup::create( materialIndex, numMorphTargets, numMorphNormals ) ) );
-    }
-
-    auto geometryGroup = geometry.geometryGroups[ groupHash ];
+    const int materialIndex = useFaceMaterial ? face.materialIndex : 0;
 
     const auto vertices = 3;
 
-    if ( geometryGroup->vertices + vertices > 65535 ) {
+    auto current = currentGroups.find( materialIndex );
 
-      hash_map[ materialHash ].second += 1;
-      groupHash = toString( hash_map[ materialHash ] );
+    if ( current == currentGroups.end() ||
+         geometry.geometryGroups[ current->second ]->vertices + vertices > maxVertices ) {
 
-      if ( geometry.geometryGroups.count( groupHash ) == 0 ) {
-        geometryGroup = GeometryGroup::create( materialIndex, numMorphTargets, numMorphNormals );
-        geometry.geometryGroups.insert( std::make_pair( groupHash, geometryGroup ) );
-      }
+      currentGroups[ materialIndex ] = ( int )geometry.geometryGroups.size();
+      geometry.geometryGroups.push_back( GeometryGroup::create( materialIndex, numMorphTargets, numMorphNormals ) );
 
     }
 
+    auto& geometryGroup = *geometry.geometryGroups[ currentGroups[ materialIndex ] ];
+
     THREE_ASSERT( face.type() == THREE::Face3 );
-    geometryGroup->faces3.push_back( f );
+    geometryGroup.faces3.push_back( f );
 
-    geometryGroup->vertices += vertices;
+    geometryGroup.vertices += vertices;
 
   }
 
   geometry.geometryGroupsList.clear();
 
   for ( auto& geometryGroup : geometry.geometryGroups ) {
-    geometryGroup.second->id = _geometryGroupCounter ++;
-    geometry.geometryGroupsList.push_back( geometryGroup.second.get() );
+    geometryGroup->id = _geometryGroupCounter ++;
+    geometryGroup->__glUintIndices = geometryGroup->vertices > 65535;
+    geometryGroup->interleaved = geometry.interleaved;
+    geometryGroup->vertexFormats = geometry.vertexFormats;
+    geometry.geometryGroupsList.push_back( geometryGroup.get() );
   }
 
 }
@@ -3164,7 +4953,15 @@ void GLRenderer::initGLObjects( Scene& scene ) {
 
     //TODO(ea): Do we need the hack here?
 
-    updateObject( *glObject.object );
+    auto& object = *glObject.object;
+
+    updateObject( object );
+
+    // edited or swapped geometries refit the bounds tree, as moves do
+
+    if ( object.geometry ? object.worldBoundsGeometryChanged() : object.__boundsProxy != AABBTree::nullNode ) {
+      scene.__boundsChanged.push_back( &object );
+    }
   }
 
 }
@@ -3209,7 +5006,7 @@ void GLRenderer::addObject( Object3D& object, Scene& scene ) {
 
         initDirectBuffers( geometry );
 
-    } else if ( object.type() == THREE::Mesh ) {
+    } else if ( object.type() == THREE::Mesh || object.type() == THREE::InstancedMesh ) {
 
       if ( geometry.geometryGroups.empty() ) {
         sortFacesByMaterial( geometry, *static_cast<Mesh&>( object ).material );
@@ -3221,10 +5018,10 @@ void GLRenderer::addObject( Object3D& object, Scene& scene ) {
 
         // initialise VBO on the first access
 
-        if ( ! geometryGroup.second->__glVertexBuffer ) {
+        if ( ! geometryGroup->__glVertexBuffer ) {
 
-          createMeshBuffers( *geometryGroup.second );
-          initMeshBuffers( *geometryGroup.second, static_cast<Mesh&>( object ) );
+          createMeshBuffers( *geometryGroup );
+          initMeshBuffers( *geometryGroup, static_cast<Mesh&>( object ) );
 
           geometry.verticesNeedUpdate     = true;
           geometry.morphTargetsNeedUpdate = true;
@@ -3269,7 +5066,7 @@ void GLRenderer::addObject( Object3D& object, Scene& scene ) {
 
   if ( ! object.glData.__glActive ) {
 
-    if ( object.type() == THREE::Mesh ) {
+    if ( object.type() == THREE::Mesh || object.type() == THREE::InstancedMesh ) {
 
       if ( geometry.type() == THREE::BufferGeometry ) {
 
@@ -3279,7 +5076,7 @@ void GLRenderer::addObject( Object3D& object, Scene& scene ) {
 
         for ( auto& geometryGroup : geometry.geometryGroups ) {
 
-          addBuffer( scene.__glObjects, *geometryGroup.second, object );
+          addBuffer( scene.__glObjects, *geometryGroup, object );
 
         }
 
@@ -3322,12 +5119,51 @@ void GLRenderer::updateObject( Object3D& object ) {
   Material* material = nullptr;
   //GeometryGroup* geometryGroup = nullptr;
 
+  // edited positions leave the bounds stale; they are computed again when
+  // the scene's bounds are next updated
+
+  auto positionsEdited = geometry.verticesNeedUpdate;
+
   if ( geometry.type() == THREE::BufferGeometry ) {
+    const auto position = geometry.attributes.get( AttributeKey::position() );
+    positionsEdited = position && ( position->needsUpdate || ! position->updateRanges.empty() );
+  }
+
+  if ( positionsEdited && ( geometry.boundingBox || geometry.boundingSphere ) ) {
+    geometry.invalidateBounds();
+  }
+
+  // any edit can move the bounds of quantized positions, which are then
+  // quantized again as a whole
+
+  const auto quantized = quantizedPositions( geometry );
+
+  if ( geometry.type() == THREE::BufferGeometry ) {
+
+    if ( quantized ) {
+
+      auto& position = geometry.attributes[ AttributeKey::position() ];
+
+      if ( position.needsUpdate || ! position.updateRanges.empty() ) {
+        updatePositionQuantization( geometry );
+        position.needsUpdate = true;
+      }
+
+    }
+
     setDirectBuffers( geometry, GL_DYNAMIC_DRAW, !geometry.dynamic );
   }
-  else if ( object.type() == THREE::Mesh ) {
+  else if ( object.type() == THREE::Mesh || object.type() == THREE::InstancedMesh ) {
+
+    if ( quantized && ( geometry.verticesNeedUpdate || ! geometry.__dirtyVertices.empty() ) ) {
+      updatePositionQuantization( geometry );
+      geometry.verticesNeedUpdate = true;
+      geometry.__dirtyVertices.clear();
+    }
 
-    // check all geometry groups
+    // check all geometry groups, then update the dirty ones together
+
+    std::vector<MeshBufferUpdate> updates;
 
     for ( auto& geometryGroup : geometry.geometryGroupsList ) {
 
@@ -3340,13 +5176,24 @@ void GLRenderer::updateObject( Object3D& object ) {
       if ( geometry.verticesNeedUpdate  || geometry.morphTargetsNeedUpdate ||
            geometry.uvsNeedUpdate       || geometry.normalsNeedUpdate      ||
            geometry.colorsNeedUpdate    || geometry.tangentsNeedUpdate     ||
-           geometry.elementsNeedUpdate  || customAttributesDirty ) {
+           geometry.elementsNeedUpdate  || customAttributesDirty           ||
+           ! geometry.__dirtyVertices.empty() || ! geometry.__dirtyColors.empty() ) {
+
+        updates.emplace_back( *geometryGroup, material );
+
+      }
+
+    }
+
+    if ( ! updates.empty() ) {
+      setMeshBuffers( updates, object, GL_DYNAMIC_DRAW, !geometry.dynamic );
+    }
 
-        setMeshBuffers( *geometryGroup, object, GL_DYNAMIC_DRAW, !geometry.dynamic, material );
+    for ( auto& geometryGroup : geometry.geometryGroupsList ) {
 
-      }
+      auto groupMaterial = getBufferMaterial( object, geometryGroup );
 
-      clearCustomAttributes( *material );
+      if ( groupMaterial ) clearCustomAttributes( *groupMaterial );
 
     }
 
@@ -3360,6 +5207,9 @@ void GLRenderer::updateObject( Object3D& object ) {
 
     geometry.buffersNeedUpdate      = false;
 
+    geometry.__dirtyVertices.clear();
+    geometry.__dirtyColors.clear();
+
     if( material->attributes.size() ) clearCustomAttributes( *material );
 
 
@@ -3371,7 +5221,8 @@ void GLRenderer::updateObject( Object3D& object ) {
 
     const auto customAttributesDirty = areCustomAttributesDirty( *material );
 
-    if ( geometry.verticesNeedUpdate ||  geometry.colorsNeedUpdate || geometry.lineDistancesNeedUpdate || customAttributesDirty ) {
+    if ( geometry.verticesNeedUpdate ||  geometry.colorsNeedUpdate || geometry.lineDistancesNeedUpdate || customAttributesDirty ||
+         ! geometry.__dirtyVertices.empty() || ! geometry.__dirtyColors.empty() ) {
       setLineBuffers( geometry, GL_DYNAMIC_DRAW );
     }
 
@@ -3379,6 +5230,9 @@ void GLRenderer::updateObject( Object3D& object ) {
     geometry.colorsNeedUpdate = false;
     geometry.lineDistancesNeedUpdate = false;
 
+    geometry.__dirtyVertices.clear();
+    geometry.__dirtyColors.clear();
+
     clearCustomAttributes( *material );
 
   } else if ( object.type() == THREE::ParticleSystem ) {
@@ -3389,13 +5243,17 @@ void GLRenderer::updateObject( Object3D& object ) {
 
     const auto customAttributesDirty = areCustomAttributesDirty( *material );
 
-    if ( geometry.verticesNeedUpdate || geometry.colorsNeedUpdate || object.sortParticles || customAttributesDirty ) {
+    if ( geometry.verticesNeedUpdate || geometry.colorsNeedUpdate || object.sortParticles || customAttributesDirty ||
+         ! geometry.__dirtyVertices.empty() || ! geometry.__dirtyColors.empty() ) {
       setParticleBuffers( geometry, GL_DYNAMIC_DRAW, object );
     }
 
     geometry.verticesNeedUpdate = false;
     geometry.colorsNeedUpdate = false;
 
+    geometry.__dirtyVertices.clear();
+    geometry.__dirtyColors.clear();
+
     clearCustomAttributes( *material );
 
   }
@@ -3426,7 +5284,13 @@ void GLRenderer::clearCustomAttributes( Material& material ) {
 
 void GLRenderer::removeObject( Object3D& object, Scene& scene ) {
 
+  if ( object.type() == THREE::InstancedMesh ) {
+    deleteBuffer( static_cast<InstancedMesh&>( object ).__glInstanceBuffer );
+    forgetBuffers();
+  }
+
   if ( object.type() == THREE::Mesh  ||
+       object.type() == THREE::InstancedMesh ||
        object.type() == THREE::ParticleSystem ||
        object.type() == THREE::Line ) {
     removeInstances( scene.__glObjects, object );
@@ -3464,6 +5328,27 @@ void GLRenderer::removeInstancesDirect( RenderListDirect& objlist, Object3D& obj
 
 // Materials
 
+// uniforms backed by the shared camera, lights and fog blocks
+static inline bool isUniformBlockMember( const std::string& name ) {
+
+  static const char* members[] = {
+    "ambientLightColor",
+    "directionalLightColor", "directionalLightDirection",
+    "hemisphereLightSkyColor", "hemisphereLightGroundColor", "hemisphereLightDirection",
+    "pointLightColor", "pointLightPosition", "pointLightDistance",
+    "spotLightColor", "spotLightPosition", "spotLightDirection",
+    "spotLightDistance", "spotLightAngleCos", "spotLightExponent",
+    "fogColor", "fogNear", "fogFar", "fogDensity"
+  };
+
+  for ( auto member : members ) {
+    if ( name == member ) return true;
+  }
+
+  return false;
+
+}
+
 void GLRenderer::initMaterial( Material& material, Lights& lights, IFog* fog, Object3D& object ) {
 
   material.addEventListener( TargetEvent::TARGET_DISPOSE, std::bind(&GLRenderer::onMaterialDispose, this, std::placeholders::_1) );
@@ -3531,6 +5416,20 @@ void GLRenderer::initMaterial( Material& material, Lights& lights, IFog* fog, Ob
   parameters.maxPointLights = maxLightCount.point;
   parameters.maxSpotLights = maxLightCount.spot;
   parameters.maxHemiLights = maxLightCount.hemi;
+
+  if ( _uniformBlocks ) {
+
+    // light arrays in the shared block have a fixed, renderer-wide size
+
+    const auto blockLights = uniformBlockLights();
+
+    parameters.maxDirLights = std::min( parameters.maxDirLights, blockLights );
+    parameters.maxPointLights = std::min( parameters.maxPointLights, blockLights );
+    parameters.maxSpotLights = std::min( parameters.maxSpotLights, blockLights );
+    parameters.maxHemiLights = std::min( parameters.maxHemiLights, blockLights );
+
+  }
+
   parameters.maxShadows = maxShadows;
   parameters.shadowMapEnabled = shadowMapEnabled && object.receiveShadow;
   parameters.shadowMapType = shadowMapType;
@@ -3542,6 +5441,9 @@ void GLRenderer::initMaterial( Material& material, Lights& lights, IFog* fog, Ob
   parameters.wrapAround = material.wrapAround;
   parameters.doubleSided = material.side == THREE::DoubleSide;
   parameters.flipSided = material.side == THREE::BackSide;
+  parameters.instancing = _supportsInstancing && object.type() == THREE::InstancedMesh;
+  parameters.instancingColor = parameters.instancing && !static_cast<InstancedMesh&>( object ).instanceColors.empty();
+  parameters.quantizedPosition = quantizedPositions( object );
 
   material.program = buildProgram( shaderID,
                                    material.fragmentShader,
@@ -3597,7 +5499,7 @@ void GLRenderer::initMaterial( Material& material, Lights& lights, IFog* fog, Ob
     for ( int i = 0; i < maxMorphTargets; i ++ ) {
       id = toString( base, i );
       if ( attributes[ id ].valid() ) {
-        _gl.EnableVertexAttribArray( attributes[ id ] );
+        enableAttribute( attributes[ id ] );
         material.numSupportedMorphTargets ++;
       }
     }
@@ -3613,7 +5515,7 @@ void GLRenderer::initMaterial( Material& material, Lights& lights, IFog* fog, Ob
     for ( int i = 0; i < maxMorphNormals; i ++ ) {
       auto id = toString( base, i );
       if ( attributes[ id ].valid() ) {
-        _gl.EnableVertexAttribArray( attributes[ id ] );
+        enableAttribute( attributes[ id ] );
         material.numSupportedMorphNormals ++;
       }
     }
@@ -3623,7 +5525,8 @@ void GLRenderer::initMaterial( Material& material, Lights& lights, IFog* fog, Ob
   material.uniformsList.clear();
 
   for ( auto& u : material.uniforms ) {
-    material.uniformsList.emplace_back( &u.second, u.first );
+    if ( _uniformBlocks && isUniformBlockMember( u.first ) ) continue;
+    material.uniformsList.emplace_back( &u.second, internUniform( u.first ) );
   }
 
 }
@@ -3634,16 +5537,32 @@ void GLRenderer::setMaterialShaders( Material& material, const Shader& shaders )
   material.fragmentShader = shaders.fragmentShader;
 }
 
+// Whether the material's program draws `object` as is, which touches no
+// GL state and so is asked by the draw packet workers too
+
+bool GLRenderer::programCurrent( const Material& material, const Object3D& object ) const {
+
+  // a program that dequantizes positions also draws float ones (with an
+  // identity scale), so a shared material only needs rebuilding one way
+
+  return material.program && ! material.needsUpdate &&
+         ( material.program->quantizedPosition || ! quantizedPositions( object ) );
+
+}
+
 Program& GLRenderer::setProgram( Camera& camera, Lights& lights, IFog* fog, Material& material, Object3D& object ) {
 
   _usedTextureUnits = 0;
 
-  if ( material.needsUpdate ) {
+  auto initialized = false;
+
+  if ( ! programCurrent( material, object ) ) {
     if ( material.program ) {
       deallocateMaterial( material );
     }
     initMaterial( material, lights, fog, object );
     material.needsUpdate = false;
+    initialized = true;
   }
 
   if ( material.morphTargets ) {
@@ -3656,9 +5575,16 @@ Program& GLRenderer::setProgram( Camera& camera, Lights& lights, IFog* fog, Mate
   auto& p_uniforms = program.uniforms;
   auto& m_uniforms = material.uniforms;
 
+  // a draw packet's material comes with its uniform values refreshed,
+  // unless its program was only just built
+
+  const auto refreshed = _drawPacket && _drawPacket->material == &material &&
+                         _drawPacket->program == &program && ! initialized;
+
   if ( &program != _currentProgram ) {
     _gl.UseProgram( program.program );
     _currentProgram = &program;
+    _info.render.programSwitches ++;
     refreshMaterial = true;
   }
 
@@ -3667,8 +5593,19 @@ Program& GLRenderer::setProgram( Camera& camera, Lights& lights, IFog* fog, Mate
     refreshMaterial = true;
   }
 
-  if ( refreshMaterial || &camera != _currentCamera ) {
-    _gl.UniformMatrix4fv( p_uniforms[UniformKey::projectionMatrix()], 1, false, camera._projectionMatrixArray.data() );
+  if ( refreshMaterial ) _info.render.materialRefreshes ++;
+
+  if ( _uniformBlocks ) {
+
+    // the camera block is shared, so it only changes with the camera
+
+    if ( &camera != _currentCamera ) {
+      updateCameraBlock( camera );
+      _currentCamera = &camera;
+    }
+
+  } else if ( refreshMaterial || &camera != _currentCamera ) {
+    _gl.UniformMatrix4fv( uniformLocation( p_uniforms, UniformKey::projectionMatrixId() ), 1, false, camera._projectionMatrixArray.data() );
     if ( &camera != _currentCamera ) _currentCamera = &camera;
   }
 
@@ -3678,24 +5615,24 @@ Program& GLRenderer::setProgram( Camera& camera, Lights& lights, IFog* fog, Mate
 
    if ( material.skinning ) {
     if ( _supportsBoneTextures && object.useVertexTexture ) {
-      const auto boneTextureLocation = uniformLocation( p_uniforms, "boneTexture" );
+      const auto boneTextureLocation = uniformLocation( p_uniforms, UniformKey::boneTextureId() );
       if ( validUniformLocation( boneTextureLocation ) ) {
         auto textureUnit = getTextureUnit();
         _gl.Uniform1i( boneTextureLocation, textureUnit );
         setTexture( *object.boneTexture, textureUnit );
       }
 
-      const auto boneTextureWidthLocation = uniformLocation( p_uniforms, "boneTextureWidth" );
+      const auto boneTextureWidthLocation = uniformLocation( p_uniforms, UniformKey::boneTextureWidthId() );
       if ( validUniformLocation( boneTextureWidthLocation ) ) {
         _gl.Uniform1i( boneTextureWidthLocation, object.boneTextureWidth );
       }
 
-      const auto boneTextureHeightLocation = uniformLocation( p_uniforms, "boneTextureHeight" );
+      const auto boneTextureHeightLocation = uniformLocation( p_uniforms, UniformKey::boneTextureHeightId() );
       if ( validUniformLocation( boneTextureHeightLocation ) ) {
         _gl.Uniform1i( boneTextureHeightLocation, object.boneTextureHeight );
       }
     } else {
-      const auto boneMatricesLocation = uniformLocation( p_uniforms, "boneGlobalMatrices" );
+      const auto boneMatricesLocation = uniformLocation( p_uniforms, UniformKey::boneGlobalMatricesId() );
       if ( validUniformLocation( boneMatricesLocation ) ) {
         _gl.UniformMatrix4fv( boneMatricesLocation,
                             ( int )object.boneMatrices.size(),
@@ -3706,49 +5643,19 @@ Program& GLRenderer::setProgram( Camera& camera, Lights& lights, IFog* fog, Mate
   }
 
   if ( refreshMaterial ) {
-    // refresh uniforms common to several materials
-    if ( fog && material.fog ) {
-      refreshUniformsFog( m_uniforms, *fog );
+    // the shared blocks, and the lights the uniforms are refreshed from
+    if ( fog && material.fog && _uniformBlocks && _fogBlockNeedsUpdate ) {
+      updateFogBlock( *fog );
+      _fogBlockNeedsUpdate = false;
     }
 
-    if ( material.type() == THREE::MeshPhongMaterial ||
-         material.type() == THREE::MeshLambertMaterial ||
-         material.lights ) {
-
-      if ( _lightsNeedUpdate ) {
-        setupLights( program, lights );
-        _lightsNeedUpdate = false;
-      }
-
-      refreshUniformsLights( m_uniforms, _lights );
+    if ( usesLights( material ) && _lightsNeedUpdate ) {
+      setupLights( program, lights );
+      if ( _uniformBlocks ) updateLightsBlock();
+      _lightsNeedUpdate = false;
     }
 
-    if ( material.type() == THREE::MeshBasicMaterial ||
-         material.type() == THREE::MeshLambertMaterial ||
-         material.type() == THREE::MeshPhongMaterial ) {
-      refreshUniformsCommon( m_uniforms, material );
-    }
-
-    // refresh single material specific uniforms
-
-    if ( material.type() == THREE::LineBasicMaterial ) {
-      refreshUniformsLine( m_uniforms, material );
-    } else if ( material.type() == THREE::LineDashedMaterial ) {
-      refreshUniformsLine( m_uniforms, material );
-      refreshUniformsDash( m_uniforms, material );
-    } else if ( material.type() == THREE::ParticleSystemMaterial ) {
-      refreshUniformsParticle( m_uniforms, material );
-    } else if ( material.type() == THREE::MeshPhongMaterial ) {
-      refreshUniformsPhong( m_uniforms, material );
-    } else if ( material.type() == THREE::MeshLambertMaterial ) {
-      refreshUniformsLambert( m_uniforms, material );
-    } else if ( material.type() == THREE::MeshDepthMaterial ) {
-      m_uniforms[UniformKey::mNear()].value = camera.near;
-      m_uniforms[UniformKey::mFar()].value = camera.far;
-      m_uniforms[UniformKey::opacity()].value = material.opacity;
-    } else if ( material.type() == THREE::MeshNormalMaterial ) {
-      m_uniforms[UniformKey::opacity()].value = material.opacity;
-    }
+    if ( ! refreshed ) refreshUniformsMaterial( camera, fog, material );
 
     if ( object.receiveShadow && ! material.shadowPass ) {
       refreshUniformsShadow( m_uniforms, lights );
@@ -3766,7 +5673,7 @@ Program& GLRenderer::setProgram( Camera& camera, Lights& lights, IFog* fog, Mate
          material.type() == THREE::MeshPhongMaterial ||
          material.envMap ) {
 
-      const auto cameraPositionLocation = uniformLocation( p_uniforms, "cameraPosition" );
+      const auto cameraPositionLocation = uniformLocation( p_uniforms, UniformKey::cameraPositionId() );
       if ( validUniformLocation( cameraPositionLocation ) ) {
         _vector3.setFromMatrixPosition( camera.matrixWorld );
         _gl.Uniform3f( cameraPositionLocation, _vector3.x, _vector3.y, _vector3.z );
@@ -3779,7 +5686,7 @@ Program& GLRenderer::setProgram( Camera& camera, Lights& lights, IFog* fog, Mate
          material.type() == THREE::ShaderMaterial ||
          material.skinning ) {
 
-      const auto viewMatrixLocation = uniformLocation( p_uniforms, "viewMatrix" );
+      const auto viewMatrixLocation = uniformLocation( p_uniforms, UniformKey::viewMatrixId() );
       if ( validUniformLocation( viewMatrixLocation ) ) {
         _gl.UniformMatrix4fv( viewMatrixLocation, 1, false, camera._viewMatrixArray.data() );
       }
@@ -3789,11 +5696,29 @@ Program& GLRenderer::setProgram( Camera& camera, Lights& lights, IFog* fog, Mate
 
   loadUniformsMatrices( p_uniforms, object );
 
-  const auto modelMatrixLocation = uniformLocation( p_uniforms, "modelMatrix" );
+  const auto modelMatrixLocation = uniformLocation( p_uniforms, UniformKey::modelMatrixId() );
   if ( validUniformLocation( modelMatrixLocation ) ) {
     _gl.UniformMatrix4fv( modelMatrixLocation, 1, false, object.matrixWorld.elements );
   }
 
+  if ( program.quantizedPosition ) {
+
+    const auto quantized = quantizedPositions( object );
+    const auto scale  = quantized ? object.geometry->__positionScale : Vector3( 1, 1, 1 );
+    const auto offset = quantized ? object.geometry->__positionOffset : Vector3( 0, 0, 0 );
+
+    const auto scaleLocation = uniformLocation( p_uniforms, UniformKey::positionScaleId() );
+    if ( validUniformLocation( scaleLocation ) ) {
+      _gl.Uniform3f( scaleLocation, scale.x, scale.y, scale.z );
+    }
+
+    const auto offsetLocation = uniformLocation( p_uniforms, UniformKey::positionOffsetId() );
+    if ( validUniformLocation( offsetLocation ) ) {
+      _gl.Uniform3f( offsetLocation, offset.x, offset.y, offset.z );
+    }
+
+  }
+
   return program;
 
 }
@@ -3801,6 +5726,54 @@ Program& GLRenderer::setProgram( Camera& camera, Lights& lights, IFog* fog, Mate
 
 // Uniforms (refresh uniforms objects)
 
+// The material's own uniform values, from the material, the fog and the
+// lights as setupLights left them. Writes nothing but the material's
+// uniforms, so that different materials can be refreshed on different
+// threads.
+
+void GLRenderer::refreshUniformsMaterial( Camera& camera, IFog* fog, Material& material ) {
+
+  auto& m_uniforms = material.uniforms;
+
+  // refresh uniforms common to several materials
+
+  if ( fog && material.fog && ! _uniformBlocks ) {
+    refreshUniformsFog( m_uniforms, *fog );
+  }
+
+  if ( usesLights( material ) && ! _uniformBlocks ) {
+    refreshUniformsLights( m_uniforms, _lights );
+  }
+
+  if ( material.type() == THREE::MeshBasicMaterial ||
+       material.type() == THREE::MeshLambertMaterial ||
+       material.type() == THREE::MeshPhongMaterial ) {
+    refreshUniformsCommon( m_uniforms, material );
+  }
+
+  // refresh single material specific uniforms
+
+  if ( material.type() == THREE::LineBasicMaterial ) {
+    refreshUniformsLine( m_uniforms, material );
+  } else if ( material.type() == THREE::LineDashedMaterial ) {
+    refreshUniformsLine( m_uniforms, material );
+    refreshUniformsDash( m_uniforms, material );
+  } else if ( material.type() == THREE::ParticleSystemMaterial ) {
+    refreshUniformsParticle( m_uniforms, material );
+  } else if ( material.type() == THREE::MeshPhongMaterial ) {
+    refreshUniformsPhong( m_uniforms, material );
+  } else if ( material.type() == THREE::MeshLambertMaterial ) {
+    refreshUniformsLambert( m_uniforms, material );
+  } else if ( material.type() == THREE::MeshDepthMaterial ) {
+    m_uniforms[UniformKey::mNear()].value = camera.near;
+    m_uniforms[UniformKey::mFar()].value = camera.far;
+    m_uniforms[UniformKey::opacity()].value = material.opacity;
+  } else if ( material.type() == THREE::MeshNormalMaterial ) {
+    m_uniforms[UniformKey::opacity()].value = material.opacity;
+  }
+
+}
+
 void GLRenderer::refreshUniformsCommon( Uniforms& uniforms, Material& material ) {
 
   uniforms[UniformKey::opacity()].value = material.opacity;
@@ -4013,10 +5986,15 @@ void GLRenderer::refreshUniformsShadow( Uniforms& uniforms, Lights& lights ) {
 
 void GLRenderer::loadUniformsMatrices( UniformLocations& uniforms, Object3D& object ) {
 
-  _gl.UniformMatrix4fv( uniforms[UniformKey::modelViewMatrix()], 1, false, object.glData._modelViewMatrix.elements );
-  const auto normalMatrixLocation = uniformLocation( uniforms, "normalMatrix" );
+  // draw packets carry the matrices, otherwise setupMatrices left them
+
+  const auto& modelViewMatrix = _drawPacket ? _drawPacket->modelViewMatrix : object.glData._modelViewMatrix;
+  const auto& normalMatrix = _drawPacket ? _drawPacket->normalMatrix : object.glData._normalMatrix;
+
+  _gl.UniformMatrix4fv( uniformLocation( uniforms, UniformKey::modelViewMatrixId() ), 1, false, modelViewMatrix.elements );
+  const auto normalMatrixLocation = uniformLocation( uniforms, UniformKey::normalMatrixId() );
   if ( validUniformLocation( normalMatrixLocation ) ) {
-    _gl.UniformMatrix3fv( normalMatrixLocation, 1, false, object.glData._normalMatrix.elements );
+    _gl.UniformMatrix3fv( normalMatrixLocation, 1, false, normalMatrix.elements );
   }
 
 }
@@ -4033,30 +6011,60 @@ int GLRenderer::getTextureUnit() {
 
 }
 
+// Stores `data` as the last uploaded value, returns false if it was already there
+
+static inline bool updateUniformValue( std::vector<unsigned char>& uniformValue, const void* data, size_t size ) {
+
+  const auto bytes = static_cast<const unsigned char*>( data );
+
+  if ( uniformValue.size() == size && std::equal( bytes, bytes + size, uniformValue.begin() ) ) {
+    return false;
+  }
+
+  uniformValue.assign( bytes, bytes + size );
+
+  return true;
+
+}
+
 void GLRenderer::loadUniformsGeneric( Program& program, UniformsList& uniforms, bool warnIfNotFound ) {
 
   for ( const auto& uniformAndKey: uniforms ) {//( size_t j = 0, jl = uniforms.size(); j < jl; j ++ ) {
 
-    const auto& location = program.uniforms[ uniformAndKey.second ];
+    const auto location = uniformLocation( program.uniforms, uniformAndKey.second );
 
-    if ( !location.valid() ) {
+    if ( !validUniformLocation( location ) ) {
       if ( warnIfNotFound )
         console().warn() << "three::GLRenderer::loadUniformsGeneric: Expected uniform \""
-                         << uniformAndKey.second
+                         << uniformName( uniformAndKey.second )
                          << "\" location does not exist";
       continue;
     }
 
     auto& uniform = *uniformAndKey.first;
+    auto& uniformValue = program.uniformValues[ uniformAndKey.second ];
+
+    if ( uniform.type != THREE::t && uniform.type != THREE::tv ) {
+
+      if ( uniform.load( _gl, location, uniformValue ) ) {
+        _info.render.uniformUploads ++;
+      } else {
+        _info.render.uniformUploadsSkipped ++;
+      }
 
-    uniform.load( _gl, location );
+    }
 
     if ( uniform.type == THREE::t ) { // single THREE::Texture (2d or cube)
 
       const auto& texture = uniform.value.cast<Texture*>();
       const auto  textureUnit = getTextureUnit();
 
-      _gl.Uniform1i( location, textureUnit );
+      if ( updateUniformValue( uniformValue, &textureUnit, sizeof( textureUnit ) ) ) {
+        _gl.Uniform1i( location, textureUnit );
+        _info.render.uniformUploads ++;
+      } else {
+        _info.render.uniformUploadsSkipped ++;
+      }
 
       if ( !texture ) continue;
 
@@ -4077,7 +6085,12 @@ void GLRenderer::loadUniformsGeneric( Program& program, UniformsList& uniforms,
         textureUnits.push_back( getTextureUnit() );
       }
 
-      _gl.Uniform1iv( location, (int)textureUnits.size(), textureUnits.data() );
+      if ( updateUniformValue( uniformValue, textureUnits.data(), textureUnits.size() * sizeof( int ) ) ) {
+        _gl.Uniform1iv( location, (int)textureUnits.size(), textureUnits.data() );
+        _info.render.uniformUploads ++;
+      } else {
+        _info.render.uniformUploadsSkipped ++;
+      }
 
       for ( size_t i = 0; i < textures.size(); ++i ) {
 
@@ -4351,11 +6364,185 @@ void GLRenderer::setupLights( Program& program, Lights& lights ) {
 
 }
 
+// Uniform blocks
+
+static const unsigned cameraBlockBinding = 0;
+static const unsigned lightsBlockBinding = 1;
+static const unsigned fogBlockBinding    = 2;
+
+// camera block: projectionMatrix, viewMatrix, cameraPosition (std140)
+static const size_t cameraBlockSize = 16 + 16 + 4;
+// fog block: fogColor, fogNear, fogFar, fogDensity (std140, padded to a vec4)
+static const size_t fogBlockSize = 8;
+
+// lights block: ambientLightColor followed by 14 arrays, every element
+// padded to a vec4 as std140 requires
+static inline size_t lightsBlockSize( int blockLights ) {
+  return 4 + 14 * 4 * blockLights;
+}
+
+static inline float* packBlockArray( float* dst, const std::vector<float>& src, size_t components, int blockLights ) {
+
+  const auto count = std::min( src.size() / components, ( size_t )blockLights );
+
+  for ( size_t i = 0; i < count; i ++ ) {
+    std::copy( src.begin() + i * components, src.begin() + ( i + 1 ) * components, dst + i * 4 );
+  }
+
+  return dst + blockLights * 4;
+
+}
+
+int GLRenderer::uniformBlockLights() const {
+  return std::max( _maxLights, 1 );
+}
+
+void GLRenderer::initUniformBlocks() {
+
+#if !defined(THREE_GLES)
+
+  _cameraBlockBuffer = _gl.CreateBuffer();
+  _lightsBlockBuffer = _gl.CreateBuffer();
+  _fogBlockBuffer    = _gl.CreateBuffer();
+
+  _uniformBlockData.assign( cameraBlockSize, 0.f );
+  bindAndBuffer( GL_UNIFORM_BUFFER, _cameraBlockBuffer, _uniformBlockData, GL_DYNAMIC_DRAW );
+
+  _uniformBlockData.assign( lightsBlockSize( uniformBlockLights() ), 0.f );
+  bindAndBuffer( GL_UNIFORM_BUFFER, _lightsBlockBuffer, _uniformBlockData, GL_DYNAMIC_DRAW );
+
+  _uniformBlockData.assign( fogBlockSize, 0.f );
+  bindAndBuffer( GL_UNIFORM_BUFFER, _fogBlockBuffer, _uniformBlockData, GL_DYNAMIC_DRAW );
+
+  _gl.BindBufferBase( GL_UNIFORM_BUFFER, cameraBlockBinding, _cameraBlockBuffer );
+  _gl.BindBufferBase( GL_UNIFORM_BUFFER, lightsBlockBinding, _lightsBlockBuffer );
+  _gl.BindBufferBase( GL_UNIFORM_BUFFER, fogBlockBinding, _fogBlockBuffer );
+
+#endif
+
+}
+
+void GLRenderer::bindUniformBlocks( Program& program ) {
+
+#if !defined(THREE_GLES)
+
+  const std::pair<const char*, unsigned> blocks[] = {
+    std::make_pair( "CameraBlock", cameraBlockBinding ),
+    std::make_pair( "LightsBlock", lightsBlockBinding ),
+    std::make_pair( "FogBlock", fogBlockBinding )
+  };
+
+  for ( const auto& block : blocks ) {
+
+    // blocks the program doesn't use are optimized away by the linker
+
+    const auto index = _gl.GetUniformBlockIndex( program.program, block.first );
+
+    if ( index != GL_INVALID_INDEX ) {
+      _gl.UniformBlockBinding( program.program, index, block.second );
+    }
+
+  }
+
+#endif
+
+}
+
+void GLRenderer::updateCameraBlock( Camera& camera ) {
+
+#if !defined(THREE_GLES)
+
+  auto& data = _uniformBlockData;
+  data.assign( cameraBlockSize, 0.f );
+
+  std::copy( camera._projectionMatrixArray.begin(), camera._projectionMatrixArray.end(), data.begin() );
+  std::copy( camera._viewMatrixArray.begin(), camera._viewMatrixArray.end(), data.begin() + 16 );
+
+  _vector3.setFromMatrixPosition( camera.matrixWorld );
+  data[ 32 ] = _vector3.x;
+  data[ 33 ] = _vector3.y;
+  data[ 34 ] = _vector3.z;
+
+  bindAndBuffer( GL_UNIFORM_BUFFER, _cameraBlockBuffer, data, GL_DYNAMIC_DRAW );
+
+#endif
+
+}
+
+void GLRenderer::updateLightsBlock() {
+
+#if !defined(THREE_GLES)
+
+  const auto blockLights = uniformBlockLights();
+
+  auto& data = _uniformBlockData;
+  data.assign( lightsBlockSize( blockLights ), 0.f );
+
+  auto dst = packBlockArray( data.data(), _lights.ambient, 3, 1 );
+
+  dst = packBlockArray( dst, _lights.directional.colors, 3, blockLights );
+  dst = packBlockArray( dst, _lights.directional.positions, 3, blockLights );
+
+  dst = packBlockArray( dst, _lights.hemi.skyColors, 3, blockLights );
+  dst = packBlockArray( dst, _lights.hemi.groundColors, 3, blockLights );
+  dst = packBlockArray( dst, _lights.hemi.positions, 3, blockLights );
+
+  dst = packBlockArray( dst, _lights.point.colors, 3, blockLights );
+  dst = packBlockArray( dst, _lights.point.positions, 3, blockLights );
+  dst = packBlockArray( dst, _lights.point.distances, 1, blockLights );
+
+  dst = packBlockArray( dst, _lights.spot.colors, 3, blockLights );
+  dst = packBlockArray( dst, _lights.spot.positions, 3, blockLights );
+  dst = packBlockArray( dst, _lights.spot.directions, 3, blockLights );
+  dst = packBlockArray( dst, _lights.spot.distances, 1, blockLights );
+  dst = packBlockArray( dst, _lights.spot.anglesCos, 1, blockLights );
+  packBlockArray( dst, _lights.spot.exponents, 1, blockLights );
+
+  bindAndBuffer( GL_UNIFORM_BUFFER, _lightsBlockBuffer, data, GL_DYNAMIC_DRAW );
+
+#endif
+
+}
+
+void GLRenderer::updateFogBlock( IFog& fog ) {
+
+#if !defined(THREE_GLES)
+
+  auto& data = _uniformBlockData;
+  data.assign( fogBlockSize, 0.f );
+
+  if ( fog.type() == THREE::Fog ) {
+
+    auto& f = static_cast<Fog&>( fog );
+    data[ 0 ] = f.color.r;
+    data[ 1 ] = f.color.g;
+    data[ 2 ] = f.color.b;
+    data[ 3 ] = f.near;
+    data[ 4 ] = f.far;
+
+  } else if ( fog.type() == THREE::FogExp2 ) {
+
+    auto& f = static_cast<FogExp2&>( fog );
+    data[ 0 ] = f.color.r;
+    data[ 1 ] = f.color.g;
+    data[ 2 ] = f.color.b;
+    data[ 5 ] = f.density;
+
+  }
+
+  bindAndBuffer( GL_UNIFORM_BUFFER, _fogBlockBuffer, data, GL_DYNAMIC_DRAW );
+
+#endif
+
+}
+
 
 // GL state setting
 
 void GLRenderer::setFaceCulling( THREE::CullFace cullFace, THREE::FrontFaceDirection frontFaceDirection ) {
 
+  _info.render.stateChanges ++;
+
   if ( cullFace == THREE::CullFaceNone ) {
 
     _gl.Disable( GL_CULL_FACE );
@@ -4396,6 +6583,7 @@ void GLRenderer::setMaterialFaces( Material& material ) {
     }
 
     _oldDoubleSided = doubleSided;
+    _info.render.stateChanges ++;
 
   }
 
@@ -4408,6 +6596,7 @@ void GLRenderer::setMaterialFaces( Material& material ) {
     }
 
     _oldFlipSided = flipSided;
+    _info.render.stateChanges ++;
 
   }
 
@@ -4424,6 +6613,7 @@ void GLRenderer::setDepthTest( bool depthTest ) {
     }
 
     _oldDepthTest = toInt( depthTest );
+    _info.render.stateChanges ++;
 
   }
 
@@ -4434,6 +6624,7 @@ void GLRenderer::setDepthWrite( bool depthWrite ) {
   if ( _oldDepthWrite != toInt( depthWrite ) ) {
     _gl.DepthMask( depthWrite );
     _oldDepthWrite = toInt( depthWrite );
+    _info.render.stateChanges ++;
   }
 
 }
@@ -4443,6 +6634,7 @@ void GLRenderer::setLineWidth( float width ) {
   if ( width != _oldLineWidth ) {
     _gl.LineWidth( width );
     _oldLineWidth = width;
+    _info.render.stateChanges ++;
   }
 
 }
@@ -4458,6 +6650,7 @@ void GLRenderer::setPolygonOffset( bool polygonoffset, float factor, float units
     }
 
     _oldPolygonOffset = toInt( polygonoffset );
+    _info.render.stateChanges ++;
 
   }
 
@@ -4465,6 +6658,7 @@ void GLRenderer::setPolygonOffset( bool polygonoffset, float factor, float units
     _gl.PolygonOffset( factor, units );
     _oldPolygonOffsetFactor = factor;
     _oldPolygonOffsetUnits = units;
+    _info.render.stateChanges ++;
   }
 
 }
@@ -4513,6 +6707,7 @@ void GLRenderer::setBlending( THREE::Blending blending,
     }
 
     _oldBlending = blending;
+    _info.render.stateChanges ++;
 
   }
 
@@ -4521,12 +6716,14 @@ void GLRenderer::setBlending( THREE::Blending blending,
     if ( blendEquation != _oldBlendEquation ) {
       _gl.BlendEquation( paramThreeToGL( blendEquation ) );
       _oldBlendEquation = blendEquation;
+      _info.render.stateChanges ++;
     }
 
     if ( blendSrc != _oldBlendSrc || blendDst != _oldBlendDst ) {
       _gl.BlendFunc( paramThreeToGL( blendSrc ), paramThreeToGL( blendDst ) );
       _oldBlendSrc = blendSrc;
       _oldBlendDst = blendDst;
+      _info.render.stateChanges ++;
     }
 
   } else {
@@ -4552,6 +6749,9 @@ void GLRenderer::resetStates() {
   _currentMaterialId = -1;
 
   _lightsNeedUpdate = true;
+  _fogBlockNeedsUpdate = true;
+
+  invalidateStateCache();
 }
 
 // Defines
@@ -4567,6 +6767,107 @@ std::string GLRenderer::generateDefines( const Material::Defines& defines ) cons
 
 // Shaders
 
+// Canonical description of a program variant. Every input that changes the
+// generated source is written field by field, so struct padding and pointers
+// (the fog, the defines map) never reach it, and the defines are sorted by
+// name. The renderer caches programs by its hash and compares it on a hit.
+static std::string programVariant( const std::string& shaderID,
+                                   const std::string& fragmentShader,
+                                   const std::string& vertexShader,
+                                   const Material::Defines& defines,
+                                   const ProgramParameters& parameters,
+                                   std::uint64_t rendererFlags ) {
+
+  std::string variant;
+
+  auto addValue = [&variant]( std::uint64_t value ) {
+    variant.append( reinterpret_cast<const char*>( &value ), sizeof( value ) );
+  };
+
+  auto addString = [&variant, &addValue]( const std::string& value ) {
+    addValue( value.size() );
+    variant += value;
+  };
+
+  if ( !shaderID.empty() ) {
+    addValue( 0 );
+    addString( shaderID );
+  } else {
+    addValue( 1 );
+    addString( fragmentShader );
+    addString( vertexShader );
+  }
+
+  std::vector<const Material::Defines::value_type*> sortedDefines;
+
+  for ( const auto& d : defines ) {
+    sortedDefines.push_back( &d );
+  }
+
+  std::sort( sortedDefines.begin(), sortedDefines.end(), []( const Material::Defines::value_type* a, const Material::Defines::value_type* b ) {
+    return a->first < b->first;
+  } );
+
+  addValue( sortedDefines.size() );
+
+  for ( const auto d : sortedDefines ) {
+    addString( d->first );
+    addString( d->second );
+  }
+
+  std::uint64_t flags = rendererFlags;
+  int bit = 8;
+
+  auto addFlag = [&flags, &bit]( bool value ) {
+    flags |= ( std::uint64_t )value << bit++;
+  };
+
+  addFlag( parameters.map );
+  addFlag( parameters.envMap );
+  addFlag( parameters.lightMap );
+  addFlag( parameters.bumpMap );
+  addFlag( parameters.normalMap );
+  addFlag( parameters.specularMap );
+  addFlag( parameters.useFog && parameters.fog != nullptr );
+  addFlag( parameters.useFog && parameters.fogExp );
+  addFlag( parameters.sizeAttenuation );
+  addFlag( parameters.skinning );
+  addFlag( parameters.useVertexTexture );
+  addFlag( parameters.morphTargets );
+  addFlag( parameters.morphNormals );
+  addFlag( parameters.shadowMapEnabled );
+  addFlag( parameters.shadowMapDebug );
+  addFlag( parameters.shadowMapCascade );
+  addFlag( parameters.metal );
+  addFlag( parameters.perPixel );
+  addFlag( parameters.wrapAround );
+  addFlag( parameters.doubleSided );
+  addFlag( parameters.flipSided );
+  addFlag( parameters.instancing );
+  addFlag( parameters.instancingColor );
+  addFlag( parameters.quantizedPosition );
+
+  addValue( flags );
+
+  addValue( parameters.vertexColors );
+  addValue( parameters.maxBones );
+  addValue( parameters.maxMorphTargets );
+  addValue( parameters.maxMorphNormals );
+  addValue( parameters.maxDirLights );
+  addValue( parameters.maxPointLights );
+  addValue( parameters.maxSpotLights );
+  addValue( parameters.maxHemiLights );
+  addValue( parameters.maxShadows );
+  addValue( parameters.shadowMapType );
+
+  std::uint32_t alphaTest;
+  std::memcpy( &alphaTest, &parameters.alphaTest, sizeof( alphaTest ) );
+  addValue( parameters.alphaTest ? alphaTest : 0 );
+
+  return variant;
+
+}
+
 Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
                                        const std::string& fragmentShader,
                                        const std::string& vertexShader,
@@ -4576,31 +6877,26 @@ Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
                                        ProgramParameters& parameters) {
 
 
-  // Generate code
-  std::hash<std::string> hash;
-  std::stringstream chunks;
-
-  if ( !shaderID.empty() ) {
-    chunks << shaderID;
-  } else {
-    chunks << hash( fragmentShader );
-    chunks << hash( vertexShader );
-  }
+  // Check if this variant has been already compiled
 
-  chunks << jenkins_hash( &defines );
+  const std::uint64_t rendererFlags = ( gammaInput ? 1 : 0 ) |
+                                      ( gammaOutput ? 2 : 0 ) |
+                                      ( physicallyBasedShading ? 4 : 0 ) |
+                                      ( _supportsVertexTextures ? 8 : 0 );
 
-  chunks << jenkins_hash( &parameters );
+  const auto variant = programVariant( shaderID, fragmentShader, vertexShader, defines, parameters, rendererFlags );
 
-  auto code = chunks.str();
+  // variants whose hashes collide share the key, told apart by the variant itself
 
-  // Check if code has been already compiled
+  const auto key = fnv1a_hash( variant.data(), variant.size() );
+  auto programs = _programs.equal_range( key );
+  auto programIt = std::find_if( programs.first, programs.second, [&variant]( const std::pair<const std::uint64_t, ProgramInfo>& p ) {
+    return p.second.variant == variant;
+  } );
 
-  for ( auto& programInfo : _programs ) {
-    if ( programInfo.code == code ) {
-      console().log( "Code already compiled." /*: \n\n" + code*/ );
-      programInfo.usedTimes ++;
-      return programInfo.program;
-    }
+  if ( programIt != programs.second ) {
+    programIt->second.usedTimes ++;
+    return programIt->second.program;
   }
 
   auto shadowMapTypeDefine = "SHADOWMAP_TYPE_BASIC";
@@ -4629,6 +6925,12 @@ Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
     ss << "precision " << _precision << " int;" << std::endl;
 #endif
 
+    if ( _uniformBlocks ) {
+      ss << "#version 140" << std::endl;
+      ss << "#define USE_UNIFORM_BLOCKS" << std::endl;
+      ss << "#define MAX_BLOCK_LIGHTS " << uniformBlockLights() << std::endl;
+    }
+
     ss << customDefines;
 
     if ( _supportsVertexTextures ) ss << "#define VERTEX_TEXTURES" << std::endl;
@@ -4670,14 +6972,26 @@ Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
 
     if ( parameters.sizeAttenuation ) ss << "#define USE_SIZEATTENUATION" << std::endl;
 
+    if ( parameters.instancing )      ss << "#define USE_INSTANCING" << std::endl;
+    if ( parameters.instancingColor ) ss << "#define USE_INSTANCING_COLOR" << std::endl;
+
+    if ( parameters.quantizedPosition ) ss << "#define QUANTIZED_POSITION" << std::endl;
+
     ss <<
 
     "uniform mat4 modelMatrix;" << std::endl <<
     "uniform mat4 modelViewMatrix;" << std::endl <<
-    "uniform mat4 projectionMatrix;" << std::endl <<
-    "uniform mat4 viewMatrix;" << std::endl <<
-    "uniform mat3 normalMatrix;" << std::endl <<
-    "uniform vec3 cameraPosition;" << std::endl <<
+    "uniform mat3 normalMatrix;" << std::endl;
+
+    if ( _uniformBlocks ) {
+      ss << ShaderChunk::camera_block_pars() << ShaderChunk::lights_block_pars();
+    } else {
+      ss << "uniform mat4 projectionMatrix;" << std::endl <<
+      "uniform mat4 viewMatrix;" << std::endl <<
+      "uniform vec3 cameraPosition;" << std::endl;
+    }
+
+    ss <<
 
     "attribute vec3 position;" << std::endl <<
     "attribute vec3 normal;" << std::endl <<
@@ -4722,6 +7036,29 @@ Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
     "attribute vec4 skinIndex;" << std::endl <<
     "attribute vec4 skinWeight;" << std::endl <<
 
+    "#endif" << std::endl <<
+
+    "#ifdef USE_INSTANCING" << std::endl <<
+
+    "attribute mat4 instanceMatrix;" << std::endl <<
+
+    "#endif" << std::endl <<
+
+    "#ifdef USE_INSTANCING_COLOR" << std::endl <<
+
+    "attribute vec3 instanceColor;" << std::endl <<
+
+    "#endif" << std::endl <<
+
+    // a macro naming itself is not expanded again, so every use of
+    // `position` below reads the dequantized attribute
+
+    "#ifdef QUANTIZED_POSITION" << std::endl <<
+
+    "uniform vec3 positionScale;" << std::endl <<
+    "uniform vec3 positionOffset;" << std::endl <<
+    "#define position ( position * positionScale + positionOffset )" << std::endl <<
+
     "#endif" << std::endl;
 
     return ss.str();
@@ -4740,6 +7077,11 @@ Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
     ss << "#version 140" << std::endl;
 #endif
 
+    if ( _uniformBlocks ) {
+      ss << "#define USE_UNIFORM_BLOCKS" << std::endl;
+      ss << "#define MAX_BLOCK_LIGHTS " << uniformBlockLights() << std::endl;
+    }
+
     ss << customDefines;
 
     if ( parameters.bumpMap || parameters.normalMap ) ss << "#extension GL_OES_standard_derivatives : enable" << std::endl;
@@ -4767,6 +7109,8 @@ Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
     if ( parameters.specularMap )  ss << "#define USE_SPECULARMAP" <<  std::endl;
     if ( parameters.vertexColors ) ss << "#define USE_COLOR" <<  std::endl;
 
+    if ( parameters.instancingColor ) ss << "#define USE_INSTANCING_COLOR" << std::endl;
+
     if ( parameters.metal )       ss << "#define METAL" <<  std::endl;
     if ( parameters.perPixel )    ss << "#define PHONG_PER_PIXEL" <<  std::endl;
     if ( parameters.wrapAround )  ss << "#define WRAP_AROUND" <<  std::endl;
@@ -4778,38 +7122,70 @@ Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
     if ( parameters.shadowMapDebug )   ss << "#define SHADOWMAP_DEBUG" <<  std::endl;
     if ( parameters.shadowMapCascade ) ss << "#define SHADOWMAP_CASCADE" <<  std::endl;
 
-    ss << "uniform mat4 viewMatrix;" << std::endl <<
-    "uniform vec3 cameraPosition;" << std::endl;
+    if ( _uniformBlocks ) {
+      ss << ShaderChunk::camera_block_pars() << ShaderChunk::lights_block_pars() << ShaderChunk::fog_block_pars();
+    } else {
+      ss << "uniform mat4 viewMatrix;" << std::endl <<
+      "uniform vec3 cameraPosition;" << std::endl;
+    }
 
     return ss.str();
 
   }();
 
-  auto glVertexShader   = getShader( THREE::ShaderVertex,   prefix_vertex   + vertexShader );
-  auto glFragmentShader = getShader( THREE::ShaderFragment, prefix_fragment + fragmentShader );
+  const auto vertexSource   = prefix_vertex   + vertexShader;
+  const auto fragmentSource = prefix_fragment + fragmentShader;
 
-  GL_CALL( _gl.AttachShader( glProgram, glVertexShader ) );
-  GL_CALL( _gl.AttachShader( glProgram, glFragmentShader ) );
+  const auto useProgramCache = _programCache && _programCache->enabled();
 
-  GL_CALL( _gl.LinkProgram( glProgram ) );
+  // binaries on disk outlive this build of the library, so they are keyed by
+  // the complete source instead of the shader id
 
-  if ( GL_TRUE != _gl.GetProgramParameter( glProgram, GL_LINK_STATUS ) ) {
-    int loglen;
-    char logbuffer[1000];
-    _gl.GetProgramInfoLog( glProgram, sizeof( logbuffer ), &loglen, logbuffer );
-    console().error( logbuffer );
-    //console.error( "Program Info Log: " + _gl.getProgramInfoLog( program ) );
-    //console().error() << addLineNumbers( source );
-    _gl.DeleteProgram( glProgram );
-    glProgram = 0;
-  }
+  const auto binaryKey = useProgramCache
+                       ? fnv1a_hash( fragmentSource.data(), fragmentSource.size(),
+                                     fnv1a_hash( vertexSource.data(), vertexSource.size(), key ) )
+                       : key;
+
+  // a binary from the on-disk cache skips compilation altogether;
+  // on a miss the program is still unlinked and is built from source
+
+  if ( ! useProgramCache || ! _programCache->load( binaryKey, glProgram ) ) {
+
+    auto glVertexShader   = getShader( THREE::ShaderVertex,   vertexSource );
+    auto glFragmentShader = getShader( THREE::ShaderFragment, fragmentSource );
+
+    GL_CALL( _gl.AttachShader( glProgram, glVertexShader ) );
+    GL_CALL( _gl.AttachShader( glProgram, glFragmentShader ) );
+
+#if !defined(THREE_GLES)
+    if ( useProgramCache && _gl.ProgramParameteri ) {
+      _gl.ProgramParameteri( glProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+    }
+#endif
 
-  // clean up
+    GL_CALL( _gl.LinkProgram( glProgram ) );
+
+    if ( GL_TRUE != _gl.GetProgramParameter( glProgram, GL_LINK_STATUS ) ) {
+      int loglen;
+      char logbuffer[1000];
+      _gl.GetProgramInfoLog( glProgram, sizeof( logbuffer ), &loglen, logbuffer );
+      console().error( logbuffer );
+      //console.error( "Program Info Log: " + _gl.getProgramInfoLog( program ) );
+      //console().error() << addLineNumbers( source );
+      _gl.DeleteProgram( glProgram );
+      glProgram = 0;
+    } else if ( useProgramCache ) {
+      _programCache->save( binaryKey, glProgram );
+    }
+
+    // clean up
 
-  _gl.DeleteShader( glFragmentShader );
-  glFragmentShader = 0;
-  _gl.DeleteShader( glVertexShader );
-  glVertexShader = 0;
+    _gl.DeleteShader( glFragmentShader );
+    glFragmentShader = 0;
+    _gl.DeleteShader( glVertexShader );
+    glVertexShader = 0;
+
+  }
 
   if ( !glProgram ) {
 
@@ -4821,6 +7197,10 @@ Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
   //console().log() << prefix_vertex   + vertexShader;
 
   auto program = Program::create( glProgram, _programs_counter++ );
+  program->key = key;
+  program->quantizedPosition = parameters.quantizedPosition;
+
+  if ( _uniformBlocks ) bindUniformBlocks( *program );
 
   {
     // cache uniform locations
@@ -4839,6 +7219,11 @@ Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
 
     Identifiers identifiers( identifiersArray.begin(), identifiersArray.end() );
 
+    if ( parameters.quantizedPosition ) {
+      identifiers.push_back( UniformKey::positionScale() );
+      identifiers.push_back( UniformKey::positionOffset() );
+    }
+
     if ( parameters.useVertexTexture ) {
       identifiers.push_back( "boneTexture" );
       identifiers.push_back( "boneTextureWidth" );
@@ -4887,6 +7272,11 @@ Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
 
     }
 
+    if ( parameters.instancing ) {
+      identifiers.push_back( AttributeKey::instanceMatrix() );
+      identifiers.push_back( AttributeKey::instanceColor() );
+    }
+
     for ( const auto& a : attributes ) {
       identifiers.push_back( a.first );
     }
@@ -4895,7 +7285,7 @@ Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
 
   }
 
-  _programs.push_back( ProgramInfo( program, code, 1 ) );
+  _programs.emplace( key, ProgramInfo( program, variant, 1 ) );
 
   _info.memory.programs = ( int )_programs.size();
 
@@ -4906,8 +7296,13 @@ Program::Ptr GLRenderer::buildProgram( const std::string& shaderID,
 // Shader parameters cache
 
 void GLRenderer::cacheUniformLocations( Program& program, const Identifiers& identifiers ) {
-  for ( const auto& id : identifiers ) {
-    program.uniforms[ id ] = GL_CALL( _gl.GetUniformLocation( program.program, id.c_str() ) );
+  for ( const auto& name : identifiers ) {
+    const auto id = internUniform( name );
+    if ( id >= ( int )program.uniforms.size() ) {
+      program.uniforms.resize( id + 1, -1 );
+      program.uniformValues.resize( id + 1 );
+    }
+    program.uniforms[ id ] = GL_CALL( _gl.GetUniformLocation( program.program, name.c_str() ) );
   }
 }
 
@@ -4978,8 +7373,7 @@ void GLRenderer::setTexture( Texture& texture, int slot ) {
 
     }
 
-    _gl.ActiveTexture( GL_TEXTURE0 + slot );
-    _gl.BindTexture( GL_TEXTURE_2D, texture.__glTexture );
+    bindTexture( GL_TEXTURE_2D, texture.__glTexture, slot );
 
 #ifdef TODO_glUnPACK
     _gl.PixelStorei( GL_UNPACK_FLIP_Y_WEBGL, texture.flipY );
@@ -5014,8 +7408,7 @@ void GLRenderer::setTexture( Texture& texture, int slot ) {
 
   } else {
 
-    _gl.ActiveTexture( GL_TEXTURE0 + slot );
-    _gl.BindTexture( GL_TEXTURE_2D, texture.__glTexture );
+    bindTexture( GL_TEXTURE_2D, texture.__glTexture, slot );
 
   }
 
@@ -5069,8 +7462,7 @@ void GLRenderer::setCubeTexture( Texture& texture, int slot ) {
         _info.memory.textures ++;
       }
 
-      _gl.ActiveTexture( GL_TEXTURE0 + slot );
-      _gl.BindTexture( GL_TEXTURE_CUBE_MAP, texture.__glTextureCube );
+      bindTexture( GL_TEXTURE_CUBE_MAP, texture.__glTextureCube, slot );
 
 #ifdef TODO_IMAGE_SCALING
       _gl.PixelStorei( GL_UNPACK_FLIP_Y, texture.flipY );
@@ -5114,8 +7506,7 @@ void GLRenderer::setCubeTexture( Texture& texture, int slot ) {
       if ( texture.onUpdate ) texture.onUpdate();
 
     } else {
-      _gl.ActiveTexture( GL_TEXTURE0 + slot );
-      _gl.BindTexture( GL_TEXTURE_CUBE_MAP, texture.__glTextureCube );
+      bindTexture( GL_TEXTURE_CUBE_MAP, texture.__glTextureCube, slot );
     }
 
   }
@@ -5124,8 +7515,7 @@ void GLRenderer::setCubeTexture( Texture& texture, int slot ) {
 
 void GLRenderer::setCubeTextureDynamic( Texture& texture, int slot ) {
 
-  _gl.ActiveTexture( GL_TEXTURE0 + slot );
-  _gl.BindTexture( GL_TEXTURE_CUBE_MAP, texture.__glTexture );
+  bindTexture( GL_TEXTURE_CUBE_MAP, texture.__glTexture, slot );
 
 }
 
@@ -5134,7 +7524,7 @@ void GLRenderer::setCubeTextureDynamic( Texture& texture, int slot ) {
 
 void GLRenderer::setupFrameBuffer( Buffer framebuffer, GLRenderTarget& renderTarget, GLenum textureTarget ) {
 
-  _gl.BindFramebuffer( GL_FRAMEBUFFER, framebuffer );
+  bindFramebuffer( framebuffer );
   _gl.FramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureTarget, renderTarget.__glTexture, 0 );
 
 }
@@ -5193,7 +7583,7 @@ void GLRenderer::setRenderTarget( const GLRenderTarget::Ptr& renderTarget ) {
       renderTarget->__glFramebuffer.resize( 6 );
       renderTarget->__glRenderbuffer.resize( 6 );
 
-      _gl.BindTexture( GL_TEXTURE_CUBE_MAP, renderTarget->__glTexture );
+      bindTexture( GL_TEXTURE_CUBE_MAP, renderTarget->__glTexture );
       setTextureParameters( GL_TEXTURE_CUBE_MAP, *renderTarget, isTargetPowerOfTwo );
 
       for ( auto i = 0; i < 6; i ++ ) {
@@ -5223,7 +7613,7 @@ void GLRenderer::setRenderTarget( const GLRenderTarget::Ptr& renderTarget ) {
         renderTarget->__glRenderbuffer[ 0 ] = _gl.CreateRenderbuffer();
       }
 
-      _gl.BindTexture( GL_TEXTURE_2D, renderTarget->__glTexture );
+      bindTexture( GL_TEXTURE_2D, renderTarget->__glTexture );
       setTextureParameters( GL_TEXTURE_2D, *renderTarget, isTargetPowerOfTwo );
 
       _gl.TexImage2D( GL_TEXTURE_2D, 0, glFormat, renderTarget->width, renderTarget->height, 0, glFormat, glType, 0 );
@@ -5254,13 +7644,13 @@ void GLRenderer::setRenderTarget( const GLRenderTarget::Ptr& renderTarget ) {
     // Release everything
 
     if ( isCube ) {
-      _gl.BindTexture( GL_TEXTURE_CUBE_MAP, 0 );
+      bindTexture( GL_TEXTURE_CUBE_MAP, 0 );
     } else {
-      _gl.BindTexture( GL_TEXTURE_2D, 0 );
+      bindTexture( GL_TEXTURE_2D, 0 );
     }
 
     _gl.BindRenderbuffer( GL_RENDERBUFFER, 0 );
-    _gl.BindFramebuffer( GL_FRAMEBUFFER, 0 );
+    bindFramebuffer( 0 );
 
   }
 
@@ -5295,10 +7685,12 @@ void GLRenderer::setRenderTarget( const GLRenderTarget::Ptr& renderTarget ) {
 
   if ( framebuffer != _currentFramebuffer ) {
 
-    _gl.BindFramebuffer( GL_FRAMEBUFFER, framebuffer );
+    bindFramebuffer( framebuffer );
     _gl.Viewport( vx, vy, width, height );
 
-    _currentFramebuffer = framebuffer;
+  } else {
+
+    _info.render.framebufferBindsSkipped ++;
 
   }
 
@@ -5311,15 +7703,15 @@ void GLRenderer::updateRenderTargetMipmap( GLRenderTarget& renderTarget ) {
 
   if ( renderTarget.type() == THREE::GLRenderTargetCube ) {
 
-    _gl.BindTexture( GL_TEXTURE_CUBE_MAP, renderTarget.__glTexture );
+    bindTexture( GL_TEXTURE_CUBE_MAP, renderTarget.__glTexture );
     _gl.GenerateMipmap( GL_TEXTURE_CUBE_MAP );
-    _gl.BindTexture( GL_TEXTURE_CUBE_MAP, 0 );
+    bindTexture( GL_TEXTURE_CUBE_MAP, 0 );
 
   } else {
 
-    _gl.BindTexture( GL_TEXTURE_2D, renderTarget.__glTexture );
+    bindTexture( GL_TEXTURE_2D, renderTarget.__glTexture );
     _gl.GenerateMipmap( GL_TEXTURE_2D );
-    _gl.BindTexture( GL_TEXTURE_2D, 0 );
+    bindTexture( GL_TEXTURE_2D, 0 );
 
   }
 
@@ -0,0 +1,119 @@
+#include <three/renderers/gl_stream_buffer.h>
+
+#include <three/console.h>
+
+#include <cstring>
+
+namespace three {
+
+namespace {
+
+// keeps every allocation usable as an attribute or index offset
+const std::size_t streamAlignment = 16;
+
+} // namespace
+
+GLStreamBuffer::GLStreamBuffer( const GLInterfaceWrapper& gl, std::size_t capacity )
+  : _gl( gl ), _buffer( 0 ), _capacity( capacity ), _offset( 0 ), _orphans( 0 ) {
+
+#if !defined(THREE_GLES)
+
+  if ( _capacity == 0 ) return;
+
+  if ( ! _gl.MapBufferRange || ! _gl.UnmapBuffer || ! _gl.CopyBufferSubData ) {
+    console().warn( "THREE::GLStreamBuffer: Buffer mapping not supported, streaming disabled." );
+    return;
+  }
+
+  _buffer = _gl.CreateBuffer();
+
+  _gl.BindBuffer( GL_COPY_WRITE_BUFFER, _buffer );
+  _gl.BufferData( GL_COPY_WRITE_BUFFER, _capacity, nullptr, GL_STREAM_DRAW );
+
+#endif
+
+}
+
+GLStreamBuffer::~GLStreamBuffer() {
+
+  if ( _buffer ) _gl.DeleteBuffer( _buffer );
+
+}
+
+std::size_t GLStreamBuffer::footprint( std::size_t size ) {
+
+  return ( size + streamAlignment - 1 ) & ~( streamAlignment - 1 );
+
+}
+
+void GLStreamBuffer::reserve( std::size_t size ) {
+
+  if ( footprint( _offset ) + size > _capacity ) orphan();
+
+}
+
+std::size_t GLStreamBuffer::write( const void* data, std::size_t size ) {
+
+#if !defined(THREE_GLES)
+
+  auto offset = footprint( _offset );
+
+  if ( offset + size > _capacity ) {
+    orphan();
+    offset = 0;
+  }
+
+  _gl.BindBuffer( GL_COPY_WRITE_BUFFER, _buffer );
+
+  // nothing drawn since the last orphan() reads this range, so don't sync
+
+  const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+
+  if ( auto mapped = _gl.MapBufferRange( GL_COPY_WRITE_BUFFER, offset, size, access ) ) {
+    std::memcpy( mapped, data, size );
+    _gl.UnmapBuffer( GL_COPY_WRITE_BUFFER );
+  } else {
+    _gl.BufferSubData( GL_COPY_WRITE_BUFFER, offset, size, data );
+  }
+
+  _offset = offset + size;
+
+  return offset;
+
+#else
+
+  return 0;
+
+#endif
+
+}
+
+void GLStreamBuffer::upload( Buffer target, const void* data, std::size_t size ) {
+
+#if !defined(THREE_GLES)
+
+  const auto offset = write( data, size );
+
+  _gl.BindBuffer( GL_COPY_READ_BUFFER, _buffer );
+  _gl.BindBuffer( GL_COPY_WRITE_BUFFER, target );
+  _gl.CopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, offset, 0, size );
+
+#endif
+
+}
+
+void GLStreamBuffer::orphan() {
+
+#if !defined(THREE_GLES)
+
+  _gl.BindBuffer( GL_COPY_WRITE_BUFFER, _buffer );
+  _gl.BufferData( GL_COPY_WRITE_BUFFER, _capacity, nullptr, GL_STREAM_DRAW );
+
+  _offset = 0;
+  _orphans ++;
+
+#endif
+
+}
+
+} // namespace three
@@ -0,0 +1,294 @@
+#include <three/renderers/occlusion_buffer.h>
+
+#include <three/core/geometry.h>
+#include <three/core/object3d.h>
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace three {
+
+namespace {
+
+const float farthest = std::numeric_limits<float>::infinity();
+
+// NDC position of `v` through `m`, false if it lies behind the eye
+inline bool project( const Matrix4& m, float x, float y, float z, float& outX, float& outY, float& outZ ) {
+
+  const auto& e = m.elements;
+
+  const auto w = e[3] * x + e[7] * y + e[11] * z + e[15];
+  if ( w <= 1e-6f ) return false;
+
+  const auto invW = 1.f / w;
+  outX = ( e[0] * x + e[4] * y + e[8] * z + e[12] ) * invW;
+  outY = ( e[1] * x + e[5] * y + e[9] * z + e[13] ) * invW;
+  outZ = ( e[2] * x + e[6] * y + e[10] * z + e[14] ) * invW;
+
+  return true;
+
+}
+
+// `v` clamped to [lo, hi] before the conversion, which could overflow
+inline int clampToInt( float v, int lo, int hi ) {
+
+  return ( int )std::min( std::max( v, ( float )lo ), ( float )hi );
+
+}
+
+} // namespace
+
+OcclusionBuffer::OcclusionBuffer( int width, int height )
+  : _width( std::max( width, 1 ) ),
+    _height( std::max( height, 1 ) ),
+    _tilesX( ( _width + tileSize - 1 ) / tileSize ),
+    _tilesY( ( _height + tileSize - 1 ) / tileSize ),
+    _depth( _width * _height, farthest ),
+    _tileDepth( _tilesX * _tilesY, farthest ) { }
+
+void OcclusionBuffer::clear( const Matrix4& viewProjection ) {
+
+  _viewProjection.copy( viewProjection );
+  _triangles.clear();
+
+  std::fill( _depth.begin(), _depth.end(), farthest );
+  std::fill( _tileDepth.begin(), _tileDepth.end(), farthest );
+
+}
+
+void OcclusionBuffer::addOccluder( const Object3D& object ) {
+
+  const auto& geometry = object.geometry;
+
+  if ( ! geometry || geometry->type() == THREE::BufferGeometry ) return;
+
+  Matrix4 matrix;
+  matrix.multiplyMatrices( _viewProjection, object.matrixWorld );
+
+  // screen positions are in pixels, with row 0 at the bottom
+
+  const auto scaleX = 0.5f * _width, scaleY = 0.5f * _height;
+
+  for ( const auto& face : geometry->faces ) {
+
+    Triangle triangle;
+    auto inside = true;
+
+    for ( int i = 0; i < 3 && inside; ++i ) {
+
+      const auto& v = geometry->vertices[ face.abc[ i ] ];
+      float x = 0, y = 0, z = 0;
+
+      inside = project( matrix, v.x, v.y, v.z, x, y, z ) && z >= -1.f && z <= 1.f;
+
+      triangle.x[ i ] = ( x + 1.f ) * scaleX;
+      triangle.y[ i ] = ( y + 1.f ) * scaleY;
+      triangle.z[ i ] = z;
+
+    }
+
+    if ( inside ) _triangles.push_back( triangle );
+
+  }
+
+}
+
+void OcclusionBuffer::rasterize( TaskScheduler* scheduler ) {
+
+  // bands are whole rows of tiles, so each band builds its own tile depths
+
+  parallelFor( scheduler, 0, _tilesY, 2, [this]( size_t first, size_t last ) {
+
+    const auto firstRow = ( int )first * tileSize;
+    const auto lastRow = std::min( ( int )last * tileSize, _height );
+
+    rasterizeRows( firstRow, lastRow );
+
+    for ( auto ty = first; ty < last; ++ty ) {
+      for ( int tx = 0; tx < _tilesX; ++tx ) {
+
+        auto tileDepth = std::numeric_limits<float>::lowest();
+
+        const auto x1 = std::min( ( tx + 1 ) * tileSize, _width );
+        const auto y1 = std::min( ( int )( ty + 1 ) * tileSize, _height );
+
+        for ( auto y = ( int )ty * tileSize; y < y1; ++y ) {
+          const auto row = &_depth[ y * _width ];
+          for ( auto x = tx * tileSize; x < x1; ++x ) {
+            tileDepth = std::max( tileDepth, row[ x ] );
+          }
+        }
+
+        _tileDepth[ ty * _tilesX + tx ] = tileDepth;
+
+      }
+    }
+
+  } );
+
+}
+
+// Edge functions and depth are evaluated at pixel centers. A pixel is
+// covered when its center is inside, as on the GPU, so that the triangles of
+// a mesh leave no cracks between them, and it is given the triangle's
+// farthest depth within it. With SSE2 four pixels of a row are done at once.
+
+void OcclusionBuffer::rasterizeRows( int first, int last ) {
+
+  for ( const auto& t : _triangles ) {
+
+    const auto area = ( t.x[1] - t.x[0] ) * ( t.y[2] - t.y[0] ) - ( t.y[1] - t.y[0] ) * ( t.x[2] - t.x[0] );
+    if ( std::abs( area ) < 1e-6f ) continue;
+
+    const auto minY = clampToInt( std::floor( std::min( { t.y[0], t.y[1], t.y[2] } ) ), first, last );
+    const auto maxY = clampToInt( std::ceil( std::max( { t.y[0], t.y[1], t.y[2] } ) ), first, last );
+    if ( minY >= maxY ) continue;
+
+    const auto minX = clampToInt( std::floor( std::min( { t.x[0], t.x[1], t.x[2] } ) ), 0, _width );
+    const auto maxX = clampToInt( std::ceil( std::max( { t.x[0], t.x[1], t.x[2] } ) ), 0, _width );
+    if ( minX >= maxX ) continue;
+
+    // edge i runs from vertex i to the next, positive inside for either winding
+
+    const auto sign = area > 0 ? 1.f : -1.f;
+
+    float a[3], b[3], c[3];
+
+    for ( int i = 0; i < 3; ++i ) {
+      const auto j = ( i + 1 ) % 3;
+      a[i] = -( t.y[j] - t.y[i] ) * sign;
+      b[i] = ( t.x[j] - t.x[i] ) * sign;
+      c[i] = -( a[i] * t.x[i] + b[i] * t.y[i] );
+    }
+
+    // depth plane z = dzdx * x + dzdy * y + z0
+
+    const auto dzdx = ( ( t.z[1] - t.z[0] ) * ( t.y[2] - t.y[0] ) - ( t.z[2] - t.z[0] ) * ( t.y[1] - t.y[0] ) ) / area;
+    const auto dzdy = ( ( t.x[1] - t.x[0] ) * ( t.z[2] - t.z[0] ) - ( t.x[2] - t.x[0] ) * ( t.z[1] - t.z[0] ) ) / area;
+    const auto z0 = t.z[0] - dzdx * t.x[0] - dzdy * t.y[0] + 0.5f * ( std::abs( dzdx ) + std::abs( dzdy ) );
+
+    for ( auto y = minY; y < maxY; ++y ) {
+
+      const auto cy = y + 0.5f;
+
+      const auto r0 = b[0] * cy + c[0];
+      const auto r1 = b[1] * cy + c[1];
+      const auto r2 = b[2] * cy + c[2];
+      const auto rz = dzdy * cy + z0;
+
+      const auto row = &_depth[ y * _width ];
+
+      auto x = minX;
+
+#if defined(__SSE2__)
+
+      const auto zero = _mm_setzero_ps();
+      const auto offsets = _mm_set_ps( 3.5f, 2.5f, 1.5f, 0.5f );
+
+      for ( ; x + 4 <= maxX; x += 4 ) {
+
+        const auto cx = _mm_add_ps( _mm_set1_ps( ( float )x ), offsets );
+
+        const auto e0 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( a[0] ), cx ), _mm_set1_ps( r0 ) );
+        const auto e1 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( a[1] ), cx ), _mm_set1_ps( r1 ) );
+        const auto e2 = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( a[2] ), cx ), _mm_set1_ps( r2 ) );
+
+        const auto covered = _mm_and_ps( _mm_and_ps( _mm_cmpge_ps( e0, zero ), _mm_cmpge_ps( e1, zero ) ),
+                                         _mm_cmpge_ps( e2, zero ) );
+
+        const auto depth = _mm_add_ps( _mm_mul_ps( _mm_set1_ps( dzdx ), cx ), _mm_set1_ps( rz ) );
+        const auto z = _mm_or_ps( _mm_and_ps( covered, depth ), _mm_andnot_ps( covered, _mm_set1_ps( farthest ) ) );
+
+        _mm_storeu_ps( row + x, _mm_min_ps( _mm_loadu_ps( row + x ), z ) );
+
+      }
+
+#endif
+
+      for ( ; x < maxX; ++x ) {
+
+        const auto cx = x + 0.5f;
+
+        const bool covered = ( a[0] * cx + r0 >= 0.f ) & ( a[1] * cx + r1 >= 0.f ) & ( a[2] * cx + r2 >= 0.f );
+        const auto z = covered ? dzdx * cx + rz : farthest;
+
+        row[ x ] = std::min( row[ x ], z );
+
+      }
+
+    }
+
+  }
+
+}
+
+bool OcclusionBuffer::occludes( const Sphere& sphere ) const {
+
+  // screen bounds of the sphere's bounding box; anything reaching past the
+  // near plane or off screen is left to the frustum test
+
+  auto minX = farthest, minY = farthest, minZ = farthest;
+  auto maxX = -farthest, maxY = -farthest;
+
+  for ( int i = 0; i < 8; ++i ) {
+
+    const auto x = sphere.center.x + ( i & 1 ? sphere.radius : -sphere.radius );
+    const auto y = sphere.center.y + ( i & 2 ? sphere.radius : -sphere.radius );
+    const auto z = sphere.center.z + ( i & 4 ? sphere.radius : -sphere.radius );
+
+    float px, py, pz;
+    if ( ! project( _viewProjection, x, y, z, px, py, pz ) || pz < -1.f ) return false;
+
+    minX = std::min( minX, px );
+    maxX = std::max( maxX, px );
+    minY = std::min( minY, py );
+    maxY = std::max( maxY, py );
+    minZ = std::min( minZ, pz );
+
+  }
+
+  const auto x0 = clampToInt( std::floor( ( minX + 1.f ) * 0.5f * _width ), 0, _width );
+  const auto x1 = clampToInt( std::ceil( ( maxX + 1.f ) * 0.5f * _width ), 0, _width );
+  const auto y0 = clampToInt( std::floor( ( minY + 1.f ) * 0.5f * _height ), 0, _height );
+  const auto y1 = clampToInt( std::ceil( ( maxY + 1.f ) * 0.5f * _height ), 0, _height );
+
+  if ( x0 >= x1 || y0 >= y1 ) return false;
+
+  for ( auto ty = y0 / tileSize; ty * tileSize < y1; ++ty ) {
+    for ( auto tx = x0 / tileSize; tx * tileSize < x1; ++tx ) {
+
+      if ( _tileDepth[ ty * _tilesX + tx ] < minZ ) continue;
+
+      // the tile has something at or behind the object, look at its pixels
+
+      const auto px1 = std::min( ( tx + 1 ) * tileSize, x1 );
+      const auto py1 = std::min( ( ty + 1 ) * tileSize, y1 );
+
+      for ( auto y = std::max( ty * tileSize, y0 ); y < py1; ++y ) {
+        for ( auto x = std::max( tx * tileSize, x0 ); x < px1; ++x ) {
+          if ( _depth[ y * _width + x ] >= minZ ) return false;
+        }
+      }
+
+    }
+  }
+
+  return true;
+
+}
+
+bool OcclusionBuffer::occludes( const Object3D& object ) const {
+
+  if ( ! object.geometry ) return false;
+
+  return occludes( object.worldBoundingSphere() );
+
+}
+
+} // namespace three
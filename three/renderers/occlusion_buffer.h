@@ -0,0 +1,78 @@
+#ifndef THREE_OCCLUSION_BUFFER_H
+#define THREE_OCCLUSION_BUFFER_H
+
+#include <three/common.h>
+
+#include <three/core/task_scheduler.h>
+#include <three/math/matrix4.h>
+#include <three/math/sphere.h>
+#include <three/utils/noncopyable.h>
+
+#include <vector>
+
+namespace three {
+
+// A small depth buffer that occluder meshes are rasterized into on the CPU,
+// for rejecting objects hidden behind them before they are drawn. A pixel
+// whose center an occluder covers takes the farthest depth the occluder has
+// within it, and an object is only hidden if every pixel under its projected
+// bounds holds something nearer than its nearest point. Depths are NDC z,
+// and each tileSize square of pixels also keeps its farthest depth so that
+// most tests can stop at the tiles.
+
+class THREE_DECL OcclusionBuffer : NonCopyable {
+public:
+
+  static const int tileSize = 8;
+
+  explicit OcclusionBuffer( int width = 256, int height = 128 );
+
+  int width() const { return _width; }
+  int height() const { return _height; }
+
+  // Starts over for a view through `viewProjection`
+  void clear( const Matrix4& viewProjection );
+
+  // Queues the faces of `object`'s Geometry for rasterize(). Triangles that
+  // reach past the near or far plane are left out, as the GPU clips them.
+  void addOccluder( const Object3D& object );
+
+  size_t triangleCount() const { return _triangles.size(); }
+
+  // Draws the queued triangles, in bands of rows run on `scheduler`
+  void rasterize( TaskScheduler* scheduler = nullptr );
+
+  // True if the world space `sphere` is hidden everywhere on screen
+  bool occludes( const Sphere& sphere ) const;
+
+  // Tests the bounding sphere of `object`'s geometry
+  bool occludes( const Object3D& object ) const;
+
+  float depth( int x, int y ) const { return _depth[ y * _width + x ]; }
+
+private:
+
+  struct Triangle {
+    float x[ 3 ];
+    float y[ 3 ];
+    float z[ 3 ];
+  };
+
+  void rasterizeRows( int first, int last );
+
+  int _width;
+  int _height;
+  int _tilesX;
+  int _tilesY;
+
+  Matrix4 _viewProjection;
+
+  std::vector<Triangle> _triangles;
+  std::vector<float> _depth;
+  std::vector<float> _tileDepth;
+
+};
+
+} // namespace three
+
+#endif // THREE_OCCLUSION_BUFFER_H
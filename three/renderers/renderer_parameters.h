@@ -4,8 +4,12 @@
 #include <three/common.h>
 #include <three/constants.h>
 
+#include <three/core/task_scheduler.h>
 #include <three/math/color.h>
 
+#include <cstddef>
+#include <string>
+
 namespace three {
 
 struct RendererParameters {
@@ -20,7 +24,11 @@ struct RendererParameters {
       preserveDrawingBuffer( false ),
       clearColor( 0 ),
       clearAlpha( 0 ),
-      maxLights( 4 ) { }
+      maxLights( 4 ),
+      uniformBlocks( false ),
+      uintIndices( true ),
+      streamBufferSize( 4 * 1024 * 1024 ),
+      workerThreads( -1 ) { }
 
   int width, height;
   bool vsync;
@@ -33,6 +41,23 @@ struct RendererParameters {
   Color clearColor;
   float clearAlpha;
   int maxLights;
+  // share camera, lights and fog uniforms between programs through
+  // uniform buffer objects (GL 3.1+, ignored when unsupported)
+  bool uniformBlocks;
+  // draw geometry groups of more than 65535 vertices with 32-bit indices
+  // rather than splitting them (ignored when unsupported)
+  bool uintIndices;
+  // directory for linked program binaries, reused across runs (empty to disable)
+  std::string programCacheDirectory;
+  // bytes of the ring buffer that immediate objects and dynamic geometry
+  // stream through (GL 3.1+, 0 to upload with glBufferData instead)
+  std::size_t streamBufferSize;
+  // threads that pack vertex buffers, cull and record the render list next
+  // to the GL thread (-1 to share TaskScheduler::shared(), 0 to do it all
+  // on the GL thread)
+  int workerThreads;
+  // workers to use instead, ignoring workerThreads
+  TaskScheduler::Ptr scheduler;
 };
 
 } // namespace three
@@ -6,7 +6,7 @@ namespace three {
     const char* ShaderChunk::fog_pars_fragment() {
         return
 
-        "#ifdef USE_FOG\n"
+        "#if defined( USE_FOG ) && ! defined( USE_UNIFORM_BLOCKS )\n"
 
         "uniform vec3 fogColor;\n"
 
@@ -150,22 +150,30 @@ namespace three {
 
         "#ifdef USE_SKINNING\n"
 
-        "vec4 worldPosition = modelMatrix * skinned;\n"
+        "vec4 worldPosition = skinned;\n"
 
         "#endif\n"
 
         "#if defined( USE_MORPHTARGETS ) && ! defined( USE_SKINNING )\n"
 
-        "vec4 worldPosition = modelMatrix * vec4( morphed, 1.0 );\n"
+        "vec4 worldPosition = vec4( morphed, 1.0 );\n"
 
         "#endif\n"
 
         "#if ! defined( USE_MORPHTARGETS ) && ! defined( USE_SKINNING )\n"
 
-        "vec4 worldPosition = modelMatrix * vec4( position, 1.0 );\n"
+        "vec4 worldPosition = vec4( position, 1.0 );\n"
+
+        "#endif\n"
+
+        "#ifdef USE_INSTANCING\n"
+
+        "worldPosition = instanceMatrix * worldPosition;\n"
 
         "#endif\n"
 
+        "worldPosition = modelMatrix * worldPosition;\n"
+
         "#endif\n";
     }
     const char* ShaderChunk::envmap_vertex () {
@@ -417,6 +425,8 @@ namespace three {
         "uniform vec3 diffuse;\n"
         "uniform vec3 emissive;\n"
 
+        "#ifndef USE_UNIFORM_BLOCKS\n"
+
         "uniform vec3 ambientLightColor;\n"
 
         "#if MAX_DIR_LIGHTS > 0\n"
@@ -453,6 +463,8 @@ namespace three {
 
         "#endif\n"
 
+        "#endif\n"
+
         "#ifdef WRAP_AROUND\n"
 
         "uniform vec3 wrapRGB;\n"
@@ -674,18 +686,26 @@ namespace three {
 
         "#if MAX_POINT_LIGHTS > 0\n"
 
+        "#ifndef USE_UNIFORM_BLOCKS\n"
+
         "uniform vec3 pointLightPosition[ MAX_POINT_LIGHTS ];\n"
         "uniform float pointLightDistance[ MAX_POINT_LIGHTS ];\n"
 
+        "#endif\n"
+
         "varying vec4 vPointLight[ MAX_POINT_LIGHTS ];\n"
 
         "#endif\n"
 
         "#if MAX_SPOT_LIGHTS > 0\n"
 
+        "#ifndef USE_UNIFORM_BLOCKS\n"
+
         "uniform vec3 spotLightPosition[ MAX_SPOT_LIGHTS ];\n"
         "uniform float spotLightDistance[ MAX_SPOT_LIGHTS ];\n"
 
+        "#endif\n"
+
         "varying vec4 vSpotLight[ MAX_SPOT_LIGHTS ];\n"
 
         "#endif\n"
@@ -748,6 +768,8 @@ namespace three {
     const char* ShaderChunk::lights_phong_pars_fragment() {
         return
 
+        "#ifndef USE_UNIFORM_BLOCKS\n"
+
         "uniform vec3 ambientLightColor;\n"
 
         "#if MAX_DIR_LIGHTS > 0\n"
@@ -774,10 +796,6 @@ namespace three {
         "uniform vec3 pointLightPosition[ MAX_POINT_LIGHTS ];\n"
         "uniform float pointLightDistance[ MAX_POINT_LIGHTS ];\n"
 
-        "#else\n"
-
-        "varying vec4 vPointLight[ MAX_POINT_LIGHTS ];\n"
-
         "#endif\n"
 
         "#endif\n"
@@ -794,7 +812,21 @@ namespace three {
 
         "uniform float spotLightDistance[ MAX_SPOT_LIGHTS ];\n"
 
-        "#else\n"
+        "#endif\n"
+
+        "#endif\n"
+
+        "#endif\n"
+
+        "#ifndef PHONG_PER_PIXEL\n"
+
+        "#if MAX_POINT_LIGHTS > 0\n"
+
+        "varying vec4 vPointLight[ MAX_POINT_LIGHTS ];\n"
+
+        "#endif\n"
+
+        "#if MAX_SPOT_LIGHTS > 0\n"
 
         "varying vec4 vSpotLight[ MAX_SPOT_LIGHTS ];\n"
 
@@ -1098,7 +1130,7 @@ namespace three {
     const char* ShaderChunk::color_pars_fragment() {
         return
 
-        "#ifdef USE_COLOR\n"
+        "#if defined( USE_COLOR ) || defined( USE_INSTANCING_COLOR )\n"
 
         "varying vec3 vColor;\n"
 
@@ -1107,7 +1139,7 @@ namespace three {
     const char* ShaderChunk::color_fragment() {
         return
 
-        "#ifdef USE_COLOR\n"
+        "#if defined( USE_COLOR ) || defined( USE_INSTANCING_COLOR )\n"
 
         "gl_FragColor = gl_FragColor * vec4( vColor, 1.0 );\n"
 
@@ -1116,7 +1148,7 @@ namespace three {
     const char* ShaderChunk::color_pars_vertex() {
         return
 
-        "#ifdef USE_COLOR\n"
+        "#if defined( USE_COLOR ) || defined( USE_INSTANCING_COLOR )\n"
 
         "varying vec3 vColor;\n"
 
@@ -1125,15 +1157,35 @@ namespace three {
     const char* ShaderChunk::color_vertex() {
         return
 
+        "#if defined( USE_COLOR ) || defined( USE_INSTANCING_COLOR )\n"
+
+        "vColor = vec3( 1.0 );\n"
+
+        "#endif\n"
+
         "#ifdef USE_COLOR\n"
 
         "#ifdef GAMMA_INPUT\n"
 
-        "vColor = color * color;\n"
+        "vColor *= color * color;\n"
 
         "#else\n"
 
-        "vColor = color;\n"
+        "vColor *= color;\n"
+
+        "#endif\n"
+
+        "#endif\n"
+
+        "#ifdef USE_INSTANCING_COLOR\n"
+
+        "#ifdef GAMMA_INPUT\n"
+
+        "vColor *= instanceColor * instanceColor;\n"
+
+        "#else\n"
+
+        "vColor *= instanceColor;\n"
 
         "#endif\n"
 
@@ -1269,22 +1321,30 @@ namespace three {
 
         "#ifdef USE_SKINNING\n"
 
-        "mvPosition = modelViewMatrix * skinned;\n"
+        "mvPosition = skinned;\n"
 
         "#endif\n"
 
         "#if !defined( USE_SKINNING ) && defined( USE_MORPHTARGETS )\n"
 
-        "mvPosition = modelViewMatrix * vec4( morphed, 1.0 );\n"
+        "mvPosition = vec4( morphed, 1.0 );\n"
 
         "#endif\n"
 
         "#if !defined( USE_SKINNING ) && ! defined( USE_MORPHTARGETS )\n"
 
-        "mvPosition = modelViewMatrix * vec4( position, 1.0 );\n"
+        "mvPosition = vec4( position, 1.0 );\n"
+
+        "#endif\n"
+
+        "#ifdef USE_INSTANCING\n"
+
+        "mvPosition = instanceMatrix * mvPosition;\n"
 
         "#endif\n"
 
+        "mvPosition = modelViewMatrix * mvPosition;\n"
+
         "gl_Position = projectionMatrix * mvPosition;";
 
     }
@@ -1353,6 +1413,14 @@ namespace three {
 
         "#endif\n"
 
+        // instance transforms are expected to be uniformly scaled
+
+        "#ifdef USE_INSTANCING\n"
+
+        "objectNormal = mat3( instanceMatrix[ 0 ].xyz, instanceMatrix[ 1 ].xyz, instanceMatrix[ 2 ].xyz ) * objectNormal;\n"
+
+        "#endif\n"
+
         "vec3 transformedNormal = normalMatrix * objectNormal;";
 
     }
@@ -1655,4 +1723,70 @@ namespace three {
         "#endif\n";
     }
 
+    // UNIFORM BLOCKS
+    // std140 layouts shared by every program; light arrays are sized
+    // renderer-wide by MAX_BLOCK_LIGHTS so all programs see one layout
+    const char* ShaderChunk::camera_block_pars() {
+        return
+
+        "#ifdef USE_UNIFORM_BLOCKS\n"
+
+        "layout(std140) uniform CameraBlock {\n"
+
+        "mat4 projectionMatrix;\n"
+        "mat4 viewMatrix;\n"
+        "vec3 cameraPosition;\n"
+
+        "};\n"
+
+        "#endif\n";
+    }
+    const char* ShaderChunk::lights_block_pars() {
+        return
+
+        "#ifdef USE_UNIFORM_BLOCKS\n"
+
+        "layout(std140) uniform LightsBlock {\n"
+
+        "vec3 ambientLightColor;\n"
+
+        "vec3 directionalLightColor[ MAX_BLOCK_LIGHTS ];\n"
+        "vec3 directionalLightDirection[ MAX_BLOCK_LIGHTS ];\n"
+
+        "vec3 hemisphereLightSkyColor[ MAX_BLOCK_LIGHTS ];\n"
+        "vec3 hemisphereLightGroundColor[ MAX_BLOCK_LIGHTS ];\n"
+        "vec3 hemisphereLightDirection[ MAX_BLOCK_LIGHTS ];\n"
+
+        "vec3 pointLightColor[ MAX_BLOCK_LIGHTS ];\n"
+        "vec3 pointLightPosition[ MAX_BLOCK_LIGHTS ];\n"
+        "float pointLightDistance[ MAX_BLOCK_LIGHTS ];\n"
+
+        "vec3 spotLightColor[ MAX_BLOCK_LIGHTS ];\n"
+        "vec3 spotLightPosition[ MAX_BLOCK_LIGHTS ];\n"
+        "vec3 spotLightDirection[ MAX_BLOCK_LIGHTS ];\n"
+        "float spotLightDistance[ MAX_BLOCK_LIGHTS ];\n"
+        "float spotLightAngleCos[ MAX_BLOCK_LIGHTS ];\n"
+        "float spotLightExponent[ MAX_BLOCK_LIGHTS ];\n"
+
+        "};\n"
+
+        "#endif\n";
+    }
+    const char* ShaderChunk::fog_block_pars() {
+        return
+
+        "#ifdef USE_UNIFORM_BLOCKS\n"
+
+        "layout(std140) uniform FogBlock {\n"
+
+        "vec3 fogColor;\n"
+        "float fogNear;\n"
+        "float fogFar;\n"
+        "float fogDensity;\n"
+
+        "};\n"
+
+        "#endif\n";
+    }
+
 } // namespace three
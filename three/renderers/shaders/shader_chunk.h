@@ -73,6 +73,10 @@ public:
 
   static const char* linear_to_gamma_fragment();
 
+  static const char* camera_block_pars();
+  static const char* lights_block_pars();
+  static const char* fog_block_pars();
+
 };
 
 } // namespace three
@@ -18,7 +18,13 @@ Scene::Scene()
     autoUpdate( true ),
     matrixAutoUpdate( false ) { }
 
-Scene::~Scene() { }
+Scene::~Scene() {
+
+  // the objects may outlive the scene and join another one
+
+  for ( auto object : __objects ) object->__boundsProxy = AABBTree::nullNode;
+
+}
 
 namespace detail {
 
@@ -77,6 +83,10 @@ struct Remove : public FallbackVisitor {
       s.__objectsRemoved.push_back( object );
       erase( s.__objectsAdded, object );
     }
+    if ( o.__boundsProxy != AABBTree::nullNode ) {
+      s.__boundsTree.remove( o.__boundsProxy );
+      o.__boundsProxy = AABBTree::nullNode;
+    }
   }
 
   void operator()( Light& light ) {
@@ -94,6 +104,26 @@ struct Remove : public FallbackVisitor {
   const Object3D::Ptr& object;
 };
 
+// The box around the world bounding sphere of `object`'s geometry, false
+// for objects without one. Instanced meshes reach beyond their geometry
+// and are left out.
+bool worldBounds( Object3D& object, Box3& box ) {
+
+  auto& geometry = object.geometry;
+
+  if ( ! geometry || object.type() == THREE::InstancedMesh ) return false;
+
+  const auto& sphere = object.worldBoundingSphere();
+
+  const Vector3 extent( sphere.radius, sphere.radius, sphere.radius );
+
+  box.min.subVectors( sphere.center, extent );
+  box.max.addVectors( sphere.center, extent );
+
+  return true;
+
+}
+
 } // namespace detail
 
 void Scene::__addObject( const Object3D::Ptr& object ) {
@@ -124,6 +154,37 @@ void Scene::__removeObject( const Object3D::Ptr& object ) {
   }
 }
 
+void Scene::updateBounds() {
+
+  TransformStore::instance().takeMoved( __transformSlot, __boundsChanged );
+
+  Box3 box;
+
+  for ( auto object : __boundsChanged ) {
+
+    auto& proxy = object->__boundsProxy;
+
+    if ( detail::worldBounds( *object, box ) ) {
+
+      if ( proxy == AABBTree::nullNode ) {
+        proxy = __boundsTree.insert( box, object );
+      } else {
+        __boundsTree.move( proxy, box );
+      }
+
+    } else if ( proxy != AABBTree::nullNode ) {
+
+      __boundsTree.remove( proxy );
+      proxy = AABBTree::nullNode;
+
+    }
+
+  }
+
+  __boundsChanged.clear();
+
+}
+
 void Scene::__clone( Object3D::Ptr& cloned, bool recursive ) const {
 
   if ( !cloned ) cloned = create();
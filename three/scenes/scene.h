@@ -3,10 +3,13 @@
 
 #include <three/common.h>
 
+#include <three/core/aabb_tree.h>
 #include <three/core/object3d.h>
 
 #include <three/renderers/renderables/renderable_object.h>
 
+#include <cstdint>
+
 namespace three {
 
 class THREE_DECL Scene : public Object3D {
@@ -45,12 +48,15 @@ public:
         buffer( buffer ),
         render( render ),
         opaque( opaque ),
-        transparent( transparent ) { }
+        transparent( transparent ),
+        sortKey( 0 ) { }
     unsigned int id;
     GeometryBuffer* buffer;
     bool render;
     Material* opaque;
     Material* transparent;
+    // Packed render order, see GLRenderer::render
+    std::uint64_t sortKey;
   };
 
   std::vector<GLObject>  __glObjects;
@@ -60,6 +66,21 @@ public:
 
   std::vector<Object3D*> __objects;
 
+  // World bounds of the objects with a geometry, for frustum culling and
+  // ray casting. Refitted by updateBounds().
+  AABBTree __boundsTree;
+
+  // Objects whose bounds changed other than by moving, for the next
+  // updateBounds. GLRenderer::render adds those whose geometry changed,
+  // right before the call.
+  std::vector<Object3D*> __boundsChanged;
+
+  // Refits __boundsTree to the objects whose matrixWorld changed since the
+  // last call, as the TransformStore logs them, and to __boundsChanged.
+  // Objects that neither moved nor changed keep their leaves untouched.
+  // Called by GLRenderer::render after the scene graph has been updated.
+  void updateBounds();
+
 protected:
 
   Scene();
@@ -12,6 +12,7 @@
 #include <three/core/geometry_buffer.h>
 #include <three/core/geometry_group.h>
 #include <three/core/clock.h>
+#include <three/core/task_scheduler.h>
 #include <three/core/object3d.h>
 #include <three/core/projector.h>
 #include <three/core/raycaster.h>
@@ -207,8 +207,8 @@ public:
   template<typename T>
   const T& cast() const {
     if (policy->type() != typeid(T)) throw detail::bad_any_cast();
-    void* obj = const_cast<void*>(object);
-    T* r = reinterpret_cast<T*>(policy->get_value(&obj));
+    // small values live in `object` itself, so point into it rather than a copy
+    const T* r = reinterpret_cast<const T*>(policy->get_value(&object));
     return *r;
   }
 
@@ -0,0 +1,76 @@
+#ifndef THREE_DIRTY_RANGES_H
+#define THREE_DIRTY_RANGES_H
+
+#include <algorithm>
+#include <vector>
+
+namespace three {
+
+// Index ranges [first, first + count) that changed since the last upload.
+// merge() sorts them and joins overlapping or adjacent ones, after which
+// contains() can be queried.
+
+class DirtyRanges {
+public:
+
+  struct Range {
+    int first, count;
+    int end() const { return first + count; }
+  };
+
+  void add( int first, int count ) {
+    if ( count <= 0 ) return;
+    _ranges.push_back( Range{ std::max( first, 0 ), count } );
+    _merged = false;
+  }
+
+  bool empty() const { return _ranges.empty(); }
+
+  void clear() {
+    _ranges.clear();
+    _merged = true;
+  }
+
+  const std::vector<Range>& merge() {
+
+    if ( _merged ) return _ranges;
+
+    std::sort( _ranges.begin(), _ranges.end(), []( const Range& a, const Range& b ) {
+      return a.first < b.first;
+    } );
+
+    size_t last = 0;
+
+    for ( size_t i = 1; i < _ranges.size(); ++i ) {
+      if ( _ranges[ i ].first <= _ranges[ last ].end() ) {
+        _ranges[ last ].count = std::max( _ranges[ last ].end(), _ranges[ i ].end() ) - _ranges[ last ].first;
+      } else {
+        _ranges[ ++last ] = _ranges[ i ];
+      }
+    }
+
+    _ranges.resize( last + 1 );
+    _merged = true;
+
+    return _ranges;
+
+  }
+
+  // Only valid after merge()
+  bool contains( int index ) const {
+    auto it = std::upper_bound( _ranges.begin(), _ranges.end(), index, []( int i, const Range& r ) {
+      return i < r.first;
+    } );
+    return it != _ranges.begin() && index < ( it - 1 )->end();
+  }
+
+private:
+
+  std::vector<Range> _ranges;
+  bool _merged = true;
+
+};
+
+} // namespace three
+
+#endif // THREE_DIRTY_RANGES_H
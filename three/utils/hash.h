@@ -1,6 +1,7 @@
 #ifndef THREE_HASH_H
 #define THREE_HASH_H
 
+#include <cstddef>
 #include <cstdint>
 
 namespace three {
@@ -69,6 +70,22 @@ static unsigned jenkins_hash(const T& value, unsigned initval = 0) {
 #undef JENKINS_MIX
 #undef JENKINS_32
 
+// 64-bit FNV-1a. Pass a previous result as `hash` to hash data incrementally.
+
+static const std::uint64_t fnv1a_offset = 14695981039346656037ULL;
+
+inline std::uint64_t fnv1a_hash( const void* data, std::size_t size, std::uint64_t hash = fnv1a_offset ) {
+
+  const auto bytes = static_cast<const unsigned char*>( data );
+
+  for ( std::size_t i = 0; i < size; ++i ) {
+    hash ^= bytes[ i ];
+    hash *= 1099511628211ULL;
+  }
+
+  return hash;
+}
+
 }
 
 #endif // THREE_HASH_H
\ No newline at end of file
@@ -0,0 +1,71 @@
+#ifndef THREE_RADIX_SORT_H
+#define THREE_RADIX_SORT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace three {
+
+// Stable LSD radix sort on a 64-bit key, one byte per pass.
+// Passes where every key shares the same byte are skipped, so keys that
+// only use their high or low bits cost fewer passes.
+// `scratch` is resized as needed and can be reused across calls.
+
+template < typename T, typename KeyFunc >
+void radixSort( std::vector<T>& items, std::vector<T>& scratch, KeyFunc key ) {
+
+  const auto count = items.size();
+
+  if ( count < 2 ) return;
+
+  scratch.resize( count );
+
+  std::size_t histograms[ 8 ][ 256 ] = {};
+
+  for ( const auto& item : items ) {
+
+    const std::uint64_t k = key( item );
+
+    for ( int pass = 0; pass < 8; ++pass ) {
+      ++histograms[ pass ][ ( k >> ( pass * 8 ) ) & 0xff ];
+    }
+
+  }
+
+  auto* src = &items;
+  auto* dst = &scratch;
+
+  for ( int pass = 0; pass < 8; ++pass ) {
+
+    auto& histogram = histograms[ pass ];
+    const int shift = pass * 8;
+
+    if ( histogram[ ( key( ( *src )[ 0 ] ) >> shift ) & 0xff ] == count ) continue;
+
+    std::size_t offsets[ 256 ];
+    std::size_t sum = 0;
+
+    for ( int i = 0; i < 256; ++i ) {
+      offsets[ i ] = sum;
+      sum += histogram[ i ];
+    }
+
+    for ( auto& item : *src ) {
+      ( *dst )[ offsets[ ( key( item ) >> shift ) & 0xff ]++ ] = std::move( item );
+    }
+
+    std::swap( src, dst );
+
+  }
+
+  if ( src != &items ) {
+    items.swap( scratch );
+  }
+
+}
+
+} // namespace three
+
+#endif // THREE_RADIX_SORT_H
@@ -0,0 +1,195 @@
+#ifndef THREE_VERTEX_ENCODING_H
+#define THREE_VERTEX_ENCODING_H
+
+#include <three/constants.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace three {
+
+// IEEE half precision, rounded to nearest even
+inline std::uint16_t toHalfFloat( float value ) {
+
+  std::uint32_t bits;
+  std::memcpy( &bits, &value, sizeof( bits ) );
+
+  const std::uint32_t sign = ( bits >> 16 ) & 0x8000;
+  const int exponent = ( int )( ( bits >> 23 ) & 0xff ) - 127 + 15;
+  std::uint32_t mantissa = bits & 0x7fffff;
+
+  if ( exponent == 0xff - 127 + 15 ) {
+    return ( std::uint16_t )( sign | 0x7c00 | ( mantissa ? 0x200 : 0 ) );
+  }
+
+  if ( exponent >= 0x1f ) {
+    return ( std::uint16_t )( sign | 0x7c00 );
+  }
+
+  if ( exponent <= 0 ) {
+
+    // denormal, or too small for one
+
+    if ( exponent < -10 ) return ( std::uint16_t )sign;
+
+    mantissa |= 0x800000;
+
+    const int shift = 14 - exponent;
+    std::uint32_t half = mantissa >> shift;
+    const std::uint32_t rest = mantissa & ( ( 1u << shift ) - 1 );
+    const std::uint32_t halfway = 1u << ( shift - 1 );
+
+    if ( rest > halfway || ( rest == halfway && ( half & 1 ) ) ) ++ half;
+
+    return ( std::uint16_t )( sign | half );
+
+  }
+
+  // rounding may carry into the exponent, up to infinity
+
+  std::uint32_t half = ( ( std::uint32_t )exponent << 10 ) | ( mantissa >> 13 );
+  const std::uint32_t rest = mantissa & 0x1fff;
+
+  if ( rest > 0x1000 || ( rest == 0x1000 && ( half & 1 ) ) ) ++ half;
+
+  return ( std::uint16_t )( sign | half );
+
+}
+
+// Four signed normalized components, x in the low bits (GL_INT_2_10_10_10_REV)
+inline std::uint32_t packInt2101010( float x, float y, float z, float w ) {
+
+  auto component = []( float value, int bits ) -> std::uint32_t {
+    const auto max = ( float )( ( 1 << ( bits - 1 ) ) - 1 );
+    const auto clamped = std::min( std::max( value, -1.f ), 1.f );
+    return ( std::uint32_t )( int )std::lround( clamped * max ) & ( ( 1u << bits ) - 1 );
+  };
+
+  return component( x, 10 ) | component( y, 10 ) << 10 | component( z, 10 ) << 20 | component( w, 2 ) << 30;
+
+}
+
+// How an attribute's floats are stored in its vertex buffer. Items are
+// padded to four bytes, so size() rather than the component count gives
+// the stride. Components an encoding cannot hold are clamped: [-1, 1] for
+// Int2101010VertexFormat, [0, 1] after `( value - offset ) / scale` for the
+// normalized integer formats.
+
+struct VertexEncoding {
+
+  explicit VertexEncoding( THREE::VertexFormat format = THREE::FloatVertexFormat, int itemSize = 1 )
+    : format( format ), itemSize( itemSize ), normalized( true ), offset(), scale() {
+    std::fill( scale, scale + 4, 1.f );
+  }
+
+  THREE::VertexFormat format;
+  int itemSize;
+
+  // 8-bit values are scaled from [0, 1] unless this is false, for values
+  // that are integers already
+  bool normalized;
+
+  float offset[ 4 ];
+  float scale[ 4 ];
+
+  // Bytes per item
+  size_t size() const {
+
+    switch ( format ) {
+    case THREE::HalfFloatVertexFormat:
+    case THREE::UnsignedShortVertexFormat:
+      return ( 2 * itemSize + 3 ) & ~3;
+    case THREE::Int2101010VertexFormat:
+      return 4;
+    case THREE::UnsignedByteVertexFormat:
+      return ( itemSize + 3 ) & ~3;
+    default:
+      return 4 * itemSize;
+    }
+
+  }
+
+  // Sets offset and scale to the bounds of `count` items
+  void fit( const float* src, size_t count ) {
+
+    for ( int c = 0; c < itemSize && c < 4; ++ c ) {
+
+      auto min = std::numeric_limits<float>::max();
+      auto max = std::numeric_limits<float>::lowest();
+
+      for ( size_t i = 0; i < count; ++ i ) {
+        min = std::min( min, src[ i * itemSize + c ] );
+        max = std::max( max, src[ i * itemSize + c ] );
+      }
+
+      offset[ c ] = count ? min : 0.f;
+      scale[ c ] = count && max > min ? max - min : 1.f;
+
+    }
+
+  }
+
+  // Writes `count` items of `src` to `dst`, which holds count * size() bytes
+  void encode( const float* src, size_t count, unsigned char* dst ) const {
+
+    const auto stride = size();
+
+    std::memset( dst, 0, count * stride );
+
+    for ( size_t i = 0; i < count; ++ i, src += itemSize, dst += stride ) {
+
+      switch ( format ) {
+
+      case THREE::HalfFloatVertexFormat:
+        for ( int c = 0; c < itemSize; ++ c ) {
+          const auto half = toHalfFloat( src[ c ] );
+          std::memcpy( dst + c * 2, &half, 2 );
+        }
+        break;
+
+      case THREE::Int2101010VertexFormat: {
+        float v[ 4 ] = { 0, 0, 0, 0 };
+        std::copy( src, src + std::min( itemSize, 4 ), v );
+        const auto packed = packInt2101010( v[ 0 ], v[ 1 ], v[ 2 ], v[ 3 ] );
+        std::memcpy( dst, &packed, 4 );
+      } break;
+
+      case THREE::UnsignedShortVertexFormat:
+        for ( int c = 0; c < itemSize; ++ c ) {
+          const auto value = ( std::uint16_t )std::lround( unit( src[ c ], c ) * 65535.f );
+          std::memcpy( dst + c * 2, &value, 2 );
+        }
+        break;
+
+      case THREE::UnsignedByteVertexFormat:
+        for ( int c = 0; c < itemSize; ++ c ) {
+          dst[ c ] = normalized ? ( unsigned char )std::lround( unit( src[ c ], c ) * 255.f )
+                                : ( unsigned char )std::min( std::max( std::lround( src[ c ] ), 0L ), 255L );
+        }
+        break;
+
+      default:
+        std::memcpy( dst, src, itemSize * sizeof( float ) );
+        break;
+
+      }
+
+    }
+
+  }
+
+private:
+
+  float unit( float value, int component ) const {
+    const auto c = std::min( component, 3 );
+    return std::min( std::max( ( value - offset[ c ] ) / scale[ c ], 0.f ), 1.f );
+  }
+
+};
+
+} // namespace three
+
+#endif // THREE_VERTEX_ENCODING_H